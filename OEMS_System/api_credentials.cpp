@@ -1,38 +1,25 @@
 #include "api_credentials.h"
 
 #include <fstream>
-#include <iostream>
-#include <chrono>
-#include <iomanip>
-#include <sstream>
 #include <stdexcept>
 
+#include "binary_logger.h"
+
 namespace {
     // Constants
     constexpr size_t MAX_KEY_LENGTH = 128;
-    
-    // Helper function to get current timestamp for logging
-    std::string GetTimestamp() {
-        auto now = std::chrono::system_clock::now();
-        auto time = std::chrono::system_clock::to_time_t(now);
-        std::tm tm_time;
-        localtime_s(&tm_time, &time);
-        std::ostringstream ss;
-        ss << std::put_time(&tm_time, "%Y-%m-%d %H:%M:%S");
-        return ss.str();
-    }
 
-    // Helper function for logging
-    void LogMessage(const std::string& message, bool is_error = false) {
-        std::ostream& output = is_error ? std::cerr : std::cout;
-        output << "[" << GetTimestamp() << "] " << message << std::endl;
-    }
+    const LogFormat LOG_INITIALIZING{LogLevel::INFO, "[Credentials] Initializing API credentials..."};
+    const LogFormat LOG_INITIALIZED{LogLevel::INFO, "[Credentials] API credentials initialized successfully"};
+    const LogFormat LOG_INIT_FAILED{LogLevel::ERR, "[Credentials] Failed to initialize API credentials: {}"};
+    const LogFormat LOG_READ{LogLevel::INFO, "[Credentials] Successfully read credentials from: {}"};
+    const LogFormat LOG_READ_FAILED{LogLevel::ERR, "[Credentials] Error reading credential file: {}"};
 }
 
 ApiCredentials::ApiCredentials(const std::string& key_file_path, const std::string& secret_file_path)
 {
     try {
-        LogMessage("Initializing API credentials...");
+        BinaryLogger::Write(LOG_INITIALIZING);
         
         m_client_key = ReadFile(key_file_path);
         m_client_secret = ReadFile(secret_file_path);
@@ -46,10 +33,10 @@ ApiCredentials::ApiCredentials(const std::string& key_file_path, const std::stri
             throw std::runtime_error("API credentials exceed maximum allowed length");
         }
 
-        LogMessage("API credentials initialized successfully");
+        BinaryLogger::Write(LOG_INITIALIZED);
     }
     catch (const std::exception& e) {
-        LogMessage("Failed to initialize API credentials: " + std::string(e.what()), true);
+        BinaryLogger::Write(LOG_INIT_FAILED, e.what());
         throw;
     }
 }
@@ -86,11 +73,11 @@ std::string ApiCredentials::ReadFile(const std::string& file_path)
             throw std::runtime_error("Credential file is empty: " + file_path);
         }
 
-        LogMessage("Successfully read credentials from: " + file_path);
+        BinaryLogger::Write(LOG_READ, file_path);
         return content;
     }
     catch (const std::exception& e) {
-        LogMessage("Error reading credential file: " + std::string(e.what()), true);
+        BinaryLogger::Write(LOG_READ_FAILED, e.what());
         throw;
     }
 }
\ No newline at end of file
@@ -0,0 +1,896 @@
+// Microbenchmarks for the in-process hot paths. Nothing here touches the network, so results can be
+// compared run to run to catch regressions.
+//
+// Usage: oems_bench [--min-time-ms N] [--csv] [--enforce-budgets] [filter]
+// Latency budgets are reported as warnings; --enforce-budgets makes a run over budget exit with 2, for hosts
+// quiet and fast enough for the absolute numbers to mean something.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "binary_logger.h"
+#include "compact_order.h"
+#include "instrument_registry.h"
+#include "latency_recorder.h"
+#include "lz_block.h"
+#include "market_data_decoder.h"
+#include "market_data_recorder.h"
+#include "option_chain.h"
+#include "order_book.h"
+#include "order_store.h"
+#include "position_engine.h"
+#include "rate_limiter.h"
+#include "request_encoder.h"
+#include "risk_engine.h"
+#include "spsc_byte_ring.h"
+#include "strategy_thread.h"
+#include "ticker_feed.h"
+#include "token_manager.h"
+#include "utilities.h"
+#include "web_socket_client.h"
+
+namespace {
+    std::atomic<uint64_t> g_allocation_count{0};
+    volatile size_t g_sink = 0;
+
+    template<typename T>
+    void DoNotOptimize(const T& value)
+    {
+        g_sink = g_sink + static_cast<size_t>(value);
+    }
+}
+
+// Every allocation in the process is counted so each benchmark can report allocations per operation
+void* operator new(const size_t size)
+{
+    g_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size == 0 ? 1 : size))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](const size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace {
+    struct BenchmarkResult
+    {
+        std::string name;
+        uint64_t iterations;
+        double ns_per_op;
+        double allocs_per_op;
+        double ops_per_second;
+        double megabytes_per_second;  // 0 when the benchmark has no natural payload size
+        double budget_ns;             // 0 when the benchmark has no latency budget
+    };
+
+    class NullBuffer : public std::streambuf
+    {
+      protected:
+        int overflow(const int c) override { return c; }
+        std::streamsize xsputn(const char*, const std::streamsize count) override { return count; }
+    };
+
+    class BenchmarkRunner
+    {
+      private:
+        std::chrono::milliseconds m_min_time;
+        std::string m_filter;
+        std::vector<BenchmarkResult> m_results;
+
+        template<typename Body>
+        static double TimeIterations(Body& body, const uint64_t iterations)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (uint64_t i = 0; i < iterations; ++i)
+            {
+                body();
+            }
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        }
+
+      public:
+        BenchmarkRunner(const std::chrono::milliseconds min_time, std::string filter)
+            : m_min_time(min_time), m_filter(std::move(filter))
+        {
+        }
+
+        // Runs body until it has been timed for at least the minimum time; bytes_per_op feeds MB/s
+        template<typename Body>
+        void Run(const std::string_view name, const size_t bytes_per_op, Body&& body)
+        {
+            if (!m_filter.empty() && name.find(m_filter) == std::string_view::npos)
+            {
+                return;
+            }
+
+            // Grow the batch until it runs for a tenth of the target, then size the measured run from it
+            const double target_ns = std::chrono::duration<double, std::nano>(m_min_time).count();
+            uint64_t iterations = 1;
+            double elapsed_ns = TimeIterations(body, iterations);
+            while (elapsed_ns < target_ns / 10 && iterations < (uint64_t{1} << 40))
+            {
+                iterations *= 2;
+                elapsed_ns = TimeIterations(body, iterations);
+            }
+            iterations = std::max<uint64_t>(1, static_cast<uint64_t>(target_ns / std::max(elapsed_ns, 1.0) *
+                                                                     static_cast<double>(iterations)));
+
+            const uint64_t allocations_before = g_allocation_count.load(std::memory_order_relaxed);
+            elapsed_ns = TimeIterations(body, iterations);
+            const uint64_t allocations = g_allocation_count.load(std::memory_order_relaxed) - allocations_before;
+
+            const double ns_per_op = elapsed_ns / static_cast<double>(iterations);
+            const double ops_per_second = 1e9 / ns_per_op;
+            m_results.push_back({std::string(name), iterations, ns_per_op,
+                                 static_cast<double>(allocations) / static_cast<double>(iterations), ops_per_second,
+                                 static_cast<double>(bytes_per_op) * ops_per_second / 1e6, 0});
+        }
+
+        // Gives a benchmark that has already run a ns/op budget for ReportBudgets
+        void SetBudget(const std::string_view name, const double budget_ns)
+        {
+            for (auto& result : m_results)
+            {
+                if (result.name == name)
+                {
+                    result.budget_ns = budget_ns;
+                }
+            }
+        }
+
+        // Prints every benchmark that has a budget to stderr, warning about any that ran over; false if one did
+        bool ReportBudgets() const
+        {
+            bool is_within_budget = true;
+            for (const auto& result : m_results)
+            {
+                if (result.budget_ns <= 0)
+                {
+                    continue;
+                }
+                const bool is_over = result.ns_per_op > result.budget_ns;
+                std::fprintf(stderr, "%-40s %10.1f ns/op, budget %.0f ns: %s\n", result.name.c_str(),
+                             result.ns_per_op, result.budget_ns, is_over ? "warning: over budget" : "ok");
+                is_within_budget = is_within_budget && !is_over;
+            }
+            return is_within_budget;
+        }
+
+        void PrintResults(const bool as_csv) const
+        {
+            if (as_csv)
+            {
+                std::printf("benchmark,iterations,ns_per_op,allocs_per_op,ops_per_second,mb_per_second\n");
+                for (const auto& result : m_results)
+                {
+                    std::printf("%s,%llu,%.2f,%.3f,%.0f,%.2f\n", result.name.c_str(),
+                                static_cast<unsigned long long>(result.iterations), result.ns_per_op,
+                                result.allocs_per_op, result.ops_per_second, result.megabytes_per_second);
+                }
+                return;
+            }
+
+            std::printf("%-40s %12s %10s %10s %14s %10s\n", "benchmark", "iterations", "ns/op", "allocs/op",
+                        "ops/s", "MB/s");
+            for (const auto& result : m_results)
+            {
+                std::printf("%-40s %12llu %10.1f %10.2f %14.0f %10.1f\n", result.name.c_str(),
+                            static_cast<unsigned long long>(result.iterations), result.ns_per_op,
+                            result.allocs_per_op, result.ops_per_second, result.megabytes_per_second);
+            }
+        }
+    };
+
+    // Payloads in the shape Deribit sends them
+    constexpr std::string_view BUY_RESPONSE =
+        R"({"jsonrpc":"2.0","id":8,"result":{"trades":[],"order":{"web":false,"time_in_force":"good_til_cancelled",)"
+        R"("replaced":false,"reduce_only":false,"profit_loss":0.0,"price":57000.0,"post_only":false,)"
+        R"("order_type":"limit","order_state":"open","order_id":"USDC-1234567","max_show":10.0,)"
+        R"("last_update_timestamp":1716900000000,"label":"market1716900000","is_liquidation":false,)"
+        R"("instrument_name":"BTC-PERPETUAL","filled_amount":0.0,"direction":"buy",)"
+        R"("creation_timestamp":1716900000000,"average_price":0.0,"api":true,"amount":10.0}},)"
+        R"("usIn":1716900000000123,"usOut":1716900000000456,"usDiff":333,"testnet":true})";
+
+    constexpr std::string_view TICKER_FRAME =
+        R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"ticker.BTC-PERPETUAL.100ms","data":)"
+        R"({"timestamp":1716900000123,"stats":{"volume_usd":1.2e8,"volume":1900.5,"price_change":0.5,)"
+        R"("low":56000.0,"high":58000.0},"state":"open","settlement_price":56900.12,"open_interest":2.5e8,)"
+        R"("min_price":56100.5,"max_price":57800.5,"mark_price":56950.21,"last_price":56950.5,)"
+        R"("instrument_name":"BTC-PERPETUAL","index_price":56948.77,"funding_8h":0.00001,)"
+        R"("current_funding":0.0,"best_bid_price":56950.0,"best_bid_amount":12340.0,)"
+        R"("best_ask_price":56950.5,"best_ask_amount":4560.0}}})";
+
+    constexpr std::string_view TRADES_FRAME =
+        R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"trades.BTC-PERPETUAL.raw","data":[)"
+        R"({"trade_seq":30289432,"trade_id":"48079254","timestamp":1716900000100,"tick_direction":0,)"
+        R"("price":56950.5,"mark_price":56950.21,"instrument_name":"BTC-PERPETUAL","index_price":56948.77,)"
+        R"("direction":"buy","amount":200.0},)"
+        R"({"trade_seq":30289433,"trade_id":"48079255","timestamp":1716900000100,"tick_direction":1,)"
+        R"("price":56950.0,"mark_price":56950.21,"instrument_name":"BTC-PERPETUAL","index_price":56948.77,)"
+        R"("direction":"sell","amount":50.0}]}})";
+
+    std::string MakeBookFrame(const bool is_snapshot, const int64_t change_id, const std::string& bids,
+                              const std::string& asks)
+    {
+        std::string frame =
+            R"({"jsonrpc":"2.0","method":"subscription","params":{"channel":"book.BTC-PERPETUAL.raw","data":{"type":")";
+        frame += is_snapshot ? "snapshot" : "change";
+        frame += R"(","timestamp":1716900000000,)";
+        if (!is_snapshot)
+        {
+            frame += R"("prev_change_id":)" + std::to_string(change_id - 1) + ",";
+        }
+        frame += R"("instrument_name":"BTC-PERPETUAL","change_id":)" + std::to_string(change_id);
+        frame += R"(,"bids":[)" + bids + R"(],"asks":[)" + asks + "]}}}";
+        return frame;
+    }
+
+    // A snapshot of 50 levels a side followed by single-level changes with contiguous change ids
+    std::vector<std::string> MakeBookSequence(const size_t change_count)
+    {
+        std::string bids;
+        std::string asks;
+        for (int i = 0; i < 50; ++i)
+        {
+            bids += (i ? "," : "") + std::string(R"(["new",)") + std::to_string(56950.0 - i * 0.5) + ",1000.0]";
+            asks += (i ? "," : "") + std::string(R"(["new",)") + std::to_string(56950.5 + i * 0.5) + ",1000.0]";
+        }
+
+        std::vector<std::string> frames;
+        frames.push_back(MakeBookFrame(true, 1000, bids, asks));
+        for (size_t i = 0; i < change_count; ++i)
+        {
+            const double offset = static_cast<double>(i % 40) * 0.5;
+            const std::string level = i % 3 == 2 ? R"(["delete",)" + std::to_string(56950.0 - offset) + ",0.0]"
+                                                 : R"(["change",)" + std::to_string(56950.0 - offset) + "," +
+                                                       std::to_string(500.0 + static_cast<double>(i % 7)) + "]";
+            frames.push_back(i % 2 == 0 ? MakeBookFrame(false, 1001 + static_cast<int64_t>(i), level, "")
+                                        : MakeBookFrame(false, 1001 + static_cast<int64_t>(i), "", level));
+        }
+        return frames;
+    }
+
+    std::filesystem::path WriteTokenFile(const char* name, const char* token)
+    {
+        const auto path = std::filesystem::temp_directory_path() / name;
+        std::ofstream(path) << token << "\n";
+        return path;
+    }
+
+    void RunEncoderBenchmarks(BenchmarkRunner& runner)
+    {
+        const std::string instrument = "BTC-PERPETUAL";
+        const std::string label = "market1716900000";
+
+        runner.Run("encoder/http_buy_query", 0,
+                   [&]()
+                   {
+                       RequestEncoder& encoder = RequestEncoder::ThreadLocal();
+                       encoder.BeginQuery(Endpoints::BUY);
+                       encoder.AddQueryParam("amount", 10.0);
+                       encoder.AddQueryParam("instrument_name", instrument);
+                       encoder.AddQueryParam("label", label);
+                       encoder.AddQueryParam("price", 56950.5);
+                       encoder.AddQueryParam("type", "limit");
+                       DoNotOptimize(encoder.View().size());
+                   });
+
+        runner.Run("encoder/jsonrpc_buy", 0,
+                   [&]()
+                   {
+                       RequestEncoder& encoder = RequestEncoder::ThreadLocal();
+                       encoder.BeginJsonRpc(Endpoints::BUY, 42);
+                       encoder.AddJsonParam("instrument_name", instrument);
+                       encoder.AddJsonParam("amount", 10.0);
+                       encoder.AddJsonParam("type", "limit");
+                       encoder.AddJsonParam("price", 56950.5);
+                       encoder.AddJsonParam("label", label);
+                       encoder.EndJsonRpc();
+                       DoNotOptimize(encoder.View().size());
+                   });
+
+        // The same order as whole ticks and lots, written without a double
+        const DecimalScale tick{5, 1};
+        const DecimalScale lot{10, 0};
+        runner.Run("encoder/jsonrpc_buy_fixed_point", 0,
+                   [&]()
+                   {
+                       RequestEncoder& encoder = RequestEncoder::ThreadLocal();
+                       encoder.BeginJsonRpc(Endpoints::BUY, 42);
+                       encoder.AddJsonParam("instrument_name", instrument);
+                       encoder.AddJsonParam("amount", int64_t{1}, lot);
+                       encoder.AddJsonParam("type", "limit");
+                       encoder.AddJsonParam("price", int64_t{113901}, tick);
+                       encoder.AddJsonParam("label", label);
+                       encoder.EndJsonRpc();
+                       DoNotOptimize(encoder.View().size());
+                   });
+    }
+
+    void RunUtilitiesBenchmarks(BenchmarkRunner& runner)
+    {
+        const std::string response(BUY_RESPONSE);
+
+        runner.Run("utilities/is_parse_json_good", response.size(),
+                   [&]()
+                   {
+                       Json::Value json_data;
+                       DoNotOptimize(Utilities::IsParseJsonGood(response, json_data));
+                   });
+
+        NullBuffer null_buffer;
+        std::streambuf* const console = std::cout.rdbuf(&null_buffer);
+        runner.Run("utilities/display_json_response", response.size(),
+                   [&]() { Utilities::DisplayJsonResponse(response); });
+        std::cout.rdbuf(console);
+    }
+
+    void RunMarketDataBenchmarks(BenchmarkRunner& runner)
+    {
+        DrogonWebSocket web_socket;
+        OrderBookManager order_book_manager(web_socket);
+        order_book_manager.Track("BTC-PERPETUAL");
+
+        const std::vector<std::string> book_frames = MakeBookSequence(1023);
+        size_t book_bytes = 0;
+        for (const auto& frame : book_frames)
+        {
+            book_bytes += frame.size();
+        }
+
+        // The snapshot at the start of each pass resets the change ids, so the book never sees a gap
+        size_t next_frame = 0;
+        runner.Run("websocket/dispatch_book_raw", book_bytes / book_frames.size(),
+                   [&]()
+                   {
+                       web_socket.DispatchFrame(book_frames[next_frame]);
+                       next_frame = next_frame + 1 == book_frames.size() ? 0 : next_frame + 1;
+                   });
+        if (order_book_manager.GetResyncCount() != 0)
+        {
+            std::cerr << "[oems_bench] Book resynced during the benchmark; results are not representative\n";
+        }
+
+        TickerUpdate ticker;
+        web_socket.Subscribe({"ticker.BTC-PERPETUAL.100ms"},
+                             [&ticker](std::string_view, const std::string_view data)
+                             { MarketDataDecoder::DecodeTicker(data, ticker); });
+        runner.Run("websocket/dispatch_ticker", TICKER_FRAME.size(),
+                   [&]() { web_socket.DispatchFrame(TICKER_FRAME); });
+
+        runner.Run("decoder/ticker", TICKER_FRAME.size(),
+                   [&]()
+                   {
+                       std::string_view channel;
+                       std::string_view data;
+                       MarketDataDecoder::DecodeNotification(TICKER_FRAME, channel, data);
+                       DoNotOptimize(MarketDataDecoder::DecodeTicker(data, ticker));
+                   });
+
+        std::vector<TradeUpdate> trades;
+        runner.Run("decoder/trades", TRADES_FRAME.size(),
+                   [&]()
+                   {
+                       std::string_view channel;
+                       std::string_view data;
+                       MarketDataDecoder::DecodeNotification(TRADES_FRAME, channel, data);
+                       DoNotOptimize(MarketDataDecoder::DecodeTrades(data, trades));
+                   });
+    }
+
+    // A get_instruments reply with a few thousand option-like instruments, about the size of the real list
+    std::string MakeInstrumentsReply(const size_t count)
+    {
+        std::string reply = "{\"jsonrpc\":\"2.0\",\"result\":[";
+        for (size_t i = 0; i < count; ++i)
+        {
+            reply += i == 0 ? "{" : ",{";
+            reply += "\"instrument_name\":\"BTC-28JUN24-" + std::to_string(20000 + i * 1000) + "-C\","
+                     "\"kind\":\"option\",\"base_currency\":\"BTC\",\"quote_currency\":\"BTC\","
+                     "\"settlement_currency\":\"BTC\",\"instrument_type\":\"reversed\",\"option_type\":\"call\","
+                     "\"tick_size\":0.0001,\"tick_size_steps\":[{\"above_price\":0.005,\"tick_size\":0.0005}],"
+                     "\"contract_size\":1,\"min_trade_amount\":0.1,\"strike\":" + std::to_string(20000 + i * 1000) +
+                     ",\"expiration_timestamp\":1719561600000,\"creation_timestamp\":1700000000000,\"is_active\":true}";
+        }
+        reply += "]}";
+        return reply;
+    }
+
+    void RunInstrumentRegistryBenchmarks(BenchmarkRunner& runner)
+    {
+        const auto snapshot_path = std::filesystem::temp_directory_path() / "oems_bench_instruments.bin";
+        InstrumentRegistry instrument_registry(snapshot_path.string());
+        const std::string reply = MakeInstrumentsReply(5000);
+        instrument_registry.Apply(reply);
+        instrument_registry.SaveSnapshot();
+
+        // Startup with and without a snapshot
+        runner.Run("instrument_registry/apply_5000", reply.size(),
+                   [&]() { DoNotOptimize(instrument_registry.Apply(reply)); });
+        runner.Run("instrument_registry/load_snapshot_5000", 0,
+                   [&]() { DoNotOptimize(instrument_registry.LoadSnapshot()); });
+
+        runner.Run("instrument_registry/find_and_round", 0,
+                   [&]()
+                   {
+                       const InstrumentInfo* instrument = instrument_registry.Find("BTC-28JUN24-60000-C");
+                       DoNotOptimize(instrument->RoundPrice(0.01234, true));
+                   });
+
+        CompactOrder order;
+        runner.Run("compact_order/make", 0,
+                   [&]()
+                   {
+                       DoNotOptimize(CompactOrder::Make(instrument_registry, "BTC-28JUN24-60000-C", true,
+                                                        OrderType::LIMIT, 1.5, 0.01234, "market1716900000", "",
+                                                        order));
+                   });
+
+        std::filesystem::remove(snapshot_path);
+    }
+
+    // A BTC-sized chain: 20 expiries of 50 strikes, a call and a put at each
+    constexpr size_t CHAIN_EXPIRY_COUNT = 20;
+    constexpr size_t CHAIN_STRIKE_COUNT = 50;
+    constexpr int64_t CHAIN_FIRST_EXPIRY_MS = 4102444800000;
+    constexpr int64_t CHAIN_EXPIRY_STEP_MS = 7 * 24 * 3600 * 1000LL;
+
+    std::string MakeOptionName(const size_t expiry, const size_t strike, const bool is_call)
+    {
+        return "BTC-" + std::to_string(expiry + 1) + "JAN00-" + std::to_string(20000 + strike * 1000) +
+               (is_call ? "-C" : "-P");
+    }
+
+    std::string MakeOptionChainReply()
+    {
+        std::string reply = "{\"jsonrpc\":\"2.0\",\"result\":[";
+        for (size_t expiry = 0; expiry < CHAIN_EXPIRY_COUNT; ++expiry)
+        {
+            for (size_t strike = 0; strike < CHAIN_STRIKE_COUNT; ++strike)
+            {
+                for (const bool is_call : {true, false})
+                {
+                    reply += reply.back() == '[' ? "{" : ",{";
+                    reply += "\"instrument_name\":\"" + MakeOptionName(expiry, strike, is_call) + "\","
+                             "\"kind\":\"option\",\"base_currency\":\"BTC\",\"option_type\":\"" +
+                             (is_call ? "call" : "put") + "\",\"tick_size\":0.0001,\"min_trade_amount\":0.1,"
+                             "\"strike\":" + std::to_string(20000 + strike * 1000) + ",\"expiration_timestamp\":" +
+                             std::to_string(CHAIN_FIRST_EXPIRY_MS + static_cast<int64_t>(expiry) * CHAIN_EXPIRY_STEP_MS);
+                    reply += "}";
+                }
+            }
+        }
+        reply += "]}";
+        return reply;
+    }
+
+    void RunOptionChainBenchmarks(BenchmarkRunner& runner)
+    {
+        const auto snapshot_path = std::filesystem::temp_directory_path() / "oems_bench_chain.bin";
+        InstrumentRegistry instrument_registry(snapshot_path.string());
+        DrogonWebSocket web_socket;
+        TickerFeed ticker_feed(web_socket);
+        OptionChain option_chain(ticker_feed, instrument_registry, "BTC");
+        option_chain.Start();
+        instrument_registry.Apply(MakeOptionChainReply());
+
+        // One ticker per option, calls' deltas falling from deep in the money to far out of it
+        std::vector<std::string> frames;
+        for (size_t expiry = 0; expiry < CHAIN_EXPIRY_COUNT; ++expiry)
+        {
+            for (size_t strike = 0; strike < CHAIN_STRIKE_COUNT; ++strike)
+            {
+                const double call_delta = 0.98 - 0.96 * static_cast<double>(strike) / (CHAIN_STRIKE_COUNT - 1);
+                for (const bool is_call : {true, false})
+                {
+                    const std::string name = MakeOptionName(expiry, strike, is_call);
+                    const double delta = is_call ? call_delta : call_delta - 1;
+                    const double price = 0.001 + 0.1 * (is_call ? call_delta : 1 - call_delta);
+                    frames.push_back(
+                        "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":\"ticker." +
+                        name + ".raw\",\"data\":{\"timestamp\":1700000000000,\"instrument_name\":\"" + name +
+                        "\",\"best_bid_price\":" + std::to_string(price - 0.0005) +
+                        ",\"best_bid_amount\":10,\"best_ask_price\":" + std::to_string(price + 0.0005) +
+                        ",\"best_ask_amount\":10,\"mark_price\":" + std::to_string(price) +
+                        ",\"underlying_price\":60000,\"bid_iv\":49.5,\"ask_iv\":50.5,\"mark_iv\":50,"
+                        "\"open_interest\":120,\"greeks\":{\"delta\":" + std::to_string(delta) +
+                        ",\"gamma\":0.00002,\"vega\":60.1,\"theta\":-80.2,\"rho\":10.3}}}}");
+                }
+            }
+        }
+        for (const auto& frame : frames)
+        {
+            web_socket.DispatchFrame(frame);
+        }
+
+        size_t next_frame = 0;
+        runner.Run("option_chain/dispatch_ticker", frames.front().size(),
+                   [&]()
+                   {
+                       web_socket.DispatchFrame(frames[next_frame]);
+                       next_frame = next_frame + 1 == frames.size() ? 0 : next_frame + 1;
+                   });
+
+        // Scans of all 2000 rows and of one expiry's 100
+        std::vector<OptionQuote> quotes;
+        runner.Run("option_chain/calls_by_delta_2000", 0,
+                   [&]() { DoNotOptimize(option_chain.FindByDelta(OptionType::CALL, 0.2, 0.3, quotes)); });
+        OptionQuote quote;
+        const int64_t expiry_ms = CHAIN_FIRST_EXPIRY_MS + 10 * CHAIN_EXPIRY_STEP_MS;
+        runner.Run("option_chain/best_bid_expiry", 0,
+                   [&]() { DoNotOptimize(option_chain.FindBestBid(expiry_ms, OptionType::NONE, quote)); });
+        runner.Run("option_chain/best_ask_expiry", 0,
+                   [&]() { DoNotOptimize(option_chain.FindBestAsk(expiry_ms, OptionType::PUT, quote)); });
+    }
+
+    void RunOrderStoreBenchmarks(BenchmarkRunner& runner)
+    {
+        DrogonWebSocket web_socket;
+        OrderStore order_store(web_socket);
+        order_store.Start();
+
+        // A working set of 64 resting quotes, each updated in turn as a partial fill would
+        std::vector<std::string> frames;
+        for (int i = 0; i < 64; ++i)
+        {
+            frames.push_back(
+                "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":\"user.orders.any.any.raw\","
+                "\"data\":{\"order_id\":\"ETH-" + std::to_string(1000 + i) + "\",\"label\":\"quote-" +
+                std::to_string(i % 8) + "\",\"instrument_name\":\"BTC-PERPETUAL\",\"direction\":\"" +
+                (i % 2 == 0 ? "buy" : "sell") + "\",\"order_state\":\"open\",\"price\":" +
+                std::to_string(60000 + i) + ",\"amount\":100,\"filled_amount\":10,\"average_price\":0,"
+                "\"creation_timestamp\":1700000000000,\"last_update_timestamp\":1700000000000}}}");
+        }
+
+        size_t next_frame = 0;
+        runner.Run("order_store/dispatch_update", frames.front().size(),
+                   [&]()
+                   {
+                       web_socket.DispatchFrame(frames[next_frame]);
+                       next_frame = next_frame + 1 == frames.size() ? 0 : next_frame + 1;
+                   });
+
+        std::vector<OrderUpdate> orders;
+        runner.Run("order_store/get_by_label", 0,
+                   [&]() { DoNotOptimize(order_store.GetByLabel("quote-3", orders)); });
+    }
+
+    void RunTickerFeedBenchmarks(BenchmarkRunner& runner)
+    {
+        DrogonWebSocket web_socket;
+        TickerFeed ticker_feed(web_socket);
+        double mark_price = 0;
+        const auto on_ticker = [&mark_price](const TickerUpdate& ticker) { mark_price = ticker.mark_price; };
+        const TickerFeed::ConsumerId every = ticker_feed.AddConsumer(ConflationPolicy::EveryUpdate(), on_ticker);
+        const TickerFeed::ConsumerId latest = ticker_feed.AddConsumer(ConflationPolicy::Latest(), on_ticker);
+        const TickerFeed::ConsumerId moves =
+            ticker_feed.AddConsumer(ConflationPolicy::OnPriceChange(0.0005), on_ticker);
+
+        // 64 instruments, each ticking around its own price, so only some updates move it 5 bp
+        std::vector<std::string> instruments;
+        std::vector<std::string> frames;
+        for (int i = 0; i < 64; ++i)
+        {
+            instruments.push_back("BTC-" + std::to_string(i) + "JAN26");
+            for (int tick = 0; tick < 4; ++tick)
+            {
+                frames.push_back(
+                    "{\"jsonrpc\":\"2.0\",\"method\":\"subscription\",\"params\":{\"channel\":\"ticker." +
+                    instruments.back() + ".raw\",\"data\":{\"timestamp\":1700000000000,\"instrument_name\":\"" +
+                    instruments.back() + "\",\"best_bid_price\":60000,\"best_bid_amount\":10,"
+                    "\"best_ask_price\":60000.5,\"best_ask_amount\":10,\"mark_price\":" +
+                    std::to_string(60000 + 20 * tick) + ",\"index_price\":60000}}}");
+            }
+        }
+        for (const TickerFeed::ConsumerId consumer : {every, latest, moves})
+        {
+            ticker_feed.Track(consumer, instruments);
+        }
+
+        // Each frame is decoded once and offered to all three consumers
+        size_t next_frame = 0;
+        runner.Run("ticker_feed/dispatch_3_consumers", frames.front().size(),
+                   [&]()
+                   {
+                       web_socket.DispatchFrame(frames[next_frame]);
+                       next_frame = next_frame + 1 == frames.size() ? 0 : next_frame + 1;
+                   });
+        runner.Run("ticker_feed/dispatch_and_poll", frames.front().size(),
+                   [&]()
+                   {
+                       web_socket.DispatchFrame(frames[next_frame]);
+                       next_frame = next_frame + 1 == frames.size() ? 0 : next_frame + 1;
+                       DoNotOptimize(ticker_feed.Poll(latest));
+                   });
+        DoNotOptimize(mark_price);
+    }
+
+    void RunPositionEngineBenchmarks(BenchmarkRunner& runner)
+    {
+        DrogonWebSocket web_socket;
+        TickerFeed ticker_feed(web_socket);
+        PositionEngine position_engine(web_socket, ticker_feed);
+
+        // Alternating buys and sells keep the position small and exercise both the add and reduce paths
+        TradeUpdate fill;
+        fill.instrument_name = "BTC-PERPETUAL";
+        fill.amount = 10;
+        fill.fee = 0.00000001;
+        runner.Run("position_engine/apply_fill", 0,
+                   [&]()
+                   {
+                       ++fill.trade_seq;
+                       fill.direction = (fill.trade_seq & 1) != 0 ? TradeDirection::BUY : TradeDirection::SELL;
+                       fill.price = 60000.0 + static_cast<double>(fill.trade_seq % 100);
+                       position_engine.ApplyFill(fill);
+                   });
+
+        runner.Run("position_engine/currency_exposure", 0,
+                   [&]() { DoNotOptimize(position_engine.GetCurrencyExposure("BTC").open_positions); });
+    }
+
+    void RunRiskEngineBenchmarks(BenchmarkRunner& runner)
+    {
+        // All pre-trade checks of one order together, including the release when it completes
+        constexpr double RISK_CHECK_BUDGET_NS = 100;
+
+        DrogonWebSocket web_socket;
+        OrderStore order_store(web_socket);
+        TickerFeed ticker_feed(web_socket);
+        PositionEngine position_engine(web_socket, ticker_feed);
+        const auto risk_engine = std::make_unique<RiskEngine>(order_store, position_engine);
+        // The mark only reaches the risk engine for instruments the position engine already follows
+        risk_engine->Track("BTC-PERPETUAL");
+        position_engine.ApplyMarkPrice("BTC-PERPETUAL", 60000);
+
+        // A resting sell gives the self-trade guard something to compare against
+        OrderUpdate resting;
+        resting.order_id = "resting";
+        resting.instrument_name = "BTC-PERPETUAL";
+        resting.direction = TradeDirection::SELL;
+        resting.price = 61000;
+        resting.amount = 10;
+        resting.last_update_timestamp_ms = 1;
+        order_store.Apply(resting);
+
+        // Every check runs and passes; releasing keeps the pending count flat
+        const RiskCheck check = risk_engine->CheckOrder("BTC-PERPETUAL", true, false, 100, 60500);
+        risk_engine->ReleaseOrder("BTC-PERPETUAL");
+        if (check != RiskCheck::PASSED)
+        {
+            throw std::runtime_error(std::string("risk_engine/check_order setup rejected: ") +
+                                     RiskEngine::GetRiskCheckName(check));
+        }
+
+        runner.Run("risk_engine/check_order", 0,
+                   [&]()
+                   {
+                       DoNotOptimize(static_cast<int>(
+                           risk_engine->CheckOrder("BTC-PERPETUAL", true, false, 100, 60500)));
+                       risk_engine->ReleaseOrder("BTC-PERPETUAL");
+                   });
+        runner.SetBudget("risk_engine/check_order", RISK_CHECK_BUDGET_NS);
+    }
+
+    void RunRateLimiterBenchmarks(BenchmarkRunner& runner)
+    {
+        // Limits high enough that every request is admitted, so only the admission path is measured
+        RateLimiter rate_limiter;
+        rate_limiter.SetLimits(RateLimitPool::MATCHING_ENGINE, 1e9, 1e9);
+
+        runner.Run("rate_limiter/acquire", 0,
+                   [&]()
+                   {
+                       DoNotOptimize(static_cast<int>(rate_limiter.Acquire(RateLimitPool::MATCHING_ENGINE).admission));
+                   });
+    }
+
+    void RunTokenManagerBenchmarks(BenchmarkRunner& runner)
+    {
+        const auto access_token_file = WriteTokenFile("oems_bench_access_token.txt", "bench-access-token");
+        const auto refresh_token_file = WriteTokenFile("oems_bench_refresh_token.txt", "bench-refresh-token");
+        const TokenManager token_manager(access_token_file.string(), refresh_token_file.string(), 3600);
+
+        runner.Run("token_manager/check_and_header", 0,
+                   [&]()
+                   {
+                       DoNotOptimize(token_manager.IsAccessTokenExpired());
+                       DoNotOptimize(token_manager.GetAuthorizationHeader().size());
+                   });
+
+        std::filesystem::remove(access_token_file);
+        std::filesystem::remove(refresh_token_file);
+    }
+
+    const LogFormat LOG_BENCH_ORDER{LogLevel::INFO, "[Bench] Sent {} amount {} price {}"};
+
+    void RunBinaryLoggerBenchmarks(BenchmarkRunner& runner)
+    {
+        const std::string log_file = "oems_bench.binlog";
+        BinaryLogger& logger = BinaryLogger::Instance();
+        // Only errors reach the console, so the drain thread formats nothing while the bench runs
+        logger.Start(log_file, LogLevel::ERR);
+
+        int64_t amount = 0;
+        runner.Run("binary_logger/write", 0,
+                   [&]() { BinaryLogger::Write(LOG_BENCH_ORDER, "BTC-PERPETUAL", ++amount, 65432.5); });
+
+        logger.Stop();
+        std::filesystem::remove(log_file);
+    }
+
+    void RunMarketDataRecorderBenchmarks(BenchmarkRunner& runner)
+    {
+        // One journal block's worth of book frames, the recorder's unit of compression
+        std::string block;
+        const std::vector<std::string> book_frames = MakeBookSequence(1023);
+        for (size_t i = 0; block.size() < MarketDataRecorder::BLOCK_SIZE; i = (i + 1) % book_frames.size())
+        {
+            block += book_frames[i];
+        }
+        LzBlock compressor;
+        std::vector<char> compressed(LzBlock::GetMaxCompressedSize(block.size()));
+        const size_t compressed_size =
+            compressor.Compress(block.data(), block.size(), compressed.data(), compressed.size());
+        std::vector<char> decompressed(block.size());
+
+        runner.Run("lz_block/compress_book", block.size(),
+                   [&]()
+                   {
+                       DoNotOptimize(compressor.Compress(block.data(), block.size(), compressed.data(),
+                                                         compressed.size()));
+                   });
+        runner.Run("lz_block/decompress_book", block.size(),
+                   [&]()
+                   {
+                       DoNotOptimize(LzBlock::Decompress(compressed.data(), compressed_size, decompressed.data(),
+                                                         decompressed.size()));
+                   });
+
+        // What Record costs the network thread: a header and a copy of the frame into the ring. Draining inline
+        // keeps the ring from filling, which a writer thread could not promise under a tight loop
+        SpscByteRing ring(MarketDataRecorder::RING_CAPACITY);
+        uint64_t recorded = 0;
+        runner.Run("recorder/ring_ticker", TICKER_FRAME.size(),
+                   [&]()
+                   {
+                       char* const record = ring.Reserve(sizeof(int64_t) * 2 + TICKER_FRAME.size());
+                       std::memcpy(record + sizeof(int64_t) * 2, TICKER_FRAME.data(), TICKER_FRAME.size());
+                       ring.Commit();
+                       if (++recorded % 1024 == 0)
+                       {
+                           ring.Drain([](const char* data, const size_t) { DoNotOptimize(data[0]); });
+                       }
+                   });
+    }
+
+    void RunStrategyThreadBenchmarks(BenchmarkRunner& runner)
+    {
+        // One event through a queue and back out on the same thread: the copy in and out plus both index
+        // updates, without the cross-core transfer a second thread adds
+        SpscQueue<MarketEvent> queue(StrategyThread::DEFAULT_QUEUE_CAPACITY);
+        MarketEvent event{};
+        event.type = MarketEventType::BOOK;
+        event.SetInstrument("BTC-PERPETUAL");
+        MarketEvent popped;
+
+        runner.Run("strategy_thread/queue_push_pop", 0,
+                   [&]()
+                   {
+                       queue.TryPush(event);
+                       queue.TryPop(popped);
+                       DoNotOptimize(popped.instrument_size);
+                   });
+    }
+
+    void RunLatencyRecorderBenchmarks(BenchmarkRunner& runner)
+    {
+        LatencyRecorder latency_recorder;
+        int64_t value_ns = 0;
+
+        runner.Run("latency_recorder/record", 0,
+                   [&]()
+                   {
+                       value_ns = (value_ns + 7919) % 10000000;
+                       latency_recorder.Record(EndpointId::BUY, LatencyStage::EXCHANGE, value_ns);
+                   });
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    std::chrono::milliseconds min_time{200};
+    std::string filter;
+    bool as_csv = false;
+    bool enforce_budgets = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        if (arg == "--csv")
+        {
+            as_csv = true;
+        }
+        else if (arg == "--enforce-budgets")
+        {
+            enforce_budgets = true;
+        }
+        else if (arg == "--min-time-ms" && i + 1 < argc)
+        {
+            min_time = std::chrono::milliseconds(std::atoll(argv[++i]));
+        }
+        else
+        {
+            filter = std::string(arg);
+        }
+    }
+
+    try
+    {
+        BenchmarkRunner runner(min_time, filter);
+        RunEncoderBenchmarks(runner);
+        RunUtilitiesBenchmarks(runner);
+        RunMarketDataBenchmarks(runner);
+        RunInstrumentRegistryBenchmarks(runner);
+        RunOptionChainBenchmarks(runner);
+        RunOrderStoreBenchmarks(runner);
+        RunTickerFeedBenchmarks(runner);
+        RunPositionEngineBenchmarks(runner);
+        RunRiskEngineBenchmarks(runner);
+        RunRateLimiterBenchmarks(runner);
+        RunTokenManagerBenchmarks(runner);
+        RunLatencyRecorderBenchmarks(runner);
+        RunBinaryLoggerBenchmarks(runner);
+        RunMarketDataRecorderBenchmarks(runner);
+        RunStrategyThreadBenchmarks(runner);
+        runner.PrintResults(as_csv);
+        if (!runner.ReportBudgets() && enforce_budgets)
+        {
+            return 2;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,512 @@
+#include "binary_logger.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+
+#include "mapped_file.h"
+
+namespace
+{
+    static constexpr size_t FILE_BUFFER_SIZE = 1 << 16;
+
+    // Function to read a trivially copyable value from a possibly unaligned position
+    template<typename T>
+    T Load(const char* data) noexcept
+    {
+        T value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    // Function to format the date and time down to the second, once per second per thread
+    std::string_view FormatSeconds(const std::time_t seconds)
+    {
+        thread_local std::time_t cached_seconds = -1;
+        thread_local char cached_text[32];
+        thread_local size_t cached_size = 0;
+
+        if (seconds != cached_seconds)
+        {
+            std::tm tm_time{};
+#ifdef _WIN32
+            localtime_s(&tm_time, &seconds);
+#else
+            localtime_r(&seconds, &tm_time);
+#endif
+            cached_size = std::strftime(cached_text, sizeof(cached_text), "%Y-%m-%d %H:%M:%S", &tm_time);
+            cached_seconds = seconds;
+        }
+        return std::string_view(cached_text, cached_size);
+    }
+}
+
+LogFormat::LogFormat(const LogLevel level, const char* text)
+    : m_text(text), m_level(level), m_id(BinaryLogger::Instance().Register(this))
+{
+}
+
+uint16_t LogFormat::GetId() const noexcept
+{
+    return m_id;
+}
+
+LogLevel LogFormat::GetLevel() const noexcept
+{
+    return m_level;
+}
+
+const char* LogFormat::GetText() const noexcept
+{
+    return m_text;
+}
+
+BinaryLogger::~BinaryLogger()
+{
+    Stop();
+}
+
+BinaryLogger& BinaryLogger::Instance()
+{
+    static BinaryLogger instance;
+    return instance;
+}
+
+BinaryLogger::Ring* BinaryLogger::GetThreadRing() noexcept
+{
+    thread_local Ring* ring = nullptr;
+    if (!ring)
+    {
+        try
+        {
+            ring = Instance().AddRing();
+        }
+        catch (const std::exception&)
+        {
+            return nullptr;
+        }
+    }
+    return ring;
+}
+
+int64_t BinaryLogger::NowNs() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+size_t BinaryLogger::ClampStringSize(const size_t size) noexcept
+{
+    return std::min(size, MAX_RECORD_SIZE / 2);
+}
+
+void BinaryLogger::EncodeString(char*& cursor, const std::string_view value) noexcept
+{
+    const auto size = static_cast<uint32_t>(ClampStringSize(value.size()));
+    const uint32_t encoded_size = size < value.size() ? size | TRUNCATED_FLAG : size;
+    *cursor++ = static_cast<char>(LogArgType::STRING);
+    std::memcpy(cursor, &encoded_size, sizeof(encoded_size));
+    cursor += sizeof(encoded_size);
+    std::memcpy(cursor, value.data(), size);
+    cursor += size;
+}
+
+BinaryLogger::Ring* BinaryLogger::AddRing()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto index = static_cast<uint8_t>(std::min<size_t>(m_rings.size(), UINT8_MAX));
+    m_rings.push_back(std::make_unique<Ring>(index));
+    return m_rings.back().get();
+}
+
+uint16_t BinaryLogger::Register(const LogFormat* format)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_formats.size() >= MAX_FORMATS)
+    {
+        std::cerr << "[Logger] Too many log formats, dropping: " << format->GetText() << "\n";
+        return UNREGISTERED_ID;
+    }
+    m_formats.push_back(format);
+    return static_cast<uint16_t>(m_formats.size() - 1);
+}
+
+void BinaryLogger::AddConsumer(Consumer consumer)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_consumers.push_back(std::move(consumer));
+}
+
+bool BinaryLogger::Start(const std::string& path, const LogLevel console_level)
+{
+    if (m_is_running.load())
+    {
+        return true;
+    }
+
+    m_file = std::fopen(path.c_str(), "ab");
+    if (!m_file)
+    {
+        std::cerr << "[Logger] Failed to open " << path << "\n";
+        return false;
+    }
+    std::setvbuf(m_file, nullptr, _IOFBF, FILE_BUFFER_SIZE);
+
+    // Format ids are only stable within one run, so each run defines the ones it uses again
+    std::fseek(m_file, 0, SEEK_END);
+    if (std::ftell(m_file) == 0)
+    {
+        std::fwrite(FILE_MAGIC, 1, sizeof(FILE_MAGIC), m_file);
+    }
+    m_defined_formats.clear();
+    m_console_level = console_level;
+
+    m_is_running = true;
+    m_thread = std::thread([this]() { Run(); });
+    return true;
+}
+
+void BinaryLogger::Stop()
+{
+    if (!m_is_running.exchange(false))
+    {
+        return;
+    }
+
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+    std::fclose(m_file);
+    m_file = nullptr;
+}
+
+uint64_t BinaryLogger::GetDroppedCount()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t dropped = 0;
+    for (const auto& ring : m_rings)
+    {
+        dropped += ring->records.GetDroppedCount();
+    }
+    return dropped;
+}
+
+void BinaryLogger::Run()
+{
+    while (m_is_running.load(std::memory_order_acquire))
+    {
+        if (DrainAll() == 0)
+        {
+            std::fflush(m_file);
+            std::this_thread::sleep_for(IDLE_INTERVAL);
+        }
+    }
+
+    // Whatever was written before Stop still reaches the file
+    DrainAll();
+    std::fflush(m_file);
+    std::cout.flush();
+}
+
+size_t BinaryLogger::DrainAll()
+{
+    // Rings and formats only ever grow, so the copies kept here are topped up rather than rebuilt
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = m_thread_rings.size(); i < m_rings.size(); ++i)
+        {
+            m_thread_rings.push_back(m_rings[i].get());
+        }
+        for (size_t i = m_thread_formats.size(); i < m_formats.size(); ++i)
+        {
+            m_thread_formats.push_back(m_formats[i]);
+        }
+        if (m_thread_consumers.size() != m_consumers.size())
+        {
+            m_thread_consumers = m_consumers;
+        }
+    }
+
+    size_t count = 0;
+    for (Ring* ring : m_thread_rings)
+    {
+        count += ring->records.Drain([this](const char* data, const size_t size) { Handle(data, size); });
+    }
+    return count;
+}
+
+void BinaryLogger::Handle(const char* data, const size_t size)
+{
+    const auto format_id = Load<uint16_t>(data + offsetof(RecordHeader, format_id));
+    if (format_id >= m_thread_formats.size())
+    {
+        return;
+    }
+    const LogFormat* format = m_thread_formats[format_id];
+
+    if (format_id >= m_defined_formats.size())
+    {
+        m_defined_formats.resize(m_thread_formats.size(), false);
+    }
+    if (!m_defined_formats[format_id])
+    {
+        const std::string_view text = format->GetText();
+        DefinitionHeader definition{};
+        definition.size = static_cast<uint32_t>(sizeof(definition) + text.size());
+        definition.marker = DEFINITION_ID;
+        definition.format_id = format_id;
+        definition.level = format->GetLevel();
+        std::fwrite(&definition, sizeof(definition), 1, m_file);
+        std::fwrite(text.data(), 1, text.size(), m_file);
+        m_defined_formats[format_id] = true;
+    }
+    std::fwrite(data, 1, size, m_file);
+
+    if (format->GetLevel() < m_console_level && m_thread_consumers.empty())
+    {
+        return;
+    }
+    if (!DecodeRecord(data, size, m_scratch_record))
+    {
+        return;
+    }
+    m_scratch_record.level = format->GetLevel();
+    m_scratch_record.text = format->GetText();
+
+    if (m_scratch_record.level >= m_console_level)
+    {
+        FormatRecord(m_scratch_record, m_line);
+        std::ostream& output = m_scratch_record.level >= LogLevel::WARN ? std::cerr : std::cout;
+        output << m_line << "\n";
+    }
+
+    for (const auto& consumer : m_thread_consumers)
+    {
+        try
+        {
+            consumer(m_scratch_record);
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "[Logger] Consumer failed: " << e.what() << "\n";
+        }
+    }
+}
+
+bool BinaryLogger::DecodeRecord(const char* data, const size_t size, LogRecord& record)
+{
+    if (size < sizeof(RecordHeader))
+    {
+        return false;
+    }
+    const auto header = Load<RecordHeader>(data);
+    record.format_id = header.format_id;
+    record.timestamp_ns = header.timestamp_ns;
+    record.thread_index = header.thread_index;
+    record.args.clear();
+
+    const char* cursor = data + sizeof(RecordHeader);
+    const char* const end = data + size;
+    for (uint8_t i = 0; i < header.arg_count; ++i)
+    {
+        if (cursor >= end)
+        {
+            return false;
+        }
+
+        LogArg arg{};
+        arg.type = static_cast<LogArgType>(*cursor++);
+        switch (arg.type)
+        {
+            case LogArgType::BOOL:
+                if (cursor + 1 > end)
+                {
+                    return false;
+                }
+                arg.uint_value = static_cast<uint8_t>(*cursor++);
+                break;
+            case LogArgType::INT64:
+            case LogArgType::UINT64:
+            case LogArgType::DOUBLE:
+                if (cursor + sizeof(uint64_t) > end)
+                {
+                    return false;
+                }
+                arg.int_value = Load<int64_t>(cursor);
+                arg.uint_value = Load<uint64_t>(cursor);
+                arg.double_value = Load<double>(cursor);
+                cursor += sizeof(uint64_t);
+                break;
+            case LogArgType::STRING:
+            {
+                if (cursor + sizeof(uint32_t) > end)
+                {
+                    return false;
+                }
+                const auto encoded_length = Load<uint32_t>(cursor);
+                const uint32_t length = encoded_length & ~TRUNCATED_FLAG;
+                cursor += sizeof(uint32_t);
+                if (length > static_cast<size_t>(end - cursor))
+                {
+                    return false;
+                }
+                arg.string_value = std::string_view(cursor, length);
+                arg.is_truncated = (encoded_length & TRUNCATED_FLAG) != 0;
+                cursor += length;
+                break;
+            }
+            default:
+                return false;
+        }
+        record.args.push_back(arg);
+    }
+    return true;
+}
+
+const char* BinaryLogger::GetLevelName(const LogLevel level) noexcept
+{
+    switch (level)
+    {
+        case LogLevel::DEBUG:
+            return "DEBUG";
+        case LogLevel::INFO:
+            return "INFO";
+        case LogLevel::WARN:
+            return "WARN";
+        case LogLevel::ERR:
+            return "ERROR";
+    }
+    return "?";
+}
+
+void BinaryLogger::AppendArg(std::string& out, const LogArg& arg)
+{
+    char buffer[32];
+    int length = 0;
+    switch (arg.type)
+    {
+        case LogArgType::INT64:
+            length = std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(arg.int_value));
+            break;
+        case LogArgType::UINT64:
+            length = std::snprintf(buffer, sizeof(buffer), "%llu", static_cast<unsigned long long>(arg.uint_value));
+            break;
+        case LogArgType::DOUBLE:
+            length = std::snprintf(buffer, sizeof(buffer), "%.10g", arg.double_value);
+            break;
+        case LogArgType::BOOL:
+            out += arg.uint_value != 0 ? "true" : "false";
+            return;
+        case LogArgType::STRING:
+            out += arg.string_value;
+            if (arg.is_truncated)
+            {
+                out += " [truncated]";
+            }
+            return;
+    }
+    out.append(buffer, static_cast<size_t>(std::max(length, 0)));
+}
+
+void BinaryLogger::FormatRecord(const LogRecord& record, std::string& out)
+{
+    const int64_t seconds = record.timestamp_ns / 1'000'000'000;
+    const int64_t ms = record.timestamp_ns / 1'000'000 % 1000;
+
+    char prefix[32];
+    const int prefix_size = std::snprintf(prefix, sizeof(prefix), ".%03lld %-5s [%u] ", static_cast<long long>(ms),
+                                          GetLevelName(record.level), static_cast<unsigned>(record.thread_index));
+
+    out.clear();
+    out += FormatSeconds(static_cast<std::time_t>(seconds));
+    out.append(prefix, static_cast<size_t>(std::max(prefix_size, 0)));
+
+    // Each "{}" takes the next argument; placeholders without one are kept as they are
+    size_t next_arg = 0;
+    const std::string_view text = record.text;
+    size_t position = 0;
+    while (position < text.size())
+    {
+        const size_t placeholder = text.find("{}", position);
+        if (placeholder == std::string_view::npos)
+        {
+            out += text.substr(position);
+            break;
+        }
+        out += text.substr(position, placeholder - position);
+        if (next_arg < record.args.size())
+        {
+            AppendArg(out, record.args[next_arg++]);
+        }
+        else
+        {
+            out += "{}";
+        }
+        position = placeholder + 2;
+    }
+}
+
+bool BinaryLogger::DecodeFile(const std::string& path, std::ostream& out)
+{
+    MappedFile file;
+    if (!file.Open(path) || file.Size() < sizeof(FILE_MAGIC) ||
+        std::memcmp(file.Data(), FILE_MAGIC, sizeof(FILE_MAGIC)) != 0)
+    {
+        std::cerr << "[Logger] " << path << " is not a binary log\n";
+        return false;
+    }
+
+    struct Definition
+    {
+        std::string text;
+        LogLevel level;
+    };
+    std::vector<Definition> definitions;
+
+    LogRecord record;
+    std::string line;
+    const char* const data = file.Data();
+    size_t offset = sizeof(FILE_MAGIC);
+    while (offset + sizeof(uint32_t) + sizeof(uint16_t) <= file.Size())
+    {
+        const char* entry = data + offset;
+        const auto size = Load<uint32_t>(entry);
+        const auto marker = Load<uint16_t>(entry + offsetof(RecordHeader, format_id));
+        if (size < sizeof(uint32_t) + sizeof(uint16_t) || size > file.Size() - offset)
+        {
+            // A run that died mid-write leaves a partial entry at the end
+            std::cerr << "[Logger] Truncated entry at offset " << offset << "\n";
+            break;
+        }
+        offset += size;
+
+        if (marker == DEFINITION_ID)
+        {
+            if (size < sizeof(DefinitionHeader))
+            {
+                continue;
+            }
+            const auto definition = Load<DefinitionHeader>(entry);
+            if (definition.format_id >= definitions.size())
+            {
+                definitions.resize(definition.format_id + 1);
+            }
+            definitions[definition.format_id] = {
+                std::string(entry + sizeof(DefinitionHeader), size - sizeof(DefinitionHeader)), definition.level};
+            continue;
+        }
+
+        if (marker >= definitions.size() || !DecodeRecord(entry, size, record))
+        {
+            continue;
+        }
+        record.text = definitions[marker].text;
+        record.level = definitions[marker].level;
+        FormatRecord(record, line);
+        out << line << "\n";
+    }
+    return true;
+}
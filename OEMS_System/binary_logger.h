@@ -0,0 +1,283 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "spsc_byte_ring.h"
+
+// ERR rather than ERROR, which windows.h defines as a macro
+enum class LogLevel : uint8_t
+{
+    DEBUG,
+    INFO,
+    WARN,
+    ERR
+};
+
+// The constant part of a log statement, declared once per call site at namespace scope. Records carry the id
+// it is registered under instead of the text; "{}" in the text is replaced by the next argument when formatted.
+class LogFormat
+{
+  private:
+    const char* m_text;
+    LogLevel m_level;
+    uint16_t m_id;
+
+  public:
+    LogFormat(LogLevel level, const char* text);
+
+    LogFormat(const LogFormat&) = delete;
+    LogFormat& operator=(const LogFormat&) = delete;
+
+    uint16_t GetId() const noexcept;
+    LogLevel GetLevel() const noexcept;
+    const char* GetText() const noexcept;
+};
+
+enum class LogArgType : uint8_t
+{
+    INT64,
+    UINT64,
+    DOUBLE,
+    BOOL,
+    STRING
+};
+
+struct LogArg
+{
+    LogArgType type;
+    int64_t int_value;
+    uint64_t uint_value;
+    double double_value;
+    std::string_view string_value;
+    bool is_truncated;              // The string was longer than a record holds and was cut
+};
+
+// A record decoded for consumers; views point into the logger's buffers and are only valid during the call
+struct LogRecord
+{
+    uint16_t format_id;
+    LogLevel level;
+    std::string_view text;
+    int64_t timestamp_ns;           // Since the Unix epoch
+    uint8_t thread_index;           // Order in which threads first logged
+    std::vector<LogArg> args;
+};
+
+// Logging that costs the calling thread a few stores into memory it owns.
+//
+// Each thread writes binary records (format id, timestamp, raw arguments) into its own single-producer ring;
+// nothing is formatted and nothing blocks, and a record that does not fit is dropped and counted. A background
+// thread drains the rings, appends the records to a binary file and hands them to consumers, one of which
+// echoes them to the console as text. The file carries the format texts it needs, so DecodeFile can turn it
+// back into text offline.
+class BinaryLogger
+{
+  public:
+    using Consumer = std::function<void(const LogRecord& record)>;
+
+    static constexpr size_t RING_CAPACITY = size_t{1} << 20;
+    static constexpr size_t MAX_RECORD_SIZE = RING_CAPACITY / 4;
+    static constexpr std::chrono::milliseconds IDLE_INTERVAL{1};
+    static constexpr const char* DEFAULT_PATH = "oems.binlog";
+
+  private:
+    static constexpr char FILE_MAGIC[8] = {'O', 'E', 'M', 'S', 'L', 'O', 'G', '1'};
+    static constexpr uint16_t UNREGISTERED_ID = 0xFFFF;
+    static constexpr uint16_t DEFINITION_ID = 0xFFFE;
+    static constexpr size_t MAX_FORMATS = DEFINITION_ID;
+    // Set in a string's encoded length when it was cut to fit the record
+    static constexpr uint32_t TRUNCATED_FLAG = uint32_t{1} << 31;
+
+    struct RecordHeader
+    {
+        uint32_t size;              // Including this header, rounded up to 8
+        uint16_t format_id;
+        uint8_t arg_count;
+        uint8_t thread_index;
+        int64_t timestamp_ns;
+    };
+
+    // Precedes a format text in the file, the first time a record using it is written
+    struct DefinitionHeader
+    {
+        uint32_t size;
+        uint16_t marker;            // DEFINITION_ID
+        uint16_t format_id;
+        LogLevel level;
+        uint8_t reserved[7];
+    };
+
+    // One per thread that has logged; kept after the thread exits so nothing it wrote is lost
+    struct Ring
+    {
+        SpscByteRing records;
+        const uint8_t thread_index;
+
+        explicit Ring(const uint8_t index) : records(RING_CAPACITY), thread_index(index) {}
+    };
+
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<Ring>> m_rings;
+    std::vector<const LogFormat*> m_formats;
+    std::vector<Consumer> m_consumers;
+    std::FILE* m_file{nullptr};
+    std::vector<bool> m_defined_formats;
+    LogLevel m_console_level{LogLevel::INFO};
+    std::thread m_thread;
+    std::atomic<bool> m_is_running{false};
+
+    // Only touched on the logger thread
+    std::vector<Ring*> m_thread_rings;
+    std::vector<const LogFormat*> m_thread_formats;
+    std::vector<Consumer> m_thread_consumers;
+    LogRecord m_scratch_record;
+    std::string m_line;
+
+    BinaryLogger() = default;
+
+    // Null if the ring could not be allocated; the next call tries again
+    static Ring* GetThreadRing() noexcept;
+    static int64_t NowNs() noexcept;
+    static size_t ClampStringSize(size_t size) noexcept;
+
+    template<typename T>
+    static size_t EncodedSize(const T& value) noexcept;
+    template<typename T>
+    static void Encode(char*& cursor, const T& value) noexcept;
+    static void EncodeString(char*& cursor, std::string_view value) noexcept;
+
+    static bool DecodeRecord(const char* data, size_t size, LogRecord& record);
+    static void AppendArg(std::string& out, const LogArg& arg);
+
+    Ring* AddRing();
+    uint16_t Register(const LogFormat* format);
+    void Run();
+    size_t DrainAll();
+    void Handle(const char* data, size_t size);
+
+    friend class LogFormat;
+
+  public:
+    ~BinaryLogger();
+
+    BinaryLogger(const BinaryLogger&) = delete;
+    BinaryLogger& operator=(const BinaryLogger&) = delete;
+
+    static BinaryLogger& Instance();
+
+    // Never blocks or allocates once the calling thread has its ring; if its ring cannot be allocated the record
+    // is dropped. Arguments are integers, floating point, bool or anything convertible to std::string_view;
+    // strings are copied into the record, and one longer than MAX_RECORD_SIZE / 2 is cut and marked truncated.
+    template<typename... Args>
+    static void Write(const LogFormat& format, const Args&... args) noexcept;
+
+    // Must be called before Start; runs on the logger thread
+    void AddConsumer(Consumer consumer);
+
+    // Opens the binary log (appending if it exists) and starts the logger thread. Records at or above
+    // console_level are also echoed to stdout, warnings and errors to stderr.
+    bool Start(const std::string& path = DEFAULT_PATH, LogLevel console_level = LogLevel::INFO);
+    // Drains what is left and stops the thread; also run on destruction
+    void Stop();
+
+    uint64_t GetDroppedCount();
+
+    static const char* GetLevelName(LogLevel level) noexcept;
+    // "2024-05-28 12:00:00.123 INFO  [3] text with arguments"
+    static void FormatRecord(const LogRecord& record, std::string& out);
+    // Writes every record of a binary log as text; false if the file is missing or not a binary log
+    static bool DecodeFile(const std::string& path, std::ostream& out);
+};
+
+template<typename T>
+size_t BinaryLogger::EncodedSize(const T& value) noexcept
+{
+    if constexpr (std::is_same_v<T, bool>)
+    {
+        return 2;
+    }
+    else if constexpr (std::is_arithmetic_v<T>)
+    {
+        return 1 + sizeof(uint64_t);
+    }
+    else
+    {
+        static_assert(std::is_convertible_v<const T&, std::string_view>, "Unsupported log argument type");
+        return 1 + sizeof(uint32_t) + ClampStringSize(std::string_view(value).size());
+    }
+}
+
+template<typename T>
+void BinaryLogger::Encode(char*& cursor, const T& value) noexcept
+{
+    if constexpr (std::is_same_v<T, bool>)
+    {
+        *cursor++ = static_cast<char>(LogArgType::BOOL);
+        *cursor++ = value ? 1 : 0;
+    }
+    else if constexpr (std::is_floating_point_v<T>)
+    {
+        *cursor++ = static_cast<char>(LogArgType::DOUBLE);
+        const auto converted = static_cast<double>(value);
+        std::memcpy(cursor, &converted, sizeof(converted));
+        cursor += sizeof(converted);
+    }
+    else if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+    {
+        *cursor++ = static_cast<char>(LogArgType::INT64);
+        const auto converted = static_cast<int64_t>(value);
+        std::memcpy(cursor, &converted, sizeof(converted));
+        cursor += sizeof(converted);
+    }
+    else if constexpr (std::is_integral_v<T>)
+    {
+        *cursor++ = static_cast<char>(LogArgType::UINT64);
+        const auto converted = static_cast<uint64_t>(value);
+        std::memcpy(cursor, &converted, sizeof(converted));
+        cursor += sizeof(converted);
+    }
+    else
+    {
+        EncodeString(cursor, std::string_view(value));
+    }
+}
+
+template<typename... Args>
+void BinaryLogger::Write(const LogFormat& format, const Args&... args) noexcept
+{
+    static_assert(sizeof...(Args) < 256, "Too many log arguments");
+
+    const size_t payload = (sizeof(RecordHeader) + ... + EncodedSize(args));
+    const size_t size = (payload + 7) & ~size_t{7};
+
+    Ring* const ring = GetThreadRing();
+    if (!ring)
+    {
+        return;
+    }
+    char* const record = ring->records.Reserve(size);
+    if (!record)
+    {
+        return;
+    }
+
+    const RecordHeader header{static_cast<uint32_t>(size), format.GetId(), static_cast<uint8_t>(sizeof...(Args)),
+                              ring->thread_index, NowNs()};
+    std::memcpy(record, &header, sizeof(header));
+    [[maybe_unused]] char* cursor = record + sizeof(header);
+    (Encode(cursor, args), ...);
+    ring->records.Commit();
+}
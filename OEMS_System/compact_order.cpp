@@ -0,0 +1,98 @@
+#include "compact_order.h"
+
+#include <cstring>
+
+#include "binary_logger.h"
+
+namespace
+{
+    const LogFormat LOG_UNKNOWN_INSTRUMENT{LogLevel::WARN, "[Order] Unknown instrument: {}"};
+    const LogFormat LOG_INVALID_AMOUNT{LogLevel::WARN, "[Order] Invalid amount for {}: {} (must be a multiple of {})"};
+    const LogFormat LOG_UNKNOWN_TIME_IN_FORCE{LogLevel::WARN, "[Order] Unknown time in force: {}"};
+    const LogFormat LOG_LABEL_TOO_LONG{LogLevel::WARN, "[Order] Label longer than {} characters: {}"};
+}
+
+bool CompactOrder::ParseTimeInForce(const std::string_view name, TimeInForce& time_in_force) noexcept
+{
+    if (name.empty() || name == "good_til_cancelled")
+    {
+        time_in_force = TimeInForce::GOOD_TIL_CANCELLED;
+    }
+    else if (name == "good_til_day")
+    {
+        time_in_force = TimeInForce::GOOD_TIL_DAY;
+    }
+    else if (name == "fill_or_kill")
+    {
+        time_in_force = TimeInForce::FILL_OR_KILL;
+    }
+    else if (name == "immediate_or_cancel")
+    {
+        time_in_force = TimeInForce::IMMEDIATE_OR_CANCEL;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+bool CompactOrder::Make(const InstrumentRegistry& registry, const std::string_view instrument_name,
+                        const bool is_buy, const OrderType type, const double amount, const double price,
+                        const std::string_view label, const std::string_view time_in_force, CompactOrder& order)
+{
+    const InstrumentId instrument_id = registry.GetId(instrument_name);
+    const InstrumentInfo* instrument = registry.Get(instrument_id);
+    if (!instrument)
+    {
+        BinaryLogger::Write(LOG_UNKNOWN_INSTRUMENT, instrument_name);
+        return false;
+    }
+    if (!instrument->IsValidAmount(amount))
+    {
+        BinaryLogger::Write(LOG_INVALID_AMOUNT, instrument_name, amount, instrument->min_trade_amount);
+        return false;
+    }
+    if (!ParseTimeInForce(time_in_force, order.time_in_force))
+    {
+        BinaryLogger::Write(LOG_UNKNOWN_TIME_IN_FORCE, time_in_force);
+        return false;
+    }
+    if (!order.SetLabel(label))
+    {
+        BinaryLogger::Write(LOG_LABEL_TOO_LONG, LABEL_CAPACITY, label);
+        return false;
+    }
+
+    order.instrument_id = instrument_id;
+    order.type = type;
+    order.is_buy = is_buy;
+    order.amount_lots = instrument->amount_scale.ToUnits(amount);
+    order.price_ticks = 0;
+    if (order.HasPrice() && price > 0)
+    {
+        order.price_ticks = instrument->price_scale.ToUnits(instrument->RoundPrice(price, is_buy));
+    }
+    return true;
+}
+
+bool CompactOrder::HasPrice() const noexcept
+{
+    return type == OrderType::LIMIT || type == OrderType::STOP_LIMIT;
+}
+
+std::string_view CompactOrder::GetLabel() const noexcept
+{
+    return std::string_view(label, label_size);
+}
+
+bool CompactOrder::SetLabel(const std::string_view value) noexcept
+{
+    if (value.size() > LABEL_CAPACITY)
+    {
+        return false;
+    }
+    std::memcpy(label, value.data(), value.size());
+    label_size = static_cast<uint8_t>(value.size());
+    return true;
+}
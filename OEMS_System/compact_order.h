@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#include "instrument_registry.h"
+
+enum class OrderType : uint8_t
+{
+    LIMIT,
+    MARKET,
+    STOP_LIMIT,
+    STOP_MARKET
+};
+
+enum class TimeInForce : uint8_t
+{
+    GOOD_TIL_CANCELLED,
+    GOOD_TIL_DAY,
+    FILL_OR_KILL,
+    IMMEDIATE_OR_CANCEL
+};
+
+constexpr std::string_view GetTimeInForceName(const TimeInForce time_in_force) noexcept
+{
+    switch (time_in_force)
+    {
+        case TimeInForce::GOOD_TIL_DAY: return "good_til_day";
+        case TimeInForce::FILL_OR_KILL: return "fill_or_kill";
+        case TimeInForce::IMMEDIATE_OR_CANCEL: return "immediate_or_cancel";
+        default: return "good_til_cancelled";
+    }
+}
+
+// An order as it travels through validation, risk and encoding: one cache line, no heap memory, copied
+// with a memcpy. Price and amount are whole numbers of the instrument's tick and lot (price_scale and
+// amount_scale in its InstrumentInfo) and only become decimal text when the request is encoded.
+struct alignas(64) CompactOrder
+{
+    static constexpr size_t LABEL_CAPACITY = 40;
+
+    int64_t price_ticks;            // 0 for market orders
+    int64_t amount_lots;
+    InstrumentId instrument_id;
+    OrderType type;
+    TimeInForce time_in_force;
+    bool is_buy;
+    uint8_t label_size;
+    char label[LABEL_CAPACITY];     // Not NUL-terminated
+
+    // Builds an order from decimal inputs, snapping the price to the tick on the passive side. False, with
+    // the reason logged, if the instrument is unknown, the amount is not whole lots, the label is longer
+    // than LABEL_CAPACITY or the time in force is not one of the exchange's names (empty means GTC).
+    static bool Make(const InstrumentRegistry& registry, std::string_view instrument_name, bool is_buy,
+                     OrderType type, double amount, double price, std::string_view label,
+                     std::string_view time_in_force, CompactOrder& order);
+
+    static bool ParseTimeInForce(std::string_view name, TimeInForce& time_in_force) noexcept;
+
+    bool HasPrice() const noexcept;
+    std::string_view GetLabel() const noexcept;
+    bool SetLabel(std::string_view value) noexcept;
+};
+
+static_assert(sizeof(CompactOrder) == 64, "CompactOrder should fill exactly one cache line");
+static_assert(std::is_trivially_copyable_v<CompactOrder>, "CompactOrder is copied as raw bytes");
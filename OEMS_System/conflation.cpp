@@ -0,0 +1,86 @@
+#include "conflation.h"
+
+#include <cmath>
+
+ConflationPolicy ConflationPolicy::EveryUpdate() noexcept
+{
+    return {ConflationMode::EVERY_UPDATE, std::chrono::milliseconds(0), 0};
+}
+
+ConflationPolicy ConflationPolicy::Latest() noexcept
+{
+    return {ConflationMode::LATEST, std::chrono::milliseconds(0), 0};
+}
+
+ConflationPolicy ConflationPolicy::Every(const std::chrono::milliseconds interval) noexcept
+{
+    return {ConflationMode::INTERVAL, interval, 0};
+}
+
+ConflationPolicy ConflationPolicy::OnPriceChange(const double min_price_change) noexcept
+{
+    return {ConflationMode::PRICE_CHANGE, std::chrono::milliseconds(0), min_price_change};
+}
+
+void ConflationSlot::MarkDelivered(const int64_t now_ns, const double price) noexcept
+{
+    last_delivered_ns = now_ns;
+    last_price = price;
+    is_pending = false;
+    has_delivered = true;
+}
+
+bool ConflationSlot::Admit(const ConflationPolicy& policy, const int64_t now_ns, const double price) noexcept
+{
+    switch (policy.mode)
+    {
+        case ConflationMode::EVERY_UPDATE:
+            MarkDelivered(now_ns, price);
+            return true;
+
+        case ConflationMode::LATEST:
+            is_pending = true;
+            return false;
+
+        case ConflationMode::INTERVAL:
+            if (!has_delivered ||
+                now_ns - last_delivered_ns >= std::chrono::nanoseconds(policy.interval).count())
+            {
+                MarkDelivered(now_ns, price);
+                return true;
+            }
+            is_pending = true;
+            return false;
+
+        case ConflationMode::PRICE_CHANGE:
+            // The first update always goes through, as does one after a side of the book disappeared
+            if (!has_delivered || last_price == 0 || std::isnan(last_price) ||
+                std::fabs(price - last_price) >= policy.min_price_change * std::fabs(last_price))
+            {
+                MarkDelivered(now_ns, price);
+                return true;
+            }
+            return false;
+    }
+    return false;
+}
+
+bool ConflationSlot::TakeIfDue(const ConflationPolicy& policy, const int64_t now_ns, const double price) noexcept
+{
+    if (!is_pending || now_ns - last_delivered_ns < std::chrono::nanoseconds(policy.interval).count())
+    {
+        return false;
+    }
+    MarkDelivered(now_ns, price);
+    return true;
+}
+
+bool ConflationSlot::TakePending(const int64_t now_ns, const double price) noexcept
+{
+    if (!is_pending)
+    {
+        return false;
+    }
+    MarkDelivered(now_ns, price);
+    return true;
+}
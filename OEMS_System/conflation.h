@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+
+// How a consumer of a high-rate channel wants to see its updates
+enum class ConflationMode : uint8_t
+{
+    EVERY_UPDATE,    // Called for every update, on the market-data thread
+    LATEST,          // Only the newest state is kept; the consumer collects it when it is ready
+    INTERVAL,        // Called at most once per interval per instrument, with the newest state
+    PRICE_CHANGE     // Called when the price has moved by at least a fraction since the consumer last saw it
+};
+
+struct ConflationPolicy
+{
+    ConflationMode mode{ConflationMode::EVERY_UPDATE};
+    std::chrono::milliseconds interval{0};
+    double min_price_change{0};      // PRICE_CHANGE: relative move, 0.0005 being 5 bp
+
+    static ConflationPolicy EveryUpdate() noexcept;
+    static ConflationPolicy Latest() noexcept;
+    static ConflationPolicy Every(std::chrono::milliseconds interval) noexcept;
+    static ConflationPolicy OnPriceChange(double min_price_change) noexcept;
+};
+
+// One consumer's view of one instrument: what it was last given and whether something newer is waiting.
+// Updates that are held overwrite each other in the producer's state rather than queueing, so a slow consumer
+// skips the intermediate ones.
+struct ConflationSlot
+{
+    int64_t last_delivered_ns{0};
+    double last_price{std::numeric_limits<double>::quiet_NaN()};
+    bool is_pending{false};
+    bool has_delivered{false};
+
+    // For each new update: true if it is to be delivered now, in which case it is recorded as delivered.
+    // Otherwise LATEST and INTERVAL mark the slot pending and PRICE_CHANGE drops the update.
+    bool Admit(const ConflationPolicy& policy, int64_t now_ns, double price) noexcept;
+
+    // INTERVAL: true if a held update has waited out the interval, which then counts as delivered
+    bool TakeIfDue(const ConflationPolicy& policy, int64_t now_ns, double price) noexcept;
+    // LATEST: true if an update is waiting, which then counts as delivered
+    bool TakePending(int64_t now_ns, double price) noexcept;
+
+  private:
+    void MarkDelivered(int64_t now_ns, double price) noexcept;
+};
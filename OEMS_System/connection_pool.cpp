@@ -0,0 +1,167 @@
+#include "connection_pool.h"
+
+#include <algorithm>
+#include <limits>
+
+ConnectionPool::ConnectionPool(const std::string& base_url, const size_t size)
+{
+    const size_t count = std::max<size_t>(size, 1);
+    m_connections.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto connection = std::make_unique<Connection>();
+        connection->client = drogon::HttpClient::newHttpClient(base_url);
+        m_connections.push_back(std::move(connection));
+    }
+}
+
+ConnectionPool::~ConnectionPool()
+{
+    if (m_keepalive_timer != 0)
+    {
+        GetLoop()->invalidateTimer(m_keepalive_timer);
+    }
+}
+
+int64_t ConnectionPool::NowNs() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+trantor::EventLoop* ConnectionPool::GetLoop() const
+{
+    return m_connections.front()->client->getLoop();
+}
+
+size_t ConnectionPool::GetSize() const noexcept
+{
+    return m_connections.size();
+}
+
+ConnectionPoolStats ConnectionPool::GetStats() const noexcept
+{
+    ConnectionPoolStats stats{};
+    stats.connections = m_connections.size();
+    stats.requests = m_requests.load(std::memory_order_relaxed);
+    stats.handshakes = m_handshakes.load(std::memory_order_relaxed);
+    stats.keepalives = m_keepalives.load(std::memory_order_relaxed);
+    stats.failures = m_failures.load(std::memory_order_relaxed);
+    if (stats.requests != 0)
+    {
+        const uint64_t reused = stats.requests > stats.handshakes ? stats.requests - stats.handshakes : 0;
+        stats.reuse_ratio = static_cast<double>(reused) / static_cast<double>(stats.requests);
+    }
+    return stats;
+}
+
+void ConnectionPool::Start(const std::chrono::seconds keepalive_interval)
+{
+    m_keepalive_interval = keepalive_interval;
+
+    // The keepalive doubles as the warm-up: it opens the connection and completes the TLS handshake
+    for (const auto& connection : m_connections)
+    {
+        SendKeepalive(*connection);
+    }
+
+    if (m_keepalive_timer != 0)
+    {
+        GetLoop()->invalidateTimer(m_keepalive_timer);
+    }
+    m_keepalive_timer = GetLoop()->runEvery(static_cast<double>(m_keepalive_interval.count()),
+                                            [this]() { OnKeepaliveTimer(); });
+}
+
+// Function to pick the connection with the fewest requests in flight, rotating the starting point so
+// ties are spread evenly
+ConnectionPool::Connection& ConnectionPool::SelectConnection() noexcept
+{
+    const size_t count = m_connections.size();
+    const size_t start = m_next_connection.fetch_add(1, std::memory_order_relaxed);
+
+    Connection* selected = nullptr;
+    uint32_t selected_load = std::numeric_limits<uint32_t>::max();
+    for (size_t i = 0; i < count; ++i)
+    {
+        Connection& connection = *m_connections[(start + i) % count];
+        const uint32_t load = connection.in_flight.load(std::memory_order_relaxed);
+        if (load < selected_load)
+        {
+            selected = &connection;
+            selected_load = load;
+            if (load == 0)
+            {
+                break;
+            }
+        }
+    }
+    return *selected;
+}
+
+void ConnectionPool::SendRequest(const drogon::HttpRequestPtr& req, drogon::HttpReqCallback callback,
+                                 const double timeout)
+{
+    Send(SelectConnection(), req, std::move(callback), timeout);
+}
+
+void ConnectionPool::Send(Connection& connection, const drogon::HttpRequestPtr& req,
+                          drogon::HttpReqCallback callback, const double timeout)
+{
+    m_requests.fetch_add(1, std::memory_order_relaxed);
+    if (!connection.is_open.load(std::memory_order_acquire) &&
+        !connection.is_connecting.exchange(true, std::memory_order_acq_rel))
+    {
+        m_handshakes.fetch_add(1, std::memory_order_relaxed);
+    }
+    connection.in_flight.fetch_add(1, std::memory_order_relaxed);
+    connection.last_used_ns.store(NowNs(), std::memory_order_relaxed);
+
+    connection.client->sendRequest(
+        req,
+        [this, &connection, callback = std::move(callback)](const drogon::ReqResult result,
+                                                            const drogon::HttpResponsePtr& response)
+        {
+            // Any response, even an HTTP error, means the connection is up; a network error means the
+            // next request has to reconnect
+            const bool is_open = result == drogon::ReqResult::Ok;
+            if (!is_open)
+            {
+                m_failures.fetch_add(1, std::memory_order_relaxed);
+            }
+            connection.is_open.store(is_open, std::memory_order_release);
+            connection.is_connecting.store(false, std::memory_order_release);
+            connection.in_flight.fetch_sub(1, std::memory_order_relaxed);
+
+            if (callback)
+            {
+                callback(result, response);
+            }
+        },
+        timeout);
+}
+
+void ConnectionPool::SendKeepalive(Connection& connection)
+{
+    const auto req = drogon::HttpRequest::newHttpRequest();
+    req->setMethod(drogon::Get);
+    req->setPath(KEEPALIVE_PATH);
+
+    m_keepalives.fetch_add(1, std::memory_order_relaxed);
+    Send(connection, req, nullptr, static_cast<double>(m_keepalive_interval.count()));
+}
+
+// Function to touch every connection that has been idle for a full interval
+void ConnectionPool::OnKeepaliveTimer()
+{
+    const int64_t idle_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(m_keepalive_interval).count();
+    const int64_t now_ns = NowNs();
+    for (const auto& connection : m_connections)
+    {
+        if (connection->in_flight.load(std::memory_order_relaxed) == 0 &&
+            now_ns - connection->last_used_ns.load(std::memory_order_relaxed) >= idle_ns)
+        {
+            SendKeepalive(*connection);
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <drogon/HttpClient.h>
+
+struct ConnectionPoolStats
+{
+    uint64_t connections;
+    uint64_t requests;     // Requests sent, keepalives included
+    uint64_t handshakes;   // Requests that had to open (and TLS-handshake) their connection first
+    uint64_t keepalives;
+    uint64_t failures;     // Network errors; the connection reconnects on its next request
+    double reuse_ratio;    // Share of requests sent on an already open connection
+};
+
+// A fixed set of keep-alive HTTPS connections to one host.
+//
+// Each connection is its own drogon client, so requests are spread across them instead of queueing
+// behind a single socket: a request goes to the connection with the fewest requests in flight. Start
+// opens every connection up front and then sends public/test on any connection that has been idle for
+// a keepalive interval, so neither the first order nor one after a quiet period pays for DNS, TCP and
+// the TLS handshake. Drogon does not report when it reconnects, so a handshake is counted whenever a
+// request goes to a connection that has not completed a request since it was created or last failed.
+class ConnectionPool
+{
+  public:
+    static constexpr size_t DEFAULT_SIZE = 4;
+    static constexpr std::chrono::seconds DEFAULT_KEEPALIVE_INTERVAL{15};
+    static constexpr const char* KEEPALIVE_PATH = "/api/v2/public/test";
+
+  private:
+    struct Connection
+    {
+        drogon::HttpClientPtr client;
+        std::atomic<uint32_t> in_flight{0};
+        std::atomic<bool> is_open{false};
+        std::atomic<bool> is_connecting{false};
+        std::atomic<int64_t> last_used_ns{0};
+    };
+
+    std::vector<std::unique_ptr<Connection>> m_connections;
+    std::atomic<size_t> m_next_connection{0};
+    std::chrono::seconds m_keepalive_interval{DEFAULT_KEEPALIVE_INTERVAL};
+    trantor::TimerId m_keepalive_timer{0};
+
+    std::atomic<uint64_t> m_requests{0};
+    std::atomic<uint64_t> m_handshakes{0};
+    std::atomic<uint64_t> m_keepalives{0};
+    std::atomic<uint64_t> m_failures{0};
+
+    static int64_t NowNs() noexcept;
+
+    Connection& SelectConnection() noexcept;
+    void Send(Connection& connection, const drogon::HttpRequestPtr& req, drogon::HttpReqCallback callback,
+              double timeout);
+    void SendKeepalive(Connection& connection);
+    void OnKeepaliveTimer();
+
+  public:
+    explicit ConnectionPool(const std::string& base_url, size_t size = DEFAULT_SIZE);
+    ~ConnectionPool();
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // Opens every connection and starts the keepalive timer on the client loop
+    void Start(std::chrono::seconds keepalive_interval = DEFAULT_KEEPALIVE_INTERVAL);
+
+    void SendRequest(const drogon::HttpRequestPtr& req, drogon::HttpReqCallback callback, double timeout);
+
+    trantor::EventLoop* GetLoop() const;
+    size_t GetSize() const noexcept;
+    ConnectionPoolStats GetStats() const noexcept;
+};
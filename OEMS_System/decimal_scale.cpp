@@ -0,0 +1,56 @@
+#include "decimal_scale.h"
+
+#include <cmath>
+
+namespace
+{
+    constexpr double POWERS_OF_TEN[DecimalScale::MAX_DECIMALS + 1] = {1e0, 1e1, 1e2, 1e3, 1e4,
+                                                                      1e5, 1e6, 1e7, 1e8, 1e9};
+    // Tolerance for a step that is a whole number at some decimal place up to floating-point noise
+    constexpr double STEP_EPSILON = 1e-9;
+}
+
+bool DecimalScale::FromDouble(const double step, DecimalScale& scale) noexcept
+{
+    if (!(step > 0))
+    {
+        return false;
+    }
+
+    for (uint8_t decimals = 0; decimals <= MAX_DECIMALS; ++decimals)
+    {
+        const double scaled = step * POWERS_OF_TEN[decimals];
+        const double rounded = std::round(scaled);
+        if (std::abs(scaled - rounded) <= STEP_EPSILON * scaled)
+        {
+            if (rounded > static_cast<double>(UINT32_MAX))
+            {
+                return false;
+            }
+            scale.mantissa = static_cast<uint32_t>(rounded);
+            scale.decimals = decimals;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DecimalScale::IsValid() const noexcept
+{
+    return mantissa != 0 && decimals <= MAX_DECIMALS;
+}
+
+double DecimalScale::GetStep() const noexcept
+{
+    return static_cast<double>(mantissa) / POWERS_OF_TEN[decimals];
+}
+
+double DecimalScale::ToDouble(const int64_t units) const noexcept
+{
+    return static_cast<double>(units) * static_cast<double>(mantissa) / POWERS_OF_TEN[decimals];
+}
+
+int64_t DecimalScale::ToUnits(const double value) const noexcept
+{
+    return std::llround(value * POWERS_OF_TEN[decimals] / static_cast<double>(mantissa));
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+// A decimal step such as a tick or lot size, held exactly as mantissa * 10^-decimals (0.0005 is 5 and 4).
+// Prices and amounts counted in whole steps can then be written to the wire without going through a double.
+struct DecimalScale
+{
+    static constexpr uint8_t MAX_DECIMALS = 9;
+
+    uint32_t mantissa;
+    uint8_t decimals;
+
+    // False if the step is not positive or needs more than MAX_DECIMALS places
+    static bool FromDouble(double step, DecimalScale& scale) noexcept;
+
+    // What FromDouble can produce; a scale read back from disk is checked with this before it is used
+    bool IsValid() const noexcept;
+
+    double GetStep() const noexcept;
+    double ToDouble(int64_t units) const noexcept;
+    // Nearest whole number of steps
+    int64_t ToUnits(double value) const noexcept;
+};
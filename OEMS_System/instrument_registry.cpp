@@ -0,0 +1,427 @@
+#include "instrument_registry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "binary_logger.h"
+#include "json_scanner.h"
+#include "mapped_file.h"
+
+namespace
+{
+    const LogFormat LOG_MALFORMED_REPLY{LogLevel::ERR, "[Instruments] Malformed get_instruments reply"};
+    const LogFormat LOG_MALFORMED_LIST{LogLevel::ERR, "[Instruments] Malformed instrument list"};
+    const LogFormat LOG_SKIPPED{LogLevel::WARN,
+                                "[Instruments] Skipped {} instruments without a usable name, tick or lot size"};
+    const LogFormat LOG_SNAPSHOT_TRUNCATED{LogLevel::ERR, "[Instruments] Snapshot {} is truncated"};
+    const LogFormat LOG_SNAPSHOT_UNKNOWN{LogLevel::WARN,
+                                         "[Instruments] Snapshot {} has an unknown layout, ignoring it"};
+    const LogFormat LOG_SNAPSHOT_CORRUPT{LogLevel::ERR,
+                                         "[Instruments] Snapshot {} has an invalid tick or lot size, ignoring it"};
+    const LogFormat LOG_WRITE_FAILED{LogLevel::ERR, "[Instruments] Failed to write {}"};
+    const LogFormat LOG_REPLACE_FAILED{LogLevel::ERR, "[Instruments] Failed to replace {}: {}"};
+
+    // Tolerance for prices and amounts that are a whole number of steps up to floating-point noise
+    constexpr double STEP_EPSILON = 1e-9;
+
+    int64_t NowMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // Copies a name into a fixed, NUL-terminated field; false if it does not fit
+    template<size_t Capacity>
+    bool CopyName(char (&field)[Capacity], const std::string_view value) noexcept
+    {
+        if (value.size() >= Capacity)
+        {
+            return false;
+        }
+        std::memcpy(field, value.data(), value.size());
+        std::memset(field + value.size(), 0, Capacity - value.size());
+        return true;
+    }
+
+    InstrumentKind ParseKind(const std::string_view kind) noexcept
+    {
+        if (kind == "option")
+        {
+            return InstrumentKind::OPTION;
+        }
+        if (kind == "spot")
+        {
+            return InstrumentKind::SPOT;
+        }
+        if (kind == "future_combo")
+        {
+            return InstrumentKind::FUTURE_COMBO;
+        }
+        if (kind == "option_combo")
+        {
+            return InstrumentKind::OPTION_COMBO;
+        }
+        return InstrumentKind::FUTURE;
+    }
+}
+
+std::string_view InstrumentInfo::GetName() const noexcept
+{
+    return std::string_view(instrument_name, ::strnlen(instrument_name, NAME_CAPACITY));
+}
+
+bool InstrumentInfo::IsExpired(const int64_t now_ms) const noexcept
+{
+    // Perpetuals and spot carry an expiry far in the future
+    return expiration_timestamp_ms != 0 && expiration_timestamp_ms <= now_ms;
+}
+
+double InstrumentInfo::GetTickSize(const double price) const noexcept
+{
+    // Steps are sorted by above_price, so the last one below the price wins
+    double tick = tick_size;
+    for (uint8_t i = 0; i < tick_size_step_count; ++i)
+    {
+        if (price <= tick_size_steps[i].above_price)
+        {
+            break;
+        }
+        tick = tick_size_steps[i].tick_size;
+    }
+    return tick;
+}
+
+double InstrumentInfo::RoundPrice(const double price, const bool is_buy) const noexcept
+{
+    const double tick = GetTickSize(price);
+    if (tick <= 0)
+    {
+        return price;
+    }
+    const double ticks = price / tick;
+    return (is_buy ? std::floor(ticks + STEP_EPSILON) : std::ceil(ticks - STEP_EPSILON)) * tick;
+}
+
+bool InstrumentInfo::IsValidAmount(const double amount) const noexcept
+{
+    if (min_trade_amount <= 0)
+    {
+        return amount > 0;
+    }
+    const double steps = amount / min_trade_amount;
+    return steps >= 1 - STEP_EPSILON && std::abs(steps - std::round(steps)) <= STEP_EPSILON * std::max(1.0, steps);
+}
+
+InstrumentRegistry::InstrumentRegistry(std::string snapshot_path)
+    : m_snapshot_path(std::move(snapshot_path))
+{
+    Publish(std::make_unique<Table>());
+}
+
+const InstrumentRegistry::Table& InstrumentRegistry::GetTable() const noexcept
+{
+    return *m_table.load(std::memory_order_acquire);
+}
+
+void InstrumentRegistry::BuildIndex(Table& table)
+{
+    table.by_name.clear();
+    table.by_name.reserve(table.records.size());
+    for (size_t id = 0; id < table.records.size(); ++id)
+    {
+        table.by_name.emplace(table.records[id].GetName(), static_cast<InstrumentId>(id));
+    }
+}
+
+// Function to swap in a new table and tell the listeners; the caller holds m_publish_mutex or is the constructor
+void InstrumentRegistry::Publish(std::unique_ptr<Table> table)
+{
+    const auto now = std::chrono::steady_clock::now();
+    m_retired_tables.erase(std::remove_if(m_retired_tables.begin(), m_retired_tables.end(),
+                                          [now](const RetiredTable& retired)
+                                          { return now - retired.retired_at > RETIRED_TABLE_LIFETIME; }),
+                           m_retired_tables.end());
+
+    m_table.store(table.get(), std::memory_order_release);
+    if (m_current_table)
+    {
+        m_retired_tables.push_back({std::move(m_current_table), now});
+    }
+    m_current_table = std::move(table);
+    for (const auto& listener : m_update_listeners)
+    {
+        listener();
+    }
+}
+
+bool InstrumentRegistry::DecodeInstrument(const std::string_view object, InstrumentInfo& info)
+{
+    std::memset(&info, 0, sizeof(info));
+    bool name_ok = false;
+    const bool parsed = JsonScanner::ForEachMember(
+        object,
+        [&](const std::string_view key, const std::string_view value)
+        {
+            if (key == "instrument_name")
+            {
+                name_ok = CopyName(info.instrument_name, JsonScanner::ToStringView(value));
+            }
+            else if (key == "kind")
+            {
+                info.kind = ParseKind(JsonScanner::ToStringView(value));
+            }
+            else if (key == "base_currency")
+            {
+                CopyName(info.base_currency, JsonScanner::ToStringView(value));
+            }
+            else if (key == "quote_currency")
+            {
+                CopyName(info.quote_currency, JsonScanner::ToStringView(value));
+            }
+            else if (key == "settlement_currency")
+            {
+                CopyName(info.settlement_currency, JsonScanner::ToStringView(value));
+            }
+            else if (key == "instrument_type")
+            {
+                info.is_inverse = JsonScanner::ToStringView(value) == "reversed";
+            }
+            else if (key == "option_type")
+            {
+                const std::string_view option_type = JsonScanner::ToStringView(value);
+                info.option_type = option_type == "call" ? OptionType::CALL
+                                   : option_type == "put" ? OptionType::PUT
+                                                          : OptionType::NONE;
+            }
+            else if (key == "tick_size")
+            {
+                JsonScanner::ToDouble(value, info.tick_size);
+            }
+            else if (key == "tick_size_steps")
+            {
+                JsonScanner::ForEachElement(value,
+                    [&](const std::string_view step)
+                    {
+                        if (info.tick_size_step_count == InstrumentInfo::MAX_TICK_SIZE_STEPS)
+                        {
+                            return false;
+                        }
+                        TickSizeStep& out = info.tick_size_steps[info.tick_size_step_count];
+                        std::string_view field;
+                        if (JsonScanner::FindMember(step, "above_price", field) &&
+                            JsonScanner::ToDouble(field, out.above_price) &&
+                            JsonScanner::FindMember(step, "tick_size", field) &&
+                            JsonScanner::ToDouble(field, out.tick_size))
+                        {
+                            ++info.tick_size_step_count;
+                        }
+                        return true;
+                    });
+            }
+            else if (key == "contract_size")
+            {
+                JsonScanner::ToDouble(value, info.contract_size);
+            }
+            else if (key == "min_trade_amount")
+            {
+                JsonScanner::ToDouble(value, info.min_trade_amount);
+            }
+            else if (key == "strike")
+            {
+                JsonScanner::ToDouble(value, info.strike);
+            }
+            else if (key == "expiration_timestamp")
+            {
+                JsonScanner::ToInt64(value, info.expiration_timestamp_ms);
+            }
+            else if (key == "creation_timestamp")
+            {
+                JsonScanner::ToInt64(value, info.creation_timestamp_ms);
+            }
+            return true;
+        });
+
+    std::sort(info.tick_size_steps, info.tick_size_steps + info.tick_size_step_count,
+              [](const TickSizeStep& a, const TickSizeStep& b) { return a.above_price < b.above_price; });
+
+    return parsed && name_ok && DecimalScale::FromDouble(info.tick_size, info.price_scale) &&
+           DecimalScale::FromDouble(info.min_trade_amount, info.amount_scale);
+}
+
+bool InstrumentRegistry::Apply(const std::string_view response)
+{
+    std::string_view result;
+    if (!JsonScanner::FindMember(response, "result", result))
+    {
+        BinaryLogger::Write(LOG_MALFORMED_REPLY);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_publish_mutex);
+    const Table& current = GetTable();
+    auto table = std::make_unique<Table>();
+    table->records = current.records;
+
+    // Instruments not in the current table, in case one is listed twice
+    std::unordered_map<std::string, InstrumentId> new_ids;
+    size_t skipped = 0;
+    InstrumentInfo info;
+    const bool parsed = JsonScanner::ForEachElement(
+        result,
+        [&](const std::string_view element)
+        {
+            if (!DecodeInstrument(element, info))
+            {
+                ++skipped;
+                return true;
+            }
+
+            const auto existing = current.by_name.find(info.GetName());
+            if (existing != current.by_name.end())
+            {
+                table->records[existing->second] = info;
+                return true;
+            }
+
+            const auto [it, is_new] =
+                new_ids.emplace(std::string(info.GetName()), static_cast<InstrumentId>(table->records.size()));
+            if (is_new)
+            {
+                table->records.push_back(info);
+            }
+            else
+            {
+                table->records[it->second] = info;
+            }
+            return true;
+        });
+
+    if (!parsed)
+    {
+        BinaryLogger::Write(LOG_MALFORMED_LIST);
+        return false;
+    }
+    if (skipped != 0)
+    {
+        BinaryLogger::Write(LOG_SKIPPED, skipped);
+    }
+
+    BuildIndex(*table);
+    Publish(std::move(table));
+    return true;
+}
+
+void InstrumentRegistry::AddUpdateListener(UpdateListener listener)
+{
+    m_update_listeners.push_back(std::move(listener));
+}
+
+bool InstrumentRegistry::LoadSnapshot()
+{
+    MappedFile file;
+    if (!file.Open(m_snapshot_path))
+    {
+        return false;
+    }
+
+    SnapshotHeader header;
+    if (file.Size() < sizeof(header))
+    {
+        BinaryLogger::Write(LOG_SNAPSHOT_TRUNCATED, m_snapshot_path);
+        return false;
+    }
+    std::memcpy(&header, file.Data(), sizeof(header));
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+        header.version != SNAPSHOT_VERSION || header.record_size != sizeof(InstrumentInfo))
+    {
+        BinaryLogger::Write(LOG_SNAPSHOT_UNKNOWN, m_snapshot_path);
+        return false;
+    }
+    if ((file.Size() - sizeof(header)) / sizeof(InstrumentInfo) < header.record_count)
+    {
+        BinaryLogger::Write(LOG_SNAPSHOT_TRUNCATED, m_snapshot_path);
+        return false;
+    }
+
+    auto table = std::make_unique<Table>();
+    table->records.resize(static_cast<size_t>(header.record_count));
+    std::memcpy(table->records.data(), file.Data() + sizeof(header), table->records.size() * sizeof(InstrumentInfo));
+    for (InstrumentInfo& info : table->records)
+    {
+        info.instrument_name[InstrumentInfo::NAME_CAPACITY - 1] = '\0';
+        // The scales index power-of-ten tables, so a corrupt one would read out of bounds; the caller fetches
+        // the list afresh instead
+        if (!info.price_scale.IsValid() || !info.amount_scale.IsValid())
+        {
+            BinaryLogger::Write(LOG_SNAPSHOT_CORRUPT, m_snapshot_path);
+            return false;
+        }
+    }
+    BuildIndex(*table);
+
+    std::lock_guard<std::mutex> lock(m_publish_mutex);
+    Publish(std::move(table));
+    return true;
+}
+
+bool InstrumentRegistry::SaveSnapshot() const
+{
+    const Table& table = GetTable();
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.record_size = sizeof(InstrumentInfo);
+    header.record_count = table.records.size();
+    header.saved_at_ms = NowMs();
+
+    const std::string temporary_path = m_snapshot_path + ".tmp";
+    {
+        std::ofstream out(temporary_path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(table.records.data()),
+                  static_cast<std::streamsize>(table.records.size() * sizeof(InstrumentInfo)));
+        if (!out)
+        {
+            BinaryLogger::Write(LOG_WRITE_FAILED, temporary_path);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, m_snapshot_path, error);
+    if (error)
+    {
+        BinaryLogger::Write(LOG_REPLACE_FAILED, m_snapshot_path, error.message());
+        return false;
+    }
+    return true;
+}
+
+size_t InstrumentRegistry::GetCount() const noexcept
+{
+    return GetTable().records.size();
+}
+
+InstrumentId InstrumentRegistry::GetId(const std::string_view instrument_name) const
+{
+    const Table& table = GetTable();
+    const auto it = table.by_name.find(instrument_name);
+    return it != table.by_name.end() ? it->second : INVALID_INSTRUMENT_ID;
+}
+
+const InstrumentInfo* InstrumentRegistry::Find(const std::string_view instrument_name) const
+{
+    const Table& table = GetTable();
+    const auto it = table.by_name.find(instrument_name);
+    return it != table.by_name.end() ? &table.records[it->second] : nullptr;
+}
+
+const InstrumentInfo* InstrumentRegistry::Get(const InstrumentId id) const noexcept
+{
+    const Table& table = GetTable();
+    return id < table.records.size() ? &table.records[id] : nullptr;
+}
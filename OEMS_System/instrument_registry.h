@@ -0,0 +1,166 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "decimal_scale.h"
+
+// Dense index of an instrument, assigned in the order instruments are first seen. Stable for the life of the
+// process; a restart may number instruments differently.
+using InstrumentId = uint32_t;
+inline constexpr InstrumentId INVALID_INSTRUMENT_ID = ~InstrumentId{0};
+
+enum class InstrumentKind : uint8_t
+{
+    FUTURE,
+    OPTION,
+    SPOT,
+    FUTURE_COMBO,
+    OPTION_COMBO
+};
+
+enum class OptionType : uint8_t
+{
+    NONE,
+    CALL,
+    PUT
+};
+
+// Tick size that applies once the price is above above_price
+struct TickSizeStep
+{
+    double above_price;
+    double tick_size;
+};
+
+// One instrument from public/get_instruments. Plain data with fixed-size names, so the snapshot file is just
+// these records back to back.
+struct InstrumentInfo
+{
+    static constexpr size_t NAME_CAPACITY = 48;
+    static constexpr size_t CURRENCY_CAPACITY = 8;
+    static constexpr size_t MAX_TICK_SIZE_STEPS = 4;
+
+    char instrument_name[NAME_CAPACITY];
+    char base_currency[CURRENCY_CAPACITY];
+    char quote_currency[CURRENCY_CAPACITY];
+    char settlement_currency[CURRENCY_CAPACITY];
+    InstrumentKind kind;
+    OptionType option_type;
+    bool is_inverse;                  // "reversed": sized in USD, settled in the base currency
+    uint8_t tick_size_step_count;
+    double tick_size;
+    double contract_size;
+    double min_trade_amount;
+    DecimalScale price_scale;         // tick_size, exactly: prices are counted in these
+    DecimalScale amount_scale;        // min_trade_amount, exactly: amounts are counted in these
+    double strike;
+    int64_t expiration_timestamp_ms;
+    int64_t creation_timestamp_ms;
+    TickSizeStep tick_size_steps[MAX_TICK_SIZE_STEPS];
+
+    std::string_view GetName() const noexcept;
+    bool IsExpired(int64_t now_ms) const noexcept;
+    double GetTickSize(double price) const noexcept;
+
+    // Snaps a price to its tick on the passive side: down for buys, up for sells
+    double RoundPrice(double price, bool is_buy) const noexcept;
+    // True if the amount is at least the minimum and a whole multiple of it
+    bool IsValidAmount(double amount) const noexcept;
+};
+
+static_assert(std::is_trivially_copyable_v<InstrumentInfo>, "InstrumentInfo is written to disk as raw bytes");
+
+// Tick size, contract size, minimum amount and expiry of every instrument, with names interned to dense ids.
+//
+// The registry is filled from public/get_instruments replies and persisted to a binary snapshot: a small
+// header followed by the InstrumentInfo records as they sit in memory. On restart the snapshot is mapped and
+// copied in one pass, so orders can be validated before the first download has even been sent.
+//
+// Readers go through one atomic load to an immutable table; a refresh builds a new table that keeps every
+// existing id, publishes it and retires the old one, like the token manager does with its state.
+class InstrumentRegistry
+{
+  public:
+    // Invoked after every new table is published, on the thread that loaded or applied it and under the lock
+    // that orders publishes, so a listener must not call LoadSnapshot or Apply itself
+    using UpdateListener = std::function<void()>;
+
+    static constexpr const char* DEFAULT_SNAPSHOT_PATH = "instruments.bin";
+    static constexpr std::chrono::minutes RETIRED_TABLE_LIFETIME{10};
+
+  private:
+    struct SnapshotHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t record_size;
+        uint64_t record_count;
+        int64_t saved_at_ms;
+    };
+
+    static constexpr char SNAPSHOT_MAGIC[8] = {'O', 'E', 'M', 'S', 'I', 'N', 'S', 'T'};
+    static constexpr uint32_t SNAPSHOT_VERSION = 2;
+
+    struct Table
+    {
+        std::vector<InstrumentInfo> records;
+        // Keys point into records, which is never resized once the table is published
+        std::unordered_map<std::string_view, InstrumentId> by_name;
+    };
+
+    struct RetiredTable
+    {
+        std::unique_ptr<const Table> table;
+        std::chrono::steady_clock::time_point retired_at;
+    };
+
+    std::string m_snapshot_path;
+    std::atomic<const Table*> m_table;
+    std::mutex m_publish_mutex;
+    std::unique_ptr<const Table> m_current_table;
+    // Superseded tables stay alive for a while so readers still holding a record are unaffected
+    std::vector<RetiredTable> m_retired_tables;
+    std::vector<UpdateListener> m_update_listeners;
+
+    static bool DecodeInstrument(std::string_view object, InstrumentInfo& info);
+    static void BuildIndex(Table& table);
+
+    const Table& GetTable() const noexcept;
+    void Publish(std::unique_ptr<Table> table);
+
+  public:
+    explicit InstrumentRegistry(std::string snapshot_path = DEFAULT_SNAPSHOT_PATH);
+
+    InstrumentRegistry(const InstrumentRegistry&) = delete;
+    InstrumentRegistry& operator=(const InstrumentRegistry&) = delete;
+
+    // Replaces the contents with the snapshot; false, leaving the contents alone, if it is missing, was written by
+    // another layout or holds an invalid tick or lot size
+    bool LoadSnapshot();
+    // Writes to a temporary file and renames it over the snapshot, so a crash never leaves half a file
+    bool SaveSnapshot() const;
+
+    // Merges a public/get_instruments reply: known instruments are updated in place, new ones get the next ids
+    bool Apply(std::string_view response);
+
+    // Listeners must be added before the first LoadSnapshot or Apply they should hear about
+    void AddUpdateListener(UpdateListener listener);
+
+    size_t GetCount() const noexcept;
+    InstrumentId GetId(std::string_view instrument_name) const;
+
+    // Records stay valid for RETIRED_TABLE_LIFETIME after a refresh; hold on to the id, not the pointer.
+    // Both return null for unknown instruments.
+    const InstrumentInfo* Find(std::string_view instrument_name) const;
+    const InstrumentInfo* Get(InstrumentId id) const noexcept;
+};
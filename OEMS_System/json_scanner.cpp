@@ -0,0 +1,120 @@
+#include "json_scanner.h"
+
+#include <charconv>
+
+size_t JsonScanner::SkipWhitespace(const std::string_view text, size_t pos) noexcept
+{
+    while (pos < text.size() && (text[pos] == ' ' || text[pos] == '\n' || text[pos] == '\r' || text[pos] == '\t'))
+    {
+        ++pos;
+    }
+    return pos;
+}
+
+size_t JsonScanner::SkipValue(const std::string_view text, size_t pos) noexcept
+{
+    if (pos >= text.size())
+    {
+        return npos;
+    }
+
+    const char first = text[pos];
+    if (first == '"')
+    {
+        for (++pos; pos < text.size(); ++pos)
+        {
+            if (text[pos] == '\\')
+            {
+                ++pos;
+            }
+            else if (text[pos] == '"')
+            {
+                return pos + 1;
+            }
+        }
+        return npos;
+    }
+
+    if (first == '{' || first == '[')
+    {
+        int depth = 0;
+        for (; pos < text.size(); ++pos)
+        {
+            const char c = text[pos];
+            if (c == '"')
+            {
+                pos = SkipValue(text, pos);
+                if (pos == npos)
+                {
+                    return npos;
+                }
+                --pos;
+            }
+            else if (c == '{' || c == '[')
+            {
+                ++depth;
+            }
+            else if (c == '}' || c == ']')
+            {
+                if (--depth == 0)
+                {
+                    return pos + 1;
+                }
+            }
+        }
+        return npos;
+    }
+
+    // Number, true, false or null
+    const size_t start = pos;
+    while (pos < text.size() && text[pos] != ',' && text[pos] != '}' && text[pos] != ']' && text[pos] != ' ' &&
+           text[pos] != '\n' && text[pos] != '\r' && text[pos] != '\t')
+    {
+        ++pos;
+    }
+    return pos == start ? npos : pos;
+}
+
+bool JsonScanner::FindMember(const std::string_view object, const std::string_view key, std::string_view& value)
+{
+    bool found = false;
+    ForEachMember(object,
+                  [&](const std::string_view member_key, const std::string_view member_value)
+                  {
+                      if (member_key == key)
+                      {
+                          value = member_value;
+                          found = true;
+                          return false;
+                      }
+                      return true;
+                  });
+    return found;
+}
+
+bool JsonScanner::ToDouble(const std::string_view value, double& out) noexcept
+{
+    const auto result = std::from_chars(value.data(), value.data() + value.size(), out);
+    return result.ec == std::errc() && result.ptr == value.data() + value.size();
+}
+
+bool JsonScanner::ToInt64(const std::string_view value, int64_t& out) noexcept
+{
+    const auto result = std::from_chars(value.data(), value.data() + value.size(), out);
+    return result.ec == std::errc() && result.ptr == value.data() + value.size();
+}
+
+bool JsonScanner::ToUInt64(const std::string_view value, uint64_t& out) noexcept
+{
+    const auto result = std::from_chars(value.data(), value.data() + value.size(), out);
+    return result.ec == std::errc() && result.ptr == value.data() + value.size();
+}
+
+std::string_view JsonScanner::ToStringView(const std::string_view value) noexcept
+{
+    if (value.size() < 2 || value.front() != '"' || value.back() != '"')
+    {
+        return {};
+    }
+    return value.substr(1, value.size() - 2);
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// On-demand JSON reader: walks the raw frame and hands out views of the values that are asked for,
+// without building a DOM or copying. String views keep escape sequences as they appear on the wire.
+class JsonScanner
+{
+  public:
+    static constexpr size_t npos = std::string_view::npos;
+
+    static size_t SkipWhitespace(std::string_view text, size_t pos) noexcept;
+
+    // Returns the position just past the value starting at pos, or npos if it is malformed
+    static size_t SkipValue(std::string_view text, size_t pos) noexcept;
+
+    // Calls visitor(key, value) for each member; the visitor returns false to stop early
+    template<typename Visitor>
+    static bool ForEachMember(std::string_view object, Visitor&& visitor);
+
+    // Calls visitor(value) for each element; the visitor returns false to stop early
+    template<typename Visitor>
+    static bool ForEachElement(std::string_view array, Visitor&& visitor);
+
+    static bool FindMember(std::string_view object, std::string_view key, std::string_view& value);
+
+    // Each parses the whole value as a number with std::from_chars; false for null, strings or trailing text.
+    // On false, out may have been overwritten.
+    static bool ToDouble(std::string_view value, double& out) noexcept;
+    static bool ToInt64(std::string_view value, int64_t& out) noexcept;
+    static bool ToUInt64(std::string_view value, uint64_t& out) noexcept;
+
+    // Strips the quotes from a string value; returns an empty view for non-strings
+    static std::string_view ToStringView(std::string_view value) noexcept;
+};
+
+template<typename Visitor>
+bool JsonScanner::ForEachMember(const std::string_view object, Visitor&& visitor)
+{
+    size_t pos = SkipWhitespace(object, 0);
+    if (pos >= object.size() || object[pos] != '{')
+    {
+        return false;
+    }
+
+    pos = SkipWhitespace(object, pos + 1);
+    if (pos < object.size() && object[pos] == '}')
+    {
+        return true;
+    }
+
+    while (pos < object.size())
+    {
+        const size_t key_end = SkipValue(object, pos);
+        if (key_end == npos || object[pos] != '"')
+        {
+            return false;
+        }
+        const std::string_view key = object.substr(pos + 1, key_end - pos - 2);
+
+        pos = SkipWhitespace(object, key_end);
+        if (pos >= object.size() || object[pos] != ':')
+        {
+            return false;
+        }
+
+        pos = SkipWhitespace(object, pos + 1);
+        const size_t value_end = SkipValue(object, pos);
+        if (value_end == npos)
+        {
+            return false;
+        }
+
+        if (!visitor(key, object.substr(pos, value_end - pos)))
+        {
+            return true;
+        }
+
+        pos = SkipWhitespace(object, value_end);
+        if (pos >= object.size())
+        {
+            return false;
+        }
+        if (object[pos] == '}')
+        {
+            return true;
+        }
+        if (object[pos] != ',')
+        {
+            return false;
+        }
+        pos = SkipWhitespace(object, pos + 1);
+    }
+    return false;
+}
+
+template<typename Visitor>
+bool JsonScanner::ForEachElement(const std::string_view array, Visitor&& visitor)
+{
+    size_t pos = SkipWhitespace(array, 0);
+    if (pos >= array.size() || array[pos] != '[')
+    {
+        return false;
+    }
+
+    pos = SkipWhitespace(array, pos + 1);
+    if (pos < array.size() && array[pos] == ']')
+    {
+        return true;
+    }
+
+    while (pos < array.size())
+    {
+        const size_t value_end = SkipValue(array, pos);
+        if (value_end == npos)
+        {
+            return false;
+        }
+
+        if (!visitor(array.substr(pos, value_end - pos)))
+        {
+            return true;
+        }
+
+        pos = SkipWhitespace(array, value_end);
+        if (pos >= array.size())
+        {
+            return false;
+        }
+        if (array[pos] == ']')
+        {
+            return true;
+        }
+        if (array[pos] != ',')
+        {
+            return false;
+        }
+        pos = SkipWhitespace(array, pos + 1);
+    }
+    return false;
+}
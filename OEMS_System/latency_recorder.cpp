@@ -0,0 +1,296 @@
+#include "latency_recorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+    thread_local int64_t t_response_received_ns = 0;
+
+    int GetHighestBit(uint64_t value) noexcept
+    {
+        int bit = 0;
+        for (int shift = 32; shift > 0; shift >>= 1)
+        {
+            if (value >> shift)
+            {
+                value >>= shift;
+                bit += shift;
+            }
+        }
+        return bit;
+    }
+
+    void AppendMicros(std::string& out, const char* label, const uint64_t value_ns)
+    {
+        char buffer[48];
+        const int length = std::snprintf(buffer, sizeof(buffer), " %s=%.1fus", label,
+                                         static_cast<double>(value_ns) / 1000.0);
+        out.append(buffer, static_cast<size_t>(std::max(length, 0)));
+    }
+}
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value) noexcept
+{
+    constexpr uint64_t max_value = (uint64_t{1} << MAGNITUDE_BITS) - 1;
+    value = std::min(value, max_value);
+    if (value < SUB_BUCKET_COUNT)
+    {
+        return static_cast<size_t>(value);
+    }
+
+    const int shift = GetHighestBit(value) - SUB_BUCKET_BITS;
+    return static_cast<size_t>(shift) * SUB_BUCKET_COUNT + static_cast<size_t>(value >> shift);
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(const size_t index) noexcept
+{
+    if (index < SUB_BUCKET_COUNT)
+    {
+        return index;
+    }
+
+    const size_t shift = index / SUB_BUCKET_COUNT - 1;
+    const uint64_t lower = static_cast<uint64_t>(index % SUB_BUCKET_COUNT + SUB_BUCKET_COUNT) << shift;
+    return lower + (uint64_t{1} << shift) - 1;
+}
+
+void LatencyHistogram::Record(const int64_t value_ns) noexcept
+{
+    const uint64_t value = value_ns < 0 ? 0 : static_cast<uint64_t>(value_ns);
+    m_buckets[GetBucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sum_ns.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t current = m_min_ns.load(std::memory_order_relaxed);
+    while (value < current && !m_min_ns.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+    current = m_max_ns.load(std::memory_order_relaxed);
+    while (value > current && !m_max_ns.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    {
+    }
+}
+
+void LatencyHistogram::Reset() noexcept
+{
+    for (auto& bucket : m_buckets)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sum_ns.store(0, std::memory_order_relaxed);
+    m_min_ns.store(~uint64_t{0}, std::memory_order_relaxed);
+    m_max_ns.store(0, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetCount() const noexcept
+{
+    return m_count.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetValueAtPercentile(const double percentile) const noexcept
+{
+    // Bucket counts are read one at a time, so use their own total rather than m_count
+    uint64_t total = 0;
+    for (const auto& bucket : m_buckets)
+    {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    const double clamped = std::min(std::max(percentile, 0.0), 100.0);
+    const auto target = std::max<uint64_t>(1, static_cast<uint64_t>(clamped / 100.0 * static_cast<double>(total) + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i)
+    {
+        seen += m_buckets[i].load(std::memory_order_relaxed);
+        if (seen >= target)
+        {
+            return std::min(GetBucketUpperBound(i), m_max_ns.load(std::memory_order_relaxed));
+        }
+    }
+    return m_max_ns.load(std::memory_order_relaxed);
+}
+
+LatencySummary LatencyHistogram::GetSummary() const noexcept
+{
+    const uint64_t count = GetCount();
+    if (count == 0)
+    {
+        return {0, 0, 0, 0, 0, 0, 0, 0.0};
+    }
+
+    return {count,
+            m_min_ns.load(std::memory_order_relaxed),
+            GetValueAtPercentile(50.0),
+            GetValueAtPercentile(90.0),
+            GetValueAtPercentile(99.0),
+            GetValueAtPercentile(99.9),
+            m_max_ns.load(std::memory_order_relaxed),
+            static_cast<double>(m_sum_ns.load(std::memory_order_relaxed)) / static_cast<double>(count)};
+}
+
+LatencyTrace::LatencyTrace(const EndpointId endpoint_id) noexcept : endpoint(endpoint_id)
+{
+    stamps[0] = LatencyRecorder::NowNs();
+}
+
+void LatencyTrace::Mark(const LatencyStage stage, const int64_t now_ns) noexcept
+{
+    const auto index = static_cast<size_t>(stage) + 1;
+    if (index < STAMP_COUNT)
+    {
+        stamps[index] = now_ns;
+    }
+}
+
+void LatencyTrace::Mark(const LatencyStage stage) noexcept
+{
+    Mark(stage, LatencyRecorder::NowNs());
+}
+
+int64_t LatencyRecorder::NowNs() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+std::string_view LatencyRecorder::GetStageName(const LatencyStage stage) noexcept
+{
+    switch (stage)
+    {
+        case LatencyStage::VALIDATION: return "validation";
+        case LatencyStage::TOKEN_CHECK: return "token_check";
+        case LatencyStage::ADMISSION: return "admission";
+        case LatencyStage::SEND: return "send";
+        case LatencyStage::EXCHANGE: return "exchange";
+        case LatencyStage::PARSE: return "parse";
+        case LatencyStage::WAKEUP: return "wakeup";
+        case LatencyStage::TOTAL: return "total";
+        default: return "unknown";
+    }
+}
+
+void LatencyRecorder::MarkResponseReceived() noexcept
+{
+    t_response_received_ns = NowNs();
+}
+
+int64_t LatencyRecorder::TakeResponseReceived() noexcept
+{
+    const int64_t received = t_response_received_ns;
+    t_response_received_ns = 0;
+    return received;
+}
+
+void LatencyRecorder::Record(const EndpointId endpoint, const LatencyStage stage, const int64_t value_ns) noexcept
+{
+    m_histograms[static_cast<size_t>(endpoint)][static_cast<size_t>(stage)].Record(value_ns);
+}
+
+void LatencyRecorder::Record(const LatencyTrace& trace) noexcept
+{
+    // Each marked stage runs from the end of the last marked stage before it
+    int64_t previous = trace.stamps[0];
+    for (size_t i = 1; i < LatencyTrace::STAMP_COUNT; ++i)
+    {
+        if (trace.stamps[i] != 0)
+        {
+            Record(trace.endpoint, static_cast<LatencyStage>(i - 1), trace.stamps[i] - previous);
+            previous = trace.stamps[i];
+        }
+    }
+    Record(trace.endpoint, LatencyStage::TOTAL, previous - trace.stamps[0]);
+}
+
+void LatencyRecorder::Reset() noexcept
+{
+    for (auto& stages : m_histograms)
+    {
+        for (auto& histogram : stages)
+        {
+            histogram.Reset();
+        }
+    }
+}
+
+const LatencyHistogram& LatencyRecorder::GetHistogram(const EndpointId endpoint,
+                                                      const LatencyStage stage) const noexcept
+{
+    return m_histograms[static_cast<size_t>(endpoint)][static_cast<size_t>(stage)];
+}
+
+uint64_t LatencyRecorder::GetSampleCount() const noexcept
+{
+    uint64_t count = 0;
+    for (const auto& stages : m_histograms)
+    {
+        count += stages[static_cast<size_t>(LatencyStage::TOTAL)].GetCount() +
+                 stages[static_cast<size_t>(LatencyStage::WAKEUP)].GetCount();
+    }
+    return count;
+}
+
+void LatencyRecorder::FormatReport(std::string& out) const
+{
+    out.clear();
+    for (size_t endpoint = 0; endpoint < ENDPOINT_COUNT; ++endpoint)
+    {
+        for (size_t stage = 0; stage < STAGE_COUNT; ++stage)
+        {
+            const LatencySummary summary = m_histograms[endpoint][stage].GetSummary();
+            if (summary.count == 0)
+            {
+                continue;
+            }
+
+            out += "[Latency] ";
+            out += Endpoints::ALL[endpoint]->rpc_method;
+            out += ' ';
+            out += GetStageName(static_cast<LatencyStage>(stage));
+            out += " n=";
+            out += std::to_string(summary.count);
+            AppendMicros(out, "mean", static_cast<uint64_t>(summary.mean_ns));
+            AppendMicros(out, "min", summary.min_ns);
+            AppendMicros(out, "p50", summary.p50_ns);
+            AppendMicros(out, "p90", summary.p90_ns);
+            AppendMicros(out, "p99", summary.p99_ns);
+            AppendMicros(out, "p99.9", summary.p999_ns);
+            AppendMicros(out, "max", summary.max_ns);
+            out += '\n';
+        }
+    }
+}
+
+InFlightTrace::InFlightTrace(LatencyRecorder& recorder, const LatencyTrace& trace) noexcept
+    : m_recorder(recorder), m_trace(trace)
+{
+}
+
+void InFlightTrace::Mark(const LatencyStage stage, const int64_t now_ns) noexcept
+{
+    m_trace.Mark(stage, now_ns);
+}
+
+void InFlightTrace::Mark(const LatencyStage stage) noexcept
+{
+    m_trace.Mark(stage);
+}
+
+void InFlightTrace::Discard() noexcept
+{
+    m_is_discarded.store(true, std::memory_order_relaxed);
+}
+
+void InFlightTrace::Finish() noexcept
+{
+    if (m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1 && !m_is_discarded.load(std::memory_order_relaxed))
+    {
+        m_recorder.Record(m_trace);
+    }
+}
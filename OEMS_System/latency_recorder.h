@@ -0,0 +1,130 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "request_encoder.h"
+
+// Consecutive stages of one request; each histogram holds the time spent in that stage alone
+enum class LatencyStage
+{
+    VALIDATION,     // Parameter checks
+    TOKEN_CHECK,    // Access token expiry check and refresh
+    ADMISSION,      // Rate-limiter admission including any queueing delay; HTTP requests are encoded here
+    SEND,           // Handing the request to the transport; JSON-RPC requests are encoded here
+    EXCHANGE,       // Sent until the reply arrived: network plus exchange time
+    PARSE,          // Reply arrived until the completion callback ran
+    WAKEUP,         // Completion until a blocked caller resumed (blocking API only)
+    TOTAL,          // Start of validation until the completion callback ran
+    COUNT
+};
+
+struct LatencySummary
+{
+    uint64_t count;
+    uint64_t min_ns;
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t max_ns;
+    double mean_ns;
+};
+
+// Lock-free log-linear histogram in the style of HdrHistogram: every power of two is split into
+// SUB_BUCKET_COUNT linear buckets, so a recorded value is off by at most 1/SUB_BUCKET_COUNT.
+class LatencyHistogram
+{
+  public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static constexpr int MAGNITUDE_BITS = 40;  // Values above ~18 minutes land in the last bucket
+    static constexpr size_t BUCKET_COUNT = (MAGNITUDE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+  private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> m_buckets{};
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<uint64_t> m_sum_ns{0};
+    std::atomic<uint64_t> m_min_ns{~uint64_t{0}};
+    std::atomic<uint64_t> m_max_ns{0};
+
+    static size_t GetBucketIndex(uint64_t value) noexcept;
+    // Largest value that maps to the bucket
+    static uint64_t GetBucketUpperBound(size_t index) noexcept;
+
+  public:
+    void Record(int64_t value_ns) noexcept;
+    void Reset() noexcept;
+
+    uint64_t GetCount() const noexcept;
+    uint64_t GetValueAtPercentile(double percentile) const noexcept;
+    LatencySummary GetSummary() const noexcept;
+};
+
+// Stage timestamps of one request from validation to PARSE, filled in as it moves through OrderExecution
+struct LatencyTrace
+{
+    static constexpr size_t STAMP_COUNT = static_cast<size_t>(LatencyStage::PARSE) + 2;
+
+    EndpointId endpoint;
+    std::array<int64_t, STAMP_COUNT> stamps{};  // [0] is the start, [stage + 1] the end of that stage
+
+    explicit LatencyTrace(EndpointId endpoint_id) noexcept;
+
+    // Ends the stage at now_ns; stages that are never marked are left out of the histograms
+    void Mark(LatencyStage stage, int64_t now_ns) noexcept;
+    void Mark(LatencyStage stage) noexcept;
+};
+
+// Histograms for every endpoint and stage of the order path
+class LatencyRecorder
+{
+  private:
+    static constexpr size_t ENDPOINT_COUNT = static_cast<size_t>(EndpointId::COUNT);
+    static constexpr size_t STAGE_COUNT = static_cast<size_t>(LatencyStage::COUNT);
+
+    std::array<std::array<LatencyHistogram, STAGE_COUNT>, ENDPOINT_COUNT> m_histograms;
+
+  public:
+    static int64_t NowNs() noexcept;
+    static std::string_view GetStageName(LatencyStage stage) noexcept;
+
+    // Transports stamp the arrival of a reply just before they parse it; the completion callback, which
+    // runs on the same thread once parsing is done, takes the stamp. Returns 0 if nothing was stamped.
+    static void MarkResponseReceived() noexcept;
+    static int64_t TakeResponseReceived() noexcept;
+
+    void Record(EndpointId endpoint, LatencyStage stage, int64_t value_ns) noexcept;
+    void Record(const LatencyTrace& trace) noexcept;
+    void Reset() noexcept;
+
+    const LatencyHistogram& GetHistogram(EndpointId endpoint, LatencyStage stage) const noexcept;
+    uint64_t GetSampleCount() const noexcept;
+
+    // One line per endpoint and stage that has samples
+    void FormatReport(std::string& out) const;
+};
+
+// Shared by the sending thread and the completion callback, since the reply can arrive before the send
+// call returns. Each side calls Finish once; the trace is recorded by whichever finishes second.
+class InFlightTrace
+{
+  private:
+    LatencyRecorder& m_recorder;
+    LatencyTrace m_trace;
+    std::atomic<int> m_pending{2};
+    std::atomic<bool> m_is_discarded{false};
+
+  public:
+    InFlightTrace(LatencyRecorder& recorder, const LatencyTrace& trace) noexcept;
+
+    void Mark(LatencyStage stage, int64_t now_ns) noexcept;
+    void Mark(LatencyStage stage) noexcept;
+
+    // Failed requests are not recorded so that timeouts and rejects do not skew the exchange latency
+    void Discard() noexcept;
+    void Finish() noexcept;
+};
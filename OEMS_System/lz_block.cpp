@@ -0,0 +1,208 @@
+#include "lz_block.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    static constexpr size_t LENGTH_MASK = 15;
+
+    uint32_t Read32(const unsigned char* data) noexcept
+    {
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    // Function to write the part of a length the token could not hold, as a run of 255s and a remainder
+    void WriteExtraLength(unsigned char*& out, size_t length) noexcept
+    {
+        while (length >= 255)
+        {
+            *out++ = 255;
+            length -= 255;
+        }
+        *out++ = static_cast<unsigned char>(length);
+    }
+
+    bool ReadExtraLength(const unsigned char*& in, const unsigned char* end, size_t& length) noexcept
+    {
+        unsigned char byte = 0;
+        do
+        {
+            if (in == end)
+            {
+                return false;
+            }
+            byte = *in++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    // Function to write literals followed by a match; a match_length of 0 ends the block with literals only
+    bool WriteSequence(unsigned char*& out, const unsigned char* end, const unsigned char* literals,
+                       const size_t literal_length, const size_t offset, const size_t match_length,
+                       const size_t min_match) noexcept
+    {
+        const size_t match_code = match_length != 0 ? match_length - min_match : 0;
+        const size_t worst_case = 1 + literal_length / 255 + 1 + literal_length + 2 + match_code / 255 + 1;
+        if (static_cast<size_t>(end - out) < worst_case)
+        {
+            return false;
+        }
+
+        unsigned char* const token = out++;
+        *token = static_cast<unsigned char>(std::min(literal_length, LENGTH_MASK) << 4);
+        if (literal_length >= LENGTH_MASK)
+        {
+            WriteExtraLength(out, literal_length - LENGTH_MASK);
+        }
+        std::memcpy(out, literals, literal_length);
+        out += literal_length;
+
+        if (match_length == 0)
+        {
+            return true;
+        }
+
+        *out++ = static_cast<unsigned char>(offset & 0xFF);
+        *out++ = static_cast<unsigned char>(offset >> 8);
+        *token |= static_cast<unsigned char>(std::min(match_code, LENGTH_MASK));
+        if (match_code >= LENGTH_MASK)
+        {
+            WriteExtraLength(out, match_code - LENGTH_MASK);
+        }
+        return true;
+    }
+}
+
+LzBlock::LzBlock() : m_table(new uint32_t[size_t{1} << HASH_BITS]) {}
+
+size_t LzBlock::GetMaxCompressedSize(const size_t size) noexcept
+{
+    return size + size / 255 + 16;
+}
+
+size_t LzBlock::Compress(const char* source, const size_t size, char* destination, const size_t capacity) noexcept
+{
+    const auto* const in = reinterpret_cast<const unsigned char*>(source);
+    auto* out = reinterpret_cast<unsigned char*>(destination);
+    const unsigned char* const out_end = out + capacity;
+
+    // Positions are stored plus one so that zero means empty
+    std::memset(m_table.get(), 0, sizeof(uint32_t) << HASH_BITS);
+
+    size_t anchor = 0;
+    if (size > MATCH_START_LIMIT)
+    {
+        const size_t match_start_end = size - MATCH_START_LIMIT;
+        const size_t match_end = size - LAST_LITERALS;
+
+        size_t position = 0;
+        while (position < match_start_end)
+        {
+            const uint32_t sequence = Read32(in + position);
+            const uint32_t hash = (sequence * 2654435761U) >> (32 - HASH_BITS);
+            const size_t candidate = m_table[hash];
+            m_table[hash] = static_cast<uint32_t>(position + 1);
+
+            if (candidate == 0 || position - (candidate - 1) > MAX_OFFSET || Read32(in + candidate - 1) != sequence)
+            {
+                ++position;
+                continue;
+            }
+
+            const size_t match = candidate - 1;
+            size_t length = MIN_MATCH;
+            while (position + length < match_end && in[match + length] == in[position + length])
+            {
+                ++length;
+            }
+
+            if (!WriteSequence(out, out_end, in + anchor, position - anchor, position - match, length, MIN_MATCH))
+            {
+                return 0;
+            }
+            position += length;
+            anchor = position;
+        }
+    }
+
+    if (!WriteSequence(out, out_end, in + anchor, size - anchor, 0, 0, MIN_MATCH))
+    {
+        return 0;
+    }
+    return static_cast<size_t>(out - reinterpret_cast<unsigned char*>(destination));
+}
+
+size_t LzBlock::Decompress(const char* source, const size_t size, char* destination, const size_t capacity) noexcept
+{
+    const auto* in = reinterpret_cast<const unsigned char*>(source);
+    const unsigned char* const in_end = in + size;
+    auto* const out_begin = reinterpret_cast<unsigned char*>(destination);
+    unsigned char* out = out_begin;
+    const unsigned char* const out_end = out + capacity;
+
+    while (in < in_end)
+    {
+        const unsigned char token = *in++;
+
+        size_t literal_length = token >> 4;
+        if (literal_length == LENGTH_MASK && !ReadExtraLength(in, in_end, literal_length))
+        {
+            return 0;
+        }
+        if (literal_length > static_cast<size_t>(in_end - in) || literal_length > static_cast<size_t>(out_end - out))
+        {
+            return 0;
+        }
+        std::memcpy(out, in, literal_length);
+        in += literal_length;
+        out += literal_length;
+
+        // The last sequence has literals only
+        if (in == in_end)
+        {
+            break;
+        }
+
+        if (in_end - in < 2)
+        {
+            return 0;
+        }
+        const size_t offset = static_cast<size_t>(in[0]) | (static_cast<size_t>(in[1]) << 8);
+        in += 2;
+        if (offset == 0 || offset > static_cast<size_t>(out - out_begin))
+        {
+            return 0;
+        }
+
+        size_t match_length = token & LENGTH_MASK;
+        if (match_length == LENGTH_MASK && !ReadExtraLength(in, in_end, match_length))
+        {
+            return 0;
+        }
+        match_length += MIN_MATCH;
+        if (match_length > static_cast<size_t>(out_end - out))
+        {
+            return 0;
+        }
+
+        const unsigned char* match = out - offset;
+        if (offset >= match_length)
+        {
+            std::memcpy(out, match, match_length);
+        }
+        else
+        {
+            // Byte by byte, as the match overlaps what it is producing
+            for (size_t i = 0; i < match_length; ++i)
+            {
+                out[i] = match[i];
+            }
+        }
+        out += match_length;
+    }
+    return static_cast<size_t>(out - out_begin);
+}
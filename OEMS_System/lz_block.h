@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Fast block compression in the LZ4 block format: greedy matching through a small hash table, favouring
+// speed over ratio. JSON frames from the exchange repeat their keys and channel names, which is most of
+// what it finds. Each block is self-contained; there is no framing, so callers store both sizes.
+class LzBlock
+{
+  private:
+    static constexpr size_t HASH_BITS = 12;
+    static constexpr size_t MIN_MATCH = 4;
+    static constexpr size_t MAX_OFFSET = 65535;
+    // The format ends every block with literals: a match may not start within 12 bytes of the end nor
+    // cover its last 5
+    static constexpr size_t MATCH_START_LIMIT = 12;
+    static constexpr size_t LAST_LITERALS = 5;
+
+    std::unique_ptr<uint32_t[]> m_table;
+
+  public:
+    LzBlock();
+
+    // Worst case output for size input bytes
+    static size_t GetMaxCompressedSize(size_t size) noexcept;
+
+    // Returns the compressed size, or 0 if it would not fit in capacity bytes
+    size_t Compress(const char* source, size_t size, char* destination, size_t capacity) noexcept;
+    // Returns the decompressed size, or 0 if source is malformed or the output exceeds capacity
+    static size_t Decompress(const char* source, size_t size, char* destination, size_t capacity) noexcept;
+};
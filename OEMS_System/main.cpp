@@ -3,9 +3,18 @@
 #include <csignal>
 #include <iostream>
 #include <limits>
+#include <memory>
+#include <thread>
 #include <drogon/drogon.h>
 
+#include "binary_logger.h"
+#include "market_data_recorder.h"
+#include "market_data_server.h"
+#include "option_chain.h"
 #include "order_execution.h"
+#include "strategy_thread.h"
+#include "thread_topology.h"
+#include "ticker_feed.h"
 #include "utilities.h"
 #include "web_socket_client.h"
 
@@ -15,8 +24,9 @@ void displayMenu() {
     std::cout << "2. Place Buy Order\n";
     std::cout << "3. Place Sell Order\n";
     std::cout << "4. Get Current Positions\n";
-    std::cout << "5. Exit\n";
-    std::cout << "Enter your choice (1-5): ";
+    std::cout << "5. Show Latency Statistics\n";
+    std::cout << "6. Exit\n";
+    std::cout << "Enter your choice (1-6): ";
 }
 
 int main()
@@ -24,11 +34,88 @@ int main()
     std::signal(SIGINT, Utilities::HandleExitSignal);
     std::ios_base::sync_with_stdio(false);
 
+    // Modules log through this and response displays run on its thread rather than the caller's
+    BinaryLogger& logger = BinaryLogger::Instance();
+    logger.AddConsumer(Utilities::DisplayLogRecord);
+    logger.Start();
+
     try
     {
+        // Credentials let the market-data connection carry the private order stream as well
+        const ApiCredentials api_credentials("client_key.txt", "client_secret.txt");
+        // The snapshot from the last run lets orders be checked before the first refresh has landed
+        InstrumentRegistry instrument_registry;
+        instrument_registry.LoadSnapshot();
+        // Each connection gets a loop of its own and consumers a thread of their own, placed as threads.json says.
+        // Both are declared before anything they run, so they outlive it.
+        ThreadTopology thread_topology;
+        thread_topology.LoadConfig();
+        thread_topology.Start();
+        StrategyThread strategy_thread(thread_topology.GetStrategyPlacement());
+        // Keeps every frame the exchange sends us; declared first so it outlives the connection feeding it
+        MarketDataRecorder market_data_recorder;
+        market_data_recorder.Start();
+        DrogonWebSocket market_data(&api_credentials, thread_topology.GetMarketDataLoop());
+        market_data.SetRecorder(&market_data_recorder);
+        // One raw ticker subscription per instrument, shared by every module that wants tickers
+        TickerFeed ticker_feed(market_data);
+        OrderBookManager order_book_manager(market_data);
+        OrderStore order_store(market_data);
+        PositionEngine position_engine(market_data, ticker_feed);
+        // Listens to both, so it has to exist before they start; its instrument table is too big for the stack
+        const auto risk_engine = std::make_unique<RiskEngine>(order_store, position_engine);
+        // Every listed BTC option, laid out for chain-wide queries; it follows the registry as listings change
+        OptionChain option_chain(ticker_feed, instrument_registry, "BTC");
+        option_chain.Start();
+        ticker_feed.Start();
+        strategy_thread.Subscribe(order_book_manager, order_store, position_engine);
+        order_store.Start();
+        position_engine.Start();
+        // Tracked up front so their mark prices are flowing before the first order, which the risk engine
+        // rejects for instruments it does not track yet
+        for (const char* instrument_name : {"BTC-PERPETUAL", "ETH-PERPETUAL", "BTC_USDC-PERPETUAL"})
+        {
+            risk_engine->Track(instrument_name);
+        }
+
+        // Controllers and listeners must be registered before the app starts
+        const auto market_data_server = std::make_shared<MarketDataServer>(order_book_manager, instrument_registry,
+                                                                             strategy_thread);
+        strategy_thread.Start();
+        drogon::app().registerController(market_data_server);
+        drogon::app().addListener("0.0.0.0", MarketDataServer::DEFAULT_PORT);
+
+        // Drogon clients deliver their callbacks on the app loop, so keep it running in the background
+        std::thread([] { drogon::app().run(); }).detach();
+        market_data_server->Start();
+
         // Initialize managers
         TokenManager token_manager("access_token.txt", "refresh_token.txt", 2505599);
-        const OrderExecution order_execution(token_manager);
+
+        OrderGateway order_gateway(token_manager, thread_topology.GetGatewayLoop());
+        OrderExecution order_execution(token_manager, &order_book_manager, &order_gateway, &order_store,
+                                       &position_engine, risk_engine.get(), &instrument_registry);
+
+        // A request that was sent but got no reply may still have been accepted, so ask the exchange
+        order_gateway.SetOutcomeUnknownListener([&order_execution]()
+                                                { order_execution.ReconcileNow({"BTC", "ETH"}); });
+        order_gateway.Connect();
+        order_execution.SyncRateLimits("BTC");
+        order_execution.StartInstrumentSync(std::chrono::hours(1));
+        order_execution.StartOpenOrderSync(std::chrono::seconds(30));
+        order_execution.StartPositionSync({"BTC", "ETH"}, std::chrono::seconds(60));
+        order_execution.StartLatencyDump(std::chrono::seconds(60));
+
+        // Order and fill notifications sent while the session was down are lost, so catch up from REST
+        market_data.AddConnectionListener(
+            [&order_execution](const ConnectionEvent event)
+            {
+                if (event == ConnectionEvent::RECONNECTED)
+                {
+                    order_execution.ReconcileNow({"BTC", "ETH"});
+                }
+            });
+        market_data.ConnectToServer();
         std::string response;
         
         while (true) {
@@ -97,7 +184,30 @@ int main()
                     break;
                 }
                 case 5: {
+                    order_execution.GetLatencyRecorder().FormatReport(response);
+                    std::cout << (response.empty() ? "No requests recorded yet.\n" : response);
+
+                    const ConnectionPoolStats pool = order_execution.GetConnectionPool().GetStats();
+                    std::cout << "Connections: " << pool.connections << ", requests: " << pool.requests
+                              << ", handshakes: " << pool.handshakes << ", keepalives: " << pool.keepalives
+                              << ", failures: " << pool.failures << ", reuse: " << pool.reuse_ratio * 100.0
+                              << "%\n";
+
+                    const ConnectionStats connection = market_data.GetConnectionStats();
+                    std::cout << "Market data disconnects: " << connection.disconnects
+                              << ", heartbeat timeouts: " << connection.heartbeat_timeouts
+                              << ", connect attempts: " << connection.connect_attempts;
+                    if (connection.recovery.count != 0)
+                    {
+                        std::cout << ", recovery p50: " << connection.recovery.p50_ns / 1000000
+                                  << " ms, max: " << connection.recovery.max_ns / 1000000 << " ms";
+                    }
+                    std::cout << '\n';
+                    break;
+                }
+                case 6: {
                     std::cout << "Exiting program...\n";
+                    drogon::app().quit();
                     return 0;
                 }
                 default: {
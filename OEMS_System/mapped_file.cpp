@@ -0,0 +1,243 @@
+#include "mapped_file.h"
+
+#include <cstdint>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path)
+{
+    Close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    m_file_handle = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        Close();
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        Close();
+        return false;
+    }
+    m_mapping_handle = mapping;
+
+    m_data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (m_data == nullptr)
+    {
+        Close();
+        return false;
+    }
+    m_size = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+bool MappedFile::Create(const std::string& path, const size_t size)
+{
+    Close();
+
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    m_file_handle = file;
+
+    // Mapping past the end grows the file to the mapped size
+    const auto mapped_size = static_cast<uint64_t>(size);
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(mapped_size >> 32),
+                                        static_cast<DWORD>(mapped_size & 0xFFFFFFFF), nullptr);
+    if (mapping == nullptr)
+    {
+        Close();
+        return false;
+    }
+    m_mapping_handle = mapping;
+
+    m_data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0));
+    if (m_data == nullptr)
+    {
+        Close();
+        return false;
+    }
+    m_size = size;
+    m_is_writable = true;
+    return true;
+}
+
+bool MappedFile::CloseAndTruncate(const size_t size) noexcept
+{
+    if (m_data != nullptr)
+    {
+        UnmapViewOfFile(m_data);
+        m_data = nullptr;
+    }
+    if (m_mapping_handle != nullptr)
+    {
+        CloseHandle(m_mapping_handle);
+        m_mapping_handle = nullptr;
+    }
+
+    LARGE_INTEGER end;
+    end.QuadPart = static_cast<LONGLONG>(size);
+    const bool is_truncated = m_file_handle != nullptr && SetFilePointerEx(m_file_handle, end, nullptr, FILE_BEGIN) &&
+                              SetEndOfFile(m_file_handle);
+    Close();
+    return is_truncated;
+}
+
+void MappedFile::Close() noexcept
+{
+    if (m_data != nullptr)
+    {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping_handle != nullptr)
+    {
+        CloseHandle(m_mapping_handle);
+    }
+    if (m_file_handle != nullptr)
+    {
+        CloseHandle(m_file_handle);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_is_writable = false;
+    m_mapping_handle = nullptr;
+    m_file_handle = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path)
+{
+    Close();
+
+    m_fd = ::open(path.c_str(), O_RDONLY);
+    if (m_fd < 0)
+    {
+        return false;
+    }
+
+    struct stat file_stat;
+    if (::fstat(m_fd, &file_stat) != 0 || file_stat.st_size == 0)
+    {
+        Close();
+        return false;
+    }
+
+    void* data = ::mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (data == MAP_FAILED)
+    {
+        Close();
+        return false;
+    }
+    m_data = static_cast<const char*>(data);
+    m_size = static_cast<size_t>(file_stat.st_size);
+    return true;
+}
+
+bool MappedFile::Create(const std::string& path, const size_t size)
+{
+    Close();
+
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0)
+    {
+        return false;
+    }
+    if (::ftruncate(m_fd, static_cast<off_t>(size)) != 0)
+    {
+        Close();
+        return false;
+    }
+
+    void* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (data == MAP_FAILED)
+    {
+        Close();
+        return false;
+    }
+    m_data = static_cast<const char*>(data);
+    m_size = size;
+    m_is_writable = true;
+    return true;
+}
+
+bool MappedFile::CloseAndTruncate(const size_t size) noexcept
+{
+    if (m_data != nullptr)
+    {
+        ::munmap(const_cast<char*>(m_data), m_size);
+        m_data = nullptr;
+    }
+
+    const bool is_truncated = m_fd >= 0 && ::ftruncate(m_fd, static_cast<off_t>(size)) == 0;
+    Close();
+    return is_truncated;
+}
+
+void MappedFile::Close() noexcept
+{
+    if (m_data != nullptr)
+    {
+        ::munmap(const_cast<char*>(m_data), m_size);
+    }
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_is_writable = false;
+    m_fd = -1;
+}
+
+#endif
+
+bool MappedFile::IsOpen() const noexcept
+{
+    return m_data != nullptr;
+}
+
+const char* MappedFile::Data() const noexcept
+{
+    return m_data;
+}
+
+char* MappedFile::MutableData() noexcept
+{
+    return m_is_writable ? const_cast<char*>(m_data) : nullptr;
+}
+
+size_t MappedFile::Size() const noexcept
+{
+    return m_size;
+}
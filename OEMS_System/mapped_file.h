@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// View of a whole file mapped into memory, unmapped on Close or destruction. Files are mapped read-only by
+// Open; Create makes a new file of a fixed size to be written through the mapping.
+class MappedFile
+{
+  private:
+    const char* m_data{nullptr};
+    size_t m_size{0};
+    bool m_is_writable{false};
+#ifdef _WIN32
+    void* m_file_handle{nullptr};
+    void* m_mapping_handle{nullptr};
+#else
+    int m_fd{-1};
+#endif
+
+  public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // False if the file is missing, empty or cannot be mapped
+    bool Open(const std::string& path);
+    // Replaces path with size zero bytes and maps them for writing
+    bool Create(const std::string& path, size_t size);
+    void Close() noexcept;
+    // Closes a file made by Create, cutting it down to the size bytes actually written
+    bool CloseAndTruncate(size_t size) noexcept;
+
+    bool IsOpen() const noexcept;
+    const char* Data() const noexcept;
+    // Null unless the file was made by Create
+    char* MutableData() noexcept;
+    size_t Size() const noexcept;
+};
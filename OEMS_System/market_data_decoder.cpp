@@ -0,0 +1,437 @@
+#include "market_data_decoder.h"
+
+#include "json_scanner.h"
+
+namespace {
+    // Numeric fields may be null (e.g. no best bid); those, and anything else that is not a plain number, read as
+    // 0 rather than keeping what a reused update held from the previous frame
+    void ReadDouble(const std::string_view value, double& out)
+    {
+        if (!JsonScanner::ToDouble(value, out))
+        {
+            out = 0;
+        }
+    }
+
+    OrderState ParseOrderState(const std::string_view state)
+    {
+        if (state == "filled")
+        {
+            return OrderState::FILLED;
+        }
+        if (state == "cancelled")
+        {
+            return OrderState::CANCELLED;
+        }
+        if (state == "rejected")
+        {
+            return OrderState::REJECTED;
+        }
+        if (state == "untriggered")
+        {
+            return OrderState::UNTRIGGERED;
+        }
+        return OrderState::OPEN;
+    }
+
+    bool DecodeLevels(const std::string_view levels, std::vector<BookLevelUpdate>& out)
+    {
+        return JsonScanner::ForEachElement(
+            levels,
+            [&out](const std::string_view level)
+            {
+                // Each level is ["new"|"change"|"delete", price, amount]
+                int index = 0;
+                BookLevelUpdate update{BookAction::CHANGE, 0, 0};
+                JsonScanner::ForEachElement(level,
+                                            [&](const std::string_view field)
+                                            {
+                                                if (index == 0)
+                                                {
+                                                    const std::string_view action = JsonScanner::ToStringView(field);
+                                                    if (!action.empty() && action[0] == 'n')
+                                                    {
+                                                        update.action = BookAction::ADD;
+                                                    }
+                                                    else if (!action.empty() && action[0] == 'd')
+                                                    {
+                                                        update.action = BookAction::REMOVE;
+                                                    }
+                                                }
+                                                else if (index == 1)
+                                                {
+                                                    ReadDouble(field, update.price);
+                                                }
+                                                else if (index == 2)
+                                                {
+                                                    ReadDouble(field, update.amount);
+                                                }
+                                                return ++index < 3;
+                                            });
+                if (index == 3)
+                {
+                    out.push_back(update);
+                }
+                return true;
+            });
+    }
+}
+
+bool MarketDataDecoder::DecodeNotification(const std::string_view frame, std::string_view& channel,
+                                           std::string_view& data)
+{
+    std::string_view params;
+    if (!JsonScanner::FindMember(frame, "params", params))
+    {
+        return false;
+    }
+
+    channel = {};
+    data = {};
+    JsonScanner::ForEachMember(params,
+                               [&](const std::string_view key, const std::string_view value)
+                               {
+                                   if (key == "channel")
+                                   {
+                                       channel = JsonScanner::ToStringView(value);
+                                   }
+                                   else if (key == "data")
+                                   {
+                                       data = value;
+                                   }
+                                   return channel.empty() || data.empty();
+                               });
+    return !channel.empty() && !data.empty();
+}
+
+bool MarketDataDecoder::DecodeReply(const std::string_view frame, uint64_t& id, bool& is_error)
+{
+    bool has_id = false;
+    is_error = false;
+    const bool parsed = JsonScanner::ForEachMember(frame,
+                                                   [&](const std::string_view key, const std::string_view value)
+                                                   {
+                                                       if (key == "id")
+                                                       {
+                                                           has_id = JsonScanner::ToUInt64(value, id);
+                                                       }
+                                                       else if (key == "error")
+                                                       {
+                                                           is_error = true;
+                                                       }
+                                                       return true;
+                                                   });
+    return parsed && has_id;
+}
+
+bool MarketDataDecoder::DecodeHeartbeat(const std::string_view frame, bool& is_test_request)
+{
+    std::string_view method;
+    std::string_view params;
+    if (!JsonScanner::FindMember(frame, "method", method) || JsonScanner::ToStringView(method) != "heartbeat")
+    {
+        return false;
+    }
+
+    std::string_view type;
+    is_test_request = JsonScanner::FindMember(frame, "params", params) &&
+                      JsonScanner::FindMember(params, "type", type) &&
+                      JsonScanner::ToStringView(type) == "test_request";
+    return true;
+}
+
+bool MarketDataDecoder::DecodeBook(const std::string_view data, BookUpdate& update)
+{
+    update.Clear();
+    bool has_change_id = false;
+    bool levels_ok = true;
+
+    const bool parsed = JsonScanner::ForEachMember(
+        data,
+        [&](const std::string_view key, const std::string_view value)
+        {
+            if (key == "type")
+            {
+                update.is_snapshot = JsonScanner::ToStringView(value) == "snapshot";
+            }
+            else if (key == "change_id")
+            {
+                has_change_id = JsonScanner::ToInt64(value, update.change_id);
+            }
+            else if (key == "prev_change_id")
+            {
+                JsonScanner::ToInt64(value, update.prev_change_id);
+            }
+            else if (key == "timestamp")
+            {
+                JsonScanner::ToInt64(value, update.timestamp_ms);
+            }
+            else if (key == "instrument_name")
+            {
+                update.instrument_name.assign(JsonScanner::ToStringView(value));
+            }
+            else if (key == "bids")
+            {
+                levels_ok = DecodeLevels(value, update.bids) && levels_ok;
+            }
+            else if (key == "asks")
+            {
+                levels_ok = DecodeLevels(value, update.asks) && levels_ok;
+            }
+            return true;
+        });
+
+    return parsed && levels_ok && has_change_id && !update.instrument_name.empty();
+}
+
+bool MarketDataDecoder::DecodeTicker(const std::string_view data, TickerUpdate& update)
+{
+    update.Clear();
+
+    const bool parsed = JsonScanner::ForEachMember(
+        data,
+        [&update](const std::string_view key, const std::string_view value)
+        {
+            if (key == "instrument_name")
+            {
+                update.instrument_name.assign(JsonScanner::ToStringView(value));
+            }
+            else if (key == "timestamp")
+            {
+                JsonScanner::ToInt64(value, update.timestamp_ms);
+            }
+            else if (key == "best_bid_price")
+            {
+                ReadDouble(value, update.best_bid_price);
+            }
+            else if (key == "best_bid_amount")
+            {
+                ReadDouble(value, update.best_bid_amount);
+            }
+            else if (key == "best_ask_price")
+            {
+                ReadDouble(value, update.best_ask_price);
+            }
+            else if (key == "best_ask_amount")
+            {
+                ReadDouble(value, update.best_ask_amount);
+            }
+            else if (key == "last_price")
+            {
+                ReadDouble(value, update.last_price);
+            }
+            else if (key == "mark_price")
+            {
+                ReadDouble(value, update.mark_price);
+            }
+            else if (key == "index_price")
+            {
+                ReadDouble(value, update.index_price);
+            }
+            else if (key == "open_interest")
+            {
+                ReadDouble(value, update.open_interest);
+            }
+            else if (key == "underlying_price")
+            {
+                ReadDouble(value, update.underlying_price);
+            }
+            else if (key == "bid_iv")
+            {
+                ReadDouble(value, update.bid_iv);
+            }
+            else if (key == "ask_iv")
+            {
+                ReadDouble(value, update.ask_iv);
+            }
+            else if (key == "mark_iv")
+            {
+                ReadDouble(value, update.mark_iv);
+            }
+            else if (key == "greeks")
+            {
+                JsonScanner::ForEachMember(
+                    value,
+                    [&update](const std::string_view greek, const std::string_view number)
+                    {
+                        if (greek == "delta")
+                        {
+                            ReadDouble(number, update.delta);
+                        }
+                        else if (greek == "gamma")
+                        {
+                            ReadDouble(number, update.gamma);
+                        }
+                        else if (greek == "vega")
+                        {
+                            ReadDouble(number, update.vega);
+                        }
+                        else if (greek == "theta")
+                        {
+                            ReadDouble(number, update.theta);
+                        }
+                        else if (greek == "rho")
+                        {
+                            ReadDouble(number, update.rho);
+                        }
+                        return true;
+                    });
+            }
+            return true;
+        });
+
+    return parsed && !update.instrument_name.empty();
+}
+
+bool MarketDataDecoder::DecodeTrades(const std::string_view data, std::vector<TradeUpdate>& trades)
+{
+    size_t count = 0;
+    const bool parsed = JsonScanner::ForEachElement(
+        data,
+        [&trades, &count](const std::string_view element)
+        {
+            // Reuse existing entries so their strings keep their capacity
+            if (count == trades.size())
+            {
+                trades.emplace_back();
+            }
+            TradeUpdate& trade = trades[count++];
+            trade.Clear();
+
+            JsonScanner::ForEachMember(
+                element,
+                [&trade](const std::string_view key, const std::string_view value)
+                {
+                    if (key == "trade_id")
+                    {
+                        trade.trade_id.assign(JsonScanner::ToStringView(value));
+                    }
+                    else if (key == "instrument_name")
+                    {
+                        trade.instrument_name.assign(JsonScanner::ToStringView(value));
+                    }
+                    else if (key == "timestamp")
+                    {
+                        JsonScanner::ToInt64(value, trade.timestamp_ms);
+                    }
+                    else if (key == "trade_seq")
+                    {
+                        JsonScanner::ToInt64(value, trade.trade_seq);
+                    }
+                    else if (key == "price")
+                    {
+                        ReadDouble(value, trade.price);
+                    }
+                    else if (key == "amount")
+                    {
+                        ReadDouble(value, trade.amount);
+                    }
+                    else if (key == "mark_price")
+                    {
+                        ReadDouble(value, trade.mark_price);
+                    }
+                    else if (key == "fee")
+                    {
+                        ReadDouble(value, trade.fee);
+                    }
+                    else if (key == "direction")
+                    {
+                        trade.direction = JsonScanner::ToStringView(value) == "sell" ? TradeDirection::SELL
+                                                                                     : TradeDirection::BUY;
+                    }
+                    return true;
+                });
+            return true;
+        });
+
+    trades.resize(count);
+    return parsed;
+}
+
+bool MarketDataDecoder::DecodeOrder(const std::string_view object, OrderUpdate& order)
+{
+    order.Clear();
+
+    const bool parsed = JsonScanner::ForEachMember(
+        object,
+        [&order](const std::string_view key, const std::string_view value)
+        {
+            if (key == "order_id")
+            {
+                order.order_id.assign(JsonScanner::ToStringView(value));
+            }
+            else if (key == "label")
+            {
+                order.label.assign(JsonScanner::ToStringView(value));
+            }
+            else if (key == "instrument_name")
+            {
+                order.instrument_name.assign(JsonScanner::ToStringView(value));
+            }
+            else if (key == "direction")
+            {
+                order.direction = JsonScanner::ToStringView(value) == "sell" ? TradeDirection::SELL
+                                                                             : TradeDirection::BUY;
+            }
+            else if (key == "order_state")
+            {
+                order.state = ParseOrderState(JsonScanner::ToStringView(value));
+            }
+            else if (key == "price")
+            {
+                // Market orders report "market_price" here; they carry no resting price
+                ReadDouble(value, order.price);
+            }
+            else if (key == "amount")
+            {
+                ReadDouble(value, order.amount);
+            }
+            else if (key == "filled_amount")
+            {
+                ReadDouble(value, order.filled_amount);
+            }
+            else if (key == "average_price")
+            {
+                ReadDouble(value, order.average_price);
+            }
+            else if (key == "creation_timestamp")
+            {
+                JsonScanner::ToInt64(value, order.creation_timestamp_ms);
+            }
+            else if (key == "last_update_timestamp")
+            {
+                JsonScanner::ToInt64(value, order.last_update_timestamp_ms);
+            }
+            return true;
+        });
+
+    return parsed && !order.order_id.empty();
+}
+
+bool MarketDataDecoder::DecodeOrders(std::string_view data, std::vector<OrderUpdate>& orders)
+{
+    data = data.substr(JsonScanner::SkipWhitespace(data, 0));
+    if (!data.empty() && data.front() == '{')
+    {
+        orders.resize(1);
+        return DecodeOrder(data, orders.front());
+    }
+
+    size_t count = 0;
+    bool orders_ok = true;
+    const bool parsed = JsonScanner::ForEachElement(
+        data,
+        [&](const std::string_view element)
+        {
+            // Reuse existing entries so their strings keep their capacity
+            if (count == orders.size())
+            {
+                orders.emplace_back();
+            }
+            orders_ok = DecodeOrder(element, orders[count++]) && orders_ok;
+            return true;
+        });
+
+    orders.resize(count);
+    return parsed && orders_ok;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "order_book.h"
+
+// Fields read from ticker.{instrument}.{interval} notifications
+struct TickerUpdate
+{
+    std::string instrument_name;
+    int64_t timestamp_ms{0};
+    double best_bid_price{0};
+    double best_bid_amount{0};
+    double best_ask_price{0};
+    double best_ask_amount{0};
+    double last_price{0};
+    double mark_price{0};
+    double index_price{0};
+    double open_interest{0};
+    // Options only; zero for other instruments
+    double underlying_price{0};
+    double bid_iv{0};
+    double ask_iv{0};
+    double mark_iv{0};
+    double delta{0};
+    double gamma{0};
+    double vega{0};
+    double theta{0};
+    double rho{0};
+
+    void Clear()
+    {
+        instrument_name.clear();
+        timestamp_ms = 0;
+        best_bid_price = best_bid_amount = best_ask_price = best_ask_amount = 0;
+        last_price = mark_price = index_price = open_interest = 0;
+        underlying_price = bid_iv = ask_iv = mark_iv = 0;
+        delta = gamma = vega = theta = rho = 0;
+    }
+};
+
+enum class TradeDirection
+{
+    BUY,
+    SELL
+};
+
+// One element of a trades.{instrument}.{interval} or user.trades.* notification
+struct TradeUpdate
+{
+    std::string trade_id;
+    std::string instrument_name;
+    int64_t timestamp_ms{0};
+    int64_t trade_seq{0};
+    double price{0};
+    double amount{0};
+    double mark_price{0};
+    double fee{0};                // Only present on user.trades, in the settlement currency
+    TradeDirection direction{TradeDirection::BUY};
+
+    void Clear()
+    {
+        trade_id.clear();
+        instrument_name.clear();
+        timestamp_ms = trade_seq = 0;
+        price = amount = mark_price = fee = 0;
+        direction = TradeDirection::BUY;
+    }
+};
+
+enum class OrderState
+{
+    OPEN,
+    UNTRIGGERED,
+    FILLED,
+    REJECTED,
+    CANCELLED
+};
+
+// One order as it appears in user.orders.* notifications and in order-entry replies
+struct OrderUpdate
+{
+    std::string order_id;
+    std::string label;
+    std::string instrument_name;
+    TradeDirection direction{TradeDirection::BUY};
+    OrderState state{OrderState::OPEN};
+    double price{0};
+    double amount{0};
+    double filled_amount{0};
+    double average_price{0};
+    int64_t creation_timestamp_ms{0};
+    int64_t last_update_timestamp_ms{0};
+
+    void Clear()
+    {
+        order_id.clear();
+        label.clear();
+        instrument_name.clear();
+        direction = TradeDirection::BUY;
+        state = OrderState::OPEN;
+        price = amount = filled_amount = average_price = 0;
+        creation_timestamp_ms = last_update_timestamp_ms = 0;
+    }
+
+    // Open and untriggered orders are still working on the exchange
+    bool IsOpen() const noexcept
+    {
+        return state == OrderState::OPEN || state == OrderState::UNTRIGGERED;
+    }
+};
+
+// Decodes the "data" member of subscription notifications straight from the frame into typed structs.
+// Output objects are meant to be reused so their string and vector capacity is kept between frames.
+class MarketDataDecoder
+{
+  public:
+    static bool DecodeBook(std::string_view data, BookUpdate& update);
+    static bool DecodeTicker(std::string_view data, TickerUpdate& update);
+    static bool DecodeTrades(std::string_view data, std::vector<TradeUpdate>& trades);
+    static bool DecodeOrder(std::string_view object, OrderUpdate& order);
+    // Accepts a single order object (raw channels) or an array of them (aggregated channels and snapshots)
+    static bool DecodeOrders(std::string_view data, std::vector<OrderUpdate>& orders);
+
+    // Splits a notification frame into its channel name and raw data; false for RPC replies
+    static bool DecodeNotification(std::string_view frame, std::string_view& channel, std::string_view& data);
+
+    // Reads the id of a JSON-RPC reply and whether it carries an error; false for notifications
+    static bool DecodeReply(std::string_view frame, uint64_t& id, bool& is_error);
+
+    // Recognises the exchange's heartbeat notification; a test_request must be answered or the session is closed
+    static bool DecodeHeartbeat(std::string_view frame, bool& is_test_request);
+};
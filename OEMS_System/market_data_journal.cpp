@@ -0,0 +1,204 @@
+#include "market_data_journal.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+#include "binary_logger.h"
+#include "lz_block.h"
+
+namespace
+{
+    const LogFormat LOG_NO_SEGMENTS{LogLevel::ERR, "[Journal] No segments found in {}"};
+    const LogFormat LOG_SEGMENT_OPEN_FAILED{LogLevel::WARN, "[Journal] Failed to open {}"};
+    const LogFormat LOG_SEGMENT_CORRUPT{LogLevel::WARN, "[Journal] Stopped reading {} at offset {}: {}"};
+}
+
+bool MarketDataJournalReader::Open(const std::string& path)
+{
+    m_segment_paths.clear();
+
+    std::error_code error;
+    if (std::filesystem::is_directory(path, error))
+    {
+        for (const auto& entry : std::filesystem::directory_iterator(path, error))
+        {
+            if (entry.path().extension() == ".journal")
+            {
+                m_segment_paths.push_back(entry.path().string());
+            }
+        }
+        // Names carry the first receive time, which std::sort gets right as long as the digit counts match;
+        // ordering by length first keeps it right when they do not
+        std::sort(m_segment_paths.begin(), m_segment_paths.end(),
+                  [](const std::string& left, const std::string& right)
+                  { return left.size() != right.size() ? left.size() < right.size() : left < right; });
+    }
+    else if (std::filesystem::is_regular_file(path, error))
+    {
+        m_segment_paths.push_back(path);
+    }
+
+    if (m_segment_paths.empty())
+    {
+        BinaryLogger::Write(LOG_NO_SEGMENTS, path);
+        return false;
+    }
+
+    Rewind();
+    return true;
+}
+
+void MarketDataJournalReader::Rewind()
+{
+    m_segment.Close();
+    m_next_segment = 0;
+    m_segment_end = 0;
+    m_block_offset = 0;
+    m_block_size = 0;
+    m_frame_offset = 0;
+    m_corrupt_count = 0;
+}
+
+bool MarketDataJournalReader::Next(JournalFrame& frame)
+{
+    while (m_frame_offset >= m_block_size)
+    {
+        if (!ReadNextBlock())
+        {
+            return false;
+        }
+    }
+
+    JournalFrameHeader header;
+    std::memcpy(&header, m_block.data() + m_frame_offset, sizeof(header));
+    frame.receive_ns = header.receive_ns;
+    frame.channel_id = header.channel_id;
+    frame.text = std::string_view(m_block.data() + m_frame_offset + sizeof(header), header.size);
+    m_frame_offset += sizeof(header) + header.size;
+    return true;
+}
+
+// Function to load the next block into m_block, moving on to the next segment when this one is done
+bool MarketDataJournalReader::ReadNextBlock()
+{
+    m_block_size = 0;
+    m_frame_offset = 0;
+
+    while (true)
+    {
+        if (!m_segment.IsOpen() || m_block_offset + sizeof(JournalBlockHeader) > m_segment_end)
+        {
+            m_segment.Close();
+            if (!OpenNextSegment())
+            {
+                return false;
+            }
+            continue;
+        }
+
+        JournalBlockHeader header;
+        std::memcpy(&header, m_segment.Data() + m_block_offset, sizeof(header));
+        // A segment that was never sealed ends at the first block that was never written
+        if (header.stored_size == 0)
+        {
+            m_segment.Close();
+            continue;
+        }
+        if (header.stored_size > m_segment_end - m_block_offset - sizeof(header) ||
+            (header.is_compressed == 0 && header.stored_size != header.raw_size))
+        {
+            SkipSegment("block runs past the end of the segment");
+            continue;
+        }
+
+        const char* const stored = m_segment.Data() + m_block_offset + sizeof(header);
+        if (m_block.size() < header.raw_size)
+        {
+            m_block.resize(header.raw_size);
+        }
+        if (header.is_compressed != 0)
+        {
+            if (LzBlock::Decompress(stored, header.stored_size, m_block.data(), header.raw_size) != header.raw_size)
+            {
+                SkipSegment("block does not decompress");
+                continue;
+            }
+        }
+        else
+        {
+            std::memcpy(m_block.data(), stored, header.raw_size);
+        }
+
+        // Every frame must lie within the block, so Next can trust the sizes it reads
+        size_t offset = 0;
+        uint32_t frame_count = 0;
+        while (offset + sizeof(JournalFrameHeader) <= header.raw_size)
+        {
+            JournalFrameHeader frame_header;
+            std::memcpy(&frame_header, m_block.data() + offset, sizeof(frame_header));
+            offset += sizeof(frame_header) + frame_header.size;
+            ++frame_count;
+        }
+        if (offset != header.raw_size || frame_count != header.frame_count)
+        {
+            SkipSegment("frames do not fill the block");
+            continue;
+        }
+
+        m_block_offset += sizeof(header) + header.stored_size;
+        m_block_size = header.raw_size;
+        return true;
+    }
+}
+
+bool MarketDataJournalReader::OpenNextSegment()
+{
+    while (m_next_segment < m_segment_paths.size())
+    {
+        const std::string& path = m_segment_paths[m_next_segment++];
+        if (!m_segment.Open(path))
+        {
+            BinaryLogger::Write(LOG_SEGMENT_OPEN_FAILED, path);
+            continue;
+        }
+        m_block_offset = 0;
+
+        JournalSegmentHeader header;
+        if (m_segment.Size() < sizeof(header))
+        {
+            SkipSegment("too short for a header");
+            continue;
+        }
+        std::memcpy(&header, m_segment.Data(), sizeof(header));
+        if (std::memcmp(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 ||
+            header.version != JOURNAL_VERSION)
+        {
+            SkipSegment("not a journal segment of this version");
+            continue;
+        }
+        if (header.index_offset > m_segment.Size())
+        {
+            SkipSegment("index lies past the end of the file");
+            continue;
+        }
+
+        m_segment_end = header.index_offset != 0 ? header.index_offset : m_segment.Size();
+        m_block_offset = sizeof(header);
+        return true;
+    }
+    return false;
+}
+
+void MarketDataJournalReader::SkipSegment(const char* reason)
+{
+    BinaryLogger::Write(LOG_SEGMENT_CORRUPT, m_segment_paths[m_next_segment - 1], m_block_offset, reason);
+    ++m_corrupt_count;
+    m_segment.Close();
+}
+
+uint64_t MarketDataJournalReader::GetCorruptCount() const noexcept
+{
+    return m_corrupt_count;
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "mapped_file.h"
+
+// On-disk layout of the market-data journal written by MarketDataRecorder.
+//
+// A journal is a directory of segment files, named md-<first receive time in ns>.journal so they sort in time
+// order. A segment is
+//
+//   JournalSegmentHeader
+//   (JournalBlockHeader, block bytes)...
+//   (JournalChannelEntry, channel name)... JournalIndexEntry...      <- at index_offset, once sealed
+//
+// A block is a run of whole frames, each a JournalFrameHeader followed by the frame text exactly as received,
+// stored LZ-compressed (LzBlock) when that is smaller. The channel table and index are written when a segment
+// is sealed; a segment left behind by a crash has index_offset 0 and is read by walking its blocks up to the
+// first zero header. All integers are little-endian.
+
+static constexpr char JOURNAL_MAGIC[8] = {'O', 'E', 'M', 'S', 'M', 'D', 'J', '1'};
+static constexpr uint32_t JOURNAL_VERSION = 1;
+
+// Channel id of frames that are not subscription notifications, such as replies to our requests
+static constexpr uint32_t JOURNAL_NO_CHANNEL = 0;
+// Channel id of the index entry that every block gets, whatever it holds
+static constexpr uint32_t JOURNAL_ALL_CHANNELS = UINT32_MAX;
+
+struct JournalSegmentHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t channel_count;
+    int64_t first_receive_ns;       // Receive times are wall-clock, in ns since the Unix epoch
+    int64_t last_receive_ns;
+    uint64_t frame_count;
+    uint64_t block_count;
+    uint64_t index_offset;          // 0 until the segment is sealed
+    uint64_t index_entry_count;
+};
+
+struct JournalBlockHeader
+{
+    uint32_t stored_size;           // Bytes that follow this header
+    uint32_t raw_size;              // Equal to stored_size when the block is not compressed
+    int64_t first_receive_ns;
+    int64_t last_receive_ns;
+    uint32_t frame_count;
+    uint32_t is_compressed;
+};
+
+struct JournalFrameHeader
+{
+    int64_t receive_ns;
+    uint32_t size;
+    uint32_t channel_id;
+};
+
+// Channel ids are assigned in order of first appearance and kept for the whole recording, so every segment
+// lists the channels seen up to when it was sealed
+struct JournalChannelEntry
+{
+    uint32_t channel_id;
+    uint32_t name_size;             // Name bytes that follow this entry
+    uint64_t frame_count;           // Frames of the channel in this segment
+};
+
+// One entry per block for JOURNAL_ALL_CHANNELS and one per channel the block holds, in block order, so a
+// reader can seek by time and skip blocks without the channels it wants
+struct JournalIndexEntry
+{
+    int64_t first_receive_ns;
+    uint64_t block_offset;
+    uint32_t channel_id;
+    uint32_t frame_count;
+};
+
+struct JournalFrame
+{
+    int64_t receive_ns;
+    uint32_t channel_id;
+    std::string_view text;          // Valid until the next frame is read
+};
+
+// Reads the frames of a journal back in the order they were received, sealed or not
+class MarketDataJournalReader
+{
+  private:
+    std::vector<std::string> m_segment_paths;
+    size_t m_next_segment{0};
+
+    MappedFile m_segment;
+    size_t m_segment_end{0};        // Where the blocks stop: the index when sealed, the file end otherwise
+    size_t m_block_offset{0};
+
+    std::vector<char> m_block;
+    size_t m_block_size{0};
+    size_t m_frame_offset{0};
+
+    uint64_t m_corrupt_count{0};
+
+    bool OpenNextSegment();
+    bool ReadNextBlock();
+    void SkipSegment(const char* reason);
+
+  public:
+    // path is either a journal directory, whose segments are read in time order, or a single segment
+    bool Open(const std::string& path);
+    // Starts again from the first frame of the first segment
+    void Rewind();
+
+    // False once every segment has been read
+    bool Next(JournalFrame& frame);
+
+    // Segments abandoned part way because a header or block did not make sense
+    uint64_t GetCorruptCount() const noexcept;
+};
@@ -0,0 +1,325 @@
+#include "market_data_recorder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "binary_logger.h"
+#include "market_data_decoder.h"
+
+namespace
+{
+    const LogFormat LOG_DIRECTORY_FAILED{LogLevel::ERR, "[Recorder] Failed to create {}: {}"};
+    const LogFormat LOG_SEGMENT_FAILED{LogLevel::ERR, "[Recorder] Failed to create segment {}"};
+    const LogFormat LOG_INDEX_FAILED{LogLevel::ERR, "[Recorder] Failed to write the index of {}"};
+    const LogFormat LOG_SEGMENT_SEALED{LogLevel::INFO, "[Recorder] Sealed {}: {} frames in {} blocks"};
+}
+
+MarketDataRecorder::MarketDataRecorder(std::string directory, const bool is_compressed, const size_t segment_size)
+    : m_directory(std::move(directory)),
+      m_segment_size(segment_size),
+      m_is_compressed(is_compressed),
+      m_ring(RING_CAPACITY),
+      m_channel_names(1),
+      m_segment_channel_frames(1, 0),
+      m_block_channel_frames(1, 0)
+{
+    m_block.reserve(BLOCK_SIZE);
+}
+
+MarketDataRecorder::~MarketDataRecorder()
+{
+    Stop();
+}
+
+int64_t MarketDataRecorder::NowNs() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+bool MarketDataRecorder::Start()
+{
+    if (m_is_running.load())
+    {
+        return true;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+    if (error)
+    {
+        BinaryLogger::Write(LOG_DIRECTORY_FAILED, m_directory, error.message());
+        return false;
+    }
+
+    m_is_running = true;
+    m_thread = std::thread([this]() { Run(); });
+    return true;
+}
+
+void MarketDataRecorder::Stop()
+{
+    if (!m_is_running.exchange(false))
+    {
+        return;
+    }
+
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void MarketDataRecorder::Record(const std::string_view frame) noexcept
+{
+    char* const record = m_ring.Reserve(sizeof(RingFrameHeader) + frame.size());
+    if (!record)
+    {
+        return;
+    }
+
+    const RingFrameHeader header{NowNs(), static_cast<uint32_t>(frame.size()), 0};
+    std::memcpy(record, &header, sizeof(header));
+    std::memcpy(record + sizeof(header), frame.data(), frame.size());
+    m_ring.Commit();
+}
+
+void MarketDataRecorder::Run()
+{
+    const auto append = [this](const char* data, const size_t size) { Append(data, size); };
+    const int64_t flush_interval_ns = std::chrono::nanoseconds(BLOCK_FLUSH_INTERVAL).count();
+
+    while (m_is_running.load(std::memory_order_acquire))
+    {
+        if (m_ring.Drain(append) != 0)
+        {
+            continue;
+        }
+        if (!m_block.empty() && NowNs() - m_block_header.first_receive_ns >= flush_interval_ns)
+        {
+            FlushBlock();
+        }
+        std::this_thread::sleep_for(IDLE_INTERVAL);
+    }
+
+    // Frames recorded before Stop still reach the journal
+    m_ring.Drain(append);
+    FlushBlock();
+    SealSegment();
+}
+
+void MarketDataRecorder::Append(const char* data, const size_t size)
+{
+    RingFrameHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (sizeof(header) + header.size > size)
+    {
+        return;
+    }
+    const std::string_view frame(data + sizeof(header), header.size);
+
+    if (!m_block.empty() && m_block.size() + sizeof(JournalFrameHeader) + frame.size() > BLOCK_SIZE)
+    {
+        FlushBlock();
+    }
+
+    const uint32_t channel_id = GetChannelId(frame);
+    const JournalFrameHeader frame_header{header.receive_ns, header.size, channel_id};
+    m_block.append(reinterpret_cast<const char*>(&frame_header), sizeof(frame_header));
+    m_block.append(frame);
+
+    if (m_block_header.frame_count == 0)
+    {
+        m_block_header.first_receive_ns = header.receive_ns;
+    }
+    m_block_header.last_receive_ns = header.receive_ns;
+    ++m_block_header.frame_count;
+
+    if (m_block_channel_frames[channel_id]++ == 0)
+    {
+        m_block_channels.push_back(channel_id);
+    }
+}
+
+uint32_t MarketDataRecorder::GetChannelId(const std::string_view frame)
+{
+    std::string_view channel;
+    std::string_view data;
+    if (!MarketDataDecoder::DecodeNotification(frame, channel, data))
+    {
+        return JOURNAL_NO_CHANNEL;
+    }
+
+    // Keys are owned strings, so the lookup needs one; reusing the scratch copy keeps it allocation-free
+    m_channel_key.assign(channel.data(), channel.size());
+    const auto it = m_channel_ids.find(m_channel_key);
+    if (it != m_channel_ids.end())
+    {
+        return it->second;
+    }
+
+    const auto channel_id = static_cast<uint32_t>(m_channel_names.size());
+    m_channel_names.push_back(m_channel_key);
+    m_channel_ids.emplace(m_channel_key, channel_id);
+    m_segment_channel_frames.push_back(0);
+    m_block_channel_frames.push_back(0);
+    return channel_id;
+}
+
+// Function to compress the gathered frames and append them to the open segment, starting a new one if needed
+void MarketDataRecorder::FlushBlock()
+{
+    if (m_block.empty())
+    {
+        return;
+    }
+
+    const char* stored = m_block.data();
+    size_t stored_size = m_block.size();
+    m_block_header.is_compressed = 0;
+    if (m_is_compressed)
+    {
+        m_compressed.resize(LzBlock::GetMaxCompressedSize(m_block.size()));
+        const size_t compressed_size =
+            m_compressor.Compress(m_block.data(), m_block.size(), m_compressed.data(), m_compressed.size());
+        if (compressed_size != 0 && compressed_size < m_block.size())
+        {
+            stored = m_compressed.data();
+            stored_size = compressed_size;
+            m_block_header.is_compressed = 1;
+        }
+    }
+    m_block_header.stored_size = static_cast<uint32_t>(stored_size);
+    m_block_header.raw_size = static_cast<uint32_t>(m_block.size());
+
+    const size_t block_size = sizeof(JournalBlockHeader) + stored_size;
+    if (!m_segment.IsOpen() || m_segment_used + block_size > m_segment.Size())
+    {
+        SealSegment();
+        if (!OpenSegment(m_block_header.first_receive_ns, sizeof(JournalSegmentHeader) + block_size))
+        {
+            m_lost_count.fetch_add(m_block_header.frame_count, std::memory_order_relaxed);
+            for (const uint32_t channel_id : m_block_channels)
+            {
+                m_block_channel_frames[channel_id] = 0;
+            }
+            m_block.clear();
+            m_block_channels.clear();
+            m_block_header = {};
+            return;
+        }
+    }
+
+    char* const segment = m_segment.MutableData();
+    std::memcpy(segment + m_segment_used, &m_block_header, sizeof(m_block_header));
+    std::memcpy(segment + m_segment_used + sizeof(m_block_header), stored, stored_size);
+
+    m_index.push_back({m_block_header.first_receive_ns, m_segment_used, JOURNAL_ALL_CHANNELS,
+                       m_block_header.frame_count});
+    for (const uint32_t channel_id : m_block_channels)
+    {
+        m_index.push_back({m_block_header.first_receive_ns, m_segment_used, channel_id,
+                           m_block_channel_frames[channel_id]});
+        m_segment_channel_frames[channel_id] += m_block_channel_frames[channel_id];
+        m_block_channel_frames[channel_id] = 0;
+    }
+
+    // The header in the file is kept current, so a segment cut short by a crash still describes its blocks
+    if (m_segment_header.block_count == 0)
+    {
+        m_segment_header.first_receive_ns = m_block_header.first_receive_ns;
+    }
+    m_segment_header.last_receive_ns = m_block_header.last_receive_ns;
+    m_segment_header.frame_count += m_block_header.frame_count;
+    ++m_segment_header.block_count;
+    std::memcpy(segment, &m_segment_header, sizeof(m_segment_header));
+    m_segment_used += block_size;
+
+    m_frame_count.fetch_add(m_block_header.frame_count, std::memory_order_relaxed);
+    m_raw_bytes.fetch_add(m_block.size(), std::memory_order_relaxed);
+    m_stored_bytes.fetch_add(stored_size, std::memory_order_relaxed);
+
+    m_block.clear();
+    m_block_channels.clear();
+    m_block_header = {};
+}
+
+bool MarketDataRecorder::OpenSegment(const int64_t first_receive_ns, const size_t min_size)
+{
+    m_segment_path = m_directory + "/md-" + std::to_string(first_receive_ns) + ".journal";
+    if (!m_segment.Create(m_segment_path, std::max(m_segment_size, min_size)))
+    {
+        BinaryLogger::Write(LOG_SEGMENT_FAILED, m_segment_path);
+        return false;
+    }
+
+    m_segment_header = {};
+    std::memcpy(m_segment_header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    m_segment_header.version = JOURNAL_VERSION;
+    std::memcpy(m_segment.MutableData(), &m_segment_header, sizeof(m_segment_header));
+    m_segment_used = sizeof(m_segment_header);
+
+    m_index.clear();
+    std::fill(m_segment_channel_frames.begin(), m_segment_channel_frames.end(), 0);
+    return true;
+}
+
+// Function to cut the open segment down to its blocks and append the channel table and index
+void MarketDataRecorder::SealSegment()
+{
+    if (!m_segment.IsOpen())
+    {
+        return;
+    }
+
+    m_segment_header.channel_count = static_cast<uint32_t>(m_channel_names.size());
+    m_segment_header.index_offset = m_segment_used;
+    m_segment_header.index_entry_count = m_index.size();
+    std::memcpy(m_segment.MutableData(), &m_segment_header, sizeof(m_segment_header));
+
+    // The index size is only known now, so it is written past the mapping rather than into it
+    bool is_written = m_segment.CloseAndTruncate(m_segment_used);
+    if (is_written)
+    {
+        std::ofstream out(m_segment_path, std::ios::binary | std::ios::app);
+        for (uint32_t channel_id = 0; channel_id < m_channel_names.size(); ++channel_id)
+        {
+            const std::string& name = m_channel_names[channel_id];
+            const JournalChannelEntry entry{channel_id, static_cast<uint32_t>(name.size()),
+                                            m_segment_channel_frames[channel_id]};
+            out.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+            out.write(name.data(), static_cast<std::streamsize>(name.size()));
+        }
+        out.write(reinterpret_cast<const char*>(m_index.data()),
+                  static_cast<std::streamsize>(m_index.size() * sizeof(JournalIndexEntry)));
+        is_written = static_cast<bool>(out);
+    }
+
+    if (!is_written)
+    {
+        BinaryLogger::Write(LOG_INDEX_FAILED, m_segment_path);
+        return;
+    }
+    BinaryLogger::Write(LOG_SEGMENT_SEALED, m_segment_path, m_segment_header.frame_count,
+                        m_segment_header.block_count);
+}
+
+uint64_t MarketDataRecorder::GetFrameCount() const noexcept
+{
+    return m_frame_count.load(std::memory_order_relaxed);
+}
+
+uint64_t MarketDataRecorder::GetDroppedCount() const noexcept
+{
+    return m_ring.GetDroppedCount() + m_lost_count.load(std::memory_order_relaxed);
+}
+
+double MarketDataRecorder::GetCompressionRatio() const noexcept
+{
+    const uint64_t raw_bytes = m_raw_bytes.load(std::memory_order_relaxed);
+    return raw_bytes == 0 ? 1.0
+                          : static_cast<double>(m_stored_bytes.load(std::memory_order_relaxed)) / raw_bytes;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "lz_block.h"
+#include "mapped_file.h"
+#include "market_data_journal.h"
+#include "spsc_byte_ring.h"
+
+// Captures every frame the market-data connection receives into a journal (see market_data_journal.h).
+//
+// Record runs on the connection's thread and only copies the frame and its receive time into a ring; a writer
+// thread packs frames into blocks, compresses them and appends them to memory-mapped segments, sealing a
+// segment with its index when the next block does not fit. Frames that arrive while the ring is full are
+// dropped and counted rather than stalling the connection.
+class MarketDataRecorder
+{
+  public:
+    static constexpr const char* DEFAULT_DIRECTORY = "md_journal";
+    static constexpr size_t DEFAULT_SEGMENT_SIZE = size_t{256} << 20;
+    static constexpr size_t RING_CAPACITY = size_t{16} << 20;
+    // Raw bytes gathered before a block is written; a single larger frame gets a block of its own
+    static constexpr size_t BLOCK_SIZE = size_t{64} << 10;
+    // A partial block is written once its first frame is this old, bounding what a crash can lose
+    static constexpr std::chrono::milliseconds BLOCK_FLUSH_INTERVAL{100};
+    static constexpr std::chrono::milliseconds IDLE_INTERVAL{1};
+
+  private:
+    struct RingFrameHeader
+    {
+        int64_t receive_ns;
+        uint32_t size;
+        uint32_t reserved;
+    };
+
+    const std::string m_directory;
+    const size_t m_segment_size;
+    const bool m_is_compressed;
+
+    SpscByteRing m_ring;
+    std::thread m_thread;
+    std::atomic<bool> m_is_running{false};
+
+    std::atomic<uint64_t> m_frame_count{0};
+    std::atomic<uint64_t> m_lost_count{0};          // Frames that reached the writer but not the disk
+    std::atomic<uint64_t> m_raw_bytes{0};
+    std::atomic<uint64_t> m_stored_bytes{0};
+
+    // Everything below is only touched on the writer thread
+    std::unordered_map<std::string, uint32_t> m_channel_ids;
+    std::string m_channel_key;
+    std::vector<std::string> m_channel_names;       // By id; 0 is JOURNAL_NO_CHANNEL
+    std::vector<uint64_t> m_segment_channel_frames; // By id, for the open segment
+
+    std::string m_block;
+    JournalBlockHeader m_block_header{};
+    std::vector<uint32_t> m_block_channel_frames;   // By id, for the block being gathered
+    std::vector<uint32_t> m_block_channels;         // Ids with a nonzero count above
+    std::vector<char> m_compressed;
+    LzBlock m_compressor;
+
+    MappedFile m_segment;
+    std::string m_segment_path;
+    JournalSegmentHeader m_segment_header{};
+    size_t m_segment_used{0};
+    std::vector<JournalIndexEntry> m_index;
+
+    static int64_t NowNs() noexcept;
+
+    void Run();
+    void Append(const char* data, size_t size);
+    uint32_t GetChannelId(std::string_view frame);
+    void FlushBlock();
+    bool OpenSegment(int64_t first_receive_ns, size_t min_size);
+    void SealSegment();
+
+  public:
+    explicit MarketDataRecorder(std::string directory = DEFAULT_DIRECTORY, bool is_compressed = true,
+                                size_t segment_size = DEFAULT_SEGMENT_SIZE);
+    ~MarketDataRecorder();
+
+    MarketDataRecorder(const MarketDataRecorder&) = delete;
+    MarketDataRecorder& operator=(const MarketDataRecorder&) = delete;
+
+    // Creates the directory if needed and starts the writer; segments are only created once frames arrive
+    bool Start();
+    // Writes out everything recorded so far and seals the open segment; also run on destruction
+    void Stop();
+
+    // Called from the one thread that receives frames; costs a copy of the frame
+    void Record(std::string_view frame) noexcept;
+
+    uint64_t GetFrameCount() const noexcept;
+    // Frames dropped because the ring was full or a segment could not be written
+    uint64_t GetDroppedCount() const noexcept;
+    // Compression ratio so far, stored bytes over raw bytes
+    double GetCompressionRatio() const noexcept;
+};
@@ -0,0 +1,136 @@
+#include "market_data_replayer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <unordered_set>
+
+#include "market_data_decoder.h"
+
+namespace
+{
+    void AppendMicros(std::string& out, const char* label, const uint64_t value_ns)
+    {
+        char buffer[48];
+        const int length = std::snprintf(buffer, sizeof(buffer), " %s=%.2fus", label,
+                                         static_cast<double>(value_ns) / 1000.0);
+        out.append(buffer, static_cast<size_t>(std::max(length, 0)));
+    }
+
+    double PerSecond(const uint64_t count, const int64_t elapsed_ns)
+    {
+        return elapsed_ns > 0 ? static_cast<double>(count) * 1e9 / static_cast<double>(elapsed_ns) : 0.0;
+    }
+}
+
+MarketDataReplayer::MarketDataReplayer(DrogonWebSocket& web_socket) : m_web_socket(web_socket) {}
+
+void MarketDataReplayer::SetAllocationCounter(const AllocationCounter counter)
+{
+    m_allocation_counter = counter;
+}
+
+std::vector<std::string> MarketDataReplayer::FindChannels(MarketDataJournalReader& reader)
+{
+    std::vector<std::string> channels;
+    std::unordered_set<std::string> seen;
+
+    JournalFrame frame;
+    std::string_view channel;
+    std::string_view data;
+    while (reader.Next(frame))
+    {
+        if (MarketDataDecoder::DecodeNotification(frame.text, channel, data) &&
+            seen.emplace(channel).second)
+        {
+            channels.emplace_back(channel);
+        }
+    }
+
+    reader.Rewind();
+    return channels;
+}
+
+void MarketDataReplayer::WaitUntil(const int64_t target_ns) noexcept
+{
+    const int64_t spin_threshold_ns = std::chrono::nanoseconds(SPIN_THRESHOLD).count();
+    for (int64_t remaining_ns = target_ns - LatencyRecorder::NowNs(); remaining_ns > 0;
+         remaining_ns = target_ns - LatencyRecorder::NowNs())
+    {
+        if (remaining_ns > spin_threshold_ns)
+        {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(remaining_ns - spin_threshold_ns));
+        }
+    }
+}
+
+ReplayStats MarketDataReplayer::Run(MarketDataJournalReader& reader, const ReplayPace pace)
+{
+    ReplayStats stats{};
+    m_latency.Reset();
+
+    const int64_t start_ns = LatencyRecorder::NowNs();
+    int64_t first_receive_ns = 0;
+
+    JournalFrame frame;
+    while (reader.Next(frame))
+    {
+        if (pace == ReplayPace::RECORDED)
+        {
+            if (stats.message_count == 0)
+            {
+                first_receive_ns = frame.receive_ns;
+            }
+            const int64_t target_ns = start_ns + (frame.receive_ns - first_receive_ns);
+            WaitUntil(target_ns);
+            stats.max_lag_ns = std::max(stats.max_lag_ns, LatencyRecorder::NowNs() - target_ns);
+        }
+
+        const uint64_t allocations_before = m_allocation_counter ? m_allocation_counter() : 0;
+        const int64_t begin_ns = LatencyRecorder::NowNs();
+        m_web_socket.ReceiveFrame(frame.text);
+        const int64_t frame_ns = LatencyRecorder::NowNs() - begin_ns;
+        if (m_allocation_counter)
+        {
+            stats.allocation_count += m_allocation_counter() - allocations_before;
+        }
+
+        m_latency.Record(frame_ns);
+        stats.busy_ns += frame_ns;
+        stats.byte_count += frame.text.size();
+        ++stats.message_count;
+    }
+
+    stats.elapsed_ns = LatencyRecorder::NowNs() - start_ns;
+    stats.latency = m_latency.GetSummary();
+    return stats;
+}
+
+void MarketDataReplayer::FormatReport(const ReplayStats& stats, std::string& out)
+{
+    char buffer[160];
+    int length = std::snprintf(
+        buffer, sizeof(buffer), "[Replay] %llu messages, %.1f MB in %.3f s: %.0f msg/s, %.0f msg/s while busy\n",
+        static_cast<unsigned long long>(stats.message_count), static_cast<double>(stats.byte_count) / 1e6,
+        static_cast<double>(stats.elapsed_ns) / 1e9, PerSecond(stats.message_count, stats.elapsed_ns),
+        PerSecond(stats.message_count, stats.busy_ns));
+    out.append(buffer, static_cast<size_t>(std::max(length, 0)));
+
+    out += "[Replay] per message";
+    AppendMicros(out, "mean", static_cast<uint64_t>(stats.latency.mean_ns));
+    AppendMicros(out, "min", stats.latency.min_ns);
+    AppendMicros(out, "p50", stats.latency.p50_ns);
+    AppendMicros(out, "p90", stats.latency.p90_ns);
+    AppendMicros(out, "p99", stats.latency.p99_ns);
+    AppendMicros(out, "p99.9", stats.latency.p999_ns);
+    AppendMicros(out, "max", stats.latency.max_ns);
+    out += '\n';
+
+    length = std::snprintf(buffer, sizeof(buffer), "[Replay] %llu allocations, %.2f per message, max lag %.1fus\n",
+                           static_cast<unsigned long long>(stats.allocation_count),
+                           stats.message_count != 0 ? static_cast<double>(stats.allocation_count) /
+                                                          static_cast<double>(stats.message_count)
+                                                    : 0.0,
+                           static_cast<double>(stats.max_lag_ns) / 1000.0);
+    out.append(buffer, static_cast<size_t>(std::max(length, 0)));
+}
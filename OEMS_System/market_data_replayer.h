@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "latency_recorder.h"
+#include "market_data_journal.h"
+#include "web_socket_client.h"
+
+enum class ReplayPace
+{
+    RECORDED,   // Frames are fed with the gaps they arrived with
+    MAX_SPEED   // Frames are fed back to back
+};
+
+struct ReplayStats
+{
+    uint64_t message_count;
+    uint64_t byte_count;
+    int64_t elapsed_ns;         // Wall time of the whole replay, reading the journal included
+    int64_t busy_ns;            // Time spent inside ReceiveFrame only
+    int64_t max_lag_ns;         // Furthest a frame fell behind its recorded time; RECORDED only
+    uint64_t allocation_count;  // Made inside ReceiveFrame; 0 without an allocation counter
+    LatencySummary latency;     // ReceiveFrame time per message
+};
+
+// Feeds a journal written by MarketDataRecorder through DrogonWebSocket::ReceiveFrame, and so through every
+// handler subscribed on the connection, on the calling thread. Frames go in byte for byte and in the order
+// they were received, so a replay rebuilds the state the live process had; only the timing differs.
+class MarketDataReplayer
+{
+  public:
+    // Returns the process-wide allocation count; only a program that replaces operator new can provide one
+    using AllocationCounter = uint64_t (*)();
+
+    // Waits longer than this are slept, shorter ones spun, so frames are fed close to their recorded times
+    static constexpr std::chrono::microseconds SPIN_THRESHOLD{200};
+
+  private:
+    DrogonWebSocket& m_web_socket;
+    AllocationCounter m_allocation_counter{nullptr};
+    LatencyHistogram m_latency;
+
+    static void WaitUntil(int64_t target_ns) noexcept;
+
+  public:
+    explicit MarketDataReplayer(DrogonWebSocket& web_socket);
+
+    MarketDataReplayer(const MarketDataReplayer&) = delete;
+    MarketDataReplayer& operator=(const MarketDataReplayer&) = delete;
+
+    void SetAllocationCounter(AllocationCounter counter);
+
+    // Channels that appear in the journal, in order of first appearance, so the caller can subscribe the
+    // handlers that would have received them. Leaves the reader rewound.
+    static std::vector<std::string> FindChannels(MarketDataJournalReader& reader);
+
+    // Reads the journal from where the reader stands to its end
+    ReplayStats Run(MarketDataJournalReader& reader, ReplayPace pace);
+
+    static void FormatReport(const ReplayStats& stats, std::string& out);
+};
@@ -0,0 +1,357 @@
+#include "market_data_server.h"
+
+#include <algorithm>
+
+#include <drogon/drogon.h>
+
+#include "json_scanner.h"
+
+MarketDataServer::MarketDataServer(OrderBookManager& order_book_manager,
+                                   const InstrumentRegistry& instrument_registry, StrategyThread& strategy_thread,
+                                   const std::chrono::milliseconds flush_interval)
+    : m_order_book_manager(order_book_manager),
+      m_instrument_registry(instrument_registry),
+      m_flush_interval(flush_interval)
+{
+    strategy_thread.AddHandler(
+        [this](const MarketEvent& event)
+        {
+            if (event.type == MarketEventType::BOOK)
+            {
+                OnBookUpdate(event.GetInstrument());
+            }
+        });
+}
+
+MarketDataServer::~MarketDataServer()
+{
+    if (m_flush_timer != 0)
+    {
+        drogon::app().getLoop()->invalidateTimer(m_flush_timer);
+    }
+}
+
+void MarketDataServer::Start()
+{
+    m_flush_timer = drogon::app().getLoop()->runEvery(
+        std::chrono::duration<double>(m_flush_interval).count(), [this]() { Flush(); });
+}
+
+MarketDataServerStats MarketDataServer::GetStats() const noexcept
+{
+    return {m_clients.load(std::memory_order_relaxed), m_book_updates.load(std::memory_order_relaxed),
+            m_conflated.load(std::memory_order_relaxed), m_frames_sent.load(std::memory_order_relaxed),
+            m_frames_held.load(std::memory_order_relaxed)};
+}
+
+void MarketDataServer::SendError(const drogon::WebSocketConnectionPtr& connection, const std::string_view message)
+{
+    std::string reply = "{\"error\":\"";
+    reply += message;
+    reply += "\"}";
+    connection->send(reply);
+}
+
+// Function to note that a book changed; runs on the feed thread and never touches a client
+void MarketDataServer::OnBookUpdate(const std::string_view instrument_name)
+{
+    m_book_updates.fetch_add(1, std::memory_order_relaxed);
+    // Symbols are keyed by owned strings; the scratch copy keeps the lookup from allocating
+    m_update_symbol.assign(instrument_name.data(), instrument_name.size());
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_symbols.find(m_update_symbol);
+    if (it == m_symbols.end() || it->second.subscribers.empty())
+    {
+        return;
+    }
+    if (it->second.is_dirty)
+    {
+        m_conflated.fetch_add(1, std::memory_order_relaxed);
+    }
+    it->second.is_dirty = true;
+}
+
+bool MarketDataServer::BuildFrame(const std::string& symbol, std::string& frame) const
+{
+    frame.clear();
+    frame += "{\"channel\":\"book.";
+    frame += symbol;
+    frame += "\",\"data\":";
+    if (!m_order_book_manager.AppendOrderBook(symbol, frame))
+    {
+        return false;
+    }
+    frame += '}';
+    return true;
+}
+
+// Function to send a frame unless the client is backed up; a skipped client is caught up once it drains
+void MarketDataServer::SendFrame(const drogon::WebSocketConnectionPtr& connection, const std::string& frame)
+{
+    const auto client = connection->getContext<ClientState>();
+    if (client && client->is_backed_up.load(std::memory_order_acquire))
+    {
+        m_frames_held.fetch_add(1, std::memory_order_relaxed);
+        if (!client->is_stale)
+        {
+            client->is_stale = true;
+            m_stale_clients.push_back(connection);
+        }
+        return;
+    }
+
+    connection->send(frame.data(), frame.size());
+    m_frames_sent.fetch_add(1, std::memory_order_relaxed);
+}
+
+// Function to send every subscribed symbol to clients that have drained since they were skipped
+void MarketDataServer::CatchUpStaleClients()
+{
+    m_catch_up_clients.swap(m_stale_clients);
+    for (const auto& connection : m_catch_up_clients)
+    {
+        const auto client = connection->getContext<ClientState>();
+        if (!client || !connection->connected())
+        {
+            continue;
+        }
+        if (client->is_backed_up.load(std::memory_order_acquire))
+        {
+            m_stale_clients.push_back(connection);
+            continue;
+        }
+        client->is_stale = false;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_catch_up_symbols.assign(client->symbols.begin(), client->symbols.end());
+        }
+        for (const auto& symbol : m_catch_up_symbols)
+        {
+            if (BuildFrame(symbol, m_frame))
+            {
+                SendFrame(connection, m_frame);
+            }
+        }
+    }
+    m_catch_up_clients.clear();
+}
+
+// Function to send the latest state of every dirty symbol, encoded once per symbol
+void MarketDataServer::Flush()
+{
+    CatchUpStaleClients();
+
+    m_flush_symbols.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& [symbol, state] : m_symbols)
+        {
+            if (state.is_dirty)
+            {
+                state.is_dirty = false;
+                m_flush_symbols.push_back(symbol);
+            }
+        }
+    }
+
+    for (const auto& symbol : m_flush_symbols)
+    {
+        if (!BuildFrame(symbol, m_frame))
+        {
+            continue;
+        }
+
+        m_flush_subscribers.clear();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const auto it = m_symbols.find(symbol);
+            if (it != m_symbols.end())
+            {
+                m_flush_subscribers.assign(it->second.subscribers.begin(), it->second.subscribers.end());
+            }
+        }
+
+        for (const auto& connection : m_flush_subscribers)
+        {
+            if (connection->connected())
+            {
+                SendFrame(connection, m_frame);
+            }
+        }
+    }
+    m_flush_subscribers.clear();
+}
+
+void MarketDataServer::Subscribe(const drogon::WebSocketConnectionPtr& connection,
+                                 const std::vector<std::string>& symbols)
+{
+    const auto client = connection->getContext<ClientState>();
+    if (!client)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& symbol : symbols)
+        {
+            if (std::find(client->symbols.begin(), client->symbols.end(), symbol) != client->symbols.end())
+            {
+                continue;
+            }
+            client->symbols.push_back(symbol);
+
+            SymbolState& state = m_symbols[symbol];
+            // The server holds the book once, for as long as anyone subscribes to it; done under the lock so
+            // the hold and release for one symbol cannot pass each other
+            if (state.subscribers.empty())
+            {
+                m_order_book_manager.AddHolder(symbol);
+            }
+            state.subscribers.push_back(connection);
+            // The new subscriber gets the current book on the next flush
+            state.is_dirty = true;
+        }
+    }
+}
+
+void MarketDataServer::Unsubscribe(const drogon::WebSocketConnectionPtr& connection,
+                                   const std::vector<std::string>& symbols)
+{
+    const auto client = connection->getContext<ClientState>();
+    if (!client)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& symbol : symbols)
+    {
+        const auto client_it = std::find(client->symbols.begin(), client->symbols.end(), symbol);
+        if (client_it == client->symbols.end())
+        {
+            continue;
+        }
+        client->symbols.erase(client_it);
+
+        const auto it = m_symbols.find(symbol);
+        if (it != m_symbols.end())
+        {
+            auto& subscribers = it->second.subscribers;
+            subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), connection), subscribers.end());
+            if (subscribers.empty())
+            {
+                m_symbols.erase(it);
+                m_order_book_manager.RemoveHolder(symbol);
+            }
+        }
+    }
+}
+
+void MarketDataServer::handleNewMessage(const drogon::WebSocketConnectionPtr& connection, std::string&& message,
+                                        const drogon::WebSocketMessageType& type)
+{
+    if (type != drogon::WebSocketMessageType::Text)
+    {
+        return;
+    }
+
+    std::string_view method;
+    std::string_view params;
+    std::string_view symbols_array;
+    if (!JsonScanner::FindMember(message, "method", method) || !JsonScanner::FindMember(message, "params", params) ||
+        !JsonScanner::FindMember(params, "symbols", symbols_array))
+    {
+        SendError(connection, "expected method and params.symbols");
+        return;
+    }
+
+    std::vector<std::string> symbols;
+    JsonScanner::ForEachElement(symbols_array,
+                                [&symbols](const std::string_view value)
+                                {
+                                    const std::string_view symbol = JsonScanner::ToStringView(value);
+                                    if (!symbol.empty())
+                                    {
+                                        symbols.emplace_back(symbol);
+                                    }
+                                    return true;
+                                });
+
+    method = JsonScanner::ToStringView(method);
+    if (method == "subscribe")
+    {
+        // Each symbol costs an exchange subscription, so only listed instruments are accepted
+        const auto unknown = std::remove_if(symbols.begin(), symbols.end(), [this](const std::string& symbol)
+                                            { return m_instrument_registry.Find(symbol) == nullptr; });
+        if (unknown != symbols.end())
+        {
+            symbols.erase(unknown, symbols.end());
+            SendError(connection, "unknown symbol");
+        }
+        Subscribe(connection, symbols);
+    }
+    else if (method == "unsubscribe")
+    {
+        Unsubscribe(connection, symbols);
+    }
+    else
+    {
+        SendError(connection, "unknown method");
+        return;
+    }
+
+    std::string reply = "{\"result\":[";
+    for (size_t i = 0; i < symbols.size(); ++i)
+    {
+        reply += i == 0 ? "\"" : ",\"";
+        reply += symbols[i];
+        reply += '"';
+    }
+    reply += "]}";
+    connection->send(reply);
+}
+
+void MarketDataServer::handleNewConnection(const drogon::HttpRequestPtr& request,
+                                           const drogon::WebSocketConnectionPtr& connection)
+{
+    const auto client = std::make_shared<ClientState>();
+    connection->setContext(client);
+
+    // The WebSocket runs on the upgraded TCP connection, whose output buffer tells how far behind the client is
+    if (const auto tcp_connection = request->getConnectionPtr().lock())
+    {
+        const std::weak_ptr<ClientState> weak_client = client;
+        tcp_connection->setHighWaterMarkCallback(
+            [weak_client](const trantor::TcpConnectionPtr&, size_t)
+            {
+                if (const auto backed_up_client = weak_client.lock())
+                {
+                    backed_up_client->is_backed_up.store(true, std::memory_order_release);
+                }
+            },
+            CLIENT_HIGH_WATER_MARK);
+        tcp_connection->setWriteCompleteCallback(
+            [weak_client](const trantor::TcpConnectionPtr&)
+            {
+                if (const auto drained_client = weak_client.lock())
+                {
+                    drained_client->is_backed_up.store(false, std::memory_order_release);
+                }
+            });
+    }
+    m_clients.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MarketDataServer::handleConnectionClosed(const drogon::WebSocketConnectionPtr& connection)
+{
+    const auto client = connection->getContext<ClientState>();
+    if (client)
+    {
+        const std::vector<std::string> symbols = client->symbols;
+        Unsubscribe(connection, symbols);
+    }
+    m_clients.fetch_sub(1, std::memory_order_relaxed);
+}
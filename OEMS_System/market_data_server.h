@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <drogon/WebSocketController.h>
+
+#include "instrument_registry.h"
+#include "order_book.h"
+#include "strategy_thread.h"
+
+struct MarketDataServerStats
+{
+    uint64_t clients;
+    uint64_t book_updates;   // Updates received from the feed
+    uint64_t conflated;      // Updates folded into one that was still waiting to be sent
+    uint64_t frames_sent;
+    uint64_t frames_held;    // Frames not sent because the client's output had backed up
+};
+
+// Streams local order books to downstream WebSocket clients.
+//
+// Clients send {"method":"subscribe","params":{"symbols":["BTC-PERPETUAL"]}} (or "unsubscribe") and then
+// receive {"channel":"book.BTC-PERPETUAL","data":{...}} frames. Only instruments in the registry can be
+// subscribed, and a book is held in the order book manager only while some client subscribes to it. Feed updates only mark a symbol dirty;
+// every flush interval each dirty symbol is encoded once and handed to each subscriber's connection, which
+// copies it into its own output buffer. Updates arriving between flushes are conflated into the latest state,
+// so the feed never waits for a client. A client whose unsent output passes CLIENT_HIGH_WATER_MARK is skipped
+// until it drains and is then sent the latest state of all of its symbols, so a slow client holds at most
+// about CLIENT_HIGH_WATER_MARK bytes of server memory.
+class MarketDataServer : public drogon::WebSocketController<MarketDataServer, false>
+{
+  public:
+    static constexpr uint16_t DEFAULT_PORT = 8848;
+    static constexpr std::chrono::milliseconds DEFAULT_FLUSH_INTERVAL{10};
+    static constexpr size_t CLIENT_HIGH_WATER_MARK = 1 << 20;
+
+  private:
+    struct SymbolState
+    {
+        std::vector<drogon::WebSocketConnectionPtr> subscribers;
+        bool is_dirty{false};
+    };
+
+    struct ClientState
+    {
+        std::vector<std::string> symbols;
+        // Set on the connection's loop once its unsent output passes CLIENT_HIGH_WATER_MARK, cleared when it drains
+        std::atomic<bool> is_backed_up{false};
+        // Only touched by the flush timer; set once a frame has been held back from this client
+        bool is_stale{false};
+    };
+
+    OrderBookManager& m_order_book_manager;
+    const InstrumentRegistry& m_instrument_registry;
+    std::chrono::milliseconds m_flush_interval;
+    trantor::TimerId m_flush_timer{0};
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, SymbolState> m_symbols;
+    std::atomic<uint64_t> m_clients{0};
+    std::atomic<uint64_t> m_book_updates{0};
+    std::atomic<uint64_t> m_conflated{0};
+    std::atomic<uint64_t> m_frames_sent{0};
+    std::atomic<uint64_t> m_frames_held{0};
+
+    // Only touched on the strategy thread
+    std::string m_update_symbol;
+
+    // Only touched by the flush timer, so their capacity is reused from flush to flush
+    std::vector<std::string> m_flush_symbols;
+    std::vector<drogon::WebSocketConnectionPtr> m_flush_subscribers;
+    std::string m_frame;
+    // Clients that missed frames while backed up, resent every symbol once they drain
+    std::vector<drogon::WebSocketConnectionPtr> m_stale_clients;
+    std::vector<drogon::WebSocketConnectionPtr> m_catch_up_clients;
+    std::vector<std::string> m_catch_up_symbols;
+
+    static void SendError(const drogon::WebSocketConnectionPtr& connection, std::string_view message);
+
+    void OnBookUpdate(std::string_view instrument_name);
+    void Flush();
+    void CatchUpStaleClients();
+    void SendFrame(const drogon::WebSocketConnectionPtr& connection, const std::string& frame);
+    bool BuildFrame(const std::string& symbol, std::string& frame) const;
+    void Subscribe(const drogon::WebSocketConnectionPtr& connection, const std::vector<std::string>& symbols);
+    void Unsubscribe(const drogon::WebSocketConnectionPtr& connection, const std::vector<std::string>& symbols);
+
+  public:
+    // Book updates arrive through the strategy thread, so the feed never waits for the server's lock
+    MarketDataServer(OrderBookManager& order_book_manager, const InstrumentRegistry& instrument_registry,
+                     StrategyThread& strategy_thread,
+                     std::chrono::milliseconds flush_interval = DEFAULT_FLUSH_INTERVAL);
+    ~MarketDataServer() override;
+
+    MarketDataServer(const MarketDataServer&) = delete;
+    MarketDataServer& operator=(const MarketDataServer&) = delete;
+
+    // Starts the flush timer on the app loop
+    void Start();
+
+    MarketDataServerStats GetStats() const noexcept;
+
+    void handleNewMessage(const drogon::WebSocketConnectionPtr& connection, std::string&& message,
+                          const drogon::WebSocketMessageType& type) override;
+    void handleNewConnection(const drogon::HttpRequestPtr& request,
+                             const drogon::WebSocketConnectionPtr& connection) override;
+    void handleConnectionClosed(const drogon::WebSocketConnectionPtr& connection) override;
+
+    WS_PATH_LIST_BEGIN
+    WS_PATH_ADD("/ws/market_data");
+    WS_PATH_LIST_END
+};
@@ -0,0 +1,382 @@
+#include "option_chain.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <limits>
+
+#include "binary_logger.h"
+
+namespace {
+    const LogFormat LOG_REFRESHED{LogLevel::INFO,
+                                  "[OptionChain] {} options in {} expiries, {} tickers added, {} removed"};
+
+    constexpr double NOT_QUOTED = std::numeric_limits<double>::quiet_NaN();
+
+    int64_t NowMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    std::string_view GetBaseCurrency(const InstrumentInfo& info) noexcept
+    {
+        return std::string_view(info.base_currency,
+                                ::strnlen(info.base_currency, InstrumentInfo::CURRENCY_CAPACITY));
+    }
+}
+
+void OptionChain::Table::Resize(const size_t count)
+{
+    names.resize(count);
+    instrument_ids.resize(count);
+    option_types.resize(count);
+    expiration_timestamps_ms.resize(count);
+    strikes.resize(count);
+    timestamps_ms.assign(count, 0);
+    for (size_t field = 0; field < FIELD_COUNT; ++field)
+    {
+        // Volatilities and greeks are unknown rather than zero until a ticker says otherwise
+        const bool is_model_value = field >= BID_IV && field <= RHO;
+        fields[field].assign(count, is_model_value ? NOT_QUOTED : 0.0);
+    }
+}
+
+uint32_t OptionChain::Table::Find(const std::string_view instrument_name) const
+{
+    const auto it = rows.find(instrument_name);
+    return it != rows.end() ? it->second : NO_ROW;
+}
+
+const OptionExpiry* OptionChain::Table::FindExpiry(const int64_t expiration_timestamp_ms) const
+{
+    const auto it = std::lower_bound(expiries.begin(), expiries.end(), expiration_timestamp_ms,
+                                     [](const OptionExpiry& expiry, const int64_t timestamp_ms)
+                                     { return expiry.expiration_timestamp_ms < timestamp_ms; });
+    return it != expiries.end() && it->expiration_timestamp_ms == expiration_timestamp_ms ? &*it : nullptr;
+}
+
+OptionChain::OptionChain(TickerFeed& ticker_feed, InstrumentRegistry& instrument_registry, std::string currency)
+    : m_ticker_feed(ticker_feed), m_instrument_registry(instrument_registry), m_currency(std::move(currency)),
+      m_ticker_consumer(ticker_feed.AddConsumer(ConflationPolicy::Every(QUOTE_INTERVAL),
+                                                [this](const TickerUpdate& ticker) { OnTicker(ticker); }))
+{
+}
+
+void OptionChain::CopyRow(const Table& from, const uint32_t from_row, Table& to, const uint32_t to_row) noexcept
+{
+    to.timestamps_ms[to_row] = from.timestamps_ms[from_row];
+    for (size_t field = 0; field < FIELD_COUNT; ++field)
+    {
+        to.fields[field][to_row] = from.fields[field][from_row];
+    }
+}
+
+void OptionChain::ReadRow(const Table& table, const uint32_t row, OptionQuote& quote) noexcept
+{
+    const auto& fields = table.fields;
+    quote.instrument_id = table.instrument_ids[row];
+    quote.option_type = table.option_types[row];
+    quote.expiration_timestamp_ms = table.expiration_timestamps_ms[row];
+    quote.strike = table.strikes[row];
+    quote.timestamp_ms = table.timestamps_ms[row];
+    quote.best_bid_price = fields[BEST_BID_PRICE][row];
+    quote.best_bid_amount = fields[BEST_BID_AMOUNT][row];
+    quote.best_ask_price = fields[BEST_ASK_PRICE][row];
+    quote.best_ask_amount = fields[BEST_ASK_AMOUNT][row];
+    quote.mark_price = fields[MARK_PRICE][row];
+    quote.underlying_price = fields[UNDERLYING_PRICE][row];
+    quote.bid_iv = fields[BID_IV][row];
+    quote.ask_iv = fields[ASK_IV][row];
+    quote.mark_iv = fields[MARK_IV][row];
+    quote.delta = fields[DELTA][row];
+    quote.gamma = fields[GAMMA][row];
+    quote.vega = fields[VEGA][row];
+    quote.theta = fields[THETA][row];
+    quote.rho = fields[RHO][row];
+    quote.open_interest = fields[OPEN_INTEREST][row];
+}
+
+void OptionChain::Start()
+{
+    m_instrument_registry.AddUpdateListener([this]() { Refresh(); });
+    Refresh();
+}
+
+// Function to lay the currency's listed options out again, carrying over the quotes of those still listed
+// and moving the ticker subscriptions to match
+size_t OptionChain::Refresh()
+{
+    std::lock_guard<std::mutex> refresh_lock(m_refresh_mutex);
+
+    const int64_t now_ms = NowMs();
+    std::vector<const InstrumentInfo*> options;
+    const size_t instrument_count = m_instrument_registry.GetCount();
+    for (InstrumentId id = 0; id < instrument_count; ++id)
+    {
+        const InstrumentInfo* info = m_instrument_registry.Get(id);
+        if (info && info->kind == InstrumentKind::OPTION && GetBaseCurrency(*info) == m_currency &&
+            !info->IsExpired(now_ms))
+        {
+            options.push_back(info);
+        }
+    }
+    std::sort(options.begin(), options.end(),
+              [](const InstrumentInfo* left, const InstrumentInfo* right)
+              {
+                  if (left->expiration_timestamp_ms != right->expiration_timestamp_ms)
+                  {
+                      return left->expiration_timestamp_ms < right->expiration_timestamp_ms;
+                  }
+                  if (left->strike != right->strike)
+                  {
+                      return left->strike < right->strike;
+                  }
+                  return left->option_type < right->option_type;
+              });
+
+    auto table = std::make_unique<Table>();
+    table->Resize(options.size());
+    table->rows.reserve(options.size());
+    std::vector<std::string> instruments;
+    instruments.reserve(options.size());
+    for (uint32_t row = 0; row < options.size(); ++row)
+    {
+        const InstrumentInfo& info = *options[row];
+        table->names[row].assign(info.GetName());
+        table->instrument_ids[row] = m_instrument_registry.GetId(info.GetName());
+        table->option_types[row] = info.option_type;
+        table->expiration_timestamps_ms[row] = info.expiration_timestamp_ms;
+        table->strikes[row] = info.strike;
+        table->rows.emplace(table->names[row], row);
+        instruments.emplace_back(info.GetName());
+
+        if (table->expiries.empty() || table->expiries.back().expiration_timestamp_ms != info.expiration_timestamp_ms)
+        {
+            table->expiries.push_back({info.expiration_timestamp_ms, row, row});
+        }
+        table->expiries.back().end = row + 1;
+    }
+    const size_t row_count = options.size();
+    const size_t expiry_count = table->expiries.size();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_table)
+        {
+            for (uint32_t row = 0; row < row_count; ++row)
+            {
+                const uint32_t previous_row = m_table->Find(table->names[row]);
+                if (previous_row != NO_ROW)
+                {
+                    CopyRow(*m_table, previous_row, *table, row);
+                }
+            }
+        }
+        m_table.swap(table);
+    }
+
+    // Both lists sorted, so what changed falls out of one pass over each
+    std::sort(instruments.begin(), instruments.end());
+    std::vector<std::string> added;
+    std::vector<std::string> removed;
+    std::set_difference(instruments.begin(), instruments.end(), m_tracked.begin(), m_tracked.end(),
+                        std::back_inserter(added));
+    std::set_difference(m_tracked.begin(), m_tracked.end(), instruments.begin(), instruments.end(),
+                        std::back_inserter(removed));
+    m_ticker_feed.Untrack(m_ticker_consumer, removed);
+    m_ticker_feed.Track(m_ticker_consumer, added);
+    m_tracked = std::move(instruments);
+
+    BinaryLogger::Write(LOG_REFRESHED, row_count, expiry_count, added.size(), removed.size());
+    return row_count;
+}
+
+void OptionChain::OnTicker(const TickerUpdate& ticker)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_table)
+    {
+        return;
+    }
+    Table& table = *m_table;
+    // Delisted since the last refresh and not yet untracked
+    const uint32_t row = table.Find(ticker.instrument_name);
+    if (row == NO_ROW)
+    {
+        return;
+    }
+
+    auto& fields = table.fields;
+    table.timestamps_ms[row] = ticker.timestamp_ms;
+    fields[BEST_BID_PRICE][row] = ticker.best_bid_price;
+    fields[BEST_BID_AMOUNT][row] = ticker.best_bid_amount;
+    fields[BEST_ASK_PRICE][row] = ticker.best_ask_price;
+    fields[BEST_ASK_AMOUNT][row] = ticker.best_ask_amount;
+    fields[MARK_PRICE][row] = ticker.mark_price;
+    fields[UNDERLYING_PRICE][row] = ticker.underlying_price;
+    fields[BID_IV][row] = ticker.bid_iv;
+    fields[ASK_IV][row] = ticker.ask_iv;
+    fields[MARK_IV][row] = ticker.mark_iv;
+    fields[DELTA][row] = ticker.delta;
+    fields[GAMMA][row] = ticker.gamma;
+    fields[VEGA][row] = ticker.vega;
+    fields[THETA][row] = ticker.theta;
+    fields[RHO][row] = ticker.rho;
+    fields[OPEN_INTEREST][row] = ticker.open_interest;
+    ++m_update_count;
+}
+
+size_t OptionChain::GetRowCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_table ? m_table->strikes.size() : 0;
+}
+
+uint64_t OptionChain::GetUpdateCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_update_count;
+}
+
+void OptionChain::GetExpiries(std::vector<OptionExpiry>& out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_table)
+    {
+        out = m_table->expiries;
+    }
+    else
+    {
+        out.clear();
+    }
+}
+
+bool OptionChain::GetQuote(const std::string_view instrument_name, OptionQuote& out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const uint32_t row = m_table ? m_table->Find(instrument_name) : NO_ROW;
+    if (row == NO_ROW)
+    {
+        return false;
+    }
+    ReadRow(*m_table, row, out);
+    return true;
+}
+
+// Function to filter the whole chain in two passes: a branch-free one over the type and delta columns that
+// marks the matches, then one that copies out only the rows marked
+size_t OptionChain::FindByDelta(const OptionType option_type, const double min_delta, const double max_delta,
+                                std::vector<OptionQuote>& out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_table)
+    {
+        out.clear();
+        return 0;
+    }
+    const Table& table = *m_table;
+    const size_t row_count = table.strikes.size();
+    m_matches.resize(row_count);
+
+    const OptionType* option_types = table.option_types.data();
+    const double* deltas = table.fields[DELTA].data();
+    uint8_t* matches = m_matches.data();
+    size_t found = 0;
+    // A NaN delta fails both comparisons, so options that have not ticked yet never match
+    for (size_t row = 0; row < row_count; ++row)
+    {
+        const bool is_match = (option_types[row] == option_type) & (deltas[row] >= min_delta) &
+                              (deltas[row] <= max_delta);
+        matches[row] = static_cast<uint8_t>(is_match);
+        found += matches[row];
+    }
+
+    out.resize(found);
+    size_t index = 0;
+    for (uint32_t row = 0; index < found; ++row)
+    {
+        if (matches[row] != 0)
+        {
+            ReadRow(table, row, out[index++]);
+        }
+    }
+    return found;
+}
+
+bool OptionChain::FindBestBid(const int64_t expiration_timestamp_ms, const OptionType option_type,
+                              OptionQuote& out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const OptionExpiry* expiry = m_table ? m_table->FindExpiry(expiration_timestamp_ms) : nullptr;
+    if (!expiry)
+    {
+        return false;
+    }
+    const Table& table = *m_table;
+    const OptionType* option_types = table.option_types.data();
+    const double* bids = table.fields[BEST_BID_PRICE].data();
+    const bool is_any_type = option_type == OptionType::NONE;
+
+    // A max reduction over the expiry's rows, then a search for the first row holding it
+    double best = 0;
+    for (uint32_t row = expiry->begin; row < expiry->end; ++row)
+    {
+        const double bid = (is_any_type | (option_types[row] == option_type)) ? bids[row] : 0.0;
+        best = bid > best ? bid : best;
+    }
+    if (best <= 0)
+    {
+        return false;
+    }
+
+    for (uint32_t row = expiry->begin; row < expiry->end; ++row)
+    {
+        if (bids[row] == best && (is_any_type || option_types[row] == option_type))
+        {
+            ReadRow(table, row, out);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool OptionChain::FindBestAsk(const int64_t expiration_timestamp_ms, const OptionType option_type,
+                              OptionQuote& out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const OptionExpiry* expiry = m_table ? m_table->FindExpiry(expiration_timestamp_ms) : nullptr;
+    if (!expiry)
+    {
+        return false;
+    }
+    const Table& table = *m_table;
+    const OptionType* option_types = table.option_types.data();
+    const double* asks = table.fields[BEST_ASK_PRICE].data();
+    const bool is_any_type = option_type == OptionType::NONE;
+
+    // Zero means no ask, so it is left out of the min reduction along with the other type
+    constexpr double no_ask = std::numeric_limits<double>::infinity();
+    double best = no_ask;
+    for (uint32_t row = expiry->begin; row < expiry->end; ++row)
+    {
+        const bool is_candidate = (is_any_type | (option_types[row] == option_type)) & (asks[row] > 0);
+        const double ask = is_candidate ? asks[row] : no_ask;
+        best = ask < best ? ask : best;
+    }
+    if (best == no_ask)
+    {
+        return false;
+    }
+
+    for (uint32_t row = expiry->begin; row < expiry->end; ++row)
+    {
+        if (asks[row] == best && (is_any_type || option_types[row] == option_type))
+        {
+            ReadRow(table, row, out);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "instrument_registry.h"
+#include "market_data_decoder.h"
+#include "ticker_feed.h"
+
+// One option's listing and latest ticker, copied out of the chain. Greeks and volatilities are NaN until
+// the first ticker arrives; prices and amounts are zero when that side of the book is empty.
+struct OptionQuote
+{
+    InstrumentId instrument_id;
+    OptionType option_type;
+    int64_t expiration_timestamp_ms;
+    double strike;
+    int64_t timestamp_ms;
+    double best_bid_price;
+    double best_bid_amount;
+    double best_ask_price;
+    double best_ask_amount;
+    double mark_price;
+    double underlying_price;
+    double bid_iv;
+    double ask_iv;
+    double mark_iv;
+    double delta;
+    double gamma;
+    double vega;
+    double theta;
+    double rho;
+    double open_interest;
+};
+
+// Rows [begin, end) of the chain share this expiry
+struct OptionExpiry
+{
+    int64_t expiration_timestamp_ms;
+    uint32_t begin;
+    uint32_t end;
+};
+
+// Every listed option of one currency, kept current from their tickers and laid out as columns.
+//
+// Each field is a contiguous array with one entry per option, and rows are sorted by expiry, then strike,
+// then calls before puts, so an expiry is one run of rows with ascending strikes. Queries are flat loops over
+// one or two columns without branches: the delta filter compiles to vector compares over the whole chain, and
+// the best bid of an expiry is one pass over its hundred or so contiguous prices.
+//
+// The rows follow the instrument registry: each published table rebuilds them, keeping the quotes of options
+// still listed, and moves the ticker subscriptions with them. Tickers come from the ticker feed, conflated to
+// QUOTE_INTERVAL per option, and are written on the market-data thread; queries may come from any thread. Both
+// take one lock, held for a single row or a single scan.
+class OptionChain
+{
+  public:
+    static constexpr std::chrono::milliseconds QUOTE_INTERVAL{100};
+
+  private:
+    static constexpr uint32_t NO_ROW = ~uint32_t{0};
+
+    enum Field : size_t
+    {
+        BEST_BID_PRICE,
+        BEST_BID_AMOUNT,
+        BEST_ASK_PRICE,
+        BEST_ASK_AMOUNT,
+        MARK_PRICE,
+        UNDERLYING_PRICE,
+        BID_IV,
+        ASK_IV,
+        MARK_IV,
+        DELTA,
+        GAMMA,
+        VEGA,
+        THETA,
+        RHO,
+        OPEN_INTEREST,
+        FIELD_COUNT
+    };
+
+    struct Table
+    {
+        // Set when the table is built
+        std::vector<std::string> names;
+        std::vector<InstrumentId> instrument_ids;
+        std::vector<OptionType> option_types;
+        std::vector<int64_t> expiration_timestamps_ms;
+        std::vector<double> strikes;
+        std::vector<OptionExpiry> expiries;
+        // Keys point into names, which is never resized once the table is built
+        std::unordered_map<std::string_view, uint32_t> rows;
+
+        // Written by the ticker feed
+        std::vector<int64_t> timestamps_ms;
+        std::array<std::vector<double>, FIELD_COUNT> fields;
+
+        void Resize(size_t count);
+        uint32_t Find(std::string_view instrument_name) const;
+        const OptionExpiry* FindExpiry(int64_t expiration_timestamp_ms) const;
+    };
+
+    TickerFeed& m_ticker_feed;
+    InstrumentRegistry& m_instrument_registry;
+    const std::string m_currency;
+    const TickerFeed::ConsumerId m_ticker_consumer;
+
+    // Serializes rebuilds; m_tracked is only touched under it
+    std::mutex m_refresh_mutex;
+    std::vector<std::string> m_tracked;
+
+    mutable std::mutex m_mutex;
+    std::unique_ptr<Table> m_table;
+    uint64_t m_update_count{0};
+    // Scratch for queries, reused under m_mutex
+    mutable std::vector<uint8_t> m_matches;
+
+    static void CopyRow(const Table& from, uint32_t from_row, Table& to, uint32_t to_row) noexcept;
+    static void ReadRow(const Table& table, uint32_t row, OptionQuote& quote) noexcept;
+
+    void OnTicker(const TickerUpdate& ticker);
+
+  public:
+    // Registers with the ticker feed, so it must be built before the feed starts
+    OptionChain(TickerFeed& ticker_feed, InstrumentRegistry& instrument_registry, std::string currency);
+
+    OptionChain(const OptionChain&) = delete;
+    OptionChain& operator=(const OptionChain&) = delete;
+
+    // Builds the rows from the registry as it is now and rebuilds them after every refresh of it
+    void Start();
+    // Rebuilds the rows from the registry's unexpired options; returns the number of rows
+    size_t Refresh();
+
+    size_t GetRowCount() const;
+    uint64_t GetUpdateCount() const;
+    void GetExpiries(std::vector<OptionExpiry>& out) const;
+
+    bool GetQuote(std::string_view instrument_name, OptionQuote& out) const;
+
+    // Options of one type whose delta is within [min_delta, max_delta], in row order. Puts have negative
+    // deltas. Returns the number found.
+    size_t FindByDelta(OptionType option_type, double min_delta, double max_delta,
+                       std::vector<OptionQuote>& out) const;
+
+    // Highest bid and lowest ask among one expiry's options of a type, or of both types for NONE.
+    // False when the expiry is unknown or that side is empty throughout.
+    bool FindBestBid(int64_t expiration_timestamp_ms, OptionType option_type, OptionQuote& out) const;
+    bool FindBestAsk(int64_t expiration_timestamp_ms, OptionType option_type, OptionQuote& out) const;
+};
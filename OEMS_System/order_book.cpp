@@ -0,0 +1,488 @@
+#include "order_book.h"
+
+#include <algorithm>
+#include <charconv>
+
+#include "binary_logger.h"
+#include "latency_recorder.h"
+#include "market_data_decoder.h"
+#include "web_socket_client.h"
+
+namespace {
+    const LogFormat LOG_MALFORMED_UPDATE{LogLevel::ERR, "[OrderBook] Malformed book update"};
+    const LogFormat LOG_SEQUENCE_GAP{LogLevel::WARN, "[OrderBook] Sequence gap on {}, resubscribing"};
+
+    void AppendNumber(std::string& out, const double value)
+    {
+        char buffer[32];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+
+    void AppendNumber(std::string& out, const int64_t value)
+    {
+        char buffer[24];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+
+    void AppendLevels(std::string& out, const std::vector<PriceLevel>& levels, const size_t depth)
+    {
+        out += '[';
+        const size_t count = std::min(depth, levels.size());
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (i != 0)
+            {
+                out += ',';
+            }
+            out += '[';
+            AppendNumber(out, levels[i].price);
+            out += ',';
+            AppendNumber(out, levels[i].amount);
+            out += ']';
+        }
+        out += ']';
+    }
+}
+
+OrderBook::OrderBook(const std::string& instrument_name) : m_instrument_name(instrument_name)
+{
+    m_bids.reserve(DEFAULT_RESERVED_LEVELS);
+    m_asks.reserve(DEFAULT_RESERVED_LEVELS);
+}
+
+void OrderBook::ApplyLevel(std::vector<PriceLevel>& levels, const BookLevelUpdate& level, const bool descending)
+{
+    const auto it = std::lower_bound(levels.begin(), levels.end(), level.price,
+                                     [descending](const PriceLevel& existing, const double price)
+                                     { return descending ? existing.price > price : existing.price < price; });
+    const bool found = it != levels.end() && it->price == level.price;
+
+    if (level.action == BookAction::REMOVE || level.amount <= 0)
+    {
+        if (found)
+        {
+            levels.erase(it);
+        }
+        return;
+    }
+
+    if (found)
+    {
+        it->amount = level.amount;
+    }
+    else
+    {
+        levels.insert(it, PriceLevel{level.price, level.amount});
+    }
+}
+
+void OrderBook::ApplySnapshot(const BookUpdate& update)
+{
+    m_bids.clear();
+    m_asks.clear();
+    for (const auto& level : update.bids)
+    {
+        ApplyLevel(m_bids, level, true);
+    }
+    for (const auto& level : update.asks)
+    {
+        ApplyLevel(m_asks, level, false);
+    }
+    m_change_id = update.change_id;
+    m_timestamp_ms = update.timestamp_ms;
+    m_is_synced = true;
+}
+
+bool OrderBook::ApplyChange(const BookUpdate& update)
+{
+    if (!m_is_synced || update.prev_change_id != m_change_id)
+    {
+        m_is_synced = false;
+        return false;
+    }
+
+    for (const auto& level : update.bids)
+    {
+        ApplyLevel(m_bids, level, true);
+    }
+    for (const auto& level : update.asks)
+    {
+        ApplyLevel(m_asks, level, false);
+    }
+    m_change_id = update.change_id;
+    m_timestamp_ms = update.timestamp_ms;
+    return true;
+}
+
+void OrderBook::Invalidate() noexcept
+{
+    m_is_synced = false;
+}
+
+bool OrderBook::IsSynced() const noexcept
+{
+    return m_is_synced;
+}
+
+int64_t OrderBook::GetChangeId() const noexcept
+{
+    return m_change_id;
+}
+
+const std::vector<PriceLevel>& OrderBook::GetBids() const noexcept
+{
+    return m_bids;
+}
+
+const std::vector<PriceLevel>& OrderBook::GetAsks() const noexcept
+{
+    return m_asks;
+}
+
+double OrderBook::GetMidPrice() const noexcept
+{
+    if (m_bids.empty() || m_asks.empty())
+    {
+        return !m_bids.empty() ? m_bids.front().price : !m_asks.empty() ? m_asks.front().price : 0.0;
+    }
+    return (m_bids.front().price + m_asks.front().price) / 2;
+}
+
+void OrderBook::SerializeTo(std::string& out, const size_t depth) const
+{
+    out.clear();
+    out += "{\"result\":";
+    AppendTo(out, depth);
+    out += '}';
+}
+
+void OrderBook::AppendTo(std::string& out, const size_t depth) const
+{
+    out.reserve(out.size() + 128 + 2 * std::min(depth, std::max(m_bids.size(), m_asks.size())) * 48);
+
+    out += "{\"instrument_name\":\"";
+    out += m_instrument_name;
+    out += "\",\"best_bid_price\":";
+    AppendNumber(out, m_bids.empty() ? 0.0 : m_bids.front().price);
+    out += ",\"best_ask_price\":";
+    AppendNumber(out, m_asks.empty() ? 0.0 : m_asks.front().price);
+    out += ",\"change_id\":";
+    AppendNumber(out, m_change_id);
+    out += ",\"timestamp\":";
+    AppendNumber(out, m_timestamp_ms);
+    out += ",\"bids\":";
+    AppendLevels(out, m_bids, depth);
+    out += ",\"asks\":";
+    AppendLevels(out, m_asks, depth);
+    out += '}';
+}
+
+OrderBookManager::OrderBookManager(DrogonWebSocket& web_socket) : m_web_socket(web_socket)
+{
+    m_scratch_update.bids.reserve(OrderBook::DEFAULT_RESERVED_LEVELS);
+    m_scratch_update.asks.reserve(OrderBook::DEFAULT_RESERVED_LEVELS);
+
+    // Deltas missed while the connection was down can never be applied, so wait for the resubscribe's snapshot
+    m_web_socket.AddConnectionListener(
+        [this](const ConnectionEvent event)
+        {
+            if (event == ConnectionEvent::DISCONNECTED)
+            {
+                InvalidateAll();
+            }
+        });
+}
+
+OrderBookManager::~OrderBookManager()
+{
+    if (m_flush_timer != 0)
+    {
+        m_web_socket.GetLoop()->invalidateTimer(m_flush_timer);
+    }
+}
+
+std::string OrderBookManager::GetChannelName(const std::string& instrument_name)
+{
+    return "book." + instrument_name + ".raw";
+}
+
+OrderBookManager::BookEntry* OrderBookManager::FindEntry(const std::string& instrument_name) const
+{
+    std::lock_guard<std::mutex> lock(m_books_mutex);
+    const auto it = m_books.find(instrument_name);
+    return it == m_books.end() ? nullptr : it->second.get();
+}
+
+// Function to start maintaining a local book for an instrument
+void OrderBookManager::Track(const std::string& instrument_name)
+{
+    Use(instrument_name, true);
+}
+
+void OrderBookManager::AddHolder(const std::string& instrument_name)
+{
+    Use(instrument_name, false);
+}
+
+void OrderBookManager::Use(const std::string& instrument_name, const bool is_tracked)
+{
+    // Books are never removed, since listeners hold on to their names; an unused one is only unsubscribed.
+    // The subscription changes under the lock so that a concurrent add and remove reach the socket in order.
+    std::lock_guard<std::mutex> lock(m_books_mutex);
+    auto it = m_books.find(instrument_name);
+    if (it == m_books.end())
+    {
+        it = m_books.emplace(instrument_name,
+                             std::make_unique<BookEntry>(instrument_name, m_update_listeners.size())).first;
+    }
+    else if (it->second->is_tracked || it->second->holders != 0)
+    {
+        it->second->is_tracked = it->second->is_tracked || is_tracked;
+        it->second->holders += is_tracked ? 0 : 1;
+        return;
+    }
+
+    BookEntry& entry = *it->second;
+    entry.is_tracked = is_tracked;
+    entry.holders = is_tracked ? 0 : 1;
+    {
+        std::lock_guard<std::mutex> entry_lock(entry.mutex);
+        entry.is_active = true;
+    }
+    m_web_socket.Subscribe({GetChannelName(instrument_name)},
+                           [this](std::string_view, const std::string_view data) { OnBookMessage(data); });
+}
+
+void OrderBookManager::RemoveHolder(const std::string& instrument_name)
+{
+    std::lock_guard<std::mutex> lock(m_books_mutex);
+    const auto it = m_books.find(instrument_name);
+    if (it == m_books.end() || it->second->holders == 0)
+    {
+        return;
+    }
+
+    BookEntry& entry = *it->second;
+    if (--entry.holders != 0 || entry.is_tracked)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> entry_lock(entry.mutex);
+        entry.is_active = false;
+        entry.book.Invalidate();
+    }
+    m_web_socket.Unsubscribe({GetChannelName(instrument_name)});
+}
+
+bool OrderBookManager::IsSynced(const std::string& instrument_name) const
+{
+    const BookEntry* entry = FindEntry(instrument_name);
+    if (!entry)
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    return entry->book.IsSynced();
+}
+
+bool OrderBookManager::GetOrderBook(const std::string& instrument_name, std::string& response,
+                                    const size_t depth) const
+{
+    const BookEntry* entry = FindEntry(instrument_name);
+    if (!entry)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    if (!entry->book.IsSynced())
+    {
+        return false;
+    }
+    entry->book.SerializeTo(response, depth);
+    return true;
+}
+
+bool OrderBookManager::AppendOrderBook(const std::string& instrument_name, std::string& out,
+                                       const size_t depth) const
+{
+    const BookEntry* entry = FindEntry(instrument_name);
+    if (!entry)
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    if (!entry->book.IsSynced())
+    {
+        return false;
+    }
+    entry->book.AppendTo(out, depth);
+    return true;
+}
+
+OrderBookManager::ListenerId OrderBookManager::AddUpdateListener(UpdateListener listener,
+                                                                 const ConflationPolicy policy)
+{
+    m_update_listeners.push_back({std::move(listener), policy, {}});
+
+    // One timer at the shortest interval serves every INTERVAL listener
+    if (policy.mode == ConflationMode::INTERVAL &&
+        (m_flush_interval.count() == 0 || policy.interval < m_flush_interval))
+    {
+        trantor::EventLoop* loop = m_web_socket.GetLoop();
+        if (m_flush_timer != 0)
+        {
+            loop->invalidateTimer(m_flush_timer);
+        }
+        m_flush_interval = policy.interval;
+        m_flush_timer = loop->runEvery(std::chrono::duration<double>(m_flush_interval).count(), [this]() { Flush(); });
+    }
+    return m_update_listeners.size() - 1;
+}
+
+size_t OrderBookManager::PollUpdates(const ListenerId listener_id)
+{
+    if (listener_id >= m_update_listeners.size())
+    {
+        return 0;
+    }
+
+    Listener& listener = m_update_listeners[listener_id];
+    const int64_t now_ns = LatencyRecorder::NowNs();
+    listener.batch.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_books_mutex);
+        for (const auto& [instrument_name, entry] : m_books)
+        {
+            std::lock_guard<std::mutex> entry_lock(entry->mutex);
+            if (entry->slots[listener_id].TakePending(now_ns, entry->book.GetMidPrice()))
+            {
+                listener.batch.push_back(&instrument_name);
+            }
+        }
+    }
+
+    // Books are never removed, so their names outlive the lock
+    for (const std::string* instrument_name : listener.batch)
+    {
+        listener.callback(*instrument_name);
+    }
+    return listener.batch.size();
+}
+
+uint64_t OrderBookManager::GetResyncCount() const noexcept
+{
+    return m_resync_count.load(std::memory_order_relaxed);
+}
+
+// Function to apply a snapshot or delta from the WebSocket feed
+void OrderBookManager::OnBookMessage(const std::string_view data)
+{
+    if (!MarketDataDecoder::DecodeBook(data, m_scratch_update))
+    {
+        BinaryLogger::Write(LOG_MALFORMED_UPDATE);
+        return;
+    }
+
+    BookEntry* entry = FindEntry(m_scratch_update.instrument_name);
+    if (!entry)
+    {
+        return;
+    }
+
+    bool gap = false;
+    // A delta for a book still waiting on its snapshot is dropped, and listeners hear nothing
+    bool is_applied = false;
+    m_notify.clear();
+    {
+        std::lock_guard<std::mutex> lock(entry->mutex);
+        if (!entry->is_active)
+        {
+            return;
+        }
+        if (m_scratch_update.is_snapshot)
+        {
+            entry->book.ApplySnapshot(m_scratch_update);
+            is_applied = true;
+        }
+        else if (entry->book.IsSynced())
+        {
+            gap = !entry->book.ApplyChange(m_scratch_update);
+            is_applied = !gap;
+        }
+
+        if (is_applied && !m_update_listeners.empty())
+        {
+            const int64_t now_ns = LatencyRecorder::NowNs();
+            const double mid_price = entry->book.GetMidPrice();
+            for (ListenerId id = 0; id < m_update_listeners.size(); ++id)
+            {
+                if (entry->slots[id].Admit(m_update_listeners[id].policy, now_ns, mid_price))
+                {
+                    m_notify.push_back(id);
+                }
+            }
+        }
+    }
+
+    if (gap)
+    {
+        Resync(m_scratch_update.instrument_name);
+        return;
+    }
+    for (const ListenerId id : m_notify)
+    {
+        m_update_listeners[id].callback(m_scratch_update.instrument_name);
+    }
+}
+
+// Function to announce the books INTERVAL listeners were held back on once their interval has passed
+void OrderBookManager::Flush()
+{
+    const int64_t now_ns = LatencyRecorder::NowNs();
+    m_flush_notify.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_books_mutex);
+        for (const auto& [instrument_name, entry] : m_books)
+        {
+            std::lock_guard<std::mutex> entry_lock(entry->mutex);
+            for (ListenerId id = 0; id < m_update_listeners.size(); ++id)
+            {
+                const ConflationPolicy& policy = m_update_listeners[id].policy;
+                if (policy.mode == ConflationMode::INTERVAL &&
+                    entry->slots[id].TakeIfDue(policy, now_ns, entry->book.GetMidPrice()))
+                {
+                    m_flush_notify.emplace_back(id, &instrument_name);
+                }
+            }
+        }
+    }
+
+    for (const auto& [id, instrument_name] : m_flush_notify)
+    {
+        m_update_listeners[id].callback(*instrument_name);
+    }
+}
+
+// Function to request a fresh snapshot after a change_id gap
+void OrderBookManager::Resync(const std::string& instrument_name)
+{
+    m_resync_count.fetch_add(1, std::memory_order_relaxed);
+    BinaryLogger::Write(LOG_SEQUENCE_GAP, instrument_name);
+
+    m_web_socket.Resubscribe({GetChannelName(instrument_name)});
+}
+
+void OrderBookManager::InvalidateAll()
+{
+    std::lock_guard<std::mutex> lock(m_books_mutex);
+    for (const auto& [instrument_name, entry] : m_books)
+    {
+        std::lock_guard<std::mutex> entry_lock(entry->mutex);
+        entry->book.Invalidate();
+    }
+}
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <trantor/net/EventLoop.h>
+
+#include "conflation.h"
+
+class DrogonWebSocket;
+
+struct PriceLevel
+{
+    double price;
+    double amount;
+};
+
+enum class BookAction
+{
+    ADD,
+    CHANGE,
+    REMOVE
+};
+
+struct BookLevelUpdate
+{
+    BookAction action;
+    double price;
+    double amount;
+};
+
+// One decoded book.{instrument}.raw notification
+struct BookUpdate
+{
+    bool is_snapshot{false};
+    int64_t change_id{0};
+    int64_t prev_change_id{0};
+    int64_t timestamp_ms{0};
+    std::string instrument_name;
+    std::vector<BookLevelUpdate> bids;
+    std::vector<BookLevelUpdate> asks;
+
+    void Clear()
+    {
+        is_snapshot = false;
+        change_id = prev_change_id = timestamp_ms = 0;
+        instrument_name.clear();
+        bids.clear();
+        asks.clear();
+    }
+};
+
+// L2 book kept as two flat price-sorted arrays (bids descending, asks ascending)
+class OrderBook
+{
+  private:
+    std::string m_instrument_name;
+    std::vector<PriceLevel> m_bids;
+    std::vector<PriceLevel> m_asks;
+    int64_t m_change_id{0};
+    int64_t m_timestamp_ms{0};
+    bool m_is_synced{false};
+
+    static void ApplyLevel(std::vector<PriceLevel>& levels, const BookLevelUpdate& level, bool descending);
+
+  public:
+    static constexpr size_t DEFAULT_RESERVED_LEVELS = 256;
+
+    explicit OrderBook(const std::string& instrument_name);
+
+    void ApplySnapshot(const BookUpdate& update);
+
+    // Returns false on a change_id gap; the book is then marked out of sync
+    bool ApplyChange(const BookUpdate& update);
+
+    void Invalidate() noexcept;
+
+    bool IsSynced() const noexcept;
+    int64_t GetChangeId() const noexcept;
+    const std::vector<PriceLevel>& GetBids() const noexcept;
+    const std::vector<PriceLevel>& GetAsks() const noexcept;
+    // Midpoint of the best bid and ask, the one side present if the other is empty, or zero for an empty book
+    double GetMidPrice() const noexcept;
+
+    // Writes the book in the same shape as public/get_order_book so existing display code can read it
+    void SerializeTo(std::string& out, size_t depth) const;
+
+    // Appends just the book object that SerializeTo wraps in "result"
+    void AppendTo(std::string& out, size_t depth) const;
+};
+
+// Maintains in-memory books from book.{instrument}.raw and resyncs them on sequence gaps.
+//
+// Each listener picks how often it hears about a book: every change, at most once per interval, when the mid
+// price has moved far enough, or only when it polls. The book itself is the state, so a listener that is held
+// back simply reads a newer book when its turn comes.
+class OrderBookManager
+{
+  public:
+    // Invoked after an applied snapshot or delta, outside the book lock: on the market-data thread, or on the
+    // polling thread for LATEST listeners
+    using UpdateListener = std::function<void(const std::string& instrument_name)>;
+    using ListenerId = size_t;
+
+  private:
+    struct Listener
+    {
+        UpdateListener callback;
+        ConflationPolicy policy;
+        // Books to announce, collected under the locks and called outside them; reused by each poll
+        std::vector<const std::string*> batch;
+    };
+
+    struct BookEntry
+    {
+        mutable std::mutex mutex;
+        OrderBook book;
+        // One per listener, guarded by mutex
+        std::vector<ConflationSlot> slots;
+        // Guarded by mutex; cleared once nobody needs the book, so frames still in flight from its old
+        // subscription are dropped
+        bool is_active{true};
+        // Guarded by m_books_mutex: a tracked book is kept for good, a held one until its last holder goes
+        bool is_tracked{false};
+        uint32_t holders{0};
+
+        BookEntry(const std::string& instrument_name, const size_t listener_count)
+            : book(instrument_name), slots(listener_count)
+        {
+        }
+    };
+
+    DrogonWebSocket& m_web_socket;
+    mutable std::mutex m_books_mutex;
+    std::unordered_map<std::string, std::unique_ptr<BookEntry>> m_books;
+    BookUpdate m_scratch_update;
+    std::atomic<uint64_t> m_resync_count{0};
+    std::vector<Listener> m_update_listeners;
+    std::chrono::milliseconds m_flush_interval{0};
+    trantor::TimerId m_flush_timer{0};
+
+    // Only touched on the market-data thread
+    std::vector<ListenerId> m_notify;
+    std::vector<std::pair<ListenerId, const std::string*>> m_flush_notify;
+
+    static std::string GetChannelName(const std::string& instrument_name);
+
+    BookEntry* FindEntry(const std::string& instrument_name) const;
+    // Creates the entry if needed and subscribes its channel when it goes from unused to used
+    void Use(const std::string& instrument_name, bool is_tracked);
+    void OnBookMessage(std::string_view data);
+    void Resync(const std::string& instrument_name);
+    void InvalidateAll();
+    void Flush();
+
+  public:
+    static constexpr size_t DEFAULT_DEPTH = 20;
+
+    explicit OrderBookManager(DrogonWebSocket& web_socket);
+    ~OrderBookManager();
+
+    OrderBookManager(const OrderBookManager&) = delete;
+    OrderBookManager& operator=(const OrderBookManager&) = delete;
+
+    void Track(const std::string& instrument_name);
+    // Like Track, but counted: the book stops following the exchange when its last holder is removed, and a
+    // later AddHolder starts it again from a fresh snapshot
+    void AddHolder(const std::string& instrument_name);
+    void RemoveHolder(const std::string& instrument_name);
+    bool IsSynced(const std::string& instrument_name) const;
+    bool GetOrderBook(const std::string& instrument_name, std::string& response,
+                      size_t depth = DEFAULT_DEPTH) const;
+    bool AppendOrderBook(const std::string& instrument_name, std::string& out, size_t depth = DEFAULT_DEPTH) const;
+    uint64_t GetResyncCount() const noexcept;
+
+    // Listeners must be added before the first Track call. PRICE_CHANGE looks at the mid price; an INTERVAL
+    // listener starts a timer on the connection's loop that hands over the updates it held back.
+    ListenerId AddUpdateListener(UpdateListener listener, ConflationPolicy policy = ConflationPolicy::EveryUpdate());
+
+    // LATEST: calls the listener once for each book changed since its last poll; returns the number of calls
+    size_t PollUpdates(ListenerId listener);
+};
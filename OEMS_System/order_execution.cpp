@@ -1,70 +1,195 @@
 #include "order_execution.h"
-#include <cstdio>
-#include <iostream>
+#include <algorithm>
+#include <deque>
+#include <mutex>
 #include <thread>
 #include <future>
 #include <chrono>
 #include <drogon/drogon.h>
+#include "binary_logger.h"
 #include "utilities.h"
 
-class RateLimiter {
-private:
-    std::chrono::steady_clock::time_point lastRequest;
-    const std::chrono::milliseconds minInterval{100}; // 100ms between requests
-
-public:
-    void WaitIfNeeded() {
-        auto now = std::chrono::steady_clock::now();
-        auto elapsed = now - lastRequest;
-        if (elapsed < minInterval) {
-            std::this_thread::sleep_for(minInterval - elapsed);
-        }
-        lastRequest = std::chrono::steady_clock::now();
-    }
+namespace
+{
+    const LogFormat LOG_LATENCY_REPORT{LogLevel::INFO, "[Latency] Report\n{}"};
+    const LogFormat LOG_TOKEN_EXPIRED{LogLevel::WARN, "Access token expired. Refresh requested, request rejected."};
+    const LogFormat LOG_INVALID_AMOUNT{LogLevel::WARN, "Invalid amount: {}"};
+    const LogFormat LOG_INVALID_PRICE{LogLevel::WARN, "Invalid price for limit order: {}"};
+    const LogFormat LOG_INVALID_LOTS{LogLevel::WARN, "Invalid amount: {} lots"};
+    const LogFormat LOG_INVALID_TICKS{LogLevel::WARN, "Invalid price for limit order: {} ticks"};
+    const LogFormat LOG_RISK_REJECTED{LogLevel::WARN, "[Risk] Rejected {}: {}"};
+    const LogFormat LOG_UNKNOWN_INSTRUMENT{LogLevel::WARN, "Unknown instrument: {}"};
+    const LogFormat LOG_UNKNOWN_INSTRUMENT_ID{LogLevel::WARN, "Unknown instrument id: {}"};
+    const LogFormat LOG_UNKNOWN_ORDER{LogLevel::WARN, "[Risk] Rejected edit of {}: order not in the order store"};
+    const LogFormat LOG_INVALID_LOT_SIZE{LogLevel::WARN, "Invalid amount for {}: {} (must be a multiple of {})"};
+    const LogFormat LOG_RATE_LIMITED{LogLevel::WARN, "Request rejected by rate limiter"};
+    const LogFormat LOG_UNSUPPORTED_TYPE{LogLevel::ERR, "Unsupported order type."};
+    const LogFormat LOG_ENCODER_OVERFLOW{LogLevel::ERR, "Buffer overflow in request formatting"};
+    const LogFormat LOG_INVALID_INSTRUMENT_NAME{LogLevel::WARN, "Invalid instrument name"};
+    const LogFormat LOG_PLACE_FAILED{LogLevel::ERR, "Error: {}"};
+    const LogFormat LOG_CANCEL_FAILED{LogLevel::ERR, "Error canceling order: {}"};
+    const LogFormat LOG_CANCEL_INSTRUMENT_FAILED{LogLevel::ERR, "Error canceling orders for {}: {}"};
+    const LogFormat LOG_CANCEL_LABEL_FAILED{LogLevel::ERR, "Error canceling orders labelled {}: {}"};
+    const LogFormat LOG_BATCH_PLACE_FAILED{LogLevel::ERR, "Error placing order {}: {}"};
+    const LogFormat LOG_BATCH_CANCEL_FAILED{LogLevel::ERR, "Error canceling order {}: {}"};
+    const LogFormat LOG_MODIFY_FAILED{LogLevel::ERR, "Error modifying order: {}"};
+    const LogFormat LOG_ORDER_BOOK_FAILED{LogLevel::ERR, "Error getting order book: {}"};
+    const LogFormat LOG_POSITIONS_FAILED{LogLevel::ERR, "Error getting positions: {}"};
+    const LogFormat LOG_OPEN_ORDERS_FAILED{LogLevel::ERR, "Error getting open orders: {}"};
+    const LogFormat LOG_POSITION_RECONCILE_FAILED{LogLevel::ERR, "[PositionEngine] Reconciliation failed for {}: {}"};
+    const LogFormat LOG_ORDER_RECONCILE_FAILED{LogLevel::ERR, "[OrderStore] Reconciliation failed: {}"};
+    const LogFormat LOG_INSTRUMENT_REFRESH_FAILED{LogLevel::ERR, "[Instruments] Refresh failed: {}"};
+    const LogFormat LOG_INSTRUMENT_REFRESH_UNSENT{LogLevel::ERR, "[Instruments] Refresh could not be sent"};
+
+    // Set by Dispatch when a request is turned away only because the window or the rate-limit credit is
+    // used up, so a batch can queue the element instead of failing it
+    thread_local bool t_dispatch_deferred = false;
+}
+
+struct OrderExecution::Batch
+{
+    BatchStart start;
+    BatchCallback callback;
+
+    std::mutex mutex;
+    std::vector<OrderResult> results;
+    std::vector<uint8_t> is_done;
+    std::deque<size_t> queued;  // Elements waiting for credit, in batch order
+    size_t remaining{0};
+    size_t in_flight{0};
+    size_t rejected{0};
+    bool is_retry_scheduled{false};
 };
 
-OrderExecution::OrderExecution(TokenManager& token_manager)
-    : m_client(drogon::HttpClient::newHttpClient(BASE_URL)),
+OrderExecution::OrderExecution(TokenManager& token_manager, OrderBookManager* order_book_manager,
+                               OrderGateway* order_gateway, OrderStore* order_store,
+                               PositionEngine* position_engine, RiskEngine* risk_engine,
+                               InstrumentRegistry* instrument_registry)
+    : m_connection_pool(std::make_unique<ConnectionPool>(BASE_URL)),
       m_token_manager(token_manager),
       m_api_credentials("client_key.txt", "client_secret.txt"),
-      m_rate_limiter(std::make_unique<RateLimiter>())
+      m_rate_limiter(std::make_unique<RateLimiter>()),
+      m_latency_recorder(std::make_unique<LatencyRecorder>()),
+      m_order_book_manager(order_book_manager),
+      m_order_gateway(order_gateway),
+      m_order_store(order_store),
+      m_position_engine(position_engine),
+      m_risk_engine(risk_engine),
+      m_instrument_registry(instrument_registry)
+{
+    // Opens and TLS-handshakes the connections now rather than on the first order
+    m_connection_pool->Start();
+
+    // Keeps the token fresh in the background so the order path never waits on an auth round trip
+    m_token_manager.StartAutoRefresh(m_api_credentials.GetApiKey(), m_api_credentials.GetApiSecret());
+}
+
+OrderExecution::~OrderExecution()
+{
+    if (m_latency_dump_timer != 0)
+    {
+        m_connection_pool->GetLoop()->invalidateTimer(m_latency_dump_timer);
+    }
+    if (m_order_sync_timer != 0)
+    {
+        m_connection_pool->GetLoop()->invalidateTimer(m_order_sync_timer);
+    }
+    if (m_position_sync_timer != 0)
+    {
+        m_connection_pool->GetLoop()->invalidateTimer(m_position_sync_timer);
+    }
+    if (m_instrument_sync_timer != 0)
+    {
+        m_connection_pool->GetLoop()->invalidateTimer(m_instrument_sync_timer);
+    }
+}
+
+bool OrderExecution::IsGatewayReady() const noexcept
+{
+    return m_order_gateway && m_order_gateway->IsReady();
+}
+
+// Replies to these carry the order they act on, which keeps the order store ahead of the stream
+bool OrderExecution::IsOrderEntry(const EndpointId endpoint) noexcept
+{
+    return endpoint == EndpointId::BUY || endpoint == EndpointId::SELL || endpoint == EndpointId::EDIT ||
+           endpoint == EndpointId::CANCEL;
+}
+
+void OrderExecution::SetMaxInFlight(const size_t max_in_flight) noexcept
+{
+    m_max_in_flight.store(max_in_flight, std::memory_order_relaxed);
+}
+
+size_t OrderExecution::GetInFlightCount() const noexcept
+{
+    return m_in_flight.load(std::memory_order_relaxed);
+}
+
+const RateLimiter& OrderExecution::GetRateLimiter() const noexcept
+{
+    return *m_rate_limiter;
+}
+
+const LatencyRecorder& OrderExecution::GetLatencyRecorder() const noexcept
+{
+    return *m_latency_recorder;
+}
+
+const ConnectionPool& OrderExecution::GetConnectionPool() const noexcept
 {
+    return *m_connection_pool;
 }
 
+void OrderExecution::StartLatencyDump(const std::chrono::seconds interval)
+{
+    if (m_latency_dump_timer != 0)
+    {
+        m_connection_pool->GetLoop()->invalidateTimer(m_latency_dump_timer);
+    }
+
+    m_latency_dump_timer = m_connection_pool->GetLoop()->runEvery(
+        static_cast<double>(interval.count()),
+        [this, last_count = uint64_t{0}]() mutable
+        {
+            const uint64_t count = m_latency_recorder->GetSampleCount();
+            if (count == last_count)
+            {
+                return;
+            }
+            last_count = count;
+
+            std::string report;
+            m_latency_recorder->FormatReport(report);
+            if (!report.empty() && report.back() == '\n')
+            {
+                report.pop_back();
+            }
+            BinaryLogger::Write(LOG_LATENCY_REPORT, report);
+        });
+}
+
+// Function to make sure the token is usable; the background refresh normally keeps this to a single load.
+// Callers run on the client loop, so an expired token fails the request instead of waiting for a refresh there
 bool OrderExecution::RefreshTokenIfNeeded() const
 {
     if (m_token_manager.IsAccessTokenExpired())
     {
-        std::cerr << "Access token expired. Refreshing...\n";
-        if (!m_token_manager.RefreshAccessToken(m_api_credentials.GetApiKey(),
-                                                m_api_credentials.GetApiSecret()))
-        {
-            std::cerr << "Failed to refresh token. Cannot place order.\n";
-            return false;
-        }
+        BinaryLogger::Write(LOG_TOKEN_EXPIRED);
+        m_token_manager.RequestRefresh();
+        return false;
     }
     return true;
 }
 
 std::string OrderExecution::GetOrderTypeString(const OrderType& type)
 {
-    switch (type)
-    {
-        case OrderType::LIMIT: return "limit";
-        case OrderType::MARKET: return "market";
-        case OrderType::STOP_LIMIT: return "stop_limit";
-        case OrderType::STOP_MARKET: return "stop_market";
-        default: return "limit";
-    }
+    return std::string(GetOrderTypeName(type));
 }
 
-struct ApiResponse {
-    bool success;
-    std::string message;
-    std::string data;
-};
-
-ApiResponse HandleResponse(const drogon::ReqResult& result, const drogon::HttpResponsePtr& response) {
+ApiResponse OrderExecution::ProcessHttpResponse(const drogon::ReqResult& result,
+                                                const drogon::HttpResponsePtr& response) const
+{
     if (result != drogon::ReqResult::Ok) {
         return {false, "Network error", ""};
     }
@@ -77,302 +202,1181 @@ ApiResponse HandleResponse(const drogon::ReqResult& result, const drogon::HttpRe
     return {true, "Success", std::string(response->body())};
 }
 
-bool OrderExecution::ValidateOrderParams(const OrderParams& params) const {
+bool OrderExecution::ValidateOrderParams(const OrderParams& params, const bool is_buy) const {
     if (params.amount <= 0) {
-        std::cerr << "Invalid amount: " << params.amount << std::endl;
+        BinaryLogger::Write(LOG_INVALID_AMOUNT, params.amount);
         return false;
     }
     if (params.type == OrderType::LIMIT && params.price <= 0) {
-        std::cerr << "Invalid price for limit order: " << params.price << std::endl;
+        BinaryLogger::Write(LOG_INVALID_PRICE, params.price);
+        return false;
+    }
+    if (!m_risk_engine) {
+        return true;
+    }
+
+    const bool is_market = params.type == OrderType::MARKET || params.type == OrderType::STOP_MARKET;
+    const RiskCheck check =
+        m_risk_engine->CheckOrder(params.instrument_name, is_buy, is_market, params.amount, params.price);
+    if (check != RiskCheck::PASSED) {
+        BinaryLogger::Write(LOG_RISK_REJECTED, params.instrument_name, RiskEngine::GetRiskCheckName(check));
         return false;
     }
     return true;
 }
 
-template<typename Callback>
-void OrderExecution::SendAsyncRequest(const drogon::HttpRequestPtr& req, Callback&& callback) const {
-    m_rate_limiter->WaitIfNeeded();
-    m_client->sendRequest(req, std::forward<Callback>(callback));
+bool OrderExecution::ValidateOrderParams(const CompactOrder& order, const InstrumentInfo& instrument) const
+{
+    if (order.amount_lots <= 0) {
+        BinaryLogger::Write(LOG_INVALID_LOTS, order.amount_lots);
+        return false;
+    }
+    if (order.HasPrice() && order.price_ticks <= 0) {
+        BinaryLogger::Write(LOG_INVALID_TICKS, order.price_ticks);
+        return false;
+    }
+    if (!m_risk_engine) {
+        return true;
+    }
+
+    // Risk limits are decimal, so the order is converted back only for the comparison
+    const bool is_market = order.type == OrderType::MARKET || order.type == OrderType::STOP_MARKET;
+    const RiskCheck check = m_risk_engine->CheckOrder(instrument.GetName(), order.is_buy, is_market,
+                                                      instrument.amount_scale.ToDouble(order.amount_lots),
+                                                      instrument.price_scale.ToDouble(order.price_ticks));
+    if (check != RiskCheck::PASSED) {
+        BinaryLogger::Write(LOG_RISK_REJECTED, instrument.GetName(), RiskEngine::GetRiskCheckName(check));
+        return false;
+    }
+    return true;
 }
 
-template<typename Func>
-bool OrderExecution::RetryRequest(Func&& func, int maxRetries = 3) const {
-    for (int i = 0; i < maxRetries; i++) {
-        if (func()) return true;
-        std::this_thread::sleep_for(std::chrono::milliseconds(100 * (i + 1)));
+bool OrderExecution::ApplyInstrumentRules(const std::string& instrument_name, const bool is_buy, const double amount,
+                                          double& price) const
+{
+    if (!m_instrument_registry || m_instrument_registry->GetCount() == 0)
+    {
+        return true;
     }
-    return false;
+
+    const InstrumentInfo* instrument = m_instrument_registry->Find(instrument_name);
+    if (!instrument)
+    {
+        BinaryLogger::Write(LOG_UNKNOWN_INSTRUMENT, instrument_name);
+        return false;
+    }
+    if (!instrument->IsValidAmount(amount))
+    {
+        BinaryLogger::Write(LOG_INVALID_LOT_SIZE, instrument_name, amount, instrument->min_trade_amount);
+        return false;
+    }
+    if (price > 0)
+    {
+        price = instrument->RoundPrice(price, is_buy);
+    }
+    return true;
 }
 
-bool OrderExecution::PlaceOrder(const OrderParams& params, const std::string& side, std::string& response) const
+template<typename Callback>
+void OrderExecution::SendAsyncRequest(const drogon::HttpRequestPtr& req, Callback&& callback) const {
+    m_connection_pool->SendRequest(req, std::forward<Callback>(callback), REQUEST_TIMEOUT_SECONDS);
+}
+
+bool OrderExecution::Dispatch(const LatencyTrace& trace, const RateLimitPool pool,
+                              std::function<bool(CompletionCallback)> submit, CompletionCallback callback) const
 {
-    if (!ValidateOrderParams(params) || !RefreshTokenIfNeeded()) {
+    size_t in_flight = m_in_flight.load(std::memory_order_relaxed);
+    do
+    {
+        if (in_flight >= m_max_in_flight.load(std::memory_order_relaxed))
+        {
+            t_dispatch_deferred = true;
+            return false;
+        }
+    } while (!m_in_flight.compare_exchange_weak(in_flight, in_flight + 1, std::memory_order_acq_rel,
+                                                std::memory_order_relaxed));
+
+    const AdmissionResult admission = m_rate_limiter->Acquire(pool);
+    if (admission.admission == Admission::REJECTED)
+    {
+        m_in_flight.fetch_sub(1, std::memory_order_acq_rel);
+        BinaryLogger::Write(LOG_RATE_LIMITED);
+        t_dispatch_deferred = true;
         return false;
     }
 
-    const std::string access_token = m_token_manager.GetAccessToken();
-    const auto req = drogon::HttpRequest::newHttpRequest();
+    const auto in_flight_trace = std::make_shared<InFlightTrace>(*m_latency_recorder, trace);
 
-    req->setPath(side == "buy" ? "/api/v2/private/buy" : "/api/v2/private/sell");
-    req->setMethod(drogon::Get);
+    CompletionCallback completion =
+        [this, pool, endpoint = trace.endpoint, in_flight_trace,
+         callback = std::move(callback)](const bool success, const std::string& response)
+        {
+            const int64_t parsed_ns = LatencyRecorder::NowNs();
+            const int64_t received_ns = LatencyRecorder::TakeResponseReceived();
+            in_flight_trace->Mark(LatencyStage::EXCHANGE, received_ns != 0 ? received_ns : parsed_ns);
+            in_flight_trace->Mark(LatencyStage::PARSE, parsed_ns);
+            if (!success)
+            {
+                in_flight_trace->Discard();
+            }
+            in_flight_trace->Finish();
 
-    char buffer[BUFFER_SIZE];
-    int written;
+            if (success && m_order_store && IsOrderEntry(endpoint))
+            {
+                m_order_store->ApplyResponse(response);
+            }
+            if (!success && response.find("10028") != std::string::npos)
+            {
+                m_rate_limiter->OnExchangeThrottled(pool);
+            }
+            m_in_flight.fetch_sub(1, std::memory_order_acq_rel);
+            callback(success, response);
+        };
 
-    if (params.type == OrderType::LIMIT)
+    if (admission.admission == Admission::QUEUED)
     {
-        written = snprintf(buffer, BUFFER_SIZE, "%s?amount=%.6f&instrument_name=%s&label=%s&price=%.2f&type=%s",
-                           req->getPath().c_str(), params.amount, params.instrument_name.c_str(),
-                           params.label.c_str(), params.price, GetOrderTypeString(params.type).c_str());
+        // Send once the bucket has refilled, without holding the caller
+        const double delay_seconds = std::chrono::duration<double>(admission.delay).count();
+        m_connection_pool->GetLoop()->runAfter(delay_seconds,
+            [submit = std::move(submit), completion = std::move(completion), in_flight_trace]() mutable
+            {
+                in_flight_trace->Mark(LatencyStage::ADMISSION);
+                CompletionCallback on_done = completion;
+                const bool sent = submit(std::move(completion));
+                in_flight_trace->Mark(LatencyStage::SEND);
+                in_flight_trace->Finish();
+                if (!sent)
+                {
+                    on_done(false, "Request could not be sent");
+                }
+            });
+        return true;
     }
-    else if (params.type == OrderType::MARKET)
+
+    in_flight_trace->Mark(LatencyStage::ADMISSION);
+    const bool sent = submit(completion);
+    in_flight_trace->Mark(LatencyStage::SEND);
+    if (!sent)
     {
-        written = snprintf(buffer, BUFFER_SIZE, "%s?amount=%.6f&instrument_name=%s&label=%s&type=%s",
-                           req->getPath().c_str(), params.amount, params.instrument_name.c_str(),
-                           params.label.c_str(), GetOrderTypeString(params.type).c_str());
+        in_flight_trace->Discard();
     }
-    else
+    in_flight_trace->Finish();
+
+    if (!sent)
     {
-        std::cerr << "Unsupported order type.\n";
+        m_in_flight.fetch_sub(1, std::memory_order_acq_rel);
         return false;
     }
+    return true;
+}
 
-    if (written < 0 || written >= BUFFER_SIZE)
+bool OrderExecution::SendHttpRequest(const drogon::HttpRequestPtr& req, CompletionCallback callback) const
+{
+    SendAsyncRequest(req,
+        [this, callback = std::move(callback)](const drogon::ReqResult& result, const drogon::HttpResponsePtr& http_response) {
+            LatencyRecorder::MarkResponseReceived();
+            const auto apiResponse = ProcessHttpResponse(result, http_response);
+            if (apiResponse.success) {
+                callback(true, apiResponse.data);
+            } else {
+                callback(false, apiResponse.data.empty() ? apiResponse.message : apiResponse.message + " " + apiResponse.data);
+            }
+        });
+    return true;
+}
+
+drogon::HttpRequestPtr OrderExecution::NewHttpRequest(const EndpointDescriptor& endpoint,
+                                                     const RequestEncoder& encoder) const
+{
+    const auto req = drogon::HttpRequest::newHttpRequest();
+    req->setMethod(drogon::Get);
+    req->setPath(std::string(encoder.View()));
+    if (endpoint.is_private)
     {
-        std::cerr << "Buffer overflow in request formatting\n";
+        req->addHeader("Authorization", m_token_manager.GetAuthorizationHeader());
+    }
+    req->setContentTypeCode(drogon::CT_APPLICATION_JSON);
+    return req;
+}
+
+// Function to run an asynchronous call to completion for the blocking API
+bool OrderExecution::WaitForCompletion(const EndpointId endpoint, const std::function<bool(CompletionCallback)>& start,
+                                       std::string& response) const
+{
+    struct Completion
+    {
+        std::promise<bool> promise;
+        std::string body;
+        int64_t completed_ns{0};
+    };
+
+    // The callback may outlive this frame if the wait times out, so it only holds shared state
+    auto completion = std::make_shared<Completion>();
+    auto future = completion->promise.get_future();
+
+    const bool started = start(
+        [completion](const bool success, const std::string& reply)
+        {
+            completion->body = reply;
+            completion->completed_ns = LatencyRecorder::NowNs();
+            completion->promise.set_value(success);
+        });
+
+    if (!started)
+    {
+        response = "Request rejected";
         return false;
     }
 
-    req->setPath(std::string(buffer, written));
-    req->addHeader("Authorization", "Bearer " + access_token);
-    req->addHeader("Content-Type", "application/x-www-form-urlencoded");
+    if (future.wait_for(SYNC_WAIT_TIMEOUT) != std::future_status::ready)
+    {
+        response = "Request timed out";
+        return false;
+    }
 
-    std::promise<bool> requestComplete;
-    auto future = requestComplete.get_future();
+    const bool success = future.get();
+    m_latency_recorder->Record(endpoint, LatencyStage::WAKEUP, LatencyRecorder::NowNs() - completion->completed_ns);
+    response = std::move(completion->body);
+    return success;
+}
 
-    SendAsyncRequest(req, 
-        [&response, &requestComplete](const drogon::ReqResult& result, const drogon::HttpResponsePtr& http_response) {
-            auto apiResponse = HandleResponse(result, http_response);
-            if (apiResponse.success) {
-                response = apiResponse.data;
-                std::cout << "Placed Order:\n";
-                Utilities::DisplayJsonResponse(response);
-                requestComplete.set_value(true);
-            } else {
-                std::cerr << "Error: " << apiResponse.message << std::endl;
-                response = apiResponse.message;
-                requestComplete.set_value(false);
-            }
+bool OrderExecution::PlaceOrderAsync(const OrderParams& params, const std::string& side,
+                                     CompletionCallback callback) const
+{
+    const bool is_buy = side == "buy";
+
+    // Once the instruments are known every order goes through the compact path
+    if (m_instrument_registry && m_instrument_registry->GetCount() != 0) {
+        CompactOrder order;
+        if (!CompactOrder::Make(*m_instrument_registry, params.instrument_name, is_buy, params.type, params.amount,
+                                params.price, params.label, params.time_in_force, order)) {
+            return false;
+        }
+        return PlaceOrderAsync(order, std::move(callback));
+    }
+
+    const EndpointDescriptor& endpoint = is_buy ? Endpoints::BUY : Endpoints::SELL;
+    LatencyTrace trace(endpoint.id);
+
+    if (!ValidateOrderParams(params, is_buy)) {
+        return false;
+    }
+    trace.Mark(LatencyStage::VALIDATION);
+
+    if (!m_risk_engine) {
+        return SendOrderAsync(trace, endpoint, params, is_buy, std::move(callback));
+    }
+
+    // The order counts as pending in the risk engine from the check until the exchange has answered
+    const bool sent = SendOrderAsync(trace, endpoint, params, is_buy,
+        [this, instrument_name = params.instrument_name, callback = std::move(callback)](
+            const bool success, const std::string& response)
+        {
+            m_risk_engine->ReleaseOrder(instrument_name);
+            callback(success, response);
         });
+    if (!sent) {
+        m_risk_engine->ReleaseOrder(params.instrument_name);
+    }
+    return sent;
+}
+
+bool OrderExecution::PlaceOrderAsync(const CompactOrder& order, CompletionCallback callback) const
+{
+    const EndpointDescriptor& endpoint = order.is_buy ? Endpoints::BUY : Endpoints::SELL;
+    LatencyTrace trace(endpoint.id);
 
-    return RetryRequest([&future]() { 
-        return future.wait_for(std::chrono::seconds(5)) == std::future_status::ready && future.get(); 
-    });
+    const InstrumentInfo* instrument =
+        m_instrument_registry ? m_instrument_registry->Get(order.instrument_id) : nullptr;
+    if (!instrument) {
+        BinaryLogger::Write(LOG_UNKNOWN_INSTRUMENT_ID, order.instrument_id);
+        return false;
+    }
+    if (!ValidateOrderParams(order, *instrument)) {
+        return false;
+    }
+    trace.Mark(LatencyStage::VALIDATION);
+
+    if (!m_risk_engine) {
+        return SendOrderAsync(trace, endpoint, order, *instrument, std::move(callback));
+    }
+
+    // The name is kept rather than looked up again, since the registry may be reloaded before the reply
+    const bool sent = SendOrderAsync(trace, endpoint, order, *instrument,
+        [this, instrument_name = std::string(instrument->GetName()), callback = std::move(callback)](
+            const bool success, const std::string& response)
+        {
+            m_risk_engine->ReleaseOrder(instrument_name);
+            callback(success, response);
+        });
+    if (!sent) {
+        m_risk_engine->ReleaseOrder(instrument->GetName());
+    }
+    return sent;
 }
 
-// Similar changes should be applied to CancelOrder, ModifyOrder, GetOrderBook, GetCurrentPositions, and GetOpenOrders methods.
+bool OrderExecution::SendOrderAsync(LatencyTrace& trace, const EndpointDescriptor& endpoint,
+                                    const OrderParams& params, const bool is_buy, CompletionCallback callback) const
+{
+    if (!RefreshTokenIfNeeded()) {
+        return false;
+    }
+    trace.Mark(LatencyStage::TOKEN_CHECK);
+
+    if (IsGatewayReady())
+    {
+        return Dispatch(trace, endpoint.pool,
+            [this, params, is_buy](CompletionCallback completion)
+            {
+                return is_buy ? m_order_gateway->Buy(params, std::move(completion))
+                              : m_order_gateway->Sell(params, std::move(completion));
+            },
+            std::move(callback));
+    }
 
-bool OrderExecution::CancelOrder(const std::string& order_id, std::string& response) const
+    if (params.type != OrderType::LIMIT && params.type != OrderType::MARKET)
+    {
+        BinaryLogger::Write(LOG_UNSUPPORTED_TYPE);
+        return false;
+    }
+
+    RequestEncoder& encoder = RequestEncoder::ThreadLocal();
+    encoder.BeginQuery(endpoint);
+    encoder.AddQueryParam("amount", params.amount);
+    encoder.AddQueryParam("instrument_name", params.instrument_name);
+    encoder.AddQueryParam("label", params.label);
+    if (params.type == OrderType::LIMIT)
+    {
+        encoder.AddQueryParam("price", params.price);
+    }
+    encoder.AddQueryParam("type", GetOrderTypeName(params.type));
+
+    if (!encoder.Ok())
+    {
+        BinaryLogger::Write(LOG_ENCODER_OVERFLOW);
+        return false;
+    }
+
+    const auto req = NewHttpRequest(endpoint, encoder);
+    return Dispatch(trace, endpoint.pool,
+                    [this, req](CompletionCallback completion) { return SendHttpRequest(req, std::move(completion)); },
+                    std::move(callback));
+}
+
+bool OrderExecution::SendOrderAsync(LatencyTrace& trace, const EndpointDescriptor& endpoint,
+                                    const CompactOrder& order, const InstrumentInfo& instrument,
+                                    CompletionCallback callback) const
 {
+    if (!RefreshTokenIfNeeded()) {
+        return false;
+    }
+    trace.Mark(LatencyStage::TOKEN_CHECK);
+
+    if (IsGatewayReady())
+    {
+        // Looked up again when sent, in case the rate limiter queued the order across a registry refresh
+        return Dispatch(trace, endpoint.pool,
+            [this, order](CompletionCallback completion)
+            {
+                const InstrumentInfo* instrument = m_instrument_registry->Get(order.instrument_id);
+                return instrument && m_order_gateway->Place(order, *instrument, std::move(completion));
+            },
+            std::move(callback));
+    }
+
+    if (order.type != OrderType::LIMIT && order.type != OrderType::MARKET)
+    {
+        BinaryLogger::Write(LOG_UNSUPPORTED_TYPE);
+        return false;
+    }
+
+    RequestEncoder& encoder = RequestEncoder::ThreadLocal();
+    encoder.BeginQuery(endpoint);
+    encoder.AddQueryParam("amount", order.amount_lots, instrument.amount_scale);
+    encoder.AddQueryParam("instrument_name", instrument.GetName());
+    encoder.AddQueryParam("label", order.GetLabel());
+    if (order.HasPrice())
+    {
+        encoder.AddQueryParam("price", order.price_ticks, instrument.price_scale);
+    }
+    if (order.time_in_force != TimeInForce::GOOD_TIL_CANCELLED)
+    {
+        encoder.AddQueryParam("time_in_force", GetTimeInForceName(order.time_in_force));
+    }
+    encoder.AddQueryParam("type", GetOrderTypeName(order.type));
+
+    if (!encoder.Ok())
+    {
+        BinaryLogger::Write(LOG_ENCODER_OVERFLOW);
+        return false;
+    }
+
+    const auto req = NewHttpRequest(endpoint, encoder);
+    return Dispatch(trace, endpoint.pool,
+                    [this, req](CompletionCallback completion) { return SendHttpRequest(req, std::move(completion)); },
+                    std::move(callback));
+}
+
+bool OrderExecution::PlaceOrder(const OrderParams& params, const std::string& side, std::string& response) const
+{
+    const bool placed = WaitForCompletion(side == "buy" ? EndpointId::BUY : EndpointId::SELL,
+        [this, &params, &side](CompletionCallback callback) { return PlaceOrderAsync(params, side, std::move(callback)); },
+        response);
+
+    if (placed) {
+        BinaryLogger::Write(Utilities::ORDER_RESPONSE, "Placed Order:", response);
+    } else {
+        BinaryLogger::Write(LOG_PLACE_FAILED, response);
+    }
+    return placed;
+}
+
+bool OrderExecution::CancelAsync(const EndpointDescriptor& endpoint, const std::string_view key,
+                                 const std::string& value,
+                                 bool (OrderGateway::*gateway_send)(const std::string&, CompletionCallback),
+                                 CompletionCallback callback) const
+{
+    LatencyTrace trace(endpoint.id);
+    if (value.empty())
+    {
+        return false;
+    }
+    trace.Mark(LatencyStage::VALIDATION);
+
     if (!RefreshTokenIfNeeded())
     {
         return false;
     }
+    trace.Mark(LatencyStage::TOKEN_CHECK);
 
-    const auto req = drogon::HttpRequest::newHttpRequest();
-    req->setMethod(drogon::Get);
+    if (IsGatewayReady())
+    {
+        return Dispatch(trace, endpoint.pool,
+            [this, gateway_send, value](CompletionCallback completion)
+            { return (m_order_gateway->*gateway_send)(value, std::move(completion)); },
+            std::move(callback));
+    }
 
-    char buffer[BUFFER_SIZE];
-    const int written = snprintf(buffer, BUFFER_SIZE, "/api/v2/private/cancel?order_id=%s", order_id.c_str());
+    RequestEncoder& encoder = RequestEncoder::ThreadLocal();
+    encoder.BeginQuery(endpoint);
+    encoder.AddQueryParam(key, value);
 
-    if (written < 0 || written >= BUFFER_SIZE)
+    if (!encoder.Ok())
     {
-        std::cerr << "Buffer overflow or error in sprintf.\n";
+        BinaryLogger::Write(LOG_ENCODER_OVERFLOW);
         return false;
     }
 
-    req->setPath(std::string(buffer, written));
-    req->addHeader("Authorization", "Bearer " + m_token_manager.GetAccessToken());
-    req->addHeader("Content-Type", "application/json");
+    const auto req = NewHttpRequest(endpoint, encoder);
+    return Dispatch(trace, endpoint.pool,
+                    [this, req](CompletionCallback completion) { return SendHttpRequest(req, std::move(completion)); },
+                    std::move(callback));
+}
 
-    std::promise<bool> requestComplete;
-    auto future = requestComplete.get_future();
+bool OrderExecution::CancelOrderAsync(const std::string& order_id, CompletionCallback callback) const
+{
+    return CancelAsync(Endpoints::CANCEL, "order_id", order_id, &OrderGateway::Cancel, std::move(callback));
+}
 
-    SendAsyncRequest(req, 
-        [&response, &requestComplete](const drogon::ReqResult& result, const drogon::HttpResponsePtr& http_response) {
-            auto apiResponse = HandleResponse(result, http_response);
-            if (apiResponse.success) {
-                response = apiResponse.data;
-                Utilities::DisplayJsonResponse(response);
-                requestComplete.set_value(true);
-            } else {
-                std::cerr << "Error canceling order: " << apiResponse.message << std::endl;
-                response = apiResponse.message;
-                requestComplete.set_value(false);
+bool OrderExecution::CancelAllByInstrumentAsync(const std::string& instrument_name, CompletionCallback callback) const
+{
+    return CancelAsync(Endpoints::CANCEL_ALL_BY_INSTRUMENT, "instrument_name", instrument_name,
+                       &OrderGateway::CancelAllByInstrument, std::move(callback));
+}
+
+bool OrderExecution::CancelByLabelAsync(const std::string& label, CompletionCallback callback) const
+{
+    return CancelAsync(Endpoints::CANCEL_BY_LABEL, "label", label, &OrderGateway::CancelByLabel, std::move(callback));
+}
+
+bool OrderExecution::CancelOrder(const std::string& order_id, std::string& response) const
+{
+    const bool cancelled = WaitForCompletion(EndpointId::CANCEL,
+        [this, &order_id](CompletionCallback callback) { return CancelOrderAsync(order_id, std::move(callback)); },
+        response);
+
+    if (cancelled) {
+        BinaryLogger::Write(Utilities::ORDER_RESPONSE, "", response);
+    } else {
+        BinaryLogger::Write(LOG_CANCEL_FAILED, response);
+    }
+    return cancelled;
+}
+
+bool OrderExecution::CancelAllByInstrument(const std::string& instrument_name, std::string& response) const
+{
+    const bool cancelled = WaitForCompletion(EndpointId::CANCEL_ALL_BY_INSTRUMENT,
+        [this, &instrument_name](CompletionCallback callback)
+        { return CancelAllByInstrumentAsync(instrument_name, std::move(callback)); },
+        response);
+
+    if (cancelled) {
+        BinaryLogger::Write(Utilities::ORDER_RESPONSE, "", response);
+    } else {
+        BinaryLogger::Write(LOG_CANCEL_INSTRUMENT_FAILED, instrument_name, response);
+    }
+    return cancelled;
+}
+
+bool OrderExecution::CancelByLabel(const std::string& label, std::string& response) const
+{
+    const bool cancelled = WaitForCompletion(EndpointId::CANCEL_BY_LABEL,
+        [this, &label](CompletionCallback callback) { return CancelByLabelAsync(label, std::move(callback)); },
+        response);
+
+    if (cancelled) {
+        BinaryLogger::Write(Utilities::ORDER_RESPONSE, "", response);
+    } else {
+        BinaryLogger::Write(LOG_CANCEL_LABEL_FAILED, label, response);
+    }
+    return cancelled;
+}
+
+std::shared_ptr<OrderExecution::Batch> OrderExecution::StartBatch(const size_t count, BatchStart start,
+                                                                  BatchCallback callback) const
+{
+    if (count == 0)
+    {
+        callback({});
+        return nullptr;
+    }
+
+    auto batch = std::make_shared<Batch>();
+    batch->start = std::move(start);
+    batch->callback = std::move(callback);
+    batch->results.resize(count);
+    batch->is_done.resize(count, 0);
+    for (size_t i = 0; i < count; ++i)
+    {
+        batch->queued.push_back(i);
+    }
+    batch->remaining = count;
+
+    DrainBatch(batch);
+    return batch;
+}
+
+// Function to start queued elements until the batch runs out of them or out of credit
+void OrderExecution::DrainBatch(const std::shared_ptr<Batch>& batch) const
+{
+    for (;;)
+    {
+        size_t index;
+        {
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            if (batch->queued.empty())
+            {
+                return;
             }
-        });
+            index = batch->queued.front();
+            batch->queued.pop_front();
+            ++batch->in_flight;
+        }
+
+        t_dispatch_deferred = false;
+        const bool started = batch->start(index,
+            [this, batch, index](const bool success, const std::string& response)
+            {
+                if (FinishBatchElement(batch, index, success, response))
+                {
+                    DrainBatch(batch);
+                }
+            });
+        if (started)
+        {
+            continue;
+        }
+
+        if (!t_dispatch_deferred)
+        {
+            {
+                std::lock_guard<std::mutex> lock(batch->mutex);
+                ++batch->rejected;
+            }
+            if (!FinishBatchElement(batch, index, false, "Request rejected"))
+            {
+                return;
+            }
+            continue;
+        }
+
+        // Out of credit: the next completion of this batch drains it, or the retry timer if none is pending
+        {
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            batch->queued.push_front(index);
+            --batch->in_flight;
+            if (batch->in_flight != 0 || batch->is_retry_scheduled)
+            {
+                return;
+            }
+            batch->is_retry_scheduled = true;
+        }
+        m_connection_pool->GetLoop()->runAfter(std::chrono::duration<double>(BATCH_RETRY_INTERVAL).count(),
+            [this, batch]()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(batch->mutex);
+                    batch->is_retry_scheduled = false;
+                }
+                DrainBatch(batch);
+            });
+        return;
+    }
+}
+
+bool OrderExecution::FinishBatchElement(const std::shared_ptr<Batch>& batch, const size_t index, const bool success,
+                                        const std::string& response) const
+{
+    {
+        std::lock_guard<std::mutex> lock(batch->mutex);
+        batch->results[index] = {success, response};
+        batch->is_done[index] = 1;
+        --batch->in_flight;
+        if (--batch->remaining != 0)
+        {
+            return true;
+        }
+    }
 
-    return RetryRequest([&future]() { 
-        return future.wait_for(std::chrono::seconds(5)) == std::future_status::ready && future.get(); 
-    });
+    // Nothing else writes the results once the last element is in
+    batch->callback(batch->results);
+    return false;
 }
 
-bool OrderExecution::ModifyOrder(const std::string& order_id, const double& new_amount, const double& new_price,
-                             std::string& response) const
+size_t OrderExecution::RunBatch(const size_t count, BatchStart start, BatchCallback callback) const
 {
-    if (!RefreshTokenIfNeeded() || new_amount <= 0 || new_price <= 0)
+    const auto batch = StartBatch(count, std::move(start), std::move(callback));
+    if (!batch)
     {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(batch->mutex);
+    return count - batch->rejected;
+}
+
+// Function to run a batch to completion for the blocking API
+bool OrderExecution::WaitForBatch(const size_t count, BatchStart start, std::vector<OrderResult>& results) const
+{
+    struct Completion
+    {
+        std::promise<void> promise;
+        std::vector<OrderResult> results;
+    };
+
+    auto completion = std::make_shared<Completion>();
+    auto future = completion->promise.get_future();
+
+    const auto batch = StartBatch(count, std::move(start),
+        [completion](const std::vector<OrderResult>& batch_results)
+        {
+            completion->results = batch_results;
+            completion->promise.set_value();
+        });
+
+    if (future.wait_for(SYNC_WAIT_TIMEOUT) != std::future_status::ready)
+    {
+        // Whatever has not been sent yet never will be, so the caller can safely retry those elements
+        std::lock_guard<std::mutex> lock(batch->mutex);
+        for (const size_t index : batch->queued)
+        {
+            batch->results[index] = {false, "Request not sent"};
+            batch->is_done[index] = 1;
+            --batch->remaining;
+        }
+        batch->queued.clear();
+
+        results = batch->results;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (!batch->is_done[i])
+            {
+                results[i] = {false, "Request timed out, outcome unknown"};
+            }
+        }
         return false;
     }
 
-    const auto req = drogon::HttpRequest::newHttpRequest();
-    req->setMethod(drogon::Get);
+    results = std::move(completion->results);
+    return std::all_of(results.begin(), results.end(), [](const OrderResult& result) { return result.success; });
+}
+
+size_t OrderExecution::PlaceOrdersAsync(const std::vector<OrderParams>& orders, const std::string& side,
+                                        BatchCallback callback) const
+{
+    return RunBatch(orders.size(),
+                    [this, orders, side](const size_t index, CompletionCallback completion)
+                    { return PlaceOrderAsync(orders[index], side, std::move(completion)); },
+                    std::move(callback));
+}
+
+size_t OrderExecution::CancelOrdersAsync(const std::vector<std::string>& order_ids, BatchCallback callback) const
+{
+    return RunBatch(order_ids.size(),
+                    [this, order_ids](const size_t index, CompletionCallback completion)
+                    { return CancelOrderAsync(order_ids[index], std::move(completion)); },
+                    std::move(callback));
+}
 
-    char buffer[BUFFER_SIZE];
-    const int written = snprintf(buffer, BUFFER_SIZE, 
-        "/api/v2/private/edit?order_id=%s&amount=%.6f&price=%.2f",
-        order_id.c_str(), new_amount, new_price);
+bool OrderExecution::PlaceOrders(const std::vector<OrderParams>& orders, const std::string& side,
+                                 std::vector<OrderResult>& results) const
+{
+    const bool placed = WaitForBatch(orders.size(),
+        [this, orders, side](const size_t index, CompletionCallback completion)
+        { return PlaceOrderAsync(orders[index], side, std::move(completion)); },
+        results);
 
-    if (written < 0 || written >= BUFFER_SIZE)
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        if (!results[i].success)
+        {
+            BinaryLogger::Write(LOG_BATCH_PLACE_FAILED, i, results[i].response);
+        }
+    }
+    return placed;
+}
+
+bool OrderExecution::CancelOrders(const std::vector<std::string>& order_ids, std::vector<OrderResult>& results) const
+{
+    const bool cancelled = WaitForBatch(order_ids.size(),
+        [this, order_ids](const size_t index, CompletionCallback completion)
+        { return CancelOrderAsync(order_ids[index], std::move(completion)); },
+        results);
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        if (!results[i].success)
+        {
+            BinaryLogger::Write(LOG_BATCH_CANCEL_FAILED, order_ids[i], results[i].response);
+        }
+    }
+    return cancelled;
+}
+
+bool OrderExecution::ModifyOrderAsync(const std::string& order_id, const double new_amount, double new_price,
+                                      CompletionCallback callback) const
+{
+    LatencyTrace trace(EndpointId::EDIT);
+    if (new_amount <= 0 || new_price <= 0)
     {
-        std::cerr << "Buffer overflow or error in sprintf.\n";
         return false;
     }
 
-    req->setPath(std::string(buffer, written));
-    req->addHeader("Authorization", "Bearer " + m_token_manager.GetAccessToken());
-    req->addHeader("Content-Type", "application/json");
+    // The instrument and side are only known if the order store holds the order, and without them the risk
+    // checks cannot run, so an unknown order is only edited when there is no risk engine
+    OrderUpdate order;
+    const bool is_known = m_order_store && m_order_store->FindByOrderId(order_id, order);
+    if (!is_known)
+    {
+        if (m_risk_engine)
+        {
+            BinaryLogger::Write(LOG_UNKNOWN_ORDER, order_id);
+            return false;
+        }
+        trace.Mark(LatencyStage::VALIDATION);
+        return SendEditAsync(trace, order_id, new_amount, new_price, std::move(callback));
+    }
 
-    std::promise<bool> requestComplete;
-    auto future = requestComplete.get_future();
+    const bool is_buy = order.direction == TradeDirection::BUY;
+    if (!ApplyInstrumentRules(order.instrument_name, is_buy, new_amount, new_price))
+    {
+        return false;
+    }
+    if (!m_risk_engine)
+    {
+        trace.Mark(LatencyStage::VALIDATION);
+        return SendEditAsync(trace, order_id, new_amount, new_price, std::move(callback));
+    }
 
-    SendAsyncRequest(req, 
-        [&response, &requestComplete](const drogon::ReqResult& result, const drogon::HttpResponsePtr& http_response) {
-            auto apiResponse = HandleResponse(result, http_response);
-            if (apiResponse.success) {
-                response = apiResponse.data;
-                std::cout << "Modified Order:\n";
-                Utilities::DisplayJsonResponse(response);
-                requestComplete.set_value(true);
-            } else {
-                std::cerr << "Error modifying order: " << apiResponse.message << std::endl;
-                response = apiResponse.message;
-                requestComplete.set_value(false);
-            }
+    // The edited order is checked as if it were placed anew, at its full new amount and price
+    const RiskCheck check =
+        m_risk_engine->CheckOrder(order.instrument_name, is_buy, false, new_amount, new_price, true);
+    if (check != RiskCheck::PASSED)
+    {
+        BinaryLogger::Write(LOG_RISK_REJECTED, order.instrument_name, RiskEngine::GetRiskCheckName(check));
+        return false;
+    }
+    trace.Mark(LatencyStage::VALIDATION);
+
+    // Like a new order, the edit counts as pending in the risk engine until the exchange has answered
+    const bool sent = SendEditAsync(trace, order_id, new_amount, new_price,
+        [this, instrument_name = order.instrument_name, callback = std::move(callback)](
+            const bool success, const std::string& response)
+        {
+            m_risk_engine->ReleaseOrder(instrument_name);
+            callback(success, response);
         });
+    if (!sent)
+    {
+        m_risk_engine->ReleaseOrder(order.instrument_name);
+    }
+    return sent;
+}
+
+bool OrderExecution::SendEditAsync(LatencyTrace& trace, const std::string& order_id, const double new_amount,
+                                   const double new_price, CompletionCallback callback) const
+{
+    if (!RefreshTokenIfNeeded())
+    {
+        return false;
+    }
+    trace.Mark(LatencyStage::TOKEN_CHECK);
+
+    if (IsGatewayReady())
+    {
+        return Dispatch(trace, Endpoints::EDIT.pool,
+            [this, order_id, new_amount, new_price](CompletionCallback completion)
+            { return m_order_gateway->Edit(order_id, new_amount, new_price, std::move(completion)); },
+            std::move(callback));
+    }
 
-    return RetryRequest([&future]() { 
-        return future.wait_for(std::chrono::seconds(5)) == std::future_status::ready && future.get(); 
-    });
+    RequestEncoder& encoder = RequestEncoder::ThreadLocal();
+    encoder.BeginQuery(Endpoints::EDIT);
+    encoder.AddQueryParam("order_id", order_id);
+    encoder.AddQueryParam("amount", new_amount);
+    encoder.AddQueryParam("price", new_price);
+
+    if (!encoder.Ok())
+    {
+        BinaryLogger::Write(LOG_ENCODER_OVERFLOW);
+        return false;
+    }
+
+    const auto req = NewHttpRequest(Endpoints::EDIT, encoder);
+    return Dispatch(trace, Endpoints::EDIT.pool,
+                    [this, req](CompletionCallback completion) { return SendHttpRequest(req, std::move(completion)); },
+                    std::move(callback));
 }
 
-bool OrderExecution::GetOrderBook(const std::string& instrument_name, std::string& response) const
+bool OrderExecution::ModifyOrder(const std::string& order_id, const double& new_amount, const double& new_price,
+                             std::string& response) const
+{
+    const bool modified = WaitForCompletion(EndpointId::EDIT,
+        [this, &order_id, new_amount, new_price](CompletionCallback callback)
+        { return ModifyOrderAsync(order_id, new_amount, new_price, std::move(callback)); },
+        response);
+
+    if (modified) {
+        BinaryLogger::Write(Utilities::ORDER_RESPONSE, "Modified Order:", response);
+    } else {
+        BinaryLogger::Write(LOG_MODIFY_FAILED, response);
+    }
+    return modified;
+}
+
+bool OrderExecution::GetOrderBookAsync(const std::string& instrument_name, CompletionCallback callback) const
 {
+    LatencyTrace trace(EndpointId::GET_ORDER_BOOK);
     if (instrument_name.empty()) {
-        std::cerr << "Invalid instrument name\n";
+        BinaryLogger::Write(LOG_INVALID_INSTRUMENT_NAME);
         return false;
     }
+    trace.Mark(LatencyStage::VALIDATION);
 
-    const auto req = drogon::HttpRequest::newHttpRequest();
-    req->setMethod(drogon::Get);
-    req->setPath("/api/v2/public/get_order_book?instrument_name=" + instrument_name);
+    // Serve from the local book once it is synced; the first request starts tracking the instrument
+    if (m_order_book_manager)
+    {
+        std::string book;
+        if (m_order_book_manager->GetOrderBook(instrument_name, book))
+        {
+            callback(true, book);
+            return true;
+        }
+        m_order_book_manager->Track(instrument_name);
+    }
 
-    std::promise<bool> requestComplete;
-    auto future = requestComplete.get_future();
+    RequestEncoder& encoder = RequestEncoder::ThreadLocal();
+    encoder.BeginQuery(Endpoints::GET_ORDER_BOOK);
+    encoder.AddQueryParam("instrument_name", instrument_name);
+    const auto req = NewHttpRequest(Endpoints::GET_ORDER_BOOK, encoder);
+    return Dispatch(trace, Endpoints::GET_ORDER_BOOK.pool,
+                    [this, req](CompletionCallback completion) { return SendHttpRequest(req, std::move(completion)); },
+                    std::move(callback));
+}
 
-    SendAsyncRequest(req, 
-        [&response, &requestComplete](const drogon::ReqResult& result, const drogon::HttpResponsePtr& http_response) {
-            auto apiResponse = HandleResponse(result, http_response);
-            if (apiResponse.success) {
-                response = apiResponse.data;
-                Utilities::DisplayOrderBookJson(response);
-                requestComplete.set_value(true);
-            } else {
-                std::cerr << "Error getting order book: " << apiResponse.message << std::endl;
-                response = apiResponse.message;
-                requestComplete.set_value(false);
-            }
-        });
+bool OrderExecution::GetOrderBook(const std::string& instrument_name, std::string& response) const
+{
+    const bool received = WaitForCompletion(EndpointId::GET_ORDER_BOOK,
+        [this, &instrument_name](CompletionCallback callback)
+        { return GetOrderBookAsync(instrument_name, std::move(callback)); },
+        response);
 
-    return RetryRequest([&future]() { 
-        return future.wait_for(std::chrono::seconds(5)) == std::future_status::ready && future.get(); 
-    });
+    if (received) {
+        BinaryLogger::Write(Utilities::ORDER_BOOK_RESPONSE, response);
+    } else {
+        BinaryLogger::Write(LOG_ORDER_BOOK_FAILED, response);
+    }
+    return received;
 }
 
-bool OrderExecution::GetCurrentPositions(const std::string& currency, const std::string& kind,
-                                     std::string& response) const
+bool OrderExecution::RequestPositionsAsync(const std::string& currency, const std::string& kind,
+                                           CompletionCallback callback) const
 {
-    if (!RefreshTokenIfNeeded() || currency.empty())
+    LatencyTrace trace(EndpointId::GET_POSITIONS);
+    if (currency.empty())
     {
         return false;
     }
+    trace.Mark(LatencyStage::VALIDATION);
 
-    const auto req = drogon::HttpRequest::newHttpRequest();
-    req->setMethod(drogon::Get);
+    if (!RefreshTokenIfNeeded())
+    {
+        return false;
+    }
+    trace.Mark(LatencyStage::TOKEN_CHECK);
 
-    std::string path = "/api/v2/private/get_positions?currency=" + currency;
+    RequestEncoder& encoder = RequestEncoder::ThreadLocal();
+    encoder.BeginQuery(Endpoints::GET_POSITIONS);
+    encoder.AddQueryParam("currency", currency);
     if (!kind.empty())
     {
-        path += "&kind=" + kind;
+        encoder.AddQueryParam("kind", kind);
     }
-    req->setPath(path);
-    req->addHeader("Authorization", "Bearer " + m_token_manager.GetAccessToken());
-    req->addHeader("Content-Type", "application/json");
+    const auto req = NewHttpRequest(Endpoints::GET_POSITIONS, encoder);
 
-    std::promise<bool> requestComplete;
-    auto future = requestComplete.get_future();
+    return Dispatch(trace, Endpoints::GET_POSITIONS.pool,
+                    [this, req](CompletionCallback completion) { return SendHttpRequest(req, std::move(completion)); },
+                    std::move(callback));
+}
 
-    SendAsyncRequest(req, 
-        [&response, &requestComplete](const drogon::ReqResult& result, const drogon::HttpResponsePtr& http_response) {
-            auto apiResponse = HandleResponse(result, http_response);
-            if (apiResponse.success) {
-                response = apiResponse.data;
-                Utilities::DisplayCurrentPositionsJson(response);
-                requestComplete.set_value(true);
-            } else {
-                std::cerr << "Error getting positions: " << apiResponse.message << std::endl;
-                response = apiResponse.message;
-                requestComplete.set_value(false);
+bool OrderExecution::GetCurrentPositionsAsync(const std::string& currency, const std::string& kind,
+                                              CompletionCallback callback) const
+{
+    // Serve from the position engine once this currency has been reconciled
+    if (m_position_engine && m_position_engine->IsSynced(currency))
+    {
+        std::string positions;
+        m_position_engine->SerializeTo(positions, currency, kind);
+        callback(true, positions);
+        return true;
+    }
+    return RequestPositionsAsync(currency, kind, std::move(callback));
+}
+
+// Function to correct the position engine for fills it may have missed
+void OrderExecution::ReconcilePositions(const std::vector<std::string>& currencies) const
+{
+    for (const auto& currency : currencies)
+    {
+        RequestPositionsAsync(currency, "",
+            [this, currency](const bool success, const std::string& response)
+            {
+                if (success)
+                {
+                    m_position_engine->Reconcile(currency, response);
+                }
+                else
+                {
+                    BinaryLogger::Write(LOG_POSITION_RECONCILE_FAILED, currency, response);
+                }
+            });
+    }
+}
+
+void OrderExecution::StartPositionSync(const std::vector<std::string>& currencies, const std::chrono::seconds interval)
+{
+    if (!m_position_engine)
+    {
+        return;
+    }
+
+    if (m_position_sync_timer != 0)
+    {
+        m_connection_pool->GetLoop()->invalidateTimer(m_position_sync_timer);
+    }
+
+    ReconcilePositions(currencies);
+    m_position_sync_timer = m_connection_pool->GetLoop()->runEvery(static_cast<double>(interval.count()),
+                                                                   [this, currencies]() { ReconcilePositions(currencies); });
+}
+
+void OrderExecution::ReconcileNow(const std::vector<std::string>& currencies) const
+{
+    if (m_order_store)
+    {
+        ReconcileOpenOrders();
+    }
+    if (m_position_engine)
+    {
+        ReconcilePositions(currencies);
+    }
+}
+
+// Function to pull the instrument list and persist it for the next start
+void OrderExecution::RefreshInstruments() const
+{
+    LatencyTrace trace(EndpointId::GET_INSTRUMENTS);
+    trace.Mark(LatencyStage::VALIDATION);
+
+    RequestEncoder& encoder = RequestEncoder::ThreadLocal();
+    encoder.BeginQuery(Endpoints::GET_INSTRUMENTS);
+    encoder.AddQueryParam("currency", "any");
+    encoder.AddQueryParam("expired", "false");
+    const auto req = NewHttpRequest(Endpoints::GET_INSTRUMENTS, encoder);
+
+    const bool sent = Dispatch(trace, Endpoints::GET_INSTRUMENTS.pool,
+        [this, req](CompletionCallback completion) { return SendHttpRequest(req, std::move(completion)); },
+        [this](const bool success, const std::string& response)
+        {
+            if (success && m_instrument_registry->Apply(response))
+            {
+                m_instrument_registry->SaveSnapshot();
+            }
+            else if (!success)
+            {
+                BinaryLogger::Write(LOG_INSTRUMENT_REFRESH_FAILED, response);
             }
         });
+    if (!sent)
+    {
+        BinaryLogger::Write(LOG_INSTRUMENT_REFRESH_UNSENT);
+    }
+}
+
+void OrderExecution::StartInstrumentSync(const std::chrono::seconds interval)
+{
+    if (!m_instrument_registry)
+    {
+        return;
+    }
 
-    return RetryRequest([&future]() { 
-        return future.wait_for(std::chrono::seconds(5)) == std::future_status::ready && future.get(); 
-    });
+    if (m_instrument_sync_timer != 0)
+    {
+        m_connection_pool->GetLoop()->invalidateTimer(m_instrument_sync_timer);
+    }
+
+    RefreshInstruments();
+    m_instrument_sync_timer = m_connection_pool->GetLoop()->runEvery(static_cast<double>(interval.count()),
+                                                                     [this]() { RefreshInstruments(); });
 }
 
-bool OrderExecution::GetOpenOrders(std::string& response) const
+bool OrderExecution::GetCurrentPositions(const std::string& currency, const std::string& kind,
+                                     std::string& response) const
 {
+    const bool received = WaitForCompletion(EndpointId::GET_POSITIONS,
+        [this, &currency, &kind](CompletionCallback callback)
+        { return GetCurrentPositionsAsync(currency, kind, std::move(callback)); },
+        response);
+
+    if (received) {
+        BinaryLogger::Write(Utilities::POSITIONS_RESPONSE, response);
+    } else {
+        BinaryLogger::Write(LOG_POSITIONS_FAILED, response);
+    }
+    return received;
+}
+
+bool OrderExecution::RequestOpenOrdersAsync(CompletionCallback callback) const
+{
+    LatencyTrace trace(EndpointId::GET_OPEN_ORDERS);
     if (!RefreshTokenIfNeeded())
     {
         return false;
     }
+    trace.Mark(LatencyStage::TOKEN_CHECK);
 
-    const auto req = drogon::HttpRequest::newHttpRequest();
-    req->setMethod(drogon::Get);
-    req->setPath("/api/v2/private/get_open_orders");
-    req->addHeader("Authorization", "Bearer " + m_token_manager.GetAccessToken());
-    req->addHeader("Content-Type", "application/json");
+    RequestEncoder& encoder = RequestEncoder::ThreadLocal();
+    encoder.BeginQuery(Endpoints::GET_OPEN_ORDERS);
+    const auto req = NewHttpRequest(Endpoints::GET_OPEN_ORDERS, encoder);
 
-    std::promise<bool> requestComplete;
-    auto future = requestComplete.get_future();
+    return Dispatch(trace, Endpoints::GET_OPEN_ORDERS.pool,
+                    [this, req](CompletionCallback completion) { return SendHttpRequest(req, std::move(completion)); },
+                    std::move(callback));
+}
 
-    SendAsyncRequest(req, 
-        [this, &response, &requestComplete](const drogon::ReqResult& result, const drogon::HttpResponsePtr& http_response) {
-            auto apiResponse = ProcessHttpResponse(result, http_response);
-            if (apiResponse.success) {
-                response = apiResponse.data;
-                std::cout << "Open Orders:\n";
-                Utilities::DisplayJsonResponse(response);
-                requestComplete.set_value(true);
-            } else {
-                std::cerr << "Error getting open orders: " << apiResponse.message << std::endl;
-                response = "Failed to get open orders: " + apiResponse.message;
-                requestComplete.set_value(false);
+bool OrderExecution::GetOpenOrdersAsync(CompletionCallback callback) const
+{
+    // Serve from the order store once it has been reconciled at least once
+    if (m_order_store && m_order_store->IsSynced())
+    {
+        std::string orders;
+        m_order_store->SerializeTo(orders);
+        callback(true, orders);
+        return true;
+    }
+    return RequestOpenOrdersAsync(std::move(callback));
+}
+
+// Function to correct the order store for anything the stream and acks missed
+void OrderExecution::ReconcileOpenOrders() const
+{
+    const int64_t requested_at_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    RequestOpenOrdersAsync(
+        [this, requested_at_ms](const bool success, const std::string& response)
+        {
+            if (success)
+            {
+                m_order_store->Reconcile(response, requested_at_ms);
+            }
+            else
+            {
+                BinaryLogger::Write(LOG_ORDER_RECONCILE_FAILED, response);
             }
         });
+}
+
+void OrderExecution::StartOpenOrderSync(const std::chrono::seconds interval)
+{
+    if (!m_order_store)
+    {
+        return;
+    }
+
+    if (m_order_sync_timer != 0)
+    {
+        m_connection_pool->GetLoop()->invalidateTimer(m_order_sync_timer);
+    }
+
+    ReconcileOpenOrders();
+    m_order_sync_timer = m_connection_pool->GetLoop()->runEvery(static_cast<double>(interval.count()),
+                                                                [this]() { ReconcileOpenOrders(); });
+}
+
+bool OrderExecution::GetOpenOrders(std::string& response) const
+{
+    const bool received = WaitForCompletion(EndpointId::GET_OPEN_ORDERS,
+        [this](CompletionCallback callback) { return GetOpenOrdersAsync(std::move(callback)); }, response);
 
-    return RetryRequest([&future]() { 
-        return future.wait_for(std::chrono::seconds(5)) == std::future_status::ready && future.get(); 
-    });
-}
\ No newline at end of file
+    if (received) {
+        BinaryLogger::Write(Utilities::ORDER_RESPONSE, "Open Orders:", response);
+    } else {
+        BinaryLogger::Write(LOG_OPEN_ORDERS_FAILED, response);
+        response = "Failed to get open orders: " + response;
+    }
+    return received;
+}
+
+// Function to load the account's credit limits so the local buckets match the exchange
+bool OrderExecution::SyncRateLimits(const std::string& currency) const
+{
+    LatencyTrace trace(EndpointId::GET_ACCOUNT_SUMMARY);
+    if (currency.empty())
+    {
+        return false;
+    }
+    trace.Mark(LatencyStage::VALIDATION);
+
+    if (!RefreshTokenIfNeeded())
+    {
+        return false;
+    }
+    trace.Mark(LatencyStage::TOKEN_CHECK);
+
+    RequestEncoder& encoder = RequestEncoder::ThreadLocal();
+    encoder.BeginQuery(Endpoints::GET_ACCOUNT_SUMMARY);
+    encoder.AddQueryParam("currency", currency);
+    encoder.AddQueryParam("extended", "true");
+    const auto req = NewHttpRequest(Endpoints::GET_ACCOUNT_SUMMARY, encoder);
+
+    return Dispatch(trace, Endpoints::GET_ACCOUNT_SUMMARY.pool,
+                    [this, req](CompletionCallback completion) { return SendHttpRequest(req, std::move(completion)); },
+                    [this](const bool success, const std::string& response)
+                    {
+                        Json::Value json_data;
+                        if (success && Utilities::IsParseJsonGood(response, json_data))
+                        {
+                            m_rate_limiter->ApplyExchangeLimits(json_data["result"]["limits"]);
+                        }
+                    });
+}
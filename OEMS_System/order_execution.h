@@ -1,23 +1,30 @@
 #pragma once
 
+#include <atomic>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <future>
 #include <chrono>
+#include <functional>
+#include <vector>
 
 #include <drogon/HttpClient.h>
 
 #include "api_credentials.h"
+#include "compact_order.h"
+#include "connection_pool.h"
+#include "instrument_registry.h"
+#include "latency_recorder.h"
+#include "order_book.h"
+#include "order_gateway.h"
+#include "order_store.h"
+#include "position_engine.h"
+#include "rate_limiter.h"
+#include "request_encoder.h"
+#include "risk_engine.h"
 #include "token_manager.h"
 
-enum class OrderType
-{
-    LIMIT,
-    MARKET,
-    STOP_LIMIT,
-    STOP_MARKET
-};
-
 enum class InstrumentType
 {
     SPOT,
@@ -35,40 +42,130 @@ struct OrderParams
     std::string time_in_force;    // "good_til_cancelled", "fill_or_kill" "immediate_or_cancel"
 };
 
+// Outcome of one element of a batch, reported in the order the batch was given
+struct OrderResult
+{
+    bool success;
+    std::string response;
+};
+
 struct ApiResponse {
     bool success;
     std::string message;
     std::string data;
 };
 
-class RateLimiter;
-
 class OrderExecution
 {
+  public:
+    // Invoked exactly once for every accepted asynchronous request, on the thread that completed it
+    using CompletionCallback = OrderGateway::ResponseCallback;
+    // Invoked exactly once per batch, after its last element has completed
+    using BatchCallback = std::function<void(const std::vector<OrderResult>& results)>;
+
+    static constexpr size_t DEFAULT_MAX_IN_FLIGHT = 64;
+
   private:
-    static constexpr size_t BUFFER_SIZE = 2048;
+    static constexpr double REQUEST_TIMEOUT_SECONDS = 5.0;
+    static constexpr std::chrono::seconds SYNC_WAIT_TIMEOUT{10};
+    // How long a batch waits before retrying queued elements when none of its own requests are in flight
+    static constexpr std::chrono::milliseconds BATCH_RETRY_INTERVAL{10};
     static constexpr const char* BASE_URL = "https://test.deribit.com";
     static constexpr const char* API_PATH = "/api/v2/private/";
-    std::shared_ptr<drogon::HttpClient> m_client;
+    std::unique_ptr<ConnectionPool> m_connection_pool;
     TokenManager& m_token_manager;
     ApiCredentials m_api_credentials;
     std::unique_ptr<RateLimiter> m_rate_limiter;
+    std::unique_ptr<LatencyRecorder> m_latency_recorder;
+    trantor::TimerId m_latency_dump_timer{0};
+    OrderBookManager* m_order_book_manager;
+    OrderGateway* m_order_gateway;
+    OrderStore* m_order_store;
+    PositionEngine* m_position_engine;
+    RiskEngine* m_risk_engine;
+    InstrumentRegistry* m_instrument_registry;
+    trantor::TimerId m_order_sync_timer{0};
+    trantor::TimerId m_position_sync_timer{0};
+    trantor::TimerId m_instrument_sync_timer{0};
+    std::atomic<size_t> m_max_in_flight{DEFAULT_MAX_IN_FLIGHT};
+    mutable std::atomic<size_t> m_in_flight{0};
 
     bool RefreshTokenIfNeeded() const;
-    bool ValidateOrderParams(const OrderParams& params) const;
-    
+    // Basic parameter checks, then the pre-trade risk checks; an order that passes is pending in the
+    // risk engine until released
+    bool ValidateOrderParams(const OrderParams& params, bool is_buy) const;
+    bool ValidateOrderParams(const CompactOrder& order, const InstrumentInfo& instrument) const;
+    // Snaps the price to the instrument's tick and checks the amount against its minimum. Instruments pass
+    // unchanged while the registry is empty; once it is loaded, unknown instruments are rejected.
+    bool ApplyInstrumentRules(const std::string& instrument_name, bool is_buy, double amount, double& price) const;
+    bool IsGatewayReady() const noexcept;
+    static bool IsOrderEntry(EndpointId endpoint) noexcept;
+
     ApiResponse ProcessHttpResponse(const drogon::ReqResult& result, 
                                   const drogon::HttpResponsePtr& response) const;
 
+    // Claims a window slot and rate-limit credit, then hands submit a callback that releases the slot on
+    // completion. Submit may run later on the client loop when the request is queued by the rate limiter.
+    // The trace carries the stages stamped so far and is recorded once the request completes.
+    bool Dispatch(const LatencyTrace& trace, RateLimitPool pool, std::function<bool(CompletionCallback)> submit,
+                  CompletionCallback callback) const;
+    bool SendHttpRequest(const drogon::HttpRequestPtr& req, CompletionCallback callback) const;
+    // Builds a GET request from the encoder contents, signed with the cached Authorization header if private.
+    // Drogon keeps each request until its reply arrives, so the request, its path and its header are still
+    // allocated per call; only the gateway path sends straight from the encoder buffer.
+    drogon::HttpRequestPtr NewHttpRequest(const EndpointDescriptor& endpoint, const RequestEncoder& encoder) const;
+    bool WaitForCompletion(EndpointId endpoint, const std::function<bool(CompletionCallback)>& start,
+                           std::string& response) const;
+
+    // Starts count requests through start(index, completion) and gathers their results for callback.
+    // Elements turned away only for want of window or rate-limit credit are queued and started as the batch's
+    // own requests complete; elements rejected for any other reason are reported as failed without being sent.
+    // start is kept until the batch finishes, so it must own what it refers to.
+    struct Batch;
+    using BatchStart = std::function<bool(size_t, CompletionCallback)>;
+    std::shared_ptr<Batch> StartBatch(size_t count, BatchStart start, BatchCallback callback) const;
+    void DrainBatch(const std::shared_ptr<Batch>& batch) const;
+    // Returns false once the batch has finished
+    bool FinishBatchElement(const std::shared_ptr<Batch>& batch, size_t index, bool success,
+                            const std::string& response) const;
+    // Returns how many elements were started or queued
+    size_t RunBatch(size_t count, BatchStart start, BatchCallback callback) const;
+    // On timeout, queued elements are dropped unsent and the results that have arrived are kept; elements
+    // still waiting for the exchange are reported as failed with an unknown outcome
+    bool WaitForBatch(size_t count, BatchStart start, std::vector<OrderResult>& results) const;
+
+    // The cancel family: one string parameter, sent over the gateway when it is up
+    bool CancelAsync(const EndpointDescriptor& endpoint, std::string_view key, const std::string& value,
+                     bool (OrderGateway::*gateway_send)(const std::string&, CompletionCallback),
+                     CompletionCallback callback) const;
+
+    // Always asks the exchange; GetOpenOrdersAsync prefers the order store
+    bool RequestOpenOrdersAsync(CompletionCallback callback) const;
+    void ReconcileOpenOrders() const;
+    // Always asks the exchange; GetCurrentPositionsAsync prefers the position engine
+    bool RequestPositionsAsync(const std::string& currency, const std::string& kind,
+                               CompletionCallback callback) const;
+    void ReconcilePositions(const std::vector<std::string>& currencies) const;
+    void RefreshInstruments() const;
+
+    // Everything in PlaceOrderAsync after validation
+    bool SendOrderAsync(LatencyTrace& trace, const EndpointDescriptor& endpoint, const OrderParams& params,
+                        bool is_buy, CompletionCallback callback) const;
+    bool SendOrderAsync(LatencyTrace& trace, const EndpointDescriptor& endpoint, const CompactOrder& order,
+                        const InstrumentInfo& instrument, CompletionCallback callback) const;
+    // Everything in ModifyOrderAsync after validation
+    bool SendEditAsync(LatencyTrace& trace, const std::string& order_id, double new_amount, double new_price,
+                       CompletionCallback callback) const;
+
     template<typename Callback>
     void SendAsyncRequest(const drogon::HttpRequestPtr& req, Callback&& callback) const;
-    
-    template<typename Func>
-    bool RetryRequest(Func&& func, int maxRetries = 3) const;
 
   public:
-    OrderExecution(TokenManager& token_manager);
-    ~OrderExecution() = default;
+    explicit OrderExecution(TokenManager& token_manager, OrderBookManager* order_book_manager = nullptr,
+                            OrderGateway* order_gateway = nullptr, OrderStore* order_store = nullptr,
+                            PositionEngine* position_engine = nullptr, RiskEngine* risk_engine = nullptr,
+                            InstrumentRegistry* instrument_registry = nullptr);
+    ~OrderExecution();
 
     OrderExecution(const OrderExecution&) = delete;
     OrderExecution& operator=(const OrderExecution&) = delete;
@@ -77,6 +174,70 @@ class OrderExecution
 
     static std::string GetOrderTypeString(const OrderType& type);
 
+    static constexpr std::string_view GetOrderTypeName(const OrderType type) noexcept
+    {
+        switch (type)
+        {
+            case OrderType::LIMIT: return "limit";
+            case OrderType::MARKET: return "market";
+            case OrderType::STOP_LIMIT: return "stop_limit";
+            case OrderType::STOP_MARKET: return "stop_market";
+            default: return "limit";
+        }
+    }
+
+    void SetMaxInFlight(size_t max_in_flight) noexcept;
+    size_t GetInFlightCount() const noexcept;
+    const RateLimiter& GetRateLimiter() const noexcept;
+    const LatencyRecorder& GetLatencyRecorder() const noexcept;
+    const ConnectionPool& GetConnectionPool() const noexcept;
+
+    // Prints the latency report on the client loop every interval, skipping intervals without new samples
+    void StartLatencyDump(std::chrono::seconds interval);
+
+    // Reconciles the order store against private/get_open_orders now and then every interval
+    void StartOpenOrderSync(std::chrono::seconds interval);
+
+    // Reconciles the position engine against private/get_positions for each currency, now and every interval
+    void StartPositionSync(const std::vector<std::string>& currencies, std::chrono::seconds interval);
+
+    // Reconciles the order store and the position engine once, outside the regular syncs, for when updates may
+    // have been missed such as after a reconnect
+    void ReconcileNow(const std::vector<std::string>& currencies) const;
+
+    // Refreshes the instrument registry from public/get_instruments now and every interval, saving its
+    // snapshot after each refresh
+    void StartInstrumentSync(std::chrono::seconds interval);
+
+    // Pulls the account's credit limits from private/get_account_summary into the rate limiter
+    bool SyncRateLimits(const std::string& currency) const;
+
+    // Non-blocking variants: return false without invoking the callback if the request is rejected
+    // up front (invalid parameters, expired token or a full in-flight window)
+    bool PlaceOrderAsync(const OrderParams& params, const std::string& side, CompletionCallback callback) const;
+    // The compact entry point; OrderParams orders are converted to this once the registry is loaded. It encodes
+    // without allocating, but the HTTP fallback still allocates a request per order (see NewHttpRequest).
+    bool PlaceOrderAsync(const CompactOrder& order, CompletionCallback callback) const;
+    bool CancelOrderAsync(const std::string& order_id, CompletionCallback callback) const;
+    // Edits go through the same risk checks as new orders, so with a risk engine the order must be in the store
+    bool ModifyOrderAsync(const std::string& order_id, double new_amount, double new_price,
+                          CompletionCallback callback) const;
+    bool GetOrderBookAsync(const std::string& instrument_name, CompletionCallback callback) const;
+    bool GetCurrentPositionsAsync(const std::string& currency, const std::string& kind,
+                                  CompletionCallback callback) const;
+    bool GetOpenOrdersAsync(CompletionCallback callback) const;
+
+    // Batch variants: every element is dispatched concurrently within the rate-limit credits and the
+    // in-flight window, and the overflow is sent as credit frees up. Elements rejected for any other
+    // reason fail individually; the callback always runs once.
+    size_t PlaceOrdersAsync(const std::vector<OrderParams>& orders, const std::string& side,
+                            BatchCallback callback) const;
+    size_t CancelOrdersAsync(const std::vector<std::string>& order_ids, BatchCallback callback) const;
+
+    // Pull a whole set of orders with a single request
+    bool CancelAllByInstrumentAsync(const std::string& instrument_name, CompletionCallback callback) const;
+    bool CancelByLabelAsync(const std::string& label, CompletionCallback callback) const;
+
     bool PlaceOrder(const OrderParams& params, const std::string& side, std::string& response) const;
     bool CancelOrder(const std::string& order_id, std::string& response) const;
     bool ModifyOrder(const std::string& order_id, const double& new_amount, const double& new_price,
@@ -85,32 +246,11 @@ class OrderExecution
     bool GetCurrentPositions(const std::string& currency, const std::string& kind,
                              std::string& response) const;
     bool GetOpenOrders(std::string& response) const;
-};
 
-// Template implementations
-template<typename Callback>
-void OrderExecution::SendAsyncRequest(const drogon::HttpRequestPtr& req, Callback&& callback) const 
-{
-    // Implementation here
-    if (m_rate_limiter && !m_rate_limiter->CheckRateLimit()) {
-        callback(drogon::ReqResult::BadResponse, nullptr);
-        return;
-    }
-    m_client->sendRequest(req, std::forward<Callback>(callback));
-}
-
-template<typename Func>
-bool OrderExecution::RetryRequest(Func&& func, int maxRetries) const 
-{
-    int attempts = 0;
-    while (attempts < maxRetries) {
-        if (func()) {
-            return true;
-        }
-        ++attempts;
-        if (attempts < maxRetries) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100 * (1 << attempts)));
-        }
-    }
-    return false;
-}
\ No newline at end of file
+    // Return true only if every element succeeded; results holds one entry per element either way
+    bool PlaceOrders(const std::vector<OrderParams>& orders, const std::string& side,
+                     std::vector<OrderResult>& results) const;
+    bool CancelOrders(const std::vector<std::string>& order_ids, std::vector<OrderResult>& results) const;
+    bool CancelAllByInstrument(const std::string& instrument_name, std::string& response) const;
+    bool CancelByLabel(const std::string& label, std::string& response) const;
+};
@@ -0,0 +1,626 @@
+#include "order_gateway.h"
+
+#include <utility>
+
+#include <drogon/HttpAppFramework.h>
+
+#include "binary_logger.h"
+#include "latency_recorder.h"
+#include "order_execution.h"
+
+namespace
+{
+    const LogFormat LOG_SESSION_CLOSED{LogLevel::WARN, "[OrderGateway] Session closed"};
+    const LogFormat LOG_CONNECT_FAILED{LogLevel::ERR, "[OrderGateway] Failed to connect"};
+    const LogFormat LOG_CONNECT_EXCEPTION{LogLevel::ERR, "[OrderGateway] Exception while connecting: {}"};
+    const LogFormat LOG_RECONNECTING{LogLevel::INFO, "[OrderGateway] Reconnecting in {} ms"};
+    const LogFormat LOG_SESSION_REFRESH_FAILED{LogLevel::WARN,
+                                               "[OrderGateway] Session refresh failed, authenticating again"};
+    const LogFormat LOG_AUTH_FAILED{LogLevel::ERR, "[OrderGateway] Authentication failed"};
+    const LogFormat LOG_AUTHENTICATED{LogLevel::INFO, "[OrderGateway] Session authenticated"};
+    const LogFormat LOG_ENCODER_OVERFLOW{LogLevel::ERR, "[OrderGateway] Request exceeds encoder buffer"};
+    const LogFormat LOG_SEND_FAILED{LogLevel::ERR, "[OrderGateway] Send failed: {}"};
+    const LogFormat LOG_PARSE_FAILED{LogLevel::ERR, "[OrderGateway] Failed to parse message: {}"};
+    const LogFormat LOG_OUTCOME_UNKNOWN{LogLevel::WARN,
+                                        "[OrderGateway] {} sent requests got no reply, outcome unknown"};
+
+    const std::string CONNECTION_CLOSED = "Connection closed";
+    const std::string CONNECTION_CLOSED_UNKNOWN = "Connection closed, outcome unknown";
+    const std::string TIMED_OUT = "Request timed out";
+    const std::string TIMED_OUT_UNKNOWN = "Request timed out, outcome unknown";
+}
+
+OrderGateway::OrderGateway(TokenManager& token_manager, trantor::EventLoop* loop)
+    : m_loop(loop),
+      m_token_manager(token_manager),
+      m_api_credentials("client_key.txt", "client_secret.txt"),
+      m_reader(Json::CharReaderBuilder().newCharReader())
+{
+    for (uint32_t index = MAX_IN_FLIGHT; index-- > 0;)
+    {
+        PushFreeSlot(index);
+    }
+}
+
+OrderGateway::~OrderGateway()
+{
+    m_is_stopping = true;
+    if (m_reconnect_timer != 0)
+    {
+        drogon::app().getLoop()->invalidateTimer(m_reconnect_timer);
+    }
+    if (m_sweep_timer != 0)
+    {
+        GetLoop()->invalidateTimer(m_sweep_timer);
+    }
+    if (m_session_refresh_timer != 0)
+    {
+        GetLoop()->invalidateTimer(m_session_refresh_timer);
+    }
+
+    const auto client = GetClient();
+    if (client)
+    {
+        client->stop();
+    }
+}
+
+std::shared_ptr<drogon::WebSocketClient> OrderGateway::GetClient()
+{
+    std::lock_guard<std::mutex> lock(m_client_mutex);
+    return m_ws_client;
+}
+
+trantor::EventLoop* OrderGateway::GetLoop() const
+{
+    return m_loop ? m_loop : drogon::app().getLoop();
+}
+
+void OrderGateway::SetOutcomeUnknownListener(OutcomeUnknownListener listener)
+{
+    m_outcome_unknown_listener = std::move(listener);
+}
+
+// Function to open the order-entry session; authentication follows as soon as it connects
+void OrderGateway::Connect()
+{
+    OpenSession();
+    m_sweep_timer = GetLoop()->runEvery(1.0, [this]() { ExpireStaleRequests(); });
+}
+
+// Function to start a session on a fresh client, replacing the previous one
+void OrderGateway::OpenSession()
+{
+    const uint64_t session_id = m_session.fetch_add(1) + 1;
+    try
+    {
+        const auto req = drogon::HttpRequest::newHttpRequest();
+        req->setPath(WS_PATH);
+        req->setMethod(drogon::Get);
+
+        const auto client = drogon::WebSocketClient::newWebSocketClient(WS_HOST, m_loop);
+
+        client->setMessageHandler(
+            [this](std::string&& msg, const drogon::WebSocketClientPtr&, const drogon::WebSocketMessageType& type)
+            {
+                if (type == drogon::WebSocketMessageType::Text)
+                {
+                    HandleMessage(std::move(msg));
+                }
+            });
+
+        client->setConnectionClosedHandler(
+            [this, session_id](const drogon::WebSocketClientPtr&)
+            {
+                if (session_id != m_session.load())
+                {
+                    return;
+                }
+                m_is_connected = false;
+                const bool was_authenticated = m_is_authenticated.exchange(false);
+                FailAllInFlight();
+                BinaryLogger::Write(LOG_SESSION_CLOSED);
+                drogon::app().getLoop()->queueInLoop([this, session_id, was_authenticated]()
+                                                     { OnSessionLost(session_id, was_authenticated); });
+            });
+
+        std::shared_ptr<drogon::WebSocketClient> previous;
+        {
+            std::lock_guard<std::mutex> lock(m_client_mutex);
+            previous = std::exchange(m_ws_client, client);
+        }
+        // Its closed callback now carries an old session, so stopping it does not count as another loss
+        if (previous)
+        {
+            previous->stop();
+        }
+
+        client->connectToServer(
+            req,
+            [this, session_id](const drogon::ReqResult& result, const drogon::HttpResponsePtr&,
+                               const drogon::WebSocketClientPtr&)
+            {
+                if (session_id != m_session.load())
+                {
+                    return;
+                }
+                if (result != drogon::ReqResult::Ok)
+                {
+                    BinaryLogger::Write(LOG_CONNECT_FAILED);
+                    drogon::app().getLoop()->queueInLoop([this, session_id]() { OnSessionLost(session_id, false); });
+                    return;
+                }
+                m_is_connected = true;
+                Authenticate();
+            });
+    }
+    catch (const std::exception& e)
+    {
+        BinaryLogger::Write(LOG_CONNECT_EXCEPTION, e.what());
+        drogon::app().getLoop()->queueInLoop([this, session_id]() { OnSessionLost(session_id, false); });
+    }
+}
+
+// Function to schedule the replacement of a session that closed or failed to connect
+void OrderGateway::OnSessionLost(const uint64_t lost_session, const bool was_authenticated)
+{
+    if (m_is_stopping || lost_session != m_session.load() || m_reconnect_timer != 0)
+    {
+        return;
+    }
+
+    // A session that was in use is retried at once; one that never got there backs off
+    if (was_authenticated)
+    {
+        m_reconnect_backoff.Reset();
+    }
+    const std::chrono::milliseconds delay = m_reconnect_backoff.Next();
+    if (delay.count() == 0)
+    {
+        OpenSession();
+        return;
+    }
+    BinaryLogger::Write(LOG_RECONNECTING, delay.count());
+    m_reconnect_timer = drogon::app().getLoop()->runAfter(std::chrono::duration<double>(delay).count(),
+                                                          [this]()
+                                                          {
+                                                              m_reconnect_timer = 0;
+                                                              OpenSession();
+                                                          });
+}
+
+bool OrderGateway::IsReady() const noexcept
+{
+    return m_is_connected.load(std::memory_order_acquire) && m_is_authenticated.load(std::memory_order_acquire);
+}
+
+void OrderGateway::Authenticate()
+{
+    const bool is_refresh = !m_session_refresh_token.empty();
+    const uint64_t id = ClaimSlot(
+        [this, is_refresh](const bool success, const std::string& response)
+        {
+            Json::Value json_data;
+            std::string errs;
+            const bool parsed =
+                success && m_reader->parse(response.data(), response.data() + response.size(), &json_data, &errs);
+            const Json::Value& result = json_data["result"];
+            const std::string access_token = parsed ? result["access_token"].asString() : std::string();
+            const std::string refresh_token = parsed ? result["refresh_token"].asString() : std::string();
+            const int expires_in = parsed ? result["expires_in"].asInt() : 0;
+            if (access_token.empty() || refresh_token.empty() || expires_in <= 0)
+            {
+                m_session_refresh_token.clear();
+                if (is_refresh && m_is_connected)
+                {
+                    // The refresh token may have expired with the old session; the credentials still work
+                    BinaryLogger::Write(LOG_SESSION_REFRESH_FAILED);
+                    Authenticate();
+                    return;
+                }
+                BinaryLogger::Write(LOG_AUTH_FAILED);
+                return;
+            }
+
+            m_token_manager.UpdateTokens(access_token, refresh_token, expires_in);
+            m_session_refresh_token = refresh_token;
+            ScheduleSessionRefresh(expires_in);
+            m_is_authenticated = true;
+            BinaryLogger::Write(LOG_AUTHENTICATED);
+        });
+    if (id == 0)
+    {
+        return;
+    }
+
+    RequestEncoder& encoder = RequestEncoder::ThreadLocal();
+    encoder.BeginJsonRpc(Endpoints::AUTH, id);
+    if (is_refresh)
+    {
+        encoder.AddJsonParam("grant_type", "refresh_token");
+        encoder.AddJsonParam("refresh_token", m_session_refresh_token);
+    }
+    else
+    {
+        encoder.AddJsonParam("grant_type", "client_credentials");
+        encoder.AddJsonParam("client_id", m_api_credentials.GetApiKey());
+        encoder.AddJsonParam("client_secret", m_api_credentials.GetApiSecret());
+    }
+    encoder.EndJsonRpc();
+    Transmit(id, encoder);
+}
+
+// Function to authenticate the session again SESSION_REFRESH_AHEAD_S before its token runs out, or halfway
+// through a token shorter than that
+void OrderGateway::ScheduleSessionRefresh(const int expires_in)
+{
+    trantor::EventLoop* loop = GetLoop();
+    if (m_session_refresh_timer != 0)
+    {
+        loop->invalidateTimer(m_session_refresh_timer);
+    }
+
+    const int refresh_in = expires_in > 2 * SESSION_REFRESH_AHEAD_S ? expires_in - SESSION_REFRESH_AHEAD_S
+                                                                    : expires_in / 2;
+    const uint64_t session_id = m_session.load();
+    m_session_refresh_timer = loop->runAfter(static_cast<double>(refresh_in),
+                                             [this, session_id]()
+                                             {
+                                                 m_session_refresh_timer = 0;
+                                                 if (session_id == m_session.load() && IsReady())
+                                                 {
+                                                     Authenticate();
+                                                 }
+                                             });
+}
+
+uint32_t OrderGateway::PopFreeSlot() noexcept
+{
+    uint64_t top = m_free_top.load(std::memory_order_acquire);
+    while (true)
+    {
+        const uint32_t top_slot = static_cast<uint32_t>(top);
+        if (top_slot == NO_SLOT)
+        {
+            return NO_SLOT;
+        }
+        const uint64_t next = ((top >> 32) + 1) << 32 |
+                              m_in_flight[top_slot - 1].next_free.load(std::memory_order_relaxed);
+        if (m_free_top.compare_exchange_weak(top, next, std::memory_order_acq_rel, std::memory_order_acquire))
+        {
+            return top_slot;
+        }
+    }
+}
+
+void OrderGateway::PushFreeSlot(const uint32_t index) noexcept
+{
+    uint64_t top = m_free_top.load(std::memory_order_relaxed);
+    while (true)
+    {
+        m_in_flight[index].next_free.store(static_cast<uint32_t>(top), std::memory_order_relaxed);
+        const uint64_t pushed = ((top >> 32) + 1) << 32 | (index + 1);
+        if (m_free_top.compare_exchange_weak(top, pushed, std::memory_order_release, std::memory_order_relaxed))
+        {
+            return;
+        }
+    }
+}
+
+uint64_t OrderGateway::ClaimSlot(ResponseCallback callback)
+{
+    if (!m_is_connected)
+    {
+        return 0;
+    }
+
+    // Any free slot will do, so one reply that is slow to arrive holds up only its own slot
+    const uint32_t top_slot = PopFreeSlot();
+    if (top_slot == NO_SLOT)
+    {
+        return 0;
+    }
+    const uint32_t index = top_slot - 1;
+    const uint64_t id = m_next_id.fetch_add(1, std::memory_order_relaxed) * MAX_IN_FLIGHT + index;
+
+    InFlightSlot& slot = m_in_flight[index];
+    slot.callback = std::move(callback);
+    slot.sent_at = std::chrono::steady_clock::now();
+    slot.is_written.store(false, std::memory_order_relaxed);
+    slot.id.store(id, std::memory_order_release);
+    return id;
+}
+
+bool OrderGateway::TakeSlot(const uint64_t id, ResponseCallback& callback)
+{
+    const uint32_t index = static_cast<uint32_t>(id % MAX_IN_FLIGHT);
+    InFlightSlot& slot = m_in_flight[index];
+    uint64_t expected = id;
+    if (!slot.id.compare_exchange_strong(expected, SLOT_RESERVED, std::memory_order_acq_rel))
+    {
+        return false;
+    }
+
+    callback = std::move(slot.callback);
+    slot.callback = nullptr;
+    slot.id.store(0, std::memory_order_release);
+    PushFreeSlot(index);
+    return true;
+}
+
+void OrderGateway::ReleaseSlot(const uint64_t id)
+{
+    ResponseCallback callback;
+    TakeSlot(id, callback);
+}
+
+bool OrderGateway::Transmit(const uint64_t id, const RequestEncoder& encoder)
+{
+    if (!encoder.Ok())
+    {
+        BinaryLogger::Write(LOG_ENCODER_OVERFLOW);
+        ReleaseSlot(id);
+        return false;
+    }
+
+    try
+    {
+        const std::string_view msg = encoder.View();
+        const auto client = GetClient();
+        if (!client || !client->getConnection())
+        {
+            ReleaseSlot(id);
+            return false;
+        }
+        // Marked first, so a request that is failed while the send is under way is not reported as never sent
+        m_in_flight[id % MAX_IN_FLIGHT].is_written.store(true, std::memory_order_release);
+        client->getConnection()->send(msg.data(), msg.size());
+    }
+    catch (const std::exception& e)
+    {
+        BinaryLogger::Write(LOG_SEND_FAILED, e.what());
+        ReleaseSlot(id);
+        return false;
+    }
+    return true;
+}
+
+bool OrderGateway::PlaceOrder(const EndpointDescriptor& endpoint, const OrderParams& params,
+                              ResponseCallback callback)
+{
+    if (!IsReady())
+    {
+        return false;
+    }
+
+    const uint64_t id = ClaimSlot(std::move(callback));
+    if (id == 0)
+    {
+        return false;
+    }
+
+    RequestEncoder& encoder = RequestEncoder::ThreadLocal();
+    encoder.BeginJsonRpc(endpoint, id);
+    encoder.AddJsonParam("instrument_name", params.instrument_name);
+    encoder.AddJsonParam("amount", params.amount);
+    encoder.AddJsonParam("type", OrderExecution::GetOrderTypeName(params.type));
+    if (params.type == OrderType::LIMIT || params.type == OrderType::STOP_LIMIT)
+    {
+        encoder.AddJsonParam("price", params.price);
+    }
+    if (!params.label.empty())
+    {
+        encoder.AddJsonParam("label", params.label);
+    }
+    if (!params.time_in_force.empty())
+    {
+        encoder.AddJsonParam("time_in_force", params.time_in_force);
+    }
+    encoder.EndJsonRpc();
+    return Transmit(id, encoder);
+}
+
+bool OrderGateway::Buy(const OrderParams& params, ResponseCallback callback)
+{
+    return PlaceOrder(Endpoints::BUY, params, std::move(callback));
+}
+
+bool OrderGateway::Sell(const OrderParams& params, ResponseCallback callback)
+{
+    return PlaceOrder(Endpoints::SELL, params, std::move(callback));
+}
+
+bool OrderGateway::Place(const CompactOrder& order, const InstrumentInfo& instrument, ResponseCallback callback)
+{
+    if (!IsReady())
+    {
+        return false;
+    }
+
+    const uint64_t id = ClaimSlot(std::move(callback));
+    if (id == 0)
+    {
+        return false;
+    }
+
+    RequestEncoder& encoder = RequestEncoder::ThreadLocal();
+    encoder.BeginJsonRpc(order.is_buy ? Endpoints::BUY : Endpoints::SELL, id);
+    encoder.AddJsonParam("instrument_name", instrument.GetName());
+    encoder.AddJsonParam("amount", order.amount_lots, instrument.amount_scale);
+    encoder.AddJsonParam("type", OrderExecution::GetOrderTypeName(order.type));
+    if (order.HasPrice())
+    {
+        encoder.AddJsonParam("price", order.price_ticks, instrument.price_scale);
+    }
+    if (order.label_size != 0)
+    {
+        encoder.AddJsonParam("label", order.GetLabel());
+    }
+    if (order.time_in_force != TimeInForce::GOOD_TIL_CANCELLED)
+    {
+        encoder.AddJsonParam("time_in_force", GetTimeInForceName(order.time_in_force));
+    }
+    encoder.EndJsonRpc();
+    return Transmit(id, encoder);
+}
+
+bool OrderGateway::SendSimpleRequest(const EndpointDescriptor& endpoint, const std::string_view key,
+                                     const std::string_view value, ResponseCallback callback)
+{
+    if (!IsReady())
+    {
+        return false;
+    }
+
+    const uint64_t id = ClaimSlot(std::move(callback));
+    if (id == 0)
+    {
+        return false;
+    }
+
+    RequestEncoder& encoder = RequestEncoder::ThreadLocal();
+    encoder.BeginJsonRpc(endpoint, id);
+    encoder.AddJsonParam(key, value);
+    encoder.EndJsonRpc();
+    return Transmit(id, encoder);
+}
+
+bool OrderGateway::Cancel(const std::string& order_id, ResponseCallback callback)
+{
+    return SendSimpleRequest(Endpoints::CANCEL, "order_id", order_id, std::move(callback));
+}
+
+bool OrderGateway::CancelAllByInstrument(const std::string& instrument_name, ResponseCallback callback)
+{
+    return SendSimpleRequest(Endpoints::CANCEL_ALL_BY_INSTRUMENT, "instrument_name", instrument_name,
+                             std::move(callback));
+}
+
+bool OrderGateway::CancelByLabel(const std::string& label, ResponseCallback callback)
+{
+    return SendSimpleRequest(Endpoints::CANCEL_BY_LABEL, "label", label, std::move(callback));
+}
+
+bool OrderGateway::Edit(const std::string& order_id, const double new_amount, const double new_price,
+                        ResponseCallback callback)
+{
+    if (!IsReady())
+    {
+        return false;
+    }
+
+    const uint64_t id = ClaimSlot(std::move(callback));
+    if (id == 0)
+    {
+        return false;
+    }
+
+    RequestEncoder& encoder = RequestEncoder::ThreadLocal();
+    encoder.BeginJsonRpc(Endpoints::EDIT, id);
+    encoder.AddJsonParam("order_id", order_id);
+    encoder.AddJsonParam("amount", new_amount);
+    encoder.AddJsonParam("price", new_price);
+    encoder.EndJsonRpc();
+    return Transmit(id, encoder);
+}
+
+// Function to route a JSON-RPC reply to the request that is waiting for it
+void OrderGateway::HandleMessage(std::string&& msg)
+{
+    LatencyRecorder::MarkResponseReceived();
+
+    Json::Value json_data;
+    std::string errs;
+    if (!m_reader->parse(msg.data(), msg.data() + msg.size(), &json_data, &errs))
+    {
+        BinaryLogger::Write(LOG_PARSE_FAILED, errs);
+        return;
+    }
+
+    if (!json_data.isMember("id") || !json_data["id"].isUInt64())
+    {
+        return;
+    }
+
+    CompleteRequest(json_data["id"].asUInt64(), !json_data.isMember("error"), msg);
+}
+
+void OrderGateway::CompleteRequest(const uint64_t id, const bool success, const std::string& response)
+{
+    ResponseCallback callback;
+    if (!TakeSlot(id, callback))
+    {
+        return;
+    }
+
+    if (callback)
+    {
+        callback(success, response);
+    }
+}
+
+bool OrderGateway::FailRequest(const uint64_t id, const std::string& unsent_reason,
+                               const std::string& unknown_reason)
+{
+    // Read before the slot is taken, since a new request may claim it straight after
+    const bool is_written = m_in_flight[id % MAX_IN_FLIGHT].is_written.load(std::memory_order_acquire);
+    ResponseCallback callback;
+    if (!TakeSlot(id, callback))
+    {
+        return false;
+    }
+
+    if (callback)
+    {
+        callback(false, is_written ? unknown_reason : unsent_reason);
+    }
+    return is_written;
+}
+
+void OrderGateway::ReportOutcomeUnknown(const size_t count)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    BinaryLogger::Write(LOG_OUTCOME_UNKNOWN, count);
+    if (m_outcome_unknown_listener)
+    {
+        m_outcome_unknown_listener();
+    }
+}
+
+// Function to fail every request when the session closes. Only the ones that never reached the socket
+// certainly failed; the exchange may have accepted the rest, so the listener is told to find out.
+void OrderGateway::FailAllInFlight()
+{
+    size_t unknown = 0;
+    for (auto& slot : m_in_flight)
+    {
+        const uint64_t id = slot.id.load(std::memory_order_acquire);
+        if (id != 0 && id != SLOT_RESERVED && FailRequest(id, CONNECTION_CLOSED, CONNECTION_CLOSED_UNKNOWN))
+        {
+            ++unknown;
+        }
+    }
+    ReportOutcomeUnknown(unknown);
+}
+
+void OrderGateway::ExpireStaleRequests()
+{
+    const auto deadline = std::chrono::steady_clock::now() -
+                          std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                              std::chrono::duration<double>(REQUEST_TIMEOUT_SECONDS));
+    size_t unknown = 0;
+    for (auto& slot : m_in_flight)
+    {
+        const uint64_t id = slot.id.load(std::memory_order_acquire);
+        if (id != 0 && id != SLOT_RESERVED && slot.sent_at < deadline &&
+            FailRequest(id, TIMED_OUT, TIMED_OUT_UNKNOWN))
+        {
+            ++unknown;
+        }
+    }
+    ReportOutcomeUnknown(unknown);
+}
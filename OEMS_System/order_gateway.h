@@ -0,0 +1,142 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include <drogon/WebSocketClient.h>
+#include <json/json.h>
+
+#include "api_credentials.h"
+#include "compact_order.h"
+#include "reconnect_backoff.h"
+#include "request_encoder.h"
+#include "token_manager.h"
+
+struct OrderParams;
+
+// Sends order entry over one authenticated JSON-RPC WebSocket session and matches replies by id.
+//
+// A lost session is replaced and authenticated again, straight away and then with jittered backoff, from the Drogon
+// app loop. The session's token is refreshed on the session itself before it expires.
+class OrderGateway
+{
+  public:
+    using ResponseCallback = std::function<void(bool success, const std::string& response)>;
+    // Called after requests that were already written are failed without a reply, since the exchange may
+    // have acted on them
+    using OutcomeUnknownListener = std::function<void()>;
+
+    static constexpr size_t MAX_IN_FLIGHT = 256;
+
+  private:
+    static constexpr const char* WS_HOST = "wss://test.deribit.com";
+    static constexpr const char* WS_PATH = "/ws/api/v2";
+    static constexpr double REQUEST_TIMEOUT_SECONDS = 5.0;
+    static constexpr uint64_t SLOT_RESERVED = ~uint64_t{0};
+    static constexpr uint32_t NO_SLOT = 0;
+    static constexpr std::chrono::milliseconds RECONNECT_BACKOFF_MIN{100};
+    static constexpr std::chrono::milliseconds RECONNECT_BACKOFF_MAX{5000};
+    static constexpr int SESSION_REFRESH_AHEAD_S = 60;
+
+    struct InFlightSlot
+    {
+        std::atomic<uint64_t> id{0};
+        ResponseCallback callback;
+        std::chrono::steady_clock::time_point sent_at;
+        // Set once the request has been handed to the socket
+        std::atomic<bool> is_written{false};
+        // Index + 1 of the slot below this one on the free stack, NO_SLOT at the bottom
+        std::atomic<uint32_t> next_free{NO_SLOT};
+    };
+
+    // Replaced on every reconnect, so it is read and swapped under m_client_mutex
+    std::mutex m_client_mutex;
+    std::shared_ptr<drogon::WebSocketClient> m_ws_client;
+    trantor::EventLoop* m_loop;
+    TokenManager& m_token_manager;
+    ApiCredentials m_api_credentials;
+    std::atomic<bool> m_is_connected{false};
+    std::atomic<bool> m_is_authenticated{false};
+    std::atomic<bool> m_is_stopping{false};
+    // Callbacks from a client that has since been replaced carry an older session and are ignored
+    std::atomic<uint64_t> m_session{0};
+    std::atomic<uint64_t> m_next_id{1};
+    std::array<InFlightSlot, MAX_IN_FLIGHT> m_in_flight;
+    // Lock-free stack of free slots: index + 1 of the top in the low half, a tag against ABA in the high half
+    std::atomic<uint64_t> m_free_top{0};
+    std::unique_ptr<Json::CharReader> m_reader;
+    trantor::TimerId m_sweep_timer{0};
+    OutcomeUnknownListener m_outcome_unknown_listener;
+
+    // Only touched on the app loop
+    ReconnectBackoff m_reconnect_backoff{RECONNECT_BACKOFF_MIN, RECONNECT_BACKOFF_MAX};
+    trantor::TimerId m_reconnect_timer{0};
+
+    // Only touched on the client loop
+    std::string m_session_refresh_token;
+    trantor::TimerId m_session_refresh_timer{0};
+
+    bool PlaceOrder(const EndpointDescriptor& endpoint, const OrderParams& params, ResponseCallback callback);
+    // Sends a request whose only parameter is one string, as the cancel family does
+    bool SendSimpleRequest(const EndpointDescriptor& endpoint, std::string_view key, std::string_view value,
+                           ResponseCallback callback);
+
+    // Request ids carry the index of the slot they were given, so a reply finds its slot as id % MAX_IN_FLIGHT
+    uint32_t PopFreeSlot() noexcept;
+    void PushFreeSlot(uint32_t index) noexcept;
+    // Reserves a free in-flight slot and returns its request id, or 0 when all of them are busy
+    uint64_t ClaimSlot(ResponseCallback callback);
+    // Detaches the request from its slot and frees the slot; false if another path already did
+    bool TakeSlot(uint64_t id, ResponseCallback& callback);
+    void ReleaseSlot(uint64_t id);
+    // Sends the message held by the encoder; the slot is released if the send fails
+    bool Transmit(uint64_t id, const RequestEncoder& encoder);
+
+    std::shared_ptr<drogon::WebSocketClient> GetClient();
+    trantor::EventLoop* GetLoop() const;
+    void OpenSession();
+    void OnSessionLost(uint64_t lost_session, bool was_authenticated);
+    // Uses the session's refresh token when there is one, the API credentials otherwise
+    void Authenticate();
+    void ScheduleSessionRefresh(int expires_in);
+    void HandleMessage(std::string&& msg);
+    void CompleteRequest(uint64_t id, bool success, const std::string& response);
+    // Fails a request that will get no reply with one reason if it was never written and another if it was;
+    // true if it was written and this call failed it
+    bool FailRequest(uint64_t id, const std::string& unsent_reason, const std::string& unknown_reason);
+    void ReportOutcomeUnknown(size_t count);
+    void FailAllInFlight();
+    void ExpireStaleRequests();
+
+  public:
+    // Replies and timeouts are handled on loop, or on the Drogon app loop if none is given
+    explicit OrderGateway(TokenManager& token_manager, trantor::EventLoop* loop = nullptr);
+    ~OrderGateway();
+
+    OrderGateway(const OrderGateway&) = delete;
+    OrderGateway& operator=(const OrderGateway&) = delete;
+
+    // Must be set before Connect
+    void SetOutcomeUnknownListener(OutcomeUnknownListener listener);
+
+    // Opens the session and keeps it open, reconnecting whenever it is lost
+    void Connect();
+    bool IsReady() const noexcept;
+
+    // Each call returns false without sending if the session is down or the in-flight table is full
+    bool Buy(const OrderParams& params, ResponseCallback callback);
+    bool Sell(const OrderParams& params, ResponseCallback callback);
+    // Buy or sell by order.is_buy; instrument supplies the name and the tick and lot sizes
+    bool Place(const CompactOrder& order, const InstrumentInfo& instrument, ResponseCallback callback);
+    bool Cancel(const std::string& order_id, ResponseCallback callback);
+    bool CancelAllByInstrument(const std::string& instrument_name, ResponseCallback callback);
+    bool CancelByLabel(const std::string& label, ResponseCallback callback);
+    bool Edit(const std::string& order_id, double new_amount, double new_price, ResponseCallback callback);
+};
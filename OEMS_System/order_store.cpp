@@ -0,0 +1,648 @@
+#include "order_store.h"
+
+#include <algorithm>
+#include <charconv>
+#include <functional>
+#include <unordered_set>
+
+#include "binary_logger.h"
+#include "json_scanner.h"
+#include "web_socket_client.h"
+
+namespace {
+    const LogFormat LOG_MALFORMED_UPDATE{LogLevel::ERR, "[OrderStore] Malformed order update"};
+    const LogFormat LOG_MALFORMED_SNAPSHOT{LogLevel::ERR, "[OrderStore] Malformed open orders snapshot"};
+    const LogFormat LOG_DROPPED_CLOSED{LogLevel::INFO, "[OrderStore] Reconciliation dropped {} closed orders"};
+
+    // Acks for orders that closed just before a snapshot may still be in flight when it is applied
+    constexpr int64_t CLOSED_ORDER_RETENTION_MS = 60000;
+
+    void AppendNumber(std::string& out, const double value)
+    {
+        char buffer[32];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+
+    void AppendNumber(std::string& out, const int64_t value)
+    {
+        char buffer[24];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+
+    void AppendString(std::string& out, const std::string_view text)
+    {
+        out += '"';
+        for (const char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+            }
+            out += c;
+        }
+        out += '"';
+    }
+
+    const char* GetOrderStateName(const OrderState state)
+    {
+        switch (state)
+        {
+            case OrderState::UNTRIGGERED: return "untriggered";
+            case OrderState::FILLED: return "filled";
+            case OrderState::REJECTED: return "rejected";
+            case OrderState::CANCELLED: return "cancelled";
+            default: return "open";
+        }
+    }
+
+    size_t GetSideIndex(const TradeDirection direction)
+    {
+        return direction == TradeDirection::SELL ? 1 : 0;
+    }
+}
+
+OrderStore::SlotIndex::SlotIndex(std::string OrderUpdate::*key, const size_t capacity) : m_key(key)
+{
+    size_t size = 16;
+    while (size < capacity)
+    {
+        size *= 2;
+    }
+    m_entries.resize(size);
+}
+
+size_t OrderStore::SlotIndex::Hash(const std::string_view key) noexcept
+{
+    return std::hash<std::string_view>{}(key);
+}
+
+const OrderStore::SlotIndex::Entry* OrderStore::SlotIndex::Find(const std::string_view key, const size_t hash,
+                                                                 const std::vector<Record>& records) const
+{
+    // Never more than half full, so the probe always reaches an empty entry
+    const size_t mask = m_entries.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        const Entry& entry = m_entries[i];
+        if (entry.chain.head == NO_SLOT)
+        {
+            return nullptr;
+        }
+        if (entry.hash == hash && records[entry.chain.head].order.*m_key == key)
+        {
+            return &entry;
+        }
+    }
+}
+
+OrderStore::SlotIndex::Entry* OrderStore::SlotIndex::Find(const std::string_view key, const size_t hash,
+                                                           const std::vector<Record>& records)
+{
+    return const_cast<Entry*>(static_cast<const SlotIndex*>(this)->Find(key, hash, records));
+}
+
+OrderStore::SlotIndex::Entry& OrderStore::SlotIndex::FindOrInsert(const std::string_view key, const size_t hash,
+                                                                   const std::vector<Record>& records)
+{
+    if (Entry* entry = Find(key, hash, records))
+    {
+        return *entry;
+    }
+    if (2 * (m_size + 1) > m_entries.size())
+    {
+        Grow();
+    }
+
+    const size_t mask = m_entries.size() - 1;
+    size_t i = hash & mask;
+    while (m_entries[i].chain.head != NO_SLOT)
+    {
+        i = (i + 1) & mask;
+    }
+    // The caller links a record in straight away, which is what marks the entry as used
+    m_entries[i] = Entry{hash, {}};
+    ++m_size;
+    return m_entries[i];
+}
+
+void OrderStore::SlotIndex::Erase(Entry& entry)
+{
+    const size_t mask = m_entries.size() - 1;
+    size_t hole = static_cast<size_t>(&entry - m_entries.data());
+    for (size_t i = (hole + 1) & mask; m_entries[i].chain.head != NO_SLOT; i = (i + 1) & mask)
+    {
+        // An entry may move back into the hole only if the hole is not before its home position
+        const size_t home = m_entries[i].hash & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask))
+        {
+            m_entries[hole] = m_entries[i];
+            hole = i;
+        }
+    }
+    m_entries[hole] = Entry{};
+    --m_size;
+}
+
+void OrderStore::SlotIndex::Grow()
+{
+    std::vector<Entry> entries(m_entries.size() * 2);
+    const size_t mask = entries.size() - 1;
+    for (const Entry& entry : m_entries)
+    {
+        if (entry.chain.head == NO_SLOT)
+        {
+            continue;
+        }
+        size_t i = entry.hash & mask;
+        while (entries[i].chain.head != NO_SLOT)
+        {
+            i = (i + 1) & mask;
+        }
+        entries[i] = entry;
+    }
+    m_entries.swap(entries);
+}
+
+OrderStore::OrderStore(DrogonWebSocket& web_socket) : m_web_socket(web_socket)
+{
+    m_records.reserve(DEFAULT_RESERVED_ORDERS);
+    m_free_slots.reserve(DEFAULT_RESERVED_ORDERS);
+}
+
+void OrderStore::Start()
+{
+    m_web_socket.Subscribe({CHANNEL}, [this](std::string_view, const std::string_view data) { OnOrderMessage(data); });
+}
+
+void OrderStore::AddUpdateListener(UpdateListener listener)
+{
+    m_update_listeners.push_back(std::move(listener));
+}
+
+void OrderStore::NotifyListeners(const std::vector<const std::string*>& instruments) const
+{
+    if (m_update_listeners.empty())
+    {
+        return;
+    }
+    for (size_t i = 0; i < instruments.size(); ++i)
+    {
+        // Batches usually repeat one instrument, so only report each once
+        const auto is_same = [&instruments, i](const std::string* other) { return *other == *instruments[i]; };
+        if (std::none_of(instruments.begin(), instruments.begin() + static_cast<std::ptrdiff_t>(i), is_same))
+        {
+            for (const auto& listener : m_update_listeners)
+            {
+                listener(*instruments[i]);
+            }
+        }
+    }
+}
+
+bool OrderStore::IsSynced() const noexcept
+{
+    return m_is_synced.load(std::memory_order_acquire);
+}
+
+uint64_t OrderStore::GetUpdateCount() const noexcept
+{
+    return m_update_count.load(std::memory_order_relaxed);
+}
+
+// Function to apply one notification from the order stream
+void OrderStore::OnOrderMessage(const std::string_view data)
+{
+    if (!MarketDataDecoder::DecodeOrders(data, m_scratch_orders))
+    {
+        BinaryLogger::Write(LOG_MALFORMED_UPDATE);
+        return;
+    }
+
+    // Points into m_scratch_orders, which nothing else touches until the next message
+    m_scratch_changed.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const OrderUpdate& order : m_scratch_orders)
+        {
+            if (ApplyLocked(order))
+            {
+                m_scratch_changed.push_back(&order.instrument_name);
+            }
+        }
+    }
+    NotifyListeners(m_scratch_changed);
+}
+
+void OrderStore::Apply(const OrderUpdate& order)
+{
+    bool is_changed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        is_changed = ApplyLocked(order);
+    }
+    if (!is_changed)
+    {
+        return;
+    }
+    for (const auto& listener : m_update_listeners)
+    {
+        listener(order.instrument_name);
+    }
+}
+
+bool OrderStore::ApplyResponse(const std::string_view response)
+{
+    std::string_view result;
+    if (!JsonScanner::FindMember(response, "result", result))
+    {
+        return false;
+    }
+
+    // buy, sell and edit nest the order under "order"; cancel returns it directly
+    std::string_view order_object;
+    if (!JsonScanner::FindMember(result, "order", order_object))
+    {
+        order_object = result;
+    }
+
+    OrderUpdate order;
+    if (!MarketDataDecoder::DecodeOrder(order_object, order))
+    {
+        return false;
+    }
+
+    Apply(order);
+    return true;
+}
+
+bool OrderStore::Reconcile(const std::string_view response, const int64_t requested_at_ms)
+{
+    std::string_view result;
+    std::vector<OrderUpdate> orders;
+    if (!JsonScanner::FindMember(response, "result", result) || !MarketDataDecoder::DecodeOrders(result, orders))
+    {
+        BinaryLogger::Write(LOG_MALFORMED_SNAPSHOT);
+        return false;
+    }
+
+    std::unordered_set<std::string_view> present;
+    present.reserve(orders.size());
+    for (const OrderUpdate& order : orders)
+    {
+        present.insert(order.order_id);
+    }
+
+    std::vector<const std::string*> changed;
+    std::vector<std::string> dropped_instruments;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const OrderUpdate& order : orders)
+        {
+            if (ApplyLocked(order))
+            {
+                changed.push_back(&order.instrument_name);
+            }
+        }
+
+        for (uint32_t slot = 0; slot < m_records.size(); ++slot)
+        {
+            const Record& record = m_records[slot];
+            if (record.order.order_id.empty())
+            {
+                continue;
+            }
+            if (record.is_open)
+            {
+                if (present.count(record.order.order_id) == 0 &&
+                    record.order.last_update_timestamp_ms < requested_at_ms)
+                {
+                    dropped_instruments.push_back(record.order.instrument_name);
+                    CloseLocked(slot);
+                }
+            }
+            else if (record.order.last_update_timestamp_ms < requested_at_ms - CLOSED_ORDER_RETENTION_MS)
+            {
+                RetireLocked(slot);
+            }
+        }
+    }
+
+    if (!dropped_instruments.empty())
+    {
+        BinaryLogger::Write(LOG_DROPPED_CLOSED, dropped_instruments.size());
+    }
+    for (const std::string& instrument_name : dropped_instruments)
+    {
+        changed.push_back(&instrument_name);
+    }
+    m_is_synced.store(true, std::memory_order_release);
+    NotifyListeners(changed);
+    return true;
+}
+
+bool OrderStore::ApplyLocked(const OrderUpdate& order)
+{
+    if (order.order_id.empty())
+    {
+        return false;
+    }
+    m_update_count.fetch_add(1, std::memory_order_relaxed);
+
+    const size_t hash = SlotIndex::Hash(order.order_id);
+    const SlotIndex::Entry* entry = m_by_order_id.Find(order.order_id, hash, m_records);
+    if (!entry)
+    {
+        InsertLocked(order, hash);
+        return order.IsOpen();
+    }
+
+    const uint32_t slot = entry->chain.head;
+    Record& record = m_records[slot];
+    if (!record.is_open)
+    {
+        // A closed order only comes back with an update newer than the one that closed it
+        if (order.last_update_timestamp_ms <= record.order.last_update_timestamp_ms)
+        {
+            return false;
+        }
+        record.order = order;
+        if (!order.IsOpen())
+        {
+            return false;
+        }
+        OpenLocked(slot);
+        return true;
+    }
+
+    if (order.last_update_timestamp_ms < record.order.last_update_timestamp_ms)
+    {
+        return false;
+    }
+    if (!order.IsOpen())
+    {
+        // Unchained under the old contents, whose label and instrument the chains were found by
+        CloseLocked(slot);
+        record.order = order;
+        return true;
+    }
+
+    // Label, instrument and side never change for an order, so the chains stay valid
+    record.order = order;
+    return true;
+}
+
+// Function to take a pooled record for an order seen for the first time; closed orders are kept too, so a
+// late ack cannot bring them back
+void OrderStore::InsertLocked(const OrderUpdate& order, const size_t hash)
+{
+    uint32_t slot;
+    if (!m_free_slots.empty())
+    {
+        slot = m_free_slots.back();
+        m_free_slots.pop_back();
+    }
+    else
+    {
+        slot = static_cast<uint32_t>(m_records.size());
+        m_records.emplace_back();
+    }
+
+    // Assigning keeps the strings' capacity from the order that last held the slot
+    m_records[slot].order = order;
+    m_records[slot].is_open = false;
+    m_by_order_id.FindOrInsert(order.order_id, hash, m_records).chain = {slot, 1};
+    if (order.IsOpen())
+    {
+        OpenLocked(slot);
+    }
+}
+
+void OrderStore::AddToChain(Chain& chain, Link Record::*link, const uint32_t slot)
+{
+    Link& record_link = m_records[slot].*link;
+    record_link.prev = NO_SLOT;
+    record_link.next = chain.head;
+    if (chain.head != NO_SLOT)
+    {
+        (m_records[chain.head].*link).prev = slot;
+    }
+    chain.head = slot;
+    ++chain.count;
+}
+
+void OrderStore::RemoveFromChain(Chain& chain, Link Record::*link, const uint32_t slot)
+{
+    Link& record_link = m_records[slot].*link;
+    if (record_link.prev != NO_SLOT)
+    {
+        (m_records[record_link.prev].*link).next = record_link.next;
+    }
+    else
+    {
+        chain.head = record_link.next;
+    }
+    if (record_link.next != NO_SLOT)
+    {
+        (m_records[record_link.next].*link).prev = record_link.prev;
+    }
+    record_link = Link{};
+    --chain.count;
+}
+
+void OrderStore::OpenLocked(const uint32_t slot)
+{
+    const OrderUpdate& order = m_records[slot].order;
+    m_records[slot].is_open = true;
+    ++m_open_count;
+
+    if (!order.label.empty())
+    {
+        AddToChain(m_by_label.FindOrInsert(order.label, SlotIndex::Hash(order.label), m_records).chain,
+                   &Record::label_link, slot);
+    }
+    AddToChain(m_by_instrument.FindOrInsert(order.instrument_name, SlotIndex::Hash(order.instrument_name),
+                                            m_records).chain,
+               &Record::instrument_link, slot);
+    AddToChain(m_by_side[GetSideIndex(order.direction)], &Record::side_link, slot);
+}
+
+void OrderStore::CloseLocked(const uint32_t slot)
+{
+    const OrderUpdate& order = m_records[slot].order;
+    if (!m_records[slot].is_open)
+    {
+        return;
+    }
+    m_records[slot].is_open = false;
+    --m_open_count;
+
+    // Labels are often unique per order, so empty entries are dropped rather than kept around
+    if (!order.label.empty())
+    {
+        SlotIndex::Entry* label = m_by_label.Find(order.label, SlotIndex::Hash(order.label), m_records);
+        if (label)
+        {
+            RemoveFromChain(label->chain, &Record::label_link, slot);
+            if (label->chain.count == 0)
+            {
+                m_by_label.Erase(*label);
+            }
+        }
+    }
+
+    SlotIndex::Entry* instrument =
+        m_by_instrument.Find(order.instrument_name, SlotIndex::Hash(order.instrument_name), m_records);
+    if (instrument)
+    {
+        RemoveFromChain(instrument->chain, &Record::instrument_link, slot);
+        if (instrument->chain.count == 0)
+        {
+            m_by_instrument.Erase(*instrument);
+        }
+    }
+    RemoveFromChain(m_by_side[GetSideIndex(order.direction)], &Record::side_link, slot);
+}
+
+// Function to forget an order entirely and return its record to the pool
+void OrderStore::RetireLocked(const uint32_t slot)
+{
+    CloseLocked(slot);
+
+    OrderUpdate& order = m_records[slot].order;
+    SlotIndex::Entry* entry = m_by_order_id.Find(order.order_id, SlotIndex::Hash(order.order_id), m_records);
+    if (entry)
+    {
+        m_by_order_id.Erase(*entry);
+    }
+
+    // Clearing keeps the strings' capacity for the next order that takes the slot
+    order.Clear();
+    m_free_slots.push_back(slot);
+}
+
+size_t OrderStore::CollectLocked(const Chain& chain, Link Record::*link, std::vector<OrderUpdate>& out) const
+{
+    out.resize(chain.count);
+    size_t i = 0;
+    for (uint32_t slot = chain.head; slot != NO_SLOT; slot = (m_records[slot].*link).next)
+    {
+        out[i++] = m_records[slot].order;
+    }
+    return out.size();
+}
+
+bool OrderStore::FindByOrderId(const std::string& order_id, OrderUpdate& out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const SlotIndex::Entry* entry = m_by_order_id.Find(order_id, SlotIndex::Hash(order_id), m_records);
+    if (!entry || !m_records[entry->chain.head].is_open)
+    {
+        return false;
+    }
+    out = m_records[entry->chain.head].order;
+    return true;
+}
+
+size_t OrderStore::GetByLabel(const std::string& label, std::vector<OrderUpdate>& out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const SlotIndex::Entry* entry = m_by_label.Find(label, SlotIndex::Hash(label), m_records);
+    if (!entry)
+    {
+        out.clear();
+        return 0;
+    }
+    return CollectLocked(entry->chain, &Record::label_link, out);
+}
+
+size_t OrderStore::GetByInstrument(const std::string& instrument_name, std::vector<OrderUpdate>& out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const SlotIndex::Entry* entry =
+        m_by_instrument.Find(instrument_name, SlotIndex::Hash(instrument_name), m_records);
+    if (!entry)
+    {
+        out.clear();
+        return 0;
+    }
+    return CollectLocked(entry->chain, &Record::instrument_link, out);
+}
+
+size_t OrderStore::GetBySide(const TradeDirection direction, std::vector<OrderUpdate>& out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return CollectLocked(m_by_side[GetSideIndex(direction)], &Record::side_link, out);
+}
+
+size_t OrderStore::GetAll(std::vector<OrderUpdate>& out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out.clear();
+    out.reserve(m_open_count);
+    for (const Record& record : m_records)
+    {
+        if (record.is_open)
+        {
+            out.push_back(record.order);
+        }
+    }
+    return out.size();
+}
+
+size_t OrderStore::GetOpenOrderCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_open_count;
+}
+
+size_t OrderStore::GetOpenOrderCount(const std::string& instrument_name) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const SlotIndex::Entry* entry =
+        m_by_instrument.Find(instrument_name, SlotIndex::Hash(instrument_name), m_records);
+    return entry ? entry->chain.count : 0;
+}
+
+void OrderStore::SerializeTo(std::string& out) const
+{
+    out.clear();
+    out += "{\"result\":[";
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    bool is_first = true;
+    for (const Record& record : m_records)
+    {
+        if (!record.is_open)
+        {
+            continue;
+        }
+        const OrderUpdate& order = record.order;
+        out += is_first ? "{\"order_id\":" : ",{\"order_id\":";
+        is_first = false;
+        AppendString(out, order.order_id);
+        out += ",\"label\":";
+        AppendString(out, order.label);
+        out += ",\"instrument_name\":";
+        AppendString(out, order.instrument_name);
+        out += ",\"direction\":\"";
+        out += order.direction == TradeDirection::SELL ? "sell" : "buy";
+        out += "\",\"order_state\":\"";
+        out += GetOrderStateName(order.state);
+        out += "\",\"price\":";
+        AppendNumber(out, order.price);
+        out += ",\"amount\":";
+        AppendNumber(out, order.amount);
+        out += ",\"filled_amount\":";
+        AppendNumber(out, order.filled_amount);
+        out += ",\"average_price\":";
+        AppendNumber(out, order.average_price);
+        out += ",\"creation_timestamp\":";
+        AppendNumber(out, order.creation_timestamp_ms);
+        out += ",\"last_update_timestamp\":";
+        AppendNumber(out, order.last_update_timestamp_ms);
+        out += '}';
+    }
+    out += "]}";
+}
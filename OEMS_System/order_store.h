@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "market_data_decoder.h"
+
+class DrogonWebSocket;
+
+// Our working orders, kept in memory so open-order queries never go to the exchange.
+//
+// Records live in one pooled array and are recycled through a free list. Order ids, labels and instruments
+// are found through open-addressing tables that hold only a hash and a slot, reading the key back from the
+// record, and the records sharing a label, instrument or side are chained through links kept in the records
+// themselves. A lookup by id is O(1), the other queries are O(k) in their result size, and applying an update
+// allocates nothing once the pool and tables have grown to the working set. Closed orders keep their record,
+// out of every chain, until reconciliation retires them.
+// The store follows user.orders.any.any.raw and the replies to our own order-entry requests, and is
+// reconciled against private/get_open_orders periodically. Updates older than what is already held are
+// ignored, so a late ack cannot undo a newer stream update or bring a closed order back.
+class OrderStore
+{
+  public:
+    // Invoked after the open orders of an instrument may have changed, outside the store lock
+    using UpdateListener = std::function<void(const std::string& instrument_name)>;
+
+    static constexpr const char* CHANNEL = "user.orders.any.any.raw";
+    static constexpr size_t DEFAULT_RESERVED_ORDERS = 1024;
+
+  private:
+    static constexpr uint32_t NO_SLOT = ~uint32_t{0};
+
+    struct Link
+    {
+        uint32_t prev{NO_SLOT};
+        uint32_t next{NO_SLOT};
+    };
+
+    struct Chain
+    {
+        uint32_t head{NO_SLOT};
+        uint32_t count{0};
+    };
+
+    struct Record
+    {
+        OrderUpdate order;
+        bool is_open{false};
+        Link label_link;
+        Link instrument_link;
+        Link side_link;
+    };
+
+    // Maps the key held in a record's order to the chain of records sharing it. Linear probing, kept at most
+    // half full, with backward-shift deletion so lookups never wade through tombstones.
+    class SlotIndex
+    {
+      public:
+        struct Entry
+        {
+            size_t hash{0};
+            Chain chain;  // Empty entries have no head
+        };
+
+        SlotIndex(std::string OrderUpdate::*key, size_t capacity);
+
+        static size_t Hash(std::string_view key) noexcept;
+
+        const Entry* Find(std::string_view key, size_t hash, const std::vector<Record>& records) const;
+        Entry* Find(std::string_view key, size_t hash, const std::vector<Record>& records);
+        // Returns an entry with an empty chain when the key is new; entries move when the table grows
+        Entry& FindOrInsert(std::string_view key, size_t hash, const std::vector<Record>& records);
+        void Erase(Entry& entry);
+
+      private:
+        std::string OrderUpdate::*m_key;
+        std::vector<Entry> m_entries;
+        size_t m_size{0};
+
+        void Grow();
+    };
+
+    DrogonWebSocket& m_web_socket;
+    mutable std::mutex m_mutex;
+    std::vector<Record> m_records;
+    std::vector<uint32_t> m_free_slots;
+    // Open and recently closed orders; closed ones stay until a snapshot makes them irrelevant
+    SlotIndex m_by_order_id{&OrderUpdate::order_id, 2 * DEFAULT_RESERVED_ORDERS};
+    SlotIndex m_by_label{&OrderUpdate::label, 2 * DEFAULT_RESERVED_ORDERS};
+    SlotIndex m_by_instrument{&OrderUpdate::instrument_name, 64};
+    Chain m_by_side[2];
+    size_t m_open_count{0};
+    std::atomic<bool> m_is_synced{false};
+    std::atomic<uint64_t> m_update_count{0};
+    std::vector<UpdateListener> m_update_listeners;
+
+    // Only touched on the market-data thread
+    std::vector<OrderUpdate> m_scratch_orders;
+    std::vector<const std::string*> m_scratch_changed;
+
+    void AddToChain(Chain& chain, Link Record::*link, uint32_t slot);
+    void RemoveFromChain(Chain& chain, Link Record::*link, uint32_t slot);
+
+    void OnOrderMessage(std::string_view data);
+    void NotifyListeners(const std::vector<const std::string*>& instruments) const;
+    // Returns true if the update changed the open orders
+    bool ApplyLocked(const OrderUpdate& order);
+    void InsertLocked(const OrderUpdate& order, size_t hash);
+    void OpenLocked(uint32_t slot);
+    void CloseLocked(uint32_t slot);
+    void RetireLocked(uint32_t slot);
+    size_t CollectLocked(const Chain& chain, Link Record::*link, std::vector<OrderUpdate>& out) const;
+
+  public:
+    explicit OrderStore(DrogonWebSocket& web_socket);
+
+    OrderStore(const OrderStore&) = delete;
+    OrderStore& operator=(const OrderStore&) = delete;
+
+    // Subscribes the order stream; the connection must carry credentials
+    void Start();
+
+    // Listeners must be added before Start
+    void AddUpdateListener(UpdateListener listener);
+
+    void Apply(const OrderUpdate& order);
+
+    // Applies the order carried by a buy/sell/edit/cancel reply; false if it carries none
+    bool ApplyResponse(std::string_view response);
+
+    // Applies a private/get_open_orders reply. Orders not in it that have not changed since
+    // requested_at_ms were closed while we were not looking and are dropped.
+    bool Reconcile(std::string_view response, int64_t requested_at_ms);
+
+    // True once the first reconciliation has succeeded
+    bool IsSynced() const noexcept;
+    uint64_t GetUpdateCount() const noexcept;
+
+    bool FindByOrderId(const std::string& order_id, OrderUpdate& out) const;
+
+    // Each replaces out with the matching open orders and returns how many there are
+    size_t GetByLabel(const std::string& label, std::vector<OrderUpdate>& out) const;
+    size_t GetByInstrument(const std::string& instrument_name, std::vector<OrderUpdate>& out) const;
+    size_t GetBySide(TradeDirection direction, std::vector<OrderUpdate>& out) const;
+    size_t GetAll(std::vector<OrderUpdate>& out) const;
+
+    size_t GetOpenOrderCount() const;
+    size_t GetOpenOrderCount(const std::string& instrument_name) const;
+
+    // Writes the open orders in the same shape as private/get_open_orders
+    void SerializeTo(std::string& out) const;
+};
@@ -0,0 +1,469 @@
+#include "position_engine.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+#include "binary_logger.h"
+#include "json_scanner.h"
+#include "web_socket_client.h"
+
+namespace {
+    const LogFormat LOG_MALFORMED_TRADES{LogLevel::ERR, "[PositionEngine] Malformed trades update"};
+    const LogFormat LOG_MALFORMED_SNAPSHOT{LogLevel::ERR, "[PositionEngine] Malformed positions snapshot"};
+
+    // Sizes below this are treated as flat, absorbing rounding from repeated partial fills
+    constexpr double FLAT_SIZE = 1e-9;
+
+    void AppendNumber(std::string& out, const double value)
+    {
+        char buffer[32];
+        const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, result.ptr);
+    }
+
+    const char* GetKindName(const ContractKind kind)
+    {
+        return kind == ContractKind::OPTION ? "option" : "future";
+    }
+}
+
+PositionEngine::PositionEngine(DrogonWebSocket& web_socket, TickerFeed& ticker_feed)
+    : m_web_socket(web_socket), m_ticker_feed(ticker_feed),
+      m_ticker_consumer(ticker_feed.AddConsumer(ConflationPolicy::Every(MARK_PRICE_INTERVAL),
+                                                [this](const TickerUpdate& ticker) { OnTicker(ticker); }))
+{
+}
+
+// Function to classify an instrument from its name: "_USDC"/"_USDT" marks a linear contract and a strike
+// plus C/P suffix marks an option
+ContractKind PositionEngine::GetContractKind(const std::string_view instrument_name) noexcept
+{
+    if (instrument_name.find('_') != std::string_view::npos)
+    {
+        return ContractKind::LINEAR;
+    }
+    return std::count(instrument_name.begin(), instrument_name.end(), '-') >= 3 ? ContractKind::OPTION
+                                                                                : ContractKind::INVERSE;
+}
+
+std::string PositionEngine::GetSettlementCurrency(const std::string_view instrument_name)
+{
+    const size_t base_end = instrument_name.find_first_of("-_");
+    if (base_end != std::string_view::npos && instrument_name[base_end] == '_')
+    {
+        // BTC_USDC-PERPETUAL settles in USDC
+        const size_t quote_end = instrument_name.find('-', base_end);
+        return std::string(instrument_name.substr(base_end + 1, quote_end == std::string_view::npos
+                                                                    ? std::string_view::npos
+                                                                    : quote_end - base_end - 1));
+    }
+    return std::string(instrument_name.substr(0, base_end));
+}
+
+// Function to value size contracts moved from entry_price to exit_price, in the settlement currency
+double PositionEngine::ComputePnl(const ContractKind kind, const double size, const double entry_price,
+                                  const double exit_price) noexcept
+{
+    if (entry_price <= 0 || exit_price <= 0)
+    {
+        return 0;
+    }
+    if (kind == ContractKind::INVERSE)
+    {
+        return size * (1.0 / entry_price - 1.0 / exit_price);
+    }
+    return size * (exit_price - entry_price);
+}
+
+PositionSnapshot PositionEngine::MakeSnapshot(const Position& position)
+{
+    const double mark_price = position.mark_price > 0 ? position.mark_price : position.average_price;
+    const double floating_pnl = ComputePnl(position.kind, position.size, position.average_price, mark_price);
+    return {position.instrument_name,
+            position.currency,
+            position.kind,
+            position.size,
+            position.average_price,
+            position.mark_price,
+            position.realized_pnl,
+            floating_pnl,
+            position.realized_pnl + floating_pnl};
+}
+
+void PositionEngine::Start()
+{
+    m_web_socket.Subscribe({CHANNEL}, [this](std::string_view, const std::string_view data) { OnTradesMessage(data); });
+}
+
+void PositionEngine::Track(const std::string& instrument_name)
+{
+    bool is_new = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        FindOrAddLocked(instrument_name, is_new);
+    }
+    if (is_new)
+    {
+        SubscribeMarkPrices({instrument_name});
+    }
+}
+
+void PositionEngine::AddUpdateListener(UpdateListener listener)
+{
+    m_update_listeners.push_back(std::move(listener));
+}
+
+PositionEngine::Position& PositionEngine::FindOrAddLocked(const std::string& instrument_name, bool& is_new)
+{
+    const auto [it, inserted] = m_positions.try_emplace(instrument_name);
+    is_new = inserted;
+    if (inserted)
+    {
+        Position& position = it->second;
+        position.instrument_name = instrument_name;
+        position.currency = GetSettlementCurrency(instrument_name);
+        position.kind = GetContractKind(instrument_name);
+        m_by_currency[position.currency].push_back(&position);
+    }
+    return it->second;
+}
+
+void PositionEngine::SubscribeMarkPrices(const std::vector<std::string>& instruments)
+{
+    if (instruments.empty())
+    {
+        return;
+    }
+
+    m_ticker_feed.Track(m_ticker_consumer, instruments);
+}
+
+void PositionEngine::OnTradesMessage(const std::string_view data)
+{
+    if (!MarketDataDecoder::DecodeTrades(data, m_scratch_trades))
+    {
+        BinaryLogger::Write(LOG_MALFORMED_TRADES);
+        return;
+    }
+    for (const TradeUpdate& trade : m_scratch_trades)
+    {
+        ApplyFill(trade);
+    }
+}
+
+void PositionEngine::OnTicker(const TickerUpdate& ticker)
+{
+    if (ticker.mark_price > 0)
+    {
+        ApplyMarkPrice(ticker.instrument_name, ticker.mark_price);
+    }
+}
+
+// Function to move a position by one of our fills
+void PositionEngine::ApplyFill(const TradeUpdate& trade)
+{
+    if (trade.instrument_name.empty() || trade.amount <= 0 || trade.price <= 0)
+    {
+        return;
+    }
+
+    bool is_new = false;
+    PositionSnapshot snapshot;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Position& position = FindOrAddLocked(trade.instrument_name, is_new);
+
+        // Fills replayed after a resubscribe carry a trade_seq we have already applied
+        if (trade.trade_seq != 0 && trade.trade_seq <= position.last_trade_seq)
+        {
+            return;
+        }
+        position.last_trade_seq = std::max(position.last_trade_seq, trade.trade_seq);
+
+        const double quantity = trade.direction == TradeDirection::BUY ? trade.amount : -trade.amount;
+        if (position.size == 0 || (position.size > 0) == (quantity > 0))
+        {
+            // Adding to the position: inverse contracts average entry harmonically, by USD notional
+            const double size = position.size + quantity;
+            if (position.size == 0)
+            {
+                position.average_price = trade.price;
+            }
+            else if (position.kind == ContractKind::INVERSE)
+            {
+                position.average_price = size / (position.size / position.average_price + quantity / trade.price);
+            }
+            else
+            {
+                position.average_price = (position.size * position.average_price + quantity * trade.price) / size;
+            }
+            position.size = size;
+        }
+        else
+        {
+            // Reducing: the overlapping part realizes PnL, any remainder opens the other way at the fill
+            const double closed = std::copysign(std::min(std::abs(quantity), std::abs(position.size)), position.size);
+            position.realized_pnl += ComputePnl(position.kind, closed, position.average_price, trade.price);
+            const bool flips = std::abs(quantity) > std::abs(position.size);
+            position.size += quantity;
+            if (flips)
+            {
+                position.average_price = trade.price;
+            }
+        }
+
+        if (std::abs(position.size) < FLAT_SIZE)
+        {
+            position.size = 0;
+            position.average_price = 0;
+        }
+        position.realized_pnl -= trade.fee;
+        if (trade.mark_price > 0)
+        {
+            position.mark_price = trade.mark_price;
+        }
+        if (!m_update_listeners.empty())
+        {
+            snapshot = MakeSnapshot(position);
+        }
+    }
+
+    if (is_new)
+    {
+        SubscribeMarkPrices({trade.instrument_name});
+    }
+    for (const auto& listener : m_update_listeners)
+    {
+        listener(snapshot);
+    }
+}
+
+void PositionEngine::ApplyMarkPrice(const std::string& instrument_name, const double mark_price)
+{
+    PositionSnapshot snapshot;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto it = m_positions.find(instrument_name);
+        if (it == m_positions.end())
+        {
+            return;
+        }
+        it->second.mark_price = mark_price;
+        if (m_update_listeners.empty())
+        {
+            return;
+        }
+        snapshot = MakeSnapshot(it->second);
+    }
+    for (const auto& listener : m_update_listeners)
+    {
+        listener(snapshot);
+    }
+}
+
+// Function to take the exchange's view of one currency; fills that land while the request is in flight
+// may be counted twice or not at all until the next reconciliation
+bool PositionEngine::Reconcile(const std::string& currency, const std::string_view response)
+{
+    std::string_view result;
+    if (!JsonScanner::FindMember(response, "result", result))
+    {
+        BinaryLogger::Write(LOG_MALFORMED_SNAPSHOT);
+        return false;
+    }
+
+    std::vector<std::string> new_instruments;
+    std::vector<PositionSnapshot> changed;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::unordered_set<Position*> reported;
+
+        const bool parsed = JsonScanner::ForEachElement(
+            result,
+            [&](const std::string_view element)
+            {
+                std::string instrument_name;
+                double size = 0;
+                double average_price = 0;
+                double realized_pnl = 0;
+                double mark_price = 0;
+                JsonScanner::ForEachMember(element,
+                                           [&](const std::string_view key, const std::string_view value)
+                                           {
+                                               if (key == "instrument_name")
+                                               {
+                                                   instrument_name.assign(JsonScanner::ToStringView(value));
+                                               }
+                                               else if (key == "size")
+                                               {
+                                                   JsonScanner::ToDouble(value, size);
+                                               }
+                                               else if (key == "average_price")
+                                               {
+                                                   JsonScanner::ToDouble(value, average_price);
+                                               }
+                                               else if (key == "realized_profit_loss")
+                                               {
+                                                   JsonScanner::ToDouble(value, realized_pnl);
+                                               }
+                                               else if (key == "mark_price")
+                                               {
+                                                   JsonScanner::ToDouble(value, mark_price);
+                                               }
+                                               return true;
+                                           });
+                if (instrument_name.empty())
+                {
+                    return true;
+                }
+
+                bool is_new = false;
+                Position& position = FindOrAddLocked(instrument_name, is_new);
+                position.size = size;
+                position.average_price = size == 0 ? 0 : average_price;
+                position.realized_pnl = realized_pnl;
+                if (mark_price > 0)
+                {
+                    position.mark_price = mark_price;
+                }
+                reported.insert(&position);
+                if (is_new)
+                {
+                    new_instruments.push_back(instrument_name);
+                }
+                return true;
+            });
+        if (!parsed)
+        {
+            BinaryLogger::Write(LOG_MALFORMED_SNAPSHOT);
+            return false;
+        }
+
+        // Anything we hold in this currency that the exchange did not report is flat
+        const auto it = m_by_currency.find(currency);
+        if (it != m_by_currency.end())
+        {
+            for (Position* position : it->second)
+            {
+                if (reported.count(position) == 0)
+                {
+                    position->size = 0;
+                    position->average_price = 0;
+                }
+                if (!m_update_listeners.empty())
+                {
+                    changed.push_back(MakeSnapshot(*position));
+                }
+            }
+        }
+        m_synced_currencies.insert(currency);
+    }
+
+    SubscribeMarkPrices(new_instruments);
+    for (const PositionSnapshot& snapshot : changed)
+    {
+        for (const auto& listener : m_update_listeners)
+        {
+            listener(snapshot);
+        }
+    }
+    return true;
+}
+
+bool PositionEngine::IsSynced(const std::string& currency) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_synced_currencies.count(currency) != 0;
+}
+
+bool PositionEngine::GetPosition(const std::string& instrument_name, PositionSnapshot& out) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_positions.find(instrument_name);
+    if (it == m_positions.end())
+    {
+        return false;
+    }
+    out = MakeSnapshot(it->second);
+    return true;
+}
+
+size_t PositionEngine::GetPositions(const std::string& currency, std::vector<PositionSnapshot>& out) const
+{
+    out.clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_by_currency.find(currency);
+    if (it == m_by_currency.end())
+    {
+        return 0;
+    }
+    for (const Position* position : it->second)
+    {
+        if (position->size != 0)
+        {
+            out.push_back(MakeSnapshot(*position));
+        }
+    }
+    return out.size();
+}
+
+CurrencyExposure PositionEngine::GetCurrencyExposure(const std::string& currency) const
+{
+    CurrencyExposure exposure{};
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_by_currency.find(currency);
+    if (it == m_by_currency.end())
+    {
+        return exposure;
+    }
+
+    for (const Position* position : it->second)
+    {
+        const PositionSnapshot snapshot = MakeSnapshot(*position);
+        exposure.open_positions += snapshot.size != 0 ? 1 : 0;
+        exposure.realized_pnl += snapshot.realized_pnl;
+        exposure.floating_pnl += snapshot.floating_pnl;
+    }
+    exposure.total_pnl = exposure.realized_pnl + exposure.floating_pnl;
+    return exposure;
+}
+
+void PositionEngine::SerializeTo(std::string& out, const std::string& currency, const std::string_view kind) const
+{
+    std::vector<PositionSnapshot> positions;
+    GetPositions(currency, positions);
+
+    out.clear();
+    out += "{\"result\":[";
+    bool is_first = true;
+    for (const PositionSnapshot& position : positions)
+    {
+        if (!kind.empty() && kind != GetKindName(position.kind))
+        {
+            continue;
+        }
+
+        out += is_first ? "{\"instrument_name\":\"" : ",{\"instrument_name\":\"";
+        is_first = false;
+        out += position.instrument_name;
+        out += "\",\"kind\":\"";
+        out += GetKindName(position.kind);
+        out += "\",\"direction\":\"";
+        out += position.size > 0 ? "buy" : "sell";
+        out += "\",\"size\":";
+        AppendNumber(out, position.size);
+        out += ",\"average_price\":";
+        AppendNumber(out, position.average_price);
+        out += ",\"mark_price\":";
+        AppendNumber(out, position.mark_price);
+        out += ",\"floating_profit_loss\":";
+        AppendNumber(out, position.floating_pnl);
+        out += ",\"realized_profit_loss\":";
+        AppendNumber(out, position.realized_pnl);
+        out += ",\"total_profit_loss\":";
+        AppendNumber(out, position.total_pnl);
+        out += '}';
+    }
+    out += "]}";
+}
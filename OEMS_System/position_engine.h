@@ -0,0 +1,131 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "market_data_decoder.h"
+#include "ticker_feed.h"
+
+class DrogonWebSocket;
+
+// How an instrument's PnL is computed
+enum class ContractKind
+{
+    INVERSE,   // BTC-PERPETUAL, BTC-28JUN24: sized in USD, settled in the base currency
+    LINEAR,    // BTC_USDC-PERPETUAL: sized in the base currency, settled in USDC
+    OPTION     // BTC-28JUN24-60000-C: priced and settled in the base currency
+};
+
+struct PositionSnapshot
+{
+    std::string instrument_name;
+    std::string currency;        // Settlement currency
+    ContractKind kind;
+    double size;                 // Signed: negative is short
+    double average_price;
+    double mark_price;
+    double realized_pnl;
+    double floating_pnl;
+    double total_pnl;
+};
+
+struct CurrencyExposure
+{
+    size_t open_positions;
+    double realized_pnl;
+    double floating_pnl;
+    double total_pnl;
+};
+
+// Positions and PnL per instrument, updated in place from our fills and mark prices.
+//
+// Fills come from user.trades.any.any.raw and move size and average entry (harmonic for inverse
+// contracts), realizing PnL on the part of a fill that reduces the position. Mark prices come from each
+// held instrument's ticker through the ticker feed, conflated to MARK_PRICE_INTERVAL, so floating PnL is
+// always current without asking the exchange.
+// private/get_positions is only used to reconcile, after which the currency counts as synced.
+class PositionEngine
+{
+  public:
+    // Invoked after a position or its mark price changes, outside the engine lock
+    using UpdateListener = std::function<void(const PositionSnapshot& position)>;
+
+    static constexpr const char* CHANNEL = "user.trades.any.any.raw";
+    static constexpr std::chrono::milliseconds MARK_PRICE_INTERVAL{100};
+
+  private:
+    struct Position
+    {
+        std::string instrument_name;
+        std::string currency;
+        ContractKind kind{ContractKind::INVERSE};
+        double size{0};
+        double average_price{0};
+        double mark_price{0};
+        double realized_pnl{0};
+        int64_t last_trade_seq{0};
+    };
+
+    DrogonWebSocket& m_web_socket;
+    TickerFeed& m_ticker_feed;
+    const TickerFeed::ConsumerId m_ticker_consumer;
+    mutable std::mutex m_mutex;
+    // Nodes are stable, so the per-currency lists can point into this map
+    std::unordered_map<std::string, Position> m_positions;
+    std::unordered_map<std::string, std::vector<Position*>> m_by_currency;
+    std::unordered_set<std::string> m_synced_currencies;
+    std::vector<UpdateListener> m_update_listeners;
+
+    // Only touched on the market-data thread
+    std::vector<TradeUpdate> m_scratch_trades;
+
+    static double ComputePnl(ContractKind kind, double size, double entry_price, double exit_price) noexcept;
+    static PositionSnapshot MakeSnapshot(const Position& position);
+
+    void OnTradesMessage(std::string_view data);
+    void OnTicker(const TickerUpdate& ticker);
+    Position& FindOrAddLocked(const std::string& instrument_name, bool& is_new);
+    void SubscribeMarkPrices(const std::vector<std::string>& instruments);
+
+  public:
+    // Registers with the ticker feed, so it must be built before the feed starts
+    PositionEngine(DrogonWebSocket& web_socket, TickerFeed& ticker_feed);
+
+    PositionEngine(const PositionEngine&) = delete;
+    PositionEngine& operator=(const PositionEngine&) = delete;
+
+    static ContractKind GetContractKind(std::string_view instrument_name) noexcept;
+    static std::string GetSettlementCurrency(std::string_view instrument_name);
+
+    // Subscribes our fills; mark prices are subscribed per instrument as positions appear
+    void Start();
+
+    // Starts following an instrument's mark price before we hold a position in it
+    void Track(const std::string& instrument_name);
+
+    // Listeners must be added before Start
+    void AddUpdateListener(UpdateListener listener);
+
+    void ApplyFill(const TradeUpdate& trade);
+    void ApplyMarkPrice(const std::string& instrument_name, double mark_price);
+
+    // Replaces size, average price and realized PnL for one currency with a private/get_positions reply
+    bool Reconcile(const std::string& currency, std::string_view response);
+
+    bool IsSynced(const std::string& currency) const;
+
+    bool GetPosition(const std::string& instrument_name, PositionSnapshot& out) const;
+    size_t GetPositions(const std::string& currency, std::vector<PositionSnapshot>& out) const;
+    CurrencyExposure GetCurrencyExposure(const std::string& currency) const;
+
+    // Writes the open positions of one currency in the same shape as private/get_positions.
+    // kind is "future", "option" or empty for both.
+    void SerializeTo(std::string& out, const std::string& currency, std::string_view kind) const;
+};
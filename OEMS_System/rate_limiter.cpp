@@ -0,0 +1,118 @@
+#include "rate_limiter.h"
+
+#include <algorithm>
+
+RateLimiter::RateLimiter() : m_max_queue_delay_ns(DEFAULT_MAX_QUEUE_DELAY.count() * 1000000)
+{
+    SetLimits(RateLimitPool::MATCHING_ENGINE, DEFAULT_MATCHING_RATE, DEFAULT_MATCHING_BURST);
+    SetLimits(RateLimitPool::NON_MATCHING_ENGINE, DEFAULT_NON_MATCHING_RATE, DEFAULT_NON_MATCHING_BURST);
+}
+
+int64_t RateLimiter::NowNs() noexcept
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+RateLimiter::Bucket& RateLimiter::GetBucket(const RateLimitPool pool) noexcept
+{
+    return m_buckets[static_cast<size_t>(pool)];
+}
+
+const RateLimiter::Bucket& RateLimiter::GetBucket(const RateLimitPool pool) const noexcept
+{
+    return m_buckets[static_cast<size_t>(pool)];
+}
+
+AdmissionResult RateLimiter::Acquire(const RateLimitPool pool) noexcept
+{
+    Bucket& bucket = GetBucket(pool);
+    const int64_t now = NowNs();
+    const int64_t increment = bucket.ns_per_request.load(std::memory_order_relaxed);
+    const int64_t burst_window = bucket.burst_window_ns.load(std::memory_order_relaxed);
+    const int64_t max_queue_delay = m_max_queue_delay_ns.load(std::memory_order_relaxed);
+
+    int64_t tat = bucket.theoretical_arrival_ns.load(std::memory_order_relaxed);
+    int64_t delay;
+    int64_t new_tat;
+    do
+    {
+        new_tat = std::max(tat, now) + increment;
+        delay = std::max<int64_t>(0, new_tat - now - burst_window);
+        if (delay > max_queue_delay)
+        {
+            bucket.rejected.fetch_add(1, std::memory_order_relaxed);
+            return {Admission::REJECTED, std::chrono::nanoseconds(delay)};
+        }
+    } while (!bucket.theoretical_arrival_ns.compare_exchange_weak(tat, new_tat, std::memory_order_acq_rel,
+                                                                  std::memory_order_relaxed));
+
+    if (delay == 0)
+    {
+        bucket.admitted.fetch_add(1, std::memory_order_relaxed);
+        return {Admission::ADMITTED, std::chrono::nanoseconds(0)};
+    }
+
+    bucket.queued.fetch_add(1, std::memory_order_relaxed);
+    bucket.throttled_ns.fetch_add(static_cast<uint64_t>(delay), std::memory_order_relaxed);
+    return {Admission::QUEUED, std::chrono::nanoseconds(delay)};
+}
+
+void RateLimiter::SetLimits(const RateLimitPool pool, const double rate_per_second, const double burst) noexcept
+{
+    if (rate_per_second <= 0 || burst < 1)
+    {
+        return;
+    }
+
+    Bucket& bucket = GetBucket(pool);
+    const auto ns_per_request = static_cast<int64_t>(1e9 / rate_per_second);
+    bucket.ns_per_request.store(ns_per_request, std::memory_order_relaxed);
+    bucket.burst_window_ns.store(static_cast<int64_t>(burst * static_cast<double>(ns_per_request)),
+                                 std::memory_order_relaxed);
+}
+
+void RateLimiter::SetMaxQueueDelay(const std::chrono::nanoseconds max_delay) noexcept
+{
+    m_max_queue_delay_ns.store(max_delay.count(), std::memory_order_relaxed);
+}
+
+void RateLimiter::ApplyExchangeLimits(const Json::Value& limits) noexcept
+{
+    const auto apply = [this](const Json::Value& pool_limits, const RateLimitPool pool)
+    {
+        if (pool_limits.isObject() && pool_limits["rate"].isNumeric() && pool_limits["burst"].isNumeric())
+        {
+            SetLimits(pool, pool_limits["rate"].asDouble(), pool_limits["burst"].asDouble());
+        }
+    };
+
+    if (limits.isObject())
+    {
+        apply(limits["matching_engine"], RateLimitPool::MATCHING_ENGINE);
+        apply(limits["non_matching_engine"], RateLimitPool::NON_MATCHING_ENGINE);
+    }
+}
+
+void RateLimiter::OnExchangeThrottled(const RateLimitPool pool) noexcept
+{
+    Bucket& bucket = GetBucket(pool);
+    bucket.exchange_throttles.fetch_add(1, std::memory_order_relaxed);
+
+    const int64_t empty_at = NowNs() + bucket.burst_window_ns.load(std::memory_order_relaxed);
+    int64_t tat = bucket.theoretical_arrival_ns.load(std::memory_order_relaxed);
+    while (tat < empty_at &&
+           !bucket.theoretical_arrival_ns.compare_exchange_weak(tat, empty_at, std::memory_order_acq_rel,
+                                                                std::memory_order_relaxed))
+    {
+    }
+}
+
+RateLimiterStats RateLimiter::GetStats(const RateLimitPool pool) const noexcept
+{
+    const Bucket& bucket = GetBucket(pool);
+    return {bucket.admitted.load(std::memory_order_relaxed), bucket.queued.load(std::memory_order_relaxed),
+            bucket.rejected.load(std::memory_order_relaxed), bucket.exchange_throttles.load(std::memory_order_relaxed),
+            bucket.throttled_ns.load(std::memory_order_relaxed)};
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <json/json.h>
+
+// Deribit meters order entry and everything else from separate credit pools
+enum class RateLimitPool
+{
+    MATCHING_ENGINE,
+    NON_MATCHING_ENGINE
+};
+
+enum class Admission
+{
+    ADMITTED,
+    QUEUED,
+    REJECTED
+};
+
+struct AdmissionResult
+{
+    Admission admission;
+    std::chrono::nanoseconds delay;  // How long a queued request must wait before it is sent
+};
+
+struct RateLimiterStats
+{
+    uint64_t admitted;
+    uint64_t queued;
+    uint64_t rejected;
+    uint64_t exchange_throttles;
+    uint64_t throttled_ns;           // Total delay imposed on queued requests
+};
+
+// Lock-free token bucket per pool, implemented as GCRA over a single atomic arrival time.
+// Credits are counted in requests: rate is the refill per second and burst the bucket size.
+class RateLimiter
+{
+  private:
+    struct Bucket
+    {
+        std::atomic<int64_t> theoretical_arrival_ns{0};
+        std::atomic<int64_t> ns_per_request{0};
+        std::atomic<int64_t> burst_window_ns{0};
+        std::atomic<uint64_t> admitted{0};
+        std::atomic<uint64_t> queued{0};
+        std::atomic<uint64_t> rejected{0};
+        std::atomic<uint64_t> exchange_throttles{0};
+        std::atomic<uint64_t> throttled_ns{0};
+    };
+
+    std::array<Bucket, 2> m_buckets;
+    std::atomic<int64_t> m_max_queue_delay_ns;
+
+    static int64_t NowNs() noexcept;
+    Bucket& GetBucket(RateLimitPool pool) noexcept;
+    const Bucket& GetBucket(RateLimitPool pool) const noexcept;
+
+  public:
+    // Deribit defaults: 20 req/s with a burst of 100 for non-matching calls, 5 req/s burst 20 for orders
+    static constexpr double DEFAULT_NON_MATCHING_RATE = 20.0;
+    static constexpr double DEFAULT_NON_MATCHING_BURST = 100.0;
+    static constexpr double DEFAULT_MATCHING_RATE = 5.0;
+    static constexpr double DEFAULT_MATCHING_BURST = 20.0;
+    static constexpr std::chrono::milliseconds DEFAULT_MAX_QUEUE_DELAY{500};
+
+    RateLimiter();
+
+    // Reserves credit for one request. A request that fits within the max queue delay is
+    // admitted with a delay instead of rejected; the reservation is kept either way.
+    AdmissionResult Acquire(RateLimitPool pool) noexcept;
+
+    void SetLimits(RateLimitPool pool, double rate_per_second, double burst) noexcept;
+    void SetMaxQueueDelay(std::chrono::nanoseconds max_delay) noexcept;
+
+    // Reads the "limits" object returned by private/get_account_summary
+    void ApplyExchangeLimits(const Json::Value& limits) noexcept;
+
+    // Empties the bucket after the exchange answered with too_many_requests (10028)
+    void OnExchangeThrottled(RateLimitPool pool) noexcept;
+
+    RateLimiterStats GetStats(RateLimitPool pool) const noexcept;
+};
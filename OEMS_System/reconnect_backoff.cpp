@@ -0,0 +1,30 @@
+#include "reconnect_backoff.h"
+
+#include <algorithm>
+
+ReconnectBackoff::ReconnectBackoff(const std::chrono::milliseconds min_delay,
+                                   const std::chrono::milliseconds max_delay)
+    : m_min_delay(min_delay),
+      m_max_delay(max_delay),
+      m_random(static_cast<uint32_t>(std::chrono::steady_clock::now().time_since_epoch().count()))
+{
+}
+
+std::chrono::milliseconds ReconnectBackoff::Next()
+{
+    const uint32_t attempt = m_attempt++;
+    if (attempt == 0)
+    {
+        return std::chrono::milliseconds(0);
+    }
+
+    const int64_t step = std::min<int64_t>(m_max_delay.count(),
+                                           m_min_delay.count() << std::min<uint32_t>(attempt - 1, 16));
+    std::uniform_int_distribution<int64_t> jitter(step / 2, step);
+    return std::chrono::milliseconds(jitter(m_random));
+}
+
+void ReconnectBackoff::Reset() noexcept
+{
+    m_attempt = 0;
+}
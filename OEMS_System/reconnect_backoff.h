@@ -0,0 +1,25 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+// Delays between attempts to restore a lost session. The first retry is immediate. After that the delay doubles up
+// to the cap and is drawn from the upper half of the current step, so clients dropped together do not come back in
+// step.
+class ReconnectBackoff
+{
+  private:
+    std::chrono::milliseconds m_min_delay;
+    std::chrono::milliseconds m_max_delay;
+    uint32_t m_attempt{0};
+    std::minstd_rand m_random;
+
+  public:
+    ReconnectBackoff(std::chrono::milliseconds min_delay, std::chrono::milliseconds max_delay);
+
+    std::chrono::milliseconds Next();
+
+    // Called once a session has come back, so its next loss is retried at once again
+    void Reset() noexcept;
+};
@@ -0,0 +1,275 @@
+#include "request_encoder.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+    constexpr uint64_t POWERS_OF_TEN[] = {1ULL,
+                                          10ULL,
+                                          100ULL,
+                                          1000ULL,
+                                          10000ULL,
+                                          100000ULL,
+                                          1000000ULL,
+                                          10000000ULL,
+                                          100000000ULL,
+                                          1000000000ULL};
+    constexpr int MAX_DECIMALS = 9;
+    // Scaled values from 2^53 up are no longer exact in a double, so extra decimals would only print noise
+    constexpr double MAX_EXACT_SCALED = 9007199254740992.0;
+    // Largest scaled value llround can return, with some margin below 2^63
+    constexpr double MAX_FIXED_POINT = 9.0e18;
+    constexpr char HEX_DIGITS[] = "0123456789ABCDEF";
+
+    bool IsUnreserved(const char c) noexcept
+    {
+        return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' ||
+               c == '_' || c == '.' || c == '~';
+    }
+}
+
+RequestEncoder& RequestEncoder::ThreadLocal() noexcept
+{
+    thread_local RequestEncoder encoder;
+    return encoder;
+}
+
+void RequestEncoder::Reset() noexcept
+{
+    m_size = 0;
+    m_overflow = false;
+    m_has_fields = false;
+}
+
+bool RequestEncoder::Ok() const noexcept
+{
+    return !m_overflow;
+}
+
+std::string_view RequestEncoder::View() const noexcept
+{
+    return {m_buffer.data(), m_size};
+}
+
+void RequestEncoder::Append(const std::string_view text) noexcept
+{
+    if (m_overflow || m_size + text.size() > BUFFER_CAPACITY)
+    {
+        m_overflow = true;
+        return;
+    }
+    std::memcpy(m_buffer.data() + m_size, text.data(), text.size());
+    m_size += text.size();
+}
+
+void RequestEncoder::Append(const char c) noexcept
+{
+    if (m_overflow || m_size == BUFFER_CAPACITY)
+    {
+        m_overflow = true;
+        return;
+    }
+    m_buffer[m_size++] = c;
+}
+
+void RequestEncoder::AppendUrlEscaped(const std::string_view text) noexcept
+{
+    for (const char c : text)
+    {
+        if (IsUnreserved(c))
+        {
+            Append(c);
+        }
+        else
+        {
+            const auto byte = static_cast<unsigned char>(c);
+            Append('%');
+            Append(HEX_DIGITS[byte >> 4]);
+            Append(HEX_DIGITS[byte & 0x0F]);
+        }
+    }
+}
+
+void RequestEncoder::AppendJsonEscaped(const std::string_view text) noexcept
+{
+    for (const char c : text)
+    {
+        switch (c)
+        {
+            case '"': Append("\\\""); break;
+            case '\\': Append("\\\\"); break;
+            case '\n': Append("\\n"); break;
+            case '\r': Append("\\r"); break;
+            case '\t': Append("\\t"); break;
+            default:
+                if (static_cast<unsigned char>(c) >= 0x20)
+                {
+                    Append(c);
+                }
+                else
+                {
+                    // Other control characters are kept, in the \u00XX form JSON requires for them
+                    const char escape[] = {'\\', 'u', '0', '0', HEX_DIGITS[(c >> 4) & 0xF], HEX_DIGITS[c & 0xF]};
+                    Append(std::string_view(escape, sizeof(escape)));
+                }
+        }
+    }
+}
+
+void RequestEncoder::AppendInteger(const uint64_t value) noexcept
+{
+    char digits[20];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    Append(std::string_view(digits, static_cast<size_t>(result.ptr - digits)));
+}
+
+// Writes scaled / 10^decimals with trailing zeros trimmed, e.g. (1, 4) -> "0.0001", (255, 1) -> "25.5"
+void RequestEncoder::AppendFixedPoint(const bool is_negative, const uint64_t scaled, const int decimals) noexcept
+{
+    const uint64_t scale = POWERS_OF_TEN[decimals];
+    uint64_t fraction = scaled % scale;
+
+    if (is_negative && scaled != 0)
+    {
+        Append('-');
+    }
+    AppendInteger(scaled / scale);
+
+    if (fraction == 0)
+    {
+        return;
+    }
+
+    int digits = decimals;
+    while (fraction % 10 == 0)
+    {
+        fraction /= 10;
+        --digits;
+    }
+
+    char buffer[MAX_DECIMALS + 1];
+    buffer[0] = '.';
+    for (int i = digits; i > 0; --i)
+    {
+        buffer[i] = static_cast<char>('0' + fraction % 10);
+        fraction /= 10;
+    }
+    Append(std::string_view(buffer, static_cast<size_t>(digits) + 1));
+}
+
+void RequestEncoder::AppendDecimal(const double value, int decimals) noexcept
+{
+    // There is no number to send in its place, so the request is refused
+    if (!std::isfinite(value))
+    {
+        m_overflow = true;
+        return;
+    }
+
+    // A large value gives up decimals rather than overflow the fixed point; a double only carries about
+    // 16 significant digits, so they were not real precision anyway
+    decimals = decimals < 0 ? 0 : (decimals > MAX_DECIMALS ? MAX_DECIMALS : decimals);
+    const double magnitude = std::fabs(value);
+    while (decimals > 0 && magnitude * static_cast<double>(POWERS_OF_TEN[decimals]) >= MAX_EXACT_SCALED)
+    {
+        --decimals;
+    }
+    const double scaled = magnitude * static_cast<double>(POWERS_OF_TEN[decimals]);
+    if (scaled >= MAX_FIXED_POINT)
+    {
+        m_overflow = true;
+        return;
+    }
+    AppendFixedPoint(value < 0, static_cast<uint64_t>(std::llround(scaled)), decimals);
+}
+
+// Exact: the value never exists as a double
+void RequestEncoder::AppendScaled(const int64_t units, const DecimalScale scale) noexcept
+{
+    const int decimals = scale.decimals > MAX_DECIMALS ? MAX_DECIMALS : scale.decimals;
+    const uint64_t magnitude = units < 0 ? 0 - static_cast<uint64_t>(units) : static_cast<uint64_t>(units);
+    if (scale.mantissa != 0 && magnitude > std::numeric_limits<uint64_t>::max() / scale.mantissa)
+    {
+        m_overflow = true;
+        return;
+    }
+    AppendFixedPoint(units < 0, magnitude * scale.mantissa, decimals);
+}
+
+void RequestEncoder::BeginField(const std::string_view key, const bool is_json) noexcept
+{
+    if (is_json)
+    {
+        Append(m_has_fields ? ",\"" : "\"");
+        Append(key);
+        Append("\":");
+    }
+    else
+    {
+        Append(m_has_fields ? '&' : '?');
+        Append(key);
+        Append('=');
+    }
+    m_has_fields = true;
+}
+
+void RequestEncoder::BeginQuery(const EndpointDescriptor& endpoint) noexcept
+{
+    Reset();
+    Append(endpoint.http_path);
+}
+
+void RequestEncoder::AddQueryParam(const std::string_view key, const std::string_view value) noexcept
+{
+    BeginField(key, false);
+    AppendUrlEscaped(value);
+}
+
+void RequestEncoder::AddQueryParam(const std::string_view key, const double value, const int decimals) noexcept
+{
+    BeginField(key, false);
+    AppendDecimal(value, decimals);
+}
+
+void RequestEncoder::AddQueryParam(const std::string_view key, const int64_t units, const DecimalScale scale) noexcept
+{
+    BeginField(key, false);
+    AppendScaled(units, scale);
+}
+
+void RequestEncoder::BeginJsonRpc(const EndpointDescriptor& endpoint, const uint64_t id) noexcept
+{
+    Reset();
+    Append("{\"jsonrpc\":\"2.0\",\"id\":");
+    AppendInteger(id);
+    Append(",\"method\":\"");
+    Append(endpoint.rpc_method);
+    Append("\",\"params\":{");
+}
+
+void RequestEncoder::AddJsonParam(const std::string_view key, const std::string_view value) noexcept
+{
+    BeginField(key, true);
+    Append('"');
+    AppendJsonEscaped(value);
+    Append('"');
+}
+
+void RequestEncoder::AddJsonParam(const std::string_view key, const double value, const int decimals) noexcept
+{
+    BeginField(key, true);
+    AppendDecimal(value, decimals);
+}
+
+void RequestEncoder::AddJsonParam(const std::string_view key, const int64_t units, const DecimalScale scale) noexcept
+{
+    BeginField(key, true);
+    AppendScaled(units, scale);
+}
+
+void RequestEncoder::EndJsonRpc() noexcept
+{
+    Append("}}");
+}
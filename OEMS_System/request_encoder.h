@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+#include "decimal_scale.h"
+#include "rate_limiter.h"
+
+// Dense index of the endpoints below, used to key per-endpoint tables such as latency histograms
+enum class EndpointId : uint8_t
+{
+    BUY,
+    SELL,
+    EDIT,
+    CANCEL,
+    CANCEL_ALL_BY_INSTRUMENT,
+    CANCEL_BY_LABEL,
+    GET_POSITIONS,
+    GET_OPEN_ORDERS,
+    GET_ACCOUNT_SUMMARY,
+    GET_ORDER_BOOK,
+    GET_INSTRUMENTS,
+    AUTH,
+    COUNT
+};
+
+// Static description of one exchange endpoint, shared by the HTTP and JSON-RPC encoders
+struct EndpointDescriptor
+{
+    EndpointId id;
+    std::string_view http_path;     // e.g. "/api/v2/private/buy"
+    std::string_view rpc_method;    // e.g. "private/buy"
+    RateLimitPool pool;
+    bool is_private;
+};
+
+namespace Endpoints
+{
+    inline constexpr EndpointDescriptor BUY{EndpointId::BUY, "/api/v2/private/buy", "private/buy",
+                                            RateLimitPool::MATCHING_ENGINE, true};
+    inline constexpr EndpointDescriptor SELL{EndpointId::SELL, "/api/v2/private/sell", "private/sell",
+                                             RateLimitPool::MATCHING_ENGINE, true};
+    inline constexpr EndpointDescriptor EDIT{EndpointId::EDIT, "/api/v2/private/edit", "private/edit",
+                                             RateLimitPool::MATCHING_ENGINE, true};
+    inline constexpr EndpointDescriptor CANCEL{EndpointId::CANCEL, "/api/v2/private/cancel", "private/cancel",
+                                               RateLimitPool::MATCHING_ENGINE, true};
+    inline constexpr EndpointDescriptor CANCEL_ALL_BY_INSTRUMENT{EndpointId::CANCEL_ALL_BY_INSTRUMENT,
+                                                                 "/api/v2/private/cancel_all_by_instrument",
+                                                                 "private/cancel_all_by_instrument",
+                                                                 RateLimitPool::MATCHING_ENGINE, true};
+    inline constexpr EndpointDescriptor CANCEL_BY_LABEL{EndpointId::CANCEL_BY_LABEL, "/api/v2/private/cancel_by_label",
+                                                        "private/cancel_by_label", RateLimitPool::MATCHING_ENGINE,
+                                                        true};
+    inline constexpr EndpointDescriptor GET_POSITIONS{EndpointId::GET_POSITIONS, "/api/v2/private/get_positions",
+                                                      "private/get_positions", RateLimitPool::NON_MATCHING_ENGINE,
+                                                      true};
+    inline constexpr EndpointDescriptor GET_OPEN_ORDERS{EndpointId::GET_OPEN_ORDERS, "/api/v2/private/get_open_orders",
+                                                        "private/get_open_orders",
+                                                        RateLimitPool::NON_MATCHING_ENGINE, true};
+    inline constexpr EndpointDescriptor GET_ACCOUNT_SUMMARY{EndpointId::GET_ACCOUNT_SUMMARY,
+                                                            "/api/v2/private/get_account_summary",
+                                                            "private/get_account_summary",
+                                                            RateLimitPool::NON_MATCHING_ENGINE, true};
+    inline constexpr EndpointDescriptor GET_ORDER_BOOK{EndpointId::GET_ORDER_BOOK, "/api/v2/public/get_order_book",
+                                                       "public/get_order_book", RateLimitPool::NON_MATCHING_ENGINE,
+                                                       false};
+    inline constexpr EndpointDescriptor GET_INSTRUMENTS{EndpointId::GET_INSTRUMENTS, "/api/v2/public/get_instruments",
+                                                        "public/get_instruments",
+                                                        RateLimitPool::NON_MATCHING_ENGINE, false};
+    inline constexpr EndpointDescriptor AUTH{EndpointId::AUTH, "/api/v2/public/auth", "public/auth",
+                                             RateLimitPool::NON_MATCHING_ENGINE, false};
+
+    // Indexed by EndpointId
+    inline constexpr std::array<const EndpointDescriptor*, static_cast<size_t>(EndpointId::COUNT)> ALL{
+        &BUY, &SELL, &EDIT, &CANCEL, &CANCEL_ALL_BY_INSTRUMENT, &CANCEL_BY_LABEL, &GET_POSITIONS,
+        &GET_OPEN_ORDERS, &GET_ACCOUNT_SUMMARY, &GET_ORDER_BOOK, &GET_INSTRUMENTS, &AUTH};
+}
+
+// Writes HTTP query strings or JSON-RPC messages into a fixed, reusable buffer.
+// Nothing is allocated; once the buffer is exhausted the encoder only records the overflow. Numbers that
+// cannot be written (NaN, infinity or too large for 64-bit fixed point) are recorded the same way, so
+// Ok() is false rather than the request carrying a wrong value.
+class RequestEncoder
+{
+  public:
+    static constexpr size_t BUFFER_CAPACITY = 2048;
+    static constexpr int DEFAULT_DECIMALS = 8;
+
+  private:
+    std::array<char, BUFFER_CAPACITY> m_buffer;
+    size_t m_size{0};
+    bool m_overflow{false};
+    bool m_has_fields{false};
+
+    void Append(std::string_view text) noexcept;
+    void Append(char c) noexcept;
+    void AppendUrlEscaped(std::string_view text) noexcept;
+    void AppendJsonEscaped(std::string_view text) noexcept;
+    void AppendInteger(uint64_t value) noexcept;
+    void AppendFixedPoint(bool is_negative, uint64_t scaled, int decimals) noexcept;
+    void AppendDecimal(double value, int decimals) noexcept;
+    void AppendScaled(int64_t units, DecimalScale scale) noexcept;
+    void BeginField(std::string_view key, bool is_json) noexcept;
+
+  public:
+    // One encoder per thread, reused for every request that thread sends
+    static RequestEncoder& ThreadLocal() noexcept;
+
+    void Reset() noexcept;
+    bool Ok() const noexcept;
+    std::string_view View() const noexcept;
+
+    // "<http_path>?key=value&..." with URL-escaped values
+    void BeginQuery(const EndpointDescriptor& endpoint) noexcept;
+    void AddQueryParam(std::string_view key, std::string_view value) noexcept;
+    void AddQueryParam(std::string_view key, double value, int decimals = DEFAULT_DECIMALS) noexcept;
+    // units * scale written exactly, e.g. 1234 ticks of 0.5 -> "617"
+    void AddQueryParam(std::string_view key, int64_t units, DecimalScale scale) noexcept;
+
+    // {"jsonrpc":"2.0","id":<id>,"method":"<rpc_method>","params":{...}}
+    void BeginJsonRpc(const EndpointDescriptor& endpoint, uint64_t id) noexcept;
+    void AddJsonParam(std::string_view key, std::string_view value) noexcept;
+    void AddJsonParam(std::string_view key, double value, int decimals = DEFAULT_DECIMALS) noexcept;
+    void AddJsonParam(std::string_view key, int64_t units, DecimalScale scale) noexcept;
+    void EndJsonRpc() noexcept;
+};
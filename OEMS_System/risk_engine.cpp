@@ -0,0 +1,274 @@
+#include "risk_engine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+#include "order_store.h"
+
+const RiskLimits& RiskLimitTable::ForKind(const ContractKind kind) const noexcept
+{
+    switch (kind)
+    {
+        case ContractKind::LINEAR: return linear;
+        case ContractKind::OPTION: return option;
+        default: return inverse;
+    }
+}
+
+RiskEngine::RiskEngine(OrderStore& order_store, PositionEngine& position_engine,
+                       const RiskLimitTable& default_limits)
+    : m_order_store(order_store), m_position_engine(position_engine), m_default_limits(default_limits)
+{
+    m_order_store.AddUpdateListener([this](const std::string& instrument_name)
+                                    { OnOrdersChanged(instrument_name); });
+    m_position_engine.AddUpdateListener([this](const PositionSnapshot& position) { OnPositionUpdate(position); });
+}
+
+const char* RiskEngine::GetRiskCheckName(const RiskCheck check) noexcept
+{
+    switch (check)
+    {
+        case RiskCheck::PASSED: return "passed";
+        case RiskCheck::ORDER_NOTIONAL: return "order notional above limit";
+        case RiskCheck::POSITION_LIMIT: return "position limit exceeded";
+        case RiskCheck::OPEN_ORDER_LIMIT: return "too many open orders";
+        case RiskCheck::PRICE_BAND: return "price outside band around mark";
+        case RiskCheck::SELF_TRADE: return "would trade against own order";
+        case RiskCheck::NO_REFERENCE_PRICE: return "no mark price to check the order against";
+        case RiskCheck::NOT_TRACKED: return "instrument not tracked by the risk engine";
+        case RiskCheck::TABLE_FULL: return "instrument table full";
+        default: return "unknown";
+    }
+}
+
+void RiskEngine::StoreLimits(InstrumentRisk& instrument, const RiskLimits& limits) noexcept
+{
+    instrument.max_order_notional.store(limits.max_order_notional, std::memory_order_relaxed);
+    instrument.max_position.store(limits.max_position, std::memory_order_relaxed);
+    instrument.max_open_orders.store(limits.max_open_orders, std::memory_order_relaxed);
+    instrument.price_band.store(limits.price_band, std::memory_order_relaxed);
+}
+
+RiskEngine::InstrumentRisk* RiskEngine::FindOrAdd(const std::string_view instrument_name)
+{
+    const size_t hash = std::hash<std::string_view>{}(instrument_name);
+    for (size_t probe = 0; probe < TABLE_CAPACITY; ++probe)
+    {
+        InstrumentRisk& instrument = m_instruments[(hash + probe) & (TABLE_CAPACITY - 1)];
+        uint8_t state = instrument.state.load(std::memory_order_acquire);
+        if (state == EMPTY)
+        {
+            if (instrument.state.compare_exchange_strong(state, CLAIMED, std::memory_order_acq_rel))
+            {
+                instrument.hash = hash;
+                instrument.instrument_name.assign(instrument_name);
+                instrument.kind = PositionEngine::GetContractKind(instrument_name);
+                StoreLimits(instrument, m_default_limits.ForKind(instrument.kind));
+                instrument.state.store(READY, std::memory_order_release);
+
+                // The price band and sizing of linear contracts need the mark price
+                m_position_engine.Track(instrument.instrument_name);
+                return &instrument;
+            }
+        }
+
+        // Another thread is filling the slot in; it becomes readable within a few instructions
+        while (state == CLAIMED)
+        {
+            state = instrument.state.load(std::memory_order_acquire);
+        }
+        if (instrument.hash == hash && instrument.instrument_name == instrument_name)
+        {
+            return &instrument;
+        }
+    }
+    return nullptr;
+}
+
+RiskEngine::InstrumentRisk* RiskEngine::Find(const std::string_view instrument_name) const noexcept
+{
+    const size_t hash = std::hash<std::string_view>{}(instrument_name);
+    for (size_t probe = 0; probe < TABLE_CAPACITY; ++probe)
+    {
+        const InstrumentRisk& instrument = m_instruments[(hash + probe) & (TABLE_CAPACITY - 1)];
+        const uint8_t state = instrument.state.load(std::memory_order_acquire);
+        if (state == EMPTY)
+        {
+            return nullptr;
+        }
+        if (state == READY && instrument.hash == hash && instrument.instrument_name == instrument_name)
+        {
+            return const_cast<InstrumentRisk*>(&instrument);
+        }
+    }
+    return nullptr;
+}
+
+bool RiskEngine::Track(const std::string& instrument_name)
+{
+    return FindOrAdd(instrument_name) != nullptr;
+}
+
+bool RiskEngine::SetLimits(const std::string& instrument_name, const RiskLimits& limits)
+{
+    InstrumentRisk* instrument = FindOrAdd(instrument_name);
+    if (!instrument)
+    {
+        return false;
+    }
+    StoreLimits(*instrument, limits);
+    return true;
+}
+
+void RiskEngine::OnPositionUpdate(const PositionSnapshot& position)
+{
+    InstrumentRisk* instrument = FindOrAdd(position.instrument_name);
+    if (!instrument)
+    {
+        return;
+    }
+    instrument->position.store(position.size, std::memory_order_relaxed);
+    if (position.mark_price > 0)
+    {
+        instrument->mark_price.store(position.mark_price, std::memory_order_relaxed);
+    }
+}
+
+// Function to refresh the open-order count and our best resting prices for one instrument
+void RiskEngine::OnOrdersChanged(const std::string& instrument_name)
+{
+    InstrumentRisk* instrument = FindOrAdd(instrument_name);
+    if (!instrument)
+    {
+        return;
+    }
+
+    thread_local std::vector<OrderUpdate> orders;
+    m_order_store.GetByInstrument(instrument_name, orders);
+
+    double best_bid = 0;
+    double best_ask = 0;
+    for (const OrderUpdate& order : orders)
+    {
+        if (order.price <= 0)
+        {
+            continue;
+        }
+        if (order.direction == TradeDirection::BUY)
+        {
+            best_bid = std::max(best_bid, order.price);
+        }
+        else if (best_ask == 0 || order.price < best_ask)
+        {
+            best_ask = order.price;
+        }
+    }
+
+    instrument->open_orders.store(static_cast<uint32_t>(orders.size()), std::memory_order_relaxed);
+    instrument->best_own_bid.store(best_bid, std::memory_order_relaxed);
+    instrument->best_own_ask.store(best_ask, std::memory_order_relaxed);
+}
+
+RiskCheck RiskEngine::Reject(const RiskCheck check) noexcept
+{
+    m_rejections[static_cast<size_t>(check)].fetch_add(1, std::memory_order_relaxed);
+    return check;
+}
+
+RiskCheck RiskEngine::CheckOrder(const std::string_view instrument_name, const bool is_buy, const bool is_market,
+                                 const double amount, const double price, const bool replaces_open_order)
+{
+    m_checks.fetch_add(1, std::memory_order_relaxed);
+
+    InstrumentRisk* instrument = Find(instrument_name);
+    if (!instrument)
+    {
+        return Reject(RiskCheck::NOT_TRACKED);
+    }
+
+    // A limit order cannot be checked against the price band until the mark price is known
+    const double mark_price = instrument->mark_price.load(std::memory_order_relaxed);
+    if (!is_market && mark_price <= 0)
+    {
+        return Reject(RiskCheck::NO_REFERENCE_PRICE);
+    }
+    const double reference_price = is_market ? mark_price : price;
+
+    double notional = amount;
+    if (instrument->kind != ContractKind::INVERSE)
+    {
+        if (reference_price <= 0)
+        {
+            return Reject(RiskCheck::NO_REFERENCE_PRICE);
+        }
+        notional = amount * reference_price;
+    }
+    if (notional > instrument->max_order_notional.load(std::memory_order_relaxed))
+    {
+        return Reject(RiskCheck::ORDER_NOTIONAL);
+    }
+
+    // Orders that shrink the position are always allowed, even above the limit
+    const double position = instrument->position.load(std::memory_order_relaxed);
+    const double resulting = position + (is_buy ? amount : -amount);
+    if (std::abs(resulting) > instrument->max_position.load(std::memory_order_relaxed) &&
+        std::abs(resulting) > std::abs(position))
+    {
+        return Reject(RiskCheck::POSITION_LIMIT);
+    }
+
+    if (!is_market &&
+        std::abs(price - mark_price) > instrument->price_band.load(std::memory_order_relaxed) * mark_price)
+    {
+        return Reject(RiskCheck::PRICE_BAND);
+    }
+
+    if (is_buy)
+    {
+        const double own_ask = instrument->best_own_ask.load(std::memory_order_relaxed);
+        if (own_ask > 0 && (is_market || price >= own_ask))
+        {
+            return Reject(RiskCheck::SELF_TRADE);
+        }
+    }
+    else
+    {
+        const double own_bid = instrument->best_own_bid.load(std::memory_order_relaxed);
+        if (own_bid > 0 && (is_market || price <= own_bid))
+        {
+            return Reject(RiskCheck::SELF_TRADE);
+        }
+    }
+
+    // Last, because passing reserves a pending slot
+    const uint32_t pending = instrument->pending_orders.fetch_add(1, std::memory_order_relaxed);
+    const uint32_t replaced = replaces_open_order ? 1 : 0;
+    if (instrument->open_orders.load(std::memory_order_relaxed) + pending >=
+        instrument->max_open_orders.load(std::memory_order_relaxed) + replaced)
+    {
+        instrument->pending_orders.fetch_sub(1, std::memory_order_relaxed);
+        return Reject(RiskCheck::OPEN_ORDER_LIMIT);
+    }
+    return RiskCheck::PASSED;
+}
+
+void RiskEngine::ReleaseOrder(const std::string_view instrument_name) noexcept
+{
+    InstrumentRisk* instrument = Find(instrument_name);
+    if (instrument)
+    {
+        instrument->pending_orders.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+uint64_t RiskEngine::GetCheckCount() const noexcept
+{
+    return m_checks.load(std::memory_order_relaxed);
+}
+
+uint64_t RiskEngine::GetRejectionCount(const RiskCheck check) const noexcept
+{
+    return m_rejections[static_cast<size_t>(check)].load(std::memory_order_relaxed);
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "position_engine.h"
+
+class OrderStore;
+
+enum class RiskCheck
+{
+    PASSED,
+    ORDER_NOTIONAL,
+    POSITION_LIMIT,
+    OPEN_ORDER_LIMIT,
+    PRICE_BAND,
+    SELF_TRADE,
+    NO_REFERENCE_PRICE,
+    NOT_TRACKED,
+    TABLE_FULL
+};
+
+// Notional is measured in the contract's own terms: USD for inverse contracts (the order amount) and the
+// settlement currency for linear contracts and options (amount times price). Positions are in order amount
+// units: USD for inverse contracts, the base currency for linear contracts and contracts for options.
+struct RiskLimits
+{
+    double max_order_notional{100000};
+    double max_position{500000};     // Absolute size after the order fills completely
+    uint32_t max_open_orders{50};    // Resting plus not yet acknowledged
+    double price_band{0.05};         // Largest allowed distance of a limit price from the mark, as a fraction
+};
+
+// The limits an instrument starts with, one set per contract kind since each kind sizes orders in its own units
+struct RiskLimitTable
+{
+    RiskLimits inverse{100000, 500000, 50, 0.05};  // USD
+    RiskLimits linear{100000, 10, 50, 0.05};       // USDC notional, base-currency position
+    RiskLimits option{5, 100, 50, 0.5};            // Premium in the base currency, position in contracts
+
+    const RiskLimits& ForKind(ContractKind kind) const noexcept;
+};
+
+// Pre-trade checks that run on the order path without taking a lock.
+//
+// Every instrument has a slot in a fixed open-addressing table holding its limits and the counters the
+// checks read: position and mark price (pushed by the position engine), open orders and our own best
+// resting bid and ask (recomputed from the order store when its orders change), and orders that passed
+// the checks but are not acknowledged yet. The order path hashes the instrument name, finds its slot
+// and reads a handful of atomics; feeds and configuration only ever store to them. Slots are only
+// claimed off the order path, by Track, SetLimits or the first order or position update seen for an
+// instrument, so an instrument must be tracked before its first order.
+class RiskEngine
+{
+  public:
+    static constexpr size_t TABLE_CAPACITY = 1024;
+
+  private:
+    enum SlotState : uint8_t
+    {
+        EMPTY,
+        CLAIMED,
+        READY
+    };
+
+    struct InstrumentRisk
+    {
+        std::atomic<uint8_t> state{EMPTY};
+        size_t hash{0};
+        std::string instrument_name;
+        ContractKind kind{ContractKind::INVERSE};
+
+        std::atomic<double> max_order_notional{0};
+        std::atomic<double> max_position{0};
+        std::atomic<uint32_t> max_open_orders{0};
+        std::atomic<double> price_band{0};
+
+        std::atomic<double> position{0};
+        std::atomic<double> mark_price{0};
+        std::atomic<uint32_t> open_orders{0};
+        std::atomic<uint32_t> pending_orders{0};
+        std::atomic<double> best_own_bid{0};   // 0 when we have no resting buy
+        std::atomic<double> best_own_ask{0};   // 0 when we have no resting sell
+    };
+
+    OrderStore& m_order_store;
+    PositionEngine& m_position_engine;
+    RiskLimitTable m_default_limits;
+    std::array<InstrumentRisk, TABLE_CAPACITY> m_instruments;
+    std::atomic<uint64_t> m_checks{0};
+    std::array<std::atomic<uint64_t>, static_cast<size_t>(RiskCheck::TABLE_FULL) + 1> m_rejections{};
+
+    static void StoreLimits(InstrumentRisk& instrument, const RiskLimits& limits) noexcept;
+
+    // Finds the instrument's slot, claiming a new one on first sight; null once the table is full
+    InstrumentRisk* FindOrAdd(std::string_view instrument_name);
+    InstrumentRisk* Find(std::string_view instrument_name) const noexcept;
+
+    void OnPositionUpdate(const PositionSnapshot& position);
+    void OnOrdersChanged(const std::string& instrument_name);
+    RiskCheck Reject(RiskCheck check) noexcept;
+
+  public:
+    // Registers itself as the update listener of both, so it must be built before either is started
+    RiskEngine(OrderStore& order_store, PositionEngine& position_engine,
+               const RiskLimitTable& default_limits = {});
+
+    RiskEngine(const RiskEngine&) = delete;
+    RiskEngine& operator=(const RiskEngine&) = delete;
+
+    static const char* GetRiskCheckName(RiskCheck check) noexcept;
+
+    // Starts checking orders for an instrument with its kind's default limits and following its mark price.
+    // Subscribes and allocates, so call it before trading the instrument rather than from the order path.
+    bool Track(const std::string& instrument_name);
+    // Sets an instrument's limits, tracking it first if needed
+    bool SetLimits(const std::string& instrument_name, const RiskLimits& limits);
+
+    // Runs every check for one order (price is ignored for market orders). Orders for untracked instruments
+    // are rejected, as are limit orders before the first mark price arrives. An order that passes counts
+    // as pending against the open-order limit until ReleaseOrder is called for it. An edit replaces an order
+    // that is already open, so it passes the open-order limit as long as nothing else is pending beyond it.
+    RiskCheck CheckOrder(std::string_view instrument_name, bool is_buy, bool is_market, double amount,
+                         double price, bool replaces_open_order = false);
+    void ReleaseOrder(std::string_view instrument_name) noexcept;
+
+    uint64_t GetCheckCount() const noexcept;
+    uint64_t GetRejectionCount(RiskCheck check) const noexcept;
+};
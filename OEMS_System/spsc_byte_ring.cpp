@@ -0,0 +1,62 @@
+#include "spsc_byte_ring.h"
+
+SpscByteRing::SpscByteRing(const size_t capacity) : m_capacity(capacity), m_buffer(new char[capacity]) {}
+
+size_t SpscByteRing::GetCapacity() const noexcept
+{
+    return m_capacity;
+}
+
+size_t SpscByteRing::GetMaxRecordSize() const noexcept
+{
+    return m_capacity / 4;
+}
+
+char* SpscByteRing::Reserve(const size_t size) noexcept
+{
+    const size_t entry_size = sizeof(EntryHeader) + ((size + 7) & ~size_t{7});
+    if (size > GetMaxRecordSize())
+    {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    const uint64_t head = m_head.load(std::memory_order_relaxed);
+    const size_t offset = head & (m_capacity - 1);
+    const size_t padding = offset + entry_size > m_capacity ? m_capacity - offset : 0;
+    const uint64_t end = head + padding + entry_size;
+
+    if (end - m_cached_tail > m_capacity)
+    {
+        m_cached_tail = m_tail.load(std::memory_order_acquire);
+        if (end - m_cached_tail > m_capacity)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+    }
+
+    // Entries are 8-aligned, so even the smallest gap at the end holds a padding header
+    if (padding != 0)
+    {
+        const EntryHeader skip{static_cast<uint32_t>(padding - sizeof(EntryHeader)), 1};
+        std::memcpy(m_buffer.get() + offset, &skip, sizeof(skip));
+    }
+
+    char* const entry = m_buffer.get() + (padding != 0 ? 0 : offset);
+    const EntryHeader header{static_cast<uint32_t>(entry_size - sizeof(EntryHeader)), 0};
+    std::memcpy(entry, &header, sizeof(header));
+
+    m_reserved = end;
+    return entry + sizeof(EntryHeader);
+}
+
+void SpscByteRing::Commit() noexcept
+{
+    m_head.store(m_reserved, std::memory_order_release);
+}
+
+uint64_t SpscByteRing::GetDroppedCount() const noexcept
+{
+    return m_dropped.load(std::memory_order_relaxed);
+}
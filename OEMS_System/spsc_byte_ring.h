@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+// Variable-sized records handed from one producer thread to one consumer thread without locks.
+//
+// The producer reserves space, writes the record in place and commits it; nothing is copied again until the
+// consumer reads it. A record that does not fit is dropped and counted rather than waited for, so the
+// producer never blocks. Records are contiguous: space left at the end of the buffer is skipped.
+class SpscByteRing
+{
+  private:
+    struct EntryHeader
+    {
+        uint32_t size;              // Payload bytes, rounded up to 8
+        uint32_t is_padding;
+    };
+
+    const size_t m_capacity;
+    std::unique_ptr<char[]> m_buffer;
+
+    alignas(64) std::atomic<uint64_t> m_head{0};   // Written by the producer
+    uint64_t m_cached_tail{0};
+    uint64_t m_reserved{0};
+    std::atomic<uint64_t> m_dropped{0};
+
+    alignas(64) std::atomic<uint64_t> m_tail{0};   // Written by the consumer
+
+  public:
+    // capacity must be a power of two
+    explicit SpscByteRing(size_t capacity);
+
+    SpscByteRing(const SpscByteRing&) = delete;
+    SpscByteRing& operator=(const SpscByteRing&) = delete;
+
+    size_t GetCapacity() const noexcept;
+    // Largest record Reserve accepts
+    size_t GetMaxRecordSize() const noexcept;
+
+    // Producer: space for one record of size bytes, or null (and a drop is counted) when the ring is full
+    char* Reserve(size_t size) noexcept;
+    // Producer: publishes the record last reserved
+    void Commit() noexcept;
+
+    // Consumer: calls handler(data, size) for every committed record, then frees their space. size is the
+    // reserved size rounded up to 8. Returns the number of records handled.
+    template<typename Handler>
+    size_t Drain(Handler&& handler);
+
+    uint64_t GetDroppedCount() const noexcept;
+};
+
+template<typename Handler>
+size_t SpscByteRing::Drain(Handler&& handler)
+{
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    const uint64_t head = m_head.load(std::memory_order_acquire);
+
+    size_t count = 0;
+    while (tail != head)
+    {
+        const char* entry = m_buffer.get() + (tail & (m_capacity - 1));
+        EntryHeader header;
+        std::memcpy(&header, entry, sizeof(header));
+        if (header.is_padding == 0)
+        {
+            handler(entry + sizeof(EntryHeader), static_cast<size_t>(header.size));
+            ++count;
+        }
+        tail += sizeof(EntryHeader) + header.size;
+    }
+
+    m_tail.store(tail, std::memory_order_release);
+    return count;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+// Bounded queue of fixed-size values from one producer thread to one consumer thread, without locks.
+//
+// Push fails rather than waits when the queue is full, so the producer never blocks. Each side keeps a
+// cached copy of the other's index and only reads the shared one when the cache says full or empty. A
+// consumer fed by several threads gives each of them a queue of its own.
+template<typename T>
+class SpscQueue
+{
+    static_assert(std::is_trivially_copyable_v<T>, "values are copied in and out of the slots");
+
+  private:
+    const size_t m_capacity;
+    std::unique_ptr<T[]> m_slots;
+
+    alignas(64) std::atomic<uint64_t> m_head{0};   // Written by the producer
+    uint64_t m_cached_tail{0};
+
+    alignas(64) std::atomic<uint64_t> m_tail{0};   // Written by the consumer
+    uint64_t m_cached_head{0};
+
+  public:
+    // capacity must be a power of two
+    explicit SpscQueue(const size_t capacity) : m_capacity(capacity), m_slots(new T[capacity]) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    size_t GetCapacity() const noexcept { return m_capacity; }
+
+    // Producer: false when the queue is full
+    bool TryPush(const T& value) noexcept;
+    // Consumer: false when the queue is empty
+    bool TryPop(T& value) noexcept;
+
+    // Either side; only a snapshot while the other side is running
+    size_t GetSize() const noexcept;
+};
+
+template<typename T>
+bool SpscQueue<T>::TryPush(const T& value) noexcept
+{
+    const uint64_t head = m_head.load(std::memory_order_relaxed);
+    if (head - m_cached_tail >= m_capacity)
+    {
+        m_cached_tail = m_tail.load(std::memory_order_acquire);
+        if (head - m_cached_tail >= m_capacity)
+        {
+            return false;
+        }
+    }
+
+    m_slots[head & (m_capacity - 1)] = value;
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+bool SpscQueue<T>::TryPop(T& value) noexcept
+{
+    const uint64_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail == m_cached_head)
+    {
+        m_cached_head = m_head.load(std::memory_order_acquire);
+        if (tail == m_cached_head)
+        {
+            return false;
+        }
+    }
+
+    value = m_slots[tail & (m_capacity - 1)];
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+size_t SpscQueue<T>::GetSize() const noexcept
+{
+    return static_cast<size_t>(m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire));
+}
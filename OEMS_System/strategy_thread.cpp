@@ -0,0 +1,240 @@
+#include "strategy_thread.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "binary_logger.h"
+#include "order_book.h"
+#include "order_store.h"
+#include "position_engine.h"
+
+namespace
+{
+    const LogFormat LOG_TOO_MANY_PRODUCERS{LogLevel::ERR, "[Strategy] More than {} threads publish; dropping"};
+    const LogFormat LOG_HANDLER_EXCEPTION{LogLevel::ERR, "[Strategy] Exception handling an event: {}"};
+
+    std::atomic<uint64_t> g_next_instance_id{1};
+
+    void CpuRelax() noexcept
+    {
+#if defined(_M_X64) || defined(__x86_64__)
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    MarketEvent MakeEvent(const MarketEventType type, const std::string& instrument_name)
+    {
+        MarketEvent event{};
+        event.type = type;
+        event.SetInstrument(instrument_name);
+        return event;
+    }
+}
+
+bool MarketEvent::SetInstrument(const std::string_view instrument_name) noexcept
+{
+    if (instrument_name.size() > MAX_INSTRUMENT_SIZE)
+    {
+        instrument_size = 0;
+        return false;
+    }
+    std::memcpy(instrument, instrument_name.data(), instrument_name.size());
+    instrument_size = static_cast<uint8_t>(instrument_name.size());
+    return true;
+}
+
+std::string_view MarketEvent::GetInstrument() const noexcept
+{
+    return std::string_view(instrument, instrument_size);
+}
+
+StrategyThread::StrategyThread(ThreadPlacement placement, const size_t queue_capacity)
+    : m_placement(std::move(placement)),
+      m_queue_capacity(queue_capacity),
+      m_instance_id(g_next_instance_id.fetch_add(1, std::memory_order_relaxed))
+{
+}
+
+StrategyThread::~StrategyThread()
+{
+    Stop();
+}
+
+void StrategyThread::AddHandler(EventHandler handler)
+{
+    m_handlers.push_back(std::move(handler));
+}
+
+void StrategyThread::Subscribe(OrderBookManager& order_book_manager, OrderStore& order_store,
+                               PositionEngine& position_engine)
+{
+    order_book_manager.AddUpdateListener([this](const std::string& instrument_name)
+                                         { Publish(MakeEvent(MarketEventType::BOOK, instrument_name)); });
+    order_store.AddUpdateListener([this](const std::string& instrument_name)
+                                  { Publish(MakeEvent(MarketEventType::ORDERS, instrument_name)); });
+    position_engine.AddUpdateListener(
+        [this](const PositionSnapshot& position)
+        {
+            MarketEvent event = MakeEvent(MarketEventType::POSITION, position.instrument_name);
+            event.position_size = position.size;
+            event.mark_price = position.mark_price;
+            Publish(event);
+        });
+}
+
+void StrategyThread::Start()
+{
+    if (m_is_running.exchange(true))
+    {
+        return;
+    }
+    m_thread = std::thread([this]() { Run(); });
+}
+
+void StrategyThread::Stop()
+{
+    if (!m_is_running.exchange(false))
+    {
+        return;
+    }
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+bool StrategyThread::Publish(MarketEvent event) noexcept
+{
+    EventQueue* const queue = GetQueueForThisThread();
+    event.publish_ns = LatencyRecorder::NowNs();
+    if (!queue || !queue->TryPush(event))
+    {
+        m_dropped_count.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+// Function to find the queue the calling thread publishes on, making one on its first publish
+StrategyThread::EventQueue* StrategyThread::GetQueueForThisThread()
+{
+    struct CachedQueue
+    {
+        uint64_t instance_id;
+        EventQueue* queue;
+    };
+    thread_local std::vector<CachedQueue> t_queues;
+
+    for (const CachedQueue& cached : t_queues)
+    {
+        if (cached.instance_id == m_instance_id)
+        {
+            return cached.queue;
+        }
+    }
+
+    EventQueue* const queue = AddQueue();
+    if (queue)
+    {
+        t_queues.push_back({m_instance_id, queue});
+    }
+    return queue;
+}
+
+StrategyThread::EventQueue* StrategyThread::AddQueue()
+{
+    std::lock_guard<std::mutex> lock(m_queues_mutex);
+    const size_t count = m_queue_count.load(std::memory_order_relaxed);
+    if (count == MAX_PRODUCERS)
+    {
+        BinaryLogger::Write(LOG_TOO_MANY_PRODUCERS, MAX_PRODUCERS);
+        return nullptr;
+    }
+
+    m_queues[count] = std::make_unique<EventQueue>(m_queue_capacity);
+    // The consumer only looks at queues below the count, so the queue is complete before it is seen
+    m_queue_count.store(count + 1, std::memory_order_release);
+    return m_queues[count].get();
+}
+
+void StrategyThread::Run()
+{
+    ThreadTopology::ApplyToCurrentThread(m_placement);
+
+    uint32_t idle_polls = 0;
+    while (m_is_running.load(std::memory_order_acquire))
+    {
+        if (PollOnce() != 0)
+        {
+            idle_polls = 0;
+        }
+        else if (m_placement.is_busy_poll || ++idle_polls < IDLE_SPIN_COUNT)
+        {
+            CpuRelax();
+        }
+        else
+        {
+            std::this_thread::sleep_for(IDLE_SLEEP);
+        }
+    }
+
+    // Events published before Stop are still handled
+    while (PollOnce() != 0)
+    {
+    }
+}
+
+size_t StrategyThread::PollOnce()
+{
+    const size_t queue_count = m_queue_count.load(std::memory_order_acquire);
+    size_t handled = 0;
+    MarketEvent event;
+    for (size_t i = 0; i < queue_count; ++i)
+    {
+        EventQueue& queue = *m_queues[i];
+        for (size_t n = 0; n < BATCH_SIZE && queue.TryPop(event); ++n)
+        {
+            m_handoff_latency.Record(LatencyRecorder::NowNs() - event.publish_ns);
+            try
+            {
+                for (const auto& handler : m_handlers)
+                {
+                    handler(event);
+                }
+            }
+            catch (const std::exception& e)
+            {
+                BinaryLogger::Write(LOG_HANDLER_EXCEPTION, e.what());
+            }
+            ++handled;
+        }
+    }
+
+    if (handled != 0)
+    {
+        m_event_count.fetch_add(handled, std::memory_order_relaxed);
+    }
+    return handled;
+}
+
+uint64_t StrategyThread::GetEventCount() const noexcept
+{
+    return m_event_count.load(std::memory_order_relaxed);
+}
+
+uint64_t StrategyThread::GetDroppedCount() const noexcept
+{
+    return m_dropped_count.load(std::memory_order_relaxed);
+}
+
+const LatencyHistogram& StrategyThread::GetHandoffLatency() const noexcept
+{
+    return m_handoff_latency;
+}
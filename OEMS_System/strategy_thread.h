@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "latency_recorder.h"
+#include "spsc_queue.h"
+#include "thread_topology.h"
+
+class OrderBookManager;
+class OrderStore;
+class PositionEngine;
+
+enum class MarketEventType : uint8_t
+{
+    BOOK,       // A book changed; OrderBookManager holds its new state
+    ORDERS,     // Our open orders on the instrument may have changed; OrderStore holds them
+    POSITION    // A position or its mark price changed; position_size and mark_price carry the new values
+};
+
+// Fixed-size, so it is copied through a queue without allocating. Books and orders are named rather than
+// copied, and read from their owners under their own locks when they are handled.
+struct MarketEvent
+{
+    static constexpr size_t MAX_INSTRUMENT_SIZE = 46;
+
+    MarketEventType type;
+    uint8_t instrument_size;
+    char instrument[MAX_INSTRUMENT_SIZE];
+    int64_t publish_ns;             // LatencyRecorder::NowNs when it was published
+    double position_size;           // POSITION only
+    double mark_price;              // POSITION only
+
+    // False if the name does not fit
+    bool SetInstrument(std::string_view instrument_name) noexcept;
+    std::string_view GetInstrument() const noexcept;
+};
+
+// A consumer thread fed by the threads that publish to it, each through a bounded queue of its own, so no
+// two producers ever write the same queue. Publishing never blocks: an event that finds its queue full is
+// dropped and counted. Handlers run on this thread only, in the order events were published per producer.
+//
+// While idle the thread spins for a while and then sleeps briefly, unless its placement asks for busy-poll,
+// in which case it spins for good and keeps its core.
+class StrategyThread
+{
+  public:
+    using EventHandler = std::function<void(const MarketEvent& event)>;
+
+    static constexpr size_t DEFAULT_QUEUE_CAPACITY = size_t{1} << 14;
+    static constexpr size_t MAX_PRODUCERS = 8;
+    // Events taken from one queue before moving on to the next
+    static constexpr size_t BATCH_SIZE = 64;
+    static constexpr uint32_t IDLE_SPIN_COUNT = 1024;
+    static constexpr std::chrono::microseconds IDLE_SLEEP{50};
+
+  private:
+    using EventQueue = SpscQueue<MarketEvent>;
+
+    const ThreadPlacement m_placement;
+    const size_t m_queue_capacity;
+    // Tells this instance apart in the per-thread queue cache, which may outlive it
+    const uint64_t m_instance_id;
+
+    std::mutex m_queues_mutex;
+    std::array<std::unique_ptr<EventQueue>, MAX_PRODUCERS> m_queues;
+    std::atomic<size_t> m_queue_count{0};
+
+    std::vector<EventHandler> m_handlers;
+    std::thread m_thread;
+    std::atomic<bool> m_is_running{false};
+
+    std::atomic<uint64_t> m_event_count{0};
+    std::atomic<uint64_t> m_dropped_count{0};
+    LatencyHistogram m_handoff_latency;
+
+    EventQueue* GetQueueForThisThread();
+    EventQueue* AddQueue();
+
+    void Run();
+    size_t PollOnce();
+
+  public:
+    explicit StrategyThread(ThreadPlacement placement, size_t queue_capacity = DEFAULT_QUEUE_CAPACITY);
+    ~StrategyThread();
+
+    StrategyThread(const StrategyThread&) = delete;
+    StrategyThread& operator=(const StrategyThread&) = delete;
+
+    // Must be added before Start
+    void AddHandler(EventHandler handler);
+    // Publishes every update of the three to this thread; must be called before they start
+    void Subscribe(OrderBookManager& order_book_manager, OrderStore& order_store, PositionEngine& position_engine);
+
+    void Start();
+    // Handles what is already queued, then joins the thread; also run on destruction
+    void Stop();
+
+    // Any thread; the first call from a thread gives it a queue
+    bool Publish(MarketEvent event) noexcept;
+
+    uint64_t GetEventCount() const noexcept;
+    uint64_t GetDroppedCount() const noexcept;
+    // Publish to the start of handling, per event
+    const LatencyHistogram& GetHandoffLatency() const noexcept;
+};
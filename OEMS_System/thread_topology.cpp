@@ -0,0 +1,126 @@
+#include "thread_topology.h"
+
+#include <fstream>
+
+#include <json/json.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "binary_logger.h"
+
+namespace
+{
+    const LogFormat LOG_CONFIG_INVALID{LogLevel::ERR, "[Threads] Failed to parse {}: {}"};
+    const LogFormat LOG_PIN_FAILED{LogLevel::WARN, "[Threads] Failed to pin {} to CPU {}"};
+    const LogFormat LOG_BUSY_POLL_IGNORED{LogLevel::WARN, "[Threads] {} runs an event loop and cannot busy-poll"};
+    const LogFormat LOG_PLACED{LogLevel::INFO, "[Threads] {} on CPU {}, busy-poll {}"};
+
+    void ReadPlacement(const Json::Value& config, const char* key, ThreadPlacement& placement)
+    {
+        const Json::Value& entry = config[key];
+        if (!entry.isObject())
+        {
+            return;
+        }
+        placement.cpu = entry.get("cpu", placement.cpu).asInt();
+        placement.is_busy_poll = entry.get("busy_poll", placement.is_busy_poll).asBool();
+    }
+}
+
+bool ThreadTopology::LoadConfig(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return true;
+    }
+
+    Json::CharReaderBuilder builder;
+    Json::Value config;
+    std::string errors;
+    if (!Json::parseFromStream(builder, file, &config, &errors) || !config.isObject())
+    {
+        BinaryLogger::Write(LOG_CONFIG_INVALID, path, errors);
+        return false;
+    }
+
+    ReadPlacement(config, "market_data", m_market_data);
+    ReadPlacement(config, "gateway", m_gateway);
+    ReadPlacement(config, "strategy", m_strategy);
+    return true;
+}
+
+std::unique_ptr<trantor::EventLoopThread> ThreadTopology::StartLoop(const ThreadPlacement& placement)
+{
+    // epoll and IOCP wait in the kernel; spinning would need a loop of our own
+    if (placement.is_busy_poll)
+    {
+        BinaryLogger::Write(LOG_BUSY_POLL_IGNORED, placement.name);
+    }
+
+    auto thread = std::make_unique<trantor::EventLoopThread>(placement.name);
+    thread->run();
+    thread->getLoop()->runInLoop([placement]() { ApplyToCurrentThread(placement); });
+    return thread;
+}
+
+void ThreadTopology::Start()
+{
+    if (m_market_data_thread)
+    {
+        return;
+    }
+    m_market_data_thread = StartLoop(m_market_data);
+    m_gateway_thread = StartLoop(m_gateway);
+}
+
+trantor::EventLoop* ThreadTopology::GetMarketDataLoop() const noexcept
+{
+    return m_market_data_thread ? m_market_data_thread->getLoop() : nullptr;
+}
+
+trantor::EventLoop* ThreadTopology::GetGatewayLoop() const noexcept
+{
+    return m_gateway_thread ? m_gateway_thread->getLoop() : nullptr;
+}
+
+const ThreadPlacement& ThreadTopology::GetStrategyPlacement() const noexcept
+{
+    return m_strategy;
+}
+
+bool ThreadTopology::ApplyToCurrentThread(const ThreadPlacement& placement)
+{
+    bool is_pinned = true;
+#ifdef _WIN32
+    const std::wstring name(placement.name.begin(), placement.name.end());
+    SetThreadDescription(GetCurrentThread(), name.c_str());
+    if (placement.cpu >= 0)
+    {
+        is_pinned = SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{1} << placement.cpu) != 0;
+    }
+#else
+    // Linux limits thread names to 15 characters
+    pthread_setname_np(pthread_self(), placement.name.substr(0, 15).c_str());
+    if (placement.cpu >= 0)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(placement.cpu, &cpus);
+        is_pinned = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+    }
+#endif
+
+    if (!is_pinned)
+    {
+        BinaryLogger::Write(LOG_PIN_FAILED, placement.name, placement.cpu);
+        return false;
+    }
+    BinaryLogger::Write(LOG_PLACED, placement.name, placement.cpu, placement.is_busy_poll);
+    return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <trantor/net/EventLoopThread.h>
+
+// Where one thread runs and how it waits for work
+struct ThreadPlacement
+{
+    std::string name;
+    int cpu{-1};                // -1 leaves the thread to the scheduler
+    bool is_busy_poll{false};   // Spin instead of sleeping while idle; only threads that poll queues can
+};
+
+// The threads the system runs on, each placed on its own:
+//   market data  the market-data WebSocket, frame parsing and every handler a frame is dispatched to
+//   gateway      the order-entry WebSocket and the completion of its requests
+//   strategy     consumers of the events the market-data thread publishes, see StrategyThread
+// The two connections get event loops of their own instead of the Drogon app loop, so REST calls, timers
+// and the downstream server no longer run between their frames.
+class ThreadTopology
+{
+  public:
+    static constexpr const char* DEFAULT_CONFIG_PATH = "threads.json";
+
+  private:
+    ThreadPlacement m_market_data{"oems-md"};
+    ThreadPlacement m_gateway{"oems-gateway"};
+    ThreadPlacement m_strategy{"oems-strategy"};
+
+    std::unique_ptr<trantor::EventLoopThread> m_market_data_thread;
+    std::unique_ptr<trantor::EventLoopThread> m_gateway_thread;
+
+    static std::unique_ptr<trantor::EventLoopThread> StartLoop(const ThreadPlacement& placement);
+
+  public:
+    ThreadTopology() = default;
+
+    ThreadTopology(const ThreadTopology&) = delete;
+    ThreadTopology& operator=(const ThreadTopology&) = delete;
+
+    // Reads placements from a file such as
+    //   {"market_data": {"cpu": 2}, "gateway": {"cpu": 3}, "strategy": {"cpu": 4, "busy_poll": true}}
+    // Anything left out keeps its default. A missing file is not an error; an unreadable one is.
+    bool LoadConfig(const std::string& path = DEFAULT_CONFIG_PATH);
+
+    // Starts and places the two connection loops; connections must be created after this
+    void Start();
+
+    // Null before Start, in which case connections fall back to the Drogon app loop
+    trantor::EventLoop* GetMarketDataLoop() const noexcept;
+    trantor::EventLoop* GetGatewayLoop() const noexcept;
+    const ThreadPlacement& GetStrategyPlacement() const noexcept;
+
+    // Names the calling thread and pins it to placement.cpu if one is set; false if pinning failed
+    static bool ApplyToCurrentThread(const ThreadPlacement& placement);
+};
@@ -0,0 +1,315 @@
+#include "ticker_feed.h"
+
+#include <algorithm>
+
+#include "binary_logger.h"
+#include "latency_recorder.h"
+#include "web_socket_client.h"
+
+namespace {
+    const LogFormat LOG_MALFORMED_TICKER{LogLevel::ERR, "[TickerFeed] Malformed ticker update"};
+    const LogFormat LOG_LATE_CONSUMER{LogLevel::WARN,
+                                      "[TickerFeed] Consumer added after Start, its held updates may be late"};
+    const LogFormat LOG_UNKNOWN_CONSUMER{LogLevel::ERR, "[TickerFeed] Unknown consumer {}"};
+
+    // Copies one state into the batch, reusing entries so their strings keep their capacity
+    void AppendToBatch(std::vector<TickerUpdate>& batch, size_t& count, const TickerUpdate& ticker)
+    {
+        if (count == batch.size())
+        {
+            batch.emplace_back();
+        }
+        batch[count++] = ticker;
+    }
+}
+
+TickerFeed::TickerFeed(DrogonWebSocket& web_socket) : m_web_socket(web_socket)
+{
+}
+
+TickerFeed::~TickerFeed()
+{
+    if (m_flush_timer != 0)
+    {
+        m_web_socket.GetLoop()->invalidateTimer(m_flush_timer);
+    }
+}
+
+std::string TickerFeed::GetChannelName(const std::string_view instrument_name)
+{
+    std::string channel = "ticker.";
+    channel += instrument_name;
+    channel += '.';
+    channel += TICKER_INTERVAL;
+    return channel;
+}
+
+TickerFeed::Interest* TickerFeed::FindInterest(InstrumentState& state, const ConsumerId consumer) noexcept
+{
+    for (auto& interest : state.interests)
+    {
+        if (interest.consumer == consumer)
+        {
+            return &interest;
+        }
+    }
+    return nullptr;
+}
+
+TickerFeed::ConsumerId TickerFeed::AddConsumer(const ConflationPolicy policy, TickerHandler handler)
+{
+    if (m_flush_timer != 0)
+    {
+        BinaryLogger::Write(LOG_LATE_CONSUMER);
+    }
+    auto consumer = std::make_unique<Consumer>();
+    consumer->policy = policy;
+    consumer->handler = std::move(handler);
+    m_consumers.push_back(std::move(consumer));
+    return static_cast<ConsumerId>(m_consumers.size() - 1);
+}
+
+void TickerFeed::Start()
+{
+    // The shortest interval bounds how late any held update can be
+    std::chrono::milliseconds flush_interval{0};
+    for (const auto& consumer : m_consumers)
+    {
+        if (consumer->policy.mode == ConflationMode::INTERVAL &&
+            (flush_interval.count() == 0 || consumer->policy.interval < flush_interval))
+        {
+            flush_interval = consumer->policy.interval;
+        }
+    }
+    if (flush_interval.count() == 0 || m_flush_timer != 0)
+    {
+        return;
+    }
+
+    m_flush_timer = m_web_socket.GetLoop()->runEvery(std::chrono::duration<double>(flush_interval).count(),
+                                                     [this]() { Flush(); });
+}
+
+void TickerFeed::Track(const ConsumerId consumer, const std::vector<std::string>& instruments)
+{
+    if (consumer >= m_consumers.size())
+    {
+        BinaryLogger::Write(LOG_UNKNOWN_CONSUMER, consumer);
+        return;
+    }
+
+    std::vector<std::string> channels;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& instrument : instruments)
+    {
+        const auto [it, is_new] = m_instruments.try_emplace(instrument);
+        if (is_new)
+        {
+            channels.push_back(GetChannelName(instrument));
+        }
+        if (!FindInterest(it->second, consumer))
+        {
+            it->second.interests.push_back({consumer, ConflationSlot{}});
+        }
+    }
+
+    // Under the lock so a concurrent Untrack cannot reach the socket first; dispatch never holds the socket's
+    // lock while calling us, so this cannot deadlock
+    if (!channels.empty())
+    {
+        m_web_socket.Subscribe(channels,
+                               [this](std::string_view, const std::string_view data) { OnTickerMessage(data); });
+    }
+}
+
+void TickerFeed::Untrack(const ConsumerId consumer, const std::vector<std::string>& instruments)
+{
+    if (consumer >= m_consumers.size())
+    {
+        BinaryLogger::Write(LOG_UNKNOWN_CONSUMER, consumer);
+        return;
+    }
+
+    std::vector<std::string> channels;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& pending = m_consumers[consumer]->pending;
+    for (const auto& instrument : instruments)
+    {
+        const auto it = m_instruments.find(instrument);
+        if (it == m_instruments.end())
+        {
+            continue;
+        }
+
+        InstrumentState& state = it->second;
+        const auto interest = std::find_if(state.interests.begin(), state.interests.end(),
+                                           [consumer](const Interest& entry) { return entry.consumer == consumer; });
+        if (interest == state.interests.end())
+        {
+            continue;
+        }
+        state.interests.erase(interest);
+        pending.erase(std::remove(pending.begin(), pending.end(), &state), pending.end());
+
+        if (state.interests.empty())
+        {
+            channels.push_back(GetChannelName(instrument));
+            m_instruments.erase(it);
+        }
+    }
+
+    if (!channels.empty())
+    {
+        m_web_socket.Unsubscribe(channels);
+    }
+}
+
+// Function to fold one ticker into the instrument's state and call the consumers whose policy lets it through
+void TickerFeed::OnTickerMessage(const std::string_view data)
+{
+    if (!MarketDataDecoder::DecodeTicker(data, m_scratch_ticker))
+    {
+        BinaryLogger::Write(LOG_MALFORMED_TICKER);
+        return;
+    }
+
+    const int64_t now_ns = LatencyRecorder::NowNs();
+    m_deliveries.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto it = m_instruments.find(m_scratch_ticker.instrument_name);
+        if (it == m_instruments.end())
+        {
+            // Untracked with the unsubscribe still on its way
+            return;
+        }
+
+        InstrumentState& state = it->second;
+        state.latest = m_scratch_ticker;
+        for (auto& interest : state.interests)
+        {
+            Consumer& consumer = *m_consumers[interest.consumer];
+            const bool was_pending = interest.slot.is_pending;
+            if (interest.slot.Admit(consumer.policy, now_ns, m_scratch_ticker.mark_price))
+            {
+                ++consumer.delivered;
+                m_deliveries.push_back(&consumer);
+            }
+            else if (was_pending || consumer.policy.mode == ConflationMode::PRICE_CHANGE)
+            {
+                ++consumer.conflated;
+            }
+            else
+            {
+                consumer.pending.push_back(&state);
+            }
+        }
+    }
+
+    // The scratch state is only rewritten by the next message on this thread
+    for (Consumer* consumer : m_deliveries)
+    {
+        consumer->handler(m_scratch_ticker);
+    }
+}
+
+// Function to hand INTERVAL consumers the updates they have held for a full interval
+void TickerFeed::Flush()
+{
+    const int64_t now_ns = LatencyRecorder::NowNs();
+    m_flush_batches.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (ConsumerId id = 0; id < m_consumers.size(); ++id)
+        {
+            Consumer& consumer = *m_consumers[id];
+            if (consumer.policy.mode != ConflationMode::INTERVAL || consumer.pending.empty())
+            {
+                continue;
+            }
+
+            size_t count = 0;
+            size_t kept = 0;
+            for (InstrumentState* state : consumer.pending)
+            {
+                Interest* interest = FindInterest(*state, id);
+                if (!interest || !interest->slot.is_pending)
+                {
+                    // A later message went through on its own in the meantime
+                    continue;
+                }
+                if (interest->slot.TakeIfDue(consumer.policy, now_ns, state->latest.mark_price))
+                {
+                    AppendToBatch(consumer.batch, count, state->latest);
+                }
+                else
+                {
+                    consumer.pending[kept++] = state;
+                }
+            }
+            consumer.pending.resize(kept);
+
+            if (count != 0)
+            {
+                consumer.delivered += count;
+                m_flush_batches.emplace_back(&consumer, count);
+            }
+        }
+    }
+
+    for (const auto& [consumer, count] : m_flush_batches)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            consumer->handler(consumer->batch[i]);
+        }
+    }
+}
+
+size_t TickerFeed::Poll(const ConsumerId consumer_id)
+{
+    if (consumer_id >= m_consumers.size())
+    {
+        BinaryLogger::Write(LOG_UNKNOWN_CONSUMER, consumer_id);
+        return 0;
+    }
+
+    Consumer& consumer = *m_consumers[consumer_id];
+    const int64_t now_ns = LatencyRecorder::NowNs();
+    size_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (InstrumentState* state : consumer.pending)
+        {
+            Interest* interest = FindInterest(*state, consumer_id);
+            if (interest && interest->slot.TakePending(now_ns, state->latest.mark_price))
+            {
+                AppendToBatch(consumer.batch, count, state->latest);
+            }
+        }
+        consumer.pending.clear();
+        consumer.delivered += count;
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        consumer.handler(consumer.batch[i]);
+    }
+    return count;
+}
+
+size_t TickerFeed::GetInstrumentCount() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_instruments.size();
+}
+
+TickerConsumerStats TickerFeed::GetStats(const ConsumerId consumer) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (consumer >= m_consumers.size())
+    {
+        return {0, 0};
+    }
+    return {m_consumers[consumer]->delivered, m_consumers[consumer]->conflated};
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <trantor/net/EventLoop.h>
+
+#include "conflation.h"
+#include "market_data_decoder.h"
+
+class DrogonWebSocket;
+
+struct TickerConsumerStats
+{
+    uint64_t delivered;
+    uint64_t conflated;              // Updates the consumer never saw because a newer one replaced them
+};
+
+// Instrument tickers from one raw subscription each, handed to any number of consumers at the rate each
+// asks for.
+//
+// ticker.{instrument}.raw carries every change. The feed subscribes an instrument once however many
+// consumers follow it, decodes each message once and keeps the newest state per instrument in place. Each
+// consumer's policy then decides whether a message reaches it now, waits as that consumer's pending state or
+// is skipped, so a fast consumer sees every tick and a slow one is at most one state behind without anything
+// being queued. PRICE_CHANGE looks at the mark price. Raw tickers need an authenticated connection.
+class TickerFeed
+{
+  public:
+    using ConsumerId = uint32_t;
+    // Push policies are called on the market-data thread, LATEST on the thread that polls
+    using TickerHandler = std::function<void(const TickerUpdate& ticker)>;
+
+    static constexpr const char* TICKER_INTERVAL = "raw";
+
+  private:
+    struct Interest
+    {
+        ConsumerId consumer;
+        ConflationSlot slot;
+    };
+
+    struct InstrumentState
+    {
+        TickerUpdate latest;
+        std::vector<Interest> interests;
+    };
+
+    struct Consumer
+    {
+        ConflationPolicy policy;
+        TickerHandler handler;
+        // Instruments holding an update for this consumer; LATEST and INTERVAL only
+        std::vector<InstrumentState*> pending;
+        // Copies handed to the handler outside the lock, reused by Poll or the flush timer
+        std::vector<TickerUpdate> batch;
+        uint64_t delivered{0};
+        uint64_t conflated{0};
+    };
+
+    DrogonWebSocket& m_web_socket;
+    // Fixed once Start has run
+    std::vector<std::unique_ptr<Consumer>> m_consumers;
+    trantor::TimerId m_flush_timer{0};
+
+    mutable std::mutex m_mutex;
+    // Nodes are stable, so the consumers' pending lists can point into this map
+    std::unordered_map<std::string, InstrumentState> m_instruments;
+
+    // Only touched on the market-data thread
+    TickerUpdate m_scratch_ticker;
+    std::vector<Consumer*> m_deliveries;
+    // Consumers given a batch by the flush timer, with how much of it this flush filled
+    std::vector<std::pair<Consumer*, size_t>> m_flush_batches;
+
+    static std::string GetChannelName(std::string_view instrument_name);
+    static Interest* FindInterest(InstrumentState& state, ConsumerId consumer) noexcept;
+
+    void OnTickerMessage(std::string_view data);
+    void Flush();
+
+  public:
+    explicit TickerFeed(DrogonWebSocket& web_socket);
+    ~TickerFeed();
+
+    TickerFeed(const TickerFeed&) = delete;
+    TickerFeed& operator=(const TickerFeed&) = delete;
+
+    // Consumers must be added before Start
+    ConsumerId AddConsumer(ConflationPolicy policy, TickerHandler handler);
+
+    // Starts the timer that hands INTERVAL consumers the updates they were holding, on the connection's loop
+    void Start();
+
+    // Subscribes instruments no other consumer follows yet; Untrack unsubscribes those it was the last one on
+    void Track(ConsumerId consumer, const std::vector<std::string>& instruments);
+    void Untrack(ConsumerId consumer, const std::vector<std::string>& instruments);
+
+    // LATEST: calls the consumer's handler once for each instrument updated since the last poll, with its newest
+    // state. Returns the number of calls.
+    size_t Poll(ConsumerId consumer);
+
+    size_t GetInstrumentCount() const;
+    TickerConsumerStats GetStats(ConsumerId consumer) const;
+};
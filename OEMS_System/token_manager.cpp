@@ -1,10 +1,18 @@
 #include "token_manager.h"
 
+#include <algorithm>
 #include <chrono>
 #include <fstream>
-#include <iostream>
+#include <utility>
 
-#include <drogon/HttpClient.h>
+#include "binary_logger.h"
+
+namespace
+{
+    const LogFormat LOG_REFRESHING{LogLevel::INFO, "[TokenManager] Refreshing access token using refresh token..."};
+    const LogFormat LOG_REFRESHED{LogLevel::INFO, "[TokenManager] Token refreshed successfully!"};
+    const LogFormat LOG_BACKGROUND_REFRESH_FAILED{LogLevel::ERR, "[TokenManager] Background token refresh failed"};
+}
 
 std::string TokenManager::ReadTokenFromFile(const std::string& file_path)
 {
@@ -21,33 +29,75 @@ std::string TokenManager::ReadTokenFromFile(const std::string& file_path)
 
 TokenManager::TokenManager(const std::string& access_token_file, const std::string& refresh_token_file,
                            const int& expires_in)
+    : m_client(drogon::HttpClient::newHttpClient("https://test.deribit.com"))
+{
+    // Read tokens from the provided files; expires_in is in seconds
+    Publish(ReadTokenFromFile(access_token_file), ReadTokenFromFile(refresh_token_file), expires_in);
+}
+
+TokenManager::~TokenManager()
+{
+    if (m_refresh_timer != 0)
+    {
+        m_client->getLoop()->invalidateTimer(m_refresh_timer);
+    }
+}
+
+const TokenManager::TokenState& TokenManager::GetState() const noexcept
 {
-    // Read tokens from the provided files
-    m_access_token = ReadTokenFromFile(access_token_file);
-    m_refresh_token = ReadTokenFromFile(refresh_token_file);
+    return *m_state.load(std::memory_order_acquire);
+}
 
-    // Set the expiry time based on the expires_in value (in seconds)
-    token_expiry_time = std::chrono::system_clock::now() + std::chrono::seconds(expires_in);
+// Function to publish a new token; readers switch over on their next load
+void TokenManager::Publish(std::string access_token, std::string refresh_token, const int expires_in)
+{
+    auto state = std::make_unique<TokenState>();
+    state->authorization_header = "Bearer " + access_token;
+    state->access_token = std::move(access_token);
+    state->refresh_token = std::move(refresh_token);
+    state->expiry_time = std::chrono::system_clock::now() + std::chrono::seconds(expires_in);
+
+    std::lock_guard<std::mutex> lock(m_publish_mutex);
+    const auto now = std::chrono::steady_clock::now();
+    m_retired_states.erase(std::remove_if(m_retired_states.begin(), m_retired_states.end(),
+                                          [now](const RetiredState& retired)
+                                          { return now - retired.retired_at > RETIRED_STATE_LIFETIME; }),
+                           m_retired_states.end());
+
+    m_state.store(state.get(), std::memory_order_release);
+    if (m_current_state)
+    {
+        m_retired_states.push_back({std::move(m_current_state), now});
+    }
+    m_current_state = std::move(state);
 }
 
 // Function to return the access token
 const std::string& TokenManager::GetAccessToken() const
 {
-    return m_access_token;
+    return GetState().access_token;
+}
+
+// Function to return the cached Authorization header value
+const std::string& TokenManager::GetAuthorizationHeader() const
+{
+    return GetState().authorization_header;
 }
 
 // Function to check if the access token has expired
 bool TokenManager::IsAccessTokenExpired() const
 {
-    return std::chrono::system_clock::now() >= token_expiry_time;
+    return std::chrono::system_clock::now() >= GetState().expiry_time;
 }
 
-// Function to refresh the access token using the refresh token
-bool TokenManager::RefreshAccessToken(const std::string& client_id, const std::string& client_secret)
+bool TokenManager::IsRefreshDue() const
 {
-    std::cout << "Refreshing access token using refresh token...\n";
+    return std::chrono::system_clock::now() + REFRESH_AHEAD >= GetState().expiry_time;
+}
 
-    const auto client = drogon::HttpClient::newHttpClient("https://test.deribit.com");
+drogon::HttpRequestPtr TokenManager::NewRefreshRequest(const std::string& client_id,
+                                                       const std::string& client_secret) const
+{
     const auto req = drogon::HttpRequest::newHttpRequest();
 
     // Set the request parameters
@@ -55,35 +105,87 @@ bool TokenManager::RefreshAccessToken(const std::string& client_id, const std::s
     req->setPath("/api/v2/public/auth");
     req->addHeader("Content-Type", "application/x-www-form-urlencoded");
 
-    const std::string body = "grant_type=refresh_token&refresh_token=" + m_refresh_token +
+    const std::string body = "grant_type=refresh_token&refresh_token=" + GetState().refresh_token +
                              "&client_id=" + client_id + "&client_secret=" + client_secret;
     req->setBody(body);
+    return req;
+}
 
-    // Send the request
-    auto [result, response] = client->sendRequest(req);
-    if (result == drogon::ReqResult::Ok && response->getStatusCode() == drogon::k200OK)
+bool TokenManager::ApplyRefreshResponse(const drogon::ReqResult result, const drogon::HttpResponsePtr& response)
+{
+    if (result == drogon::ReqResult::Ok && response && response->getStatusCode() == drogon::k200OK)
     {
-        if (const auto json_resp = response->getJsonObject())
+        const auto json_resp = response->getJsonObject();
+        if (!json_resp || json_resp->isMember("error"))
         {
-            m_access_token = (*json_resp)["result"]["access_token"].asString();
-            m_refresh_token = (*json_resp)["result"]["refresh_token"].asString();
-            const int expires_in = (*json_resp)["result"]["expires_in"].asInt();
+            return false;
+        }
 
-            token_expiry_time = std::chrono::system_clock::now() + std::chrono::seconds(expires_in);
-            std::cout << "Token refreshed successfully!\n";
-            return true;
+        // A partial reply would wipe the refresh token and leave nothing to recover with
+        const Json::Value& token = static_cast<const Json::Value&>(*json_resp)["result"];
+        if (!token.isObject())
+        {
+            return false;
+        }
+        std::string access_token = token["access_token"].asString();
+        std::string refresh_token = token["refresh_token"].asString();
+        const int expires_in = token["expires_in"].asInt();
+        if (access_token.empty() || refresh_token.empty() || expires_in <= 0)
+        {
+            return false;
         }
-    }
 
-    std::cerr << "Failed to refresh the access token.\n";
+        Publish(std::move(access_token), std::move(refresh_token), expires_in);
+        return true;
+    }
     return false;
 }
 
+void TokenManager::StartAutoRefresh(const std::string& client_id, const std::string& client_secret)
+{
+    m_client_id = client_id;
+    m_client_secret = client_secret;
+
+    if (m_refresh_timer != 0)
+    {
+        m_client->getLoop()->invalidateTimer(m_refresh_timer);
+    }
+    m_refresh_timer = m_client->getLoop()->runEvery(static_cast<double>(REFRESH_CHECK_INTERVAL.count()),
+                                                    [this]() { RefreshInBackground(); });
+}
+
+void TokenManager::RequestRefresh()
+{
+    RefreshInBackground();
+}
+
+// Function to refresh ahead of expiry on the client loop; a failed attempt is retried on the next check
+void TokenManager::RefreshInBackground()
+{
+    if (!IsRefreshDue() || m_is_refreshing.exchange(true))
+    {
+        return;
+    }
+
+    BinaryLogger::Write(LOG_REFRESHING);
+    m_client->sendRequest(NewRefreshRequest(m_client_id, m_client_secret),
+                          [this](const drogon::ReqResult result, const drogon::HttpResponsePtr& response)
+                          {
+                              if (ApplyRefreshResponse(result, response))
+                              {
+                                  BinaryLogger::Write(LOG_REFRESHED);
+                              }
+                              else
+                              {
+                                  BinaryLogger::Write(LOG_BACKGROUND_REFRESH_FAILED);
+                              }
+                              m_is_refreshing = false;
+                          });
+}
+
 // Function to update the access and refresh tokens
 void TokenManager::UpdateTokens(const std::string& new_access_token, const std::string& new_refresh_token,
                                 const int& expires_in)
 {
-    m_access_token = new_access_token;
-    m_refresh_token = new_refresh_token;
-    token_expiry_time = std::chrono::system_clock::now() + std::chrono::seconds(expires_in);
+    Publish(new_access_token, new_refresh_token, expires_in);
 }
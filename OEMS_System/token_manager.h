@@ -1,26 +1,79 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
+#include <drogon/HttpClient.h>
+
+// Holds the current access token. Readers get it with a single atomic load; a background timer refreshes
+// it ahead of expiry and publishes the new token by swapping the pointer.
 class TokenManager
 {
   private:
-    std::string m_access_token;
-    std::string m_refresh_token;
-    std::chrono::system_clock::time_point token_expiry_time;
+    struct TokenState
+    {
+        std::string access_token;
+        std::string refresh_token;
+        std::string authorization_header;  // "Bearer <access_token>"
+        std::chrono::system_clock::time_point expiry_time;
+    };
+
+    struct RetiredState
+    {
+        std::unique_ptr<const TokenState> state;
+        std::chrono::steady_clock::time_point retired_at;
+    };
+
+    std::atomic<const TokenState*> m_state{nullptr};
+    std::mutex m_publish_mutex;
+    std::unique_ptr<const TokenState> m_current_state;
+    // Superseded states stay alive for a while so readers still holding a reference are unaffected
+    std::vector<RetiredState> m_retired_states;
+
+    std::shared_ptr<drogon::HttpClient> m_client;
+    trantor::TimerId m_refresh_timer{0};
+    std::atomic<bool> m_is_refreshing{false};
+    std::string m_client_id;
+    std::string m_client_secret;
 
     static std::string ReadTokenFromFile(const std::string& file_path);
 
+    const TokenState& GetState() const noexcept;
+    void Publish(std::string access_token, std::string refresh_token, int expires_in);
+    drogon::HttpRequestPtr NewRefreshRequest(const std::string& client_id, const std::string& client_secret) const;
+    bool ApplyRefreshResponse(drogon::ReqResult result, const drogon::HttpResponsePtr& response);
+    void RefreshInBackground();
+
   public:
+    static constexpr std::chrono::seconds REFRESH_CHECK_INTERVAL{30};
+    static constexpr std::chrono::seconds REFRESH_AHEAD{300};
+    static constexpr std::chrono::minutes RETIRED_STATE_LIFETIME{10};
+
     TokenManager(const std::string& access_token_file, const std::string& refresh_token_file,
                  const int& expires_in);
+    ~TokenManager();
 
+    TokenManager(const TokenManager&) = delete;
+    TokenManager& operator=(const TokenManager&) = delete;
+
+    // References stay valid for RETIRED_STATE_LIFETIME after the token is replaced
     const std::string& GetAccessToken() const;
+    const std::string& GetAuthorizationHeader() const;
 
     bool IsAccessTokenExpired() const;
+    // True once the token is within REFRESH_AHEAD of expiring
+    bool IsRefreshDue() const;
+
+    // Starts a refresh without waiting for it; does nothing if one is already in flight. Safe to call from
+    // any thread, including the client loop, so the order path never blocks on the auth round trip
+    void RequestRefresh();
 
-    bool RefreshAccessToken(const std::string& client_id, const std::string& client_secret);
+    // Checks every REFRESH_CHECK_INTERVAL on the client loop and refreshes without blocking once due
+    void StartAutoRefresh(const std::string& client_id, const std::string& client_secret);
 
     void UpdateTokens(const std::string& new_access_token, const std::string& new_refresh_token,
                       const int& expires_in);
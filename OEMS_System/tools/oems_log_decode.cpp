@@ -0,0 +1,16 @@
+#include <iostream>
+
+#include "binary_logger.h"
+
+// Prints a binary log written by BinaryLogger as text, one record per line
+int main(int argc, char* argv[])
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: oems_log_decode <file.binlog>\n";
+        return 1;
+    }
+
+    std::ios_base::sync_with_stdio(false);
+    return BinaryLogger::DecodeFile(argv[1], std::cout) ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "binary_logger.h"
+#include "market_data_decoder.h"
+#include "market_data_journal.h"
+#include "market_data_replayer.h"
+#include "order_book.h"
+#include "order_store.h"
+#include "position_engine.h"
+#include "risk_engine.h"
+#include "ticker_feed.h"
+#include "web_socket_client.h"
+
+namespace
+{
+    // Only the replaying thread's allocations are wanted, not the logger's
+    thread_local uint64_t t_allocation_count = 0;
+
+    uint64_t GetAllocationCount()
+    {
+        return t_allocation_count;
+    }
+
+    bool StartsWith(const std::string_view text, const std::string_view prefix)
+    {
+        return text.compare(0, prefix.size(), prefix) == 0;
+    }
+
+    bool EndsWith(const std::string_view text, const std::string_view suffix)
+    {
+        return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // The instrument in a channel named prefix + instrument + suffix, or empty if it is not one
+    std::string GetInstrument(const std::string& channel, const std::string_view prefix, const std::string_view suffix)
+    {
+        if (channel.size() <= prefix.size() + suffix.size() || !StartsWith(channel, prefix) ||
+            !EndsWith(channel, suffix))
+        {
+            return {};
+        }
+        return channel.substr(prefix.size(), channel.size() - prefix.size() - suffix.size());
+    }
+}
+
+// Allocations are counted so the replay can report them per message, as the bench does
+void* operator new(const size_t size)
+{
+    ++t_allocation_count;
+    if (void* ptr = std::malloc(size == 0 ? 1 : size))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](const size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+// Replays a market-data journal through the same components the live process runs, with no network
+int main(int argc, char* argv[])
+{
+    std::string path;
+    ReplayPace pace = ReplayPace::MAX_SPEED;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string_view arg = argv[i];
+        if (arg == "--recorded-pace")
+        {
+            pace = ReplayPace::RECORDED;
+        }
+        else if (path.empty())
+        {
+            path = std::string(arg);
+        }
+        else
+        {
+            path.clear();
+            break;
+        }
+    }
+    if (path.empty())
+    {
+        std::cerr << "Usage: oems_replay <journal directory or segment> [--recorded-pace]\n";
+        return 1;
+    }
+
+    std::ios_base::sync_with_stdio(false);
+    BinaryLogger& logger = BinaryLogger::Instance();
+    logger.Start("oems_replay.binlog", LogLevel::WARN);
+
+    MarketDataJournalReader reader;
+    if (!reader.Open(path))
+    {
+        logger.Stop();
+        return 1;
+    }
+
+    // Wired as in main, minus the connection
+    DrogonWebSocket market_data;
+    OrderBookManager order_book_manager(market_data);
+    OrderStore order_store(market_data);
+    TickerFeed ticker_feed(market_data);
+    PositionEngine position_engine(market_data, ticker_feed);
+    const auto risk_engine = std::make_unique<RiskEngine>(order_store, position_engine);
+
+    // Subscribe whatever would have been listening to each recorded channel; the rest are still decoded so
+    // their parsing cost shows up
+    std::vector<std::string> book_instruments;
+    TickerUpdate ticker;
+    std::vector<TradeUpdate> trades;
+    for (const auto& channel : MarketDataReplayer::FindChannels(reader))
+    {
+        if (channel == OrderStore::CHANNEL)
+        {
+            order_store.Start();
+        }
+        else if (channel == PositionEngine::CHANNEL)
+        {
+            position_engine.Start();
+        }
+        else if (const std::string instrument = GetInstrument(channel, "book.", ".raw"); !instrument.empty())
+        {
+            order_book_manager.Track(instrument);
+            book_instruments.push_back(instrument);
+        }
+        else if (const std::string instrument = GetInstrument(channel, "ticker.", ".raw"); !instrument.empty())
+        {
+            position_engine.Track(instrument);
+        }
+        else if (StartsWith(channel, "trades."))
+        {
+            market_data.Subscribe({channel}, [&trades](std::string_view, const std::string_view data)
+                                  { MarketDataDecoder::DecodeTrades(data, trades); });
+        }
+        else if (StartsWith(channel, "ticker."))
+        {
+            market_data.Subscribe({channel}, [&ticker](std::string_view, const std::string_view data)
+                                  { MarketDataDecoder::DecodeTicker(data, ticker); });
+        }
+    }
+
+    MarketDataReplayer replayer(market_data);
+    replayer.SetAllocationCounter(GetAllocationCount);
+    const ReplayStats stats = replayer.Run(reader, pace);
+
+    std::string report;
+    MarketDataReplayer::FormatReport(stats, report);
+    std::cout << report;
+    std::cout << "[Replay] " << reader.GetCorruptCount() << " corrupt segments, "
+              << order_book_manager.GetResyncCount() << " book resyncs\n";
+
+    // The final top of each book, to compare one replay of a capture against another
+    std::string book;
+    for (const auto& instrument : book_instruments)
+    {
+        if (order_book_manager.GetOrderBook(instrument, book, 1))
+        {
+            std::cout << "[Replay] " << instrument << ' ' << book << '\n';
+        }
+    }
+
+    logger.Stop();
+    return 0;
+}
@@ -1,6 +1,10 @@
 #include "utilities.h"
 #include <drogon/HttpAppFramework.h>
 
+const LogFormat Utilities::ORDER_RESPONSE{LogLevel::DEBUG, "[Response] {}\n{}"};
+const LogFormat Utilities::ORDER_BOOK_RESPONSE{LogLevel::DEBUG, "[Response] Order book\n{}"};
+const LogFormat Utilities::POSITIONS_RESPONSE{LogLevel::DEBUG, "[Response] Positions\n{}"};
+
 void Utilities::HandleExitSignal(const int signal)
 {
     std::cout << "\n[System] Exit signal received: " << signal << ". Shutting down Drogon...\n";
@@ -190,4 +194,35 @@ bool Utilities::IsParseJsonGood(const std::string& response, Json::Value& json_d
     }
 
     return true;
-}
\ No newline at end of file
+}
+
+void Utilities::DisplayLogRecord(const LogRecord& record)
+{
+    // A response cut to fit its record is no longer valid JSON, so it is only noted
+    if (!record.args.empty() && record.args.back().is_truncated)
+    {
+        if (record.format_id == ORDER_RESPONSE.GetId() || record.format_id == ORDER_BOOK_RESPONSE.GetId() ||
+            record.format_id == POSITIONS_RESPONSE.GetId())
+        {
+            std::cout << "Response too large to display; only its start was logged\n";
+        }
+        return;
+    }
+
+    if (record.format_id == ORDER_RESPONSE.GetId() && record.args.size() == 2)
+    {
+        if (!record.args[0].string_value.empty())
+        {
+            std::cout << record.args[0].string_value << "\n";
+        }
+        DisplayJsonResponse(std::string(record.args[1].string_value));
+    }
+    else if (record.format_id == ORDER_BOOK_RESPONSE.GetId() && record.args.size() == 1)
+    {
+        DisplayOrderBookJson(std::string(record.args[0].string_value));
+    }
+    else if (record.format_id == POSITIONS_RESPONSE.GetId() && record.args.size() == 1)
+    {
+        DisplayCurrentPositionsJson(std::string(record.args[0].string_value));
+    }
+}
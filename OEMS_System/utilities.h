@@ -3,9 +3,16 @@
 
 #include <drogon/drogon.h>
 
+#include "binary_logger.h"
+
 class Utilities
 {
   public:
+    // Responses logged with these are pretty-printed by DisplayLogRecord on the logger thread
+    static const LogFormat ORDER_RESPONSE;          // Heading, then an order or list of orders
+    static const LogFormat ORDER_BOOK_RESPONSE;
+    static const LogFormat POSITIONS_RESPONSE;
+
     static void HandleExitSignal(const int signal);
     static void DisplayJsonResponse(const std::string& response);
 
@@ -15,4 +22,7 @@ class Utilities
     static bool IsParseJsonGood(const std::string& response, Json::Value& json_data);
 
     static void DisplayOrderBookJson(const std::string& response);
+
+    // Consumer for BinaryLogger that displays the responses logged above
+    static void DisplayLogRecord(const LogRecord& record);
 };
@@ -1,142 +1,616 @@
 #include "web_socket_client.h"
 
-#include <chrono>
-#include <iomanip>
-#include <iostream>
-#include <sstream>
+#include <algorithm>
+#include <future>
+#include <utility>
 
-DrogonWebSocket::DrogonWebSocket() = default;
+#include <drogon/HttpAppFramework.h>
+
+#include "binary_logger.h"
+#include "market_data_decoder.h"
+#include "request_encoder.h"
+
+namespace
+{
+    const LogFormat LOG_CONNECTING{LogLevel::INFO, "[WebSocket] Connecting to Deribit WebSocket..."};
+    const LogFormat LOG_CONNECTED{LogLevel::INFO, "[WebSocket] Connected!"};
+    const LogFormat LOG_CONNECT_FAILED{LogLevel::ERR, "[WebSocket] Failed to connect: {}"};
+    const LogFormat LOG_EXCEPTION{LogLevel::ERR, "[WebSocket] Exception: {}"};
+    const LogFormat LOG_AUTH_EXCEPTION{LogLevel::ERR, "[WebSocket] Exception during authentication: {}"};
+    const LogFormat LOG_SKIPPED_PRIVATE{LogLevel::WARN,
+                                        "[WebSocket] Skipping {}: private channels need an authenticated connection"};
+    const LogFormat LOG_SUBSCRIBE_EXCEPTION{LogLevel::ERR, "[WebSocket] Exception during subscription: {}"};
+    const LogFormat LOG_AUTH_FAILED{LogLevel::ERR, "[WebSocket] Authentication failed: {}"};
+    const LogFormat LOG_AUTHENTICATED{LogLevel::INFO, "[WebSocket] Authenticated"};
+    const LogFormat LOG_REQUEST_FAILED{LogLevel::ERR, "[WebSocket] Request {} failed: {}"};
+    const LogFormat LOG_MESSAGE_EXCEPTION{LogLevel::ERR, "[WebSocket] Exception processing message: {}"};
+    const LogFormat LOG_SESSION_LOST{LogLevel::WARN, "[WebSocket] Session lost"};
+    const LogFormat LOG_HEARTBEAT_TIMEOUT{LogLevel::WARN,
+                                          "[WebSocket] Nothing received for {} checks, dropping session"};
+    const LogFormat LOG_RECONNECTING{LogLevel::INFO, "[WebSocket] Reconnecting in {} ms"};
+    const LogFormat LOG_RECOVERED{LogLevel::INFO, "[WebSocket] Recovered after {} ms, {} channels resubscribed"};
+
+    constexpr const char* WS_HOST = "wss://test.deribit.com";
+}
+
+DrogonWebSocket::DrogonWebSocket(const ApiCredentials* credentials, trantor::EventLoop* loop)
+    : api_credentials(credentials), event_loop(loop)
+{
+}
 
 DrogonWebSocket::~DrogonWebSocket()
 {
-    if (ws_client && is_connected)
+    // The reconnect state belongs to the app loop, so it is torn down there, and the destructor waits for it
+    trantor::EventLoop* loop = GetSupervisorLoop();
+    if (loop->isInLoopThread() || !loop->isRunning())
+    {
+        Shutdown();
+    }
+    else
+    {
+        std::promise<void> done;
+        loop->runInLoop(
+            [this, &done]()
+            {
+                Shutdown();
+                done.set_value();
+            });
+        done.get_future().wait();
+    }
+
+    // Whatever its closed callback queues now finds the token expired
+    const auto client = GetClient();
+    if (client)
     {
-        ws_client->stop();
+        client->stop();
     }
 }
 
-// Function to get the current timestamp in HH:MM:SS.mmm format
-std::string DrogonWebSocket::GetFormattedTimestamp()
+void DrogonWebSocket::SetRecorder(MarketDataRecorder* frame_recorder)
 {
-    const auto now = std::chrono::system_clock::now();
-    const auto now_time = std::chrono::system_clock::to_time_t(now);
-    const auto ms =
-        std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count() % 1000;
+    recorder = frame_recorder;
+}
 
-    struct tm timeinfo;
-    char timestamp[20];
-    localtime_s(&timeinfo, &now_time);
-    std::strftime(timestamp, sizeof(timestamp), "%H:%M:%S", &timeinfo);
+bool DrogonWebSocket::IsPrivateChannel(const std::string_view channel) noexcept
+{
+    return channel.compare(0, 5, "user.") == 0;
+}
+
+bool DrogonWebSocket::IsReady() const noexcept
+{
+    return is_connected && (!api_credentials || is_authenticated);
+}
 
-    std::stringstream ss;
-    ss << timestamp << "." << std::setfill('0') << std::setw(3) << ms;
-    return ss.str();
+std::shared_ptr<drogon::WebSocketClient> DrogonWebSocket::GetClient()
+{
+    std::lock_guard<std::mutex> lock(client_mutex);
+    return ws_client;
 }
 
-// Function to connect to the WebSocket server and subscribe to a symbol
-void DrogonWebSocket::ConnectToServer(const std::string& symbol)
+// The app loop, which the connection only shares when it was not given a loop of its own
+trantor::EventLoop* DrogonWebSocket::GetSupervisorLoop()
 {
-    ws_symbol = symbol;
+    return drogon::app().getLoop();
+}
 
+void DrogonWebSocket::Shutdown()
+{
+    is_stopping = true;
+    if (liveness_timer != 0)
+    {
+        GetSupervisorLoop()->invalidateTimer(liveness_timer);
+        liveness_timer = 0;
+    }
+    if (reconnect_timer != 0)
+    {
+        GetSupervisorLoop()->invalidateTimer(reconnect_timer);
+        reconnect_timer = 0;
+    }
+    alive_token.reset();
+}
+
+void DrogonWebSocket::AddConnectionListener(ConnectionListener listener)
+{
+    connection_listeners.push_back(std::move(listener));
+}
+
+// Function to open the connection; channels added before it is up are subscribed once it is ready
+void DrogonWebSocket::ConnectToServer()
+{
+    BinaryLogger::Write(LOG_CONNECTING);
+    OpenSession();
+    liveness_timer = GetSupervisorLoop()->runEvery(LIVENESS_CHECK_S, [this]() { CheckLiveness(); });
+}
+
+// Function to start a session on a fresh client, replacing the previous one
+void DrogonWebSocket::OpenSession()
+{
     try
     {
-        std::cout << GetFormattedTimestamp() << " Connecting to Deribit WebSocket...\n";
+        const uint64_t session_id = session.fetch_add(1) + 1;
+        connect_attempts.fetch_add(1, std::memory_order_relaxed);
+        // The client's callbacks may fire after the connection is gone, so what they queue checks this first
+        const std::weak_ptr<const bool> alive = alive_token;
 
         const auto req = drogon::HttpRequest::newHttpRequest();
         req->setPath("/ws/api/v2");
         req->setMethod(drogon::Get);
 
-        ws_client = drogon::WebSocketClient::newWebSocketClient("wss://test.deribit.com");
+        const auto client = drogon::WebSocketClient::newWebSocketClient(WS_HOST, event_loop);
 
-        ws_client->setMessageHandler(
+        client->setMessageHandler(
             [this](std::string&& msg, const drogon::WebSocketClientPtr& ws_ptr,
                    const drogon::WebSocketMessageType& type)
             {
                 HandleMessage(std::move(msg), ws_ptr, type);
             });
 
+        client->setConnectionClosedHandler(
+            [this, alive, session_id](const drogon::WebSocketClientPtr&)
+            {
+                GetSupervisorLoop()->queueInLoop(
+                    [this, alive, session_id]()
+                    {
+                        if (!alive.expired())
+                        {
+                            OnSessionLost(session_id);
+                        }
+                    });
+            });
+
         const drogon::WebSocketRequestCallback callback =
-            [this, symbol](const drogon::ReqResult& result, const drogon::HttpResponsePtr& resp,
-                           const drogon::WebSocketClientPtr& ws_conn)
+            [this, alive, session_id](const drogon::ReqResult& result, const drogon::HttpResponsePtr& resp,
+                                      const drogon::WebSocketClientPtr&)
         {
+            if (session_id != session.load())
+            {
+                return;
+            }
+
             if (result == drogon::ReqResult::Ok)
             {
                 is_connected = true;
-                std::cout << GetFormattedTimestamp() << " Connected!\n";
-                SubscribeToSymbol(symbol);
+                BinaryLogger::Write(LOG_CONNECTED);
+                if (api_credentials)
+                {
+                    Authenticate();
+                }
+                else
+                {
+                    OnReady();
+                }
             }
             else
             {
-                std::cerr << GetFormattedTimestamp()
-                          << " Failed to connect: " << (resp ? std::to_string(resp->getStatusCode()) : "N/A")
-                          << "\n";
+                if (resp)
+                {
+                    BinaryLogger::Write(LOG_CONNECT_FAILED, static_cast<int>(resp->getStatusCode()));
+                }
+                else
+                {
+                    BinaryLogger::Write(LOG_CONNECT_FAILED, "N/A");
+                }
+                GetSupervisorLoop()->queueInLoop(
+                    [this, alive, session_id]()
+                    {
+                        if (!alive.expired())
+                        {
+                            OnSessionLost(session_id);
+                        }
+                    });
             }
         };
 
-        ws_client->connectToServer(req, callback);
+        std::shared_ptr<drogon::WebSocketClient> previous;
+        {
+            std::lock_guard<std::mutex> lock(client_mutex);
+            previous = std::exchange(ws_client, client);
+        }
+        // Its closed callback now carries an old session, so stopping it does not count as another loss
+        if (previous)
+        {
+            previous->stop();
+        }
+        client->connectToServer(req, callback);
+    }
+    catch (const std::exception& e)
+    {
+        // The session already counts as started, so the liveness check will give up on it and retry
+        BinaryLogger::Write(LOG_EXCEPTION, e.what());
+    }
+}
+
+// Function to give up on a session that closed, failed to connect or went silent, and schedule the next one
+void DrogonWebSocket::OnSessionLost(const uint64_t lost_session)
+{
+    if (is_stopping || lost_session != session.load())
+    {
+        return;
+    }
+
+    // Anything the lost client still reports is now stale
+    session.fetch_add(1);
+    is_connected = false;
+    is_authenticated = false;
+
+    int64_t was_up = 0;
+    if (disconnected_at_ns.compare_exchange_strong(was_up, LatencyRecorder::NowNs()))
+    {
+        reconnect_backoff.Reset();
+        disconnects.fetch_add(1, std::memory_order_relaxed);
+        BinaryLogger::Write(LOG_SESSION_LOST);
+        for (const auto& listener : connection_listeners)
+        {
+            listener(ConnectionEvent::DISCONNECTED);
+        }
+    }
+
+    const std::chrono::milliseconds delay = reconnect_backoff.Next();
+    if (delay.count() == 0)
+    {
+        OpenSession();
+        return;
+    }
+    BinaryLogger::Write(LOG_RECONNECTING, delay.count());
+    reconnect_timer = GetSupervisorLoop()->runAfter(std::chrono::duration<double>(delay).count(),
+                                                    [this]()
+                                                    {
+                                                        reconnect_timer = 0;
+                                                        OpenSession();
+                                                    });
+}
+
+// Function to notice a session that has gone quiet: a heartbeat or any other frame keeps it alive, otherwise it
+// is probed and then dropped. A handshake that never completes is dropped the same way.
+void DrogonWebSocket::CheckLiveness()
+{
+    const uint64_t current_session = session.load();
+    const uint64_t frames = frames_received.load(std::memory_order_relaxed);
+    if (current_session != checked_session || frames != checked_frames)
+    {
+        checked_session = current_session;
+        checked_frames = frames;
+        silent_checks = 0;
+        return;
+    }
+
+    ++silent_checks;
+    if (silent_checks == PROBE_AFTER_CHECKS && is_connected)
+    {
+        SendRpc("public/test", "{}");
+    }
+    else if (silent_checks >= DEAD_AFTER_CHECKS && reconnect_timer == 0)
+    {
+        heartbeat_timeouts.fetch_add(1, std::memory_order_relaxed);
+        BinaryLogger::Write(LOG_HEARTBEAT_TIMEOUT, silent_checks);
+        silent_checks = 0;
+        OnSessionLost(current_session);
+    }
+}
+
+void DrogonWebSocket::SendRpc(const std::string_view method, const std::string_view params)
+{
+    const auto client = GetClient();
+    if (!client || !client->getConnection())
+    {
+        return;
+    }
+
+    std::string msg = R"({"jsonrpc":"2.0","id":)";
+    msg += std::to_string(next_request_id.fetch_add(1, std::memory_order_relaxed));
+    msg += R"(,"method":")";
+    msg += method;
+    msg += R"(","params":)";
+    msg += params;
+    msg += '}';
+    client->getConnection()->send(msg);
+}
+
+void DrogonWebSocket::Authenticate()
+{
+    const uint64_t id = next_request_id.fetch_add(1, std::memory_order_relaxed);
+    auth_request_id = id;
+
+    RequestEncoder& encoder = RequestEncoder::ThreadLocal();
+    encoder.BeginJsonRpc(Endpoints::AUTH, id);
+    encoder.AddJsonParam("grant_type", "client_credentials");
+    encoder.AddJsonParam("client_id", api_credentials->GetApiKey());
+    encoder.AddJsonParam("client_secret", api_credentials->GetApiSecret());
+    encoder.EndJsonRpc();
+
+    try
+    {
+        const std::string_view msg = encoder.View();
+        GetClient()->getConnection()->send(msg.data(), msg.size());
     }
     catch (const std::exception& e)
     {
-        std::cerr << GetFormattedTimestamp() << " Exception: " << e.what() << "\n";
+        BinaryLogger::Write(LOG_AUTH_EXCEPTION, e.what());
+    }
+}
+
+// Function to subscribe every tracked channel in one request once the connection can carry them, which after a
+// reconnect also makes the exchange send fresh snapshots
+void DrogonWebSocket::OnReady()
+{
+    size_t channel_count = 0;
+    {
+        std::lock_guard<std::mutex> lock(channels_mutex);
+        pending_unsubscribe.clear();
+        pending_subscribe.clear();
+        pending_subscribe.reserve(ws_channels.size());
+        for (const auto& channel : ws_channels)
+        {
+            pending_subscribe.push_back(channel.second->name);
+        }
+        channel_count = pending_subscribe.size();
+    }
+    FlushPendingRequests();
+    SendRpc("public/set_heartbeat", "{\"interval\":" + std::to_string(HEARTBEAT_INTERVAL_S) + "}");
+
+    const int64_t down_since = disconnected_at_ns.exchange(0);
+    if (down_since != 0)
+    {
+        const int64_t recovery_ns = LatencyRecorder::NowNs() - down_since;
+        recovery_histogram.Record(recovery_ns);
+        BinaryLogger::Write(LOG_RECOVERED, recovery_ns / 1000000, channel_count);
+        for (const auto& listener : connection_listeners)
+        {
+            listener(ConnectionEvent::RECONNECTED);
+        }
+    }
+}
+
+void DrogonWebSocket::Subscribe(const std::vector<std::string>& channels, const ChannelHandler& handler)
+{
+    {
+        std::lock_guard<std::mutex> lock(channels_mutex);
+        for (const auto& channel : channels)
+        {
+            // Dispatch may still hold the old entry, so replace it rather than mutating it
+            auto entry = std::make_shared<ChannelEntry>(ChannelEntry{channel, handler});
+            const bool is_new = ws_channels.erase(channel) == 0;
+            ws_channels.emplace(entry->name, std::move(entry));
+
+            if (is_new)
+            {
+                const auto it = std::find(pending_unsubscribe.begin(), pending_unsubscribe.end(), channel);
+                if (it != pending_unsubscribe.end())
+                {
+                    pending_unsubscribe.erase(it);
+                }
+                else
+                {
+                    pending_subscribe.push_back(channel);
+                }
+            }
+        }
+    }
+    ScheduleFlush();
+}
+
+void DrogonWebSocket::Unsubscribe(const std::vector<std::string>& channels)
+{
+    {
+        std::lock_guard<std::mutex> lock(channels_mutex);
+        for (const auto& channel : channels)
+        {
+            if (ws_channels.erase(channel) == 0)
+            {
+                continue;
+            }
+
+            const auto it = std::find(pending_subscribe.begin(), pending_subscribe.end(), channel);
+            if (it != pending_subscribe.end())
+            {
+                pending_subscribe.erase(it);
+            }
+            else
+            {
+                pending_unsubscribe.push_back(channel);
+            }
+        }
+    }
+    ScheduleFlush();
+}
+
+void DrogonWebSocket::Resubscribe(const std::vector<std::string>& channels)
+{
+    {
+        std::lock_guard<std::mutex> lock(channels_mutex);
+        for (const auto& channel : channels)
+        {
+            if (ws_channels.count(channel) != 0 &&
+                std::find(pending_subscribe.begin(), pending_subscribe.end(), channel) == pending_subscribe.end())
+            {
+                pending_unsubscribe.push_back(channel);
+                pending_subscribe.push_back(channel);
+            }
+        }
+    }
+    ScheduleFlush();
+}
+
+size_t DrogonWebSocket::GetChannelCount()
+{
+    std::lock_guard<std::mutex> lock(channels_mutex);
+    return ws_channels.size();
+}
+
+trantor::EventLoop* DrogonWebSocket::GetLoop() const
+{
+    return event_loop ? event_loop : drogon::app().getLoop();
+}
+
+ConnectionStats DrogonWebSocket::GetConnectionStats() const noexcept
+{
+    return {disconnects.load(std::memory_order_relaxed), heartbeat_timeouts.load(std::memory_order_relaxed),
+            connect_attempts.load(std::memory_order_relaxed), recovery_histogram.GetSummary()};
+}
+
+// Function to send the accumulated changes from the event loop, so a burst of calls becomes one request each way
+void DrogonWebSocket::ScheduleFlush()
+{
+    if (!IsReady())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(channels_mutex);
+        if (is_flush_scheduled)
+        {
+            return;
+        }
+        is_flush_scheduled = true;
+    }
+    GetLoop()->queueInLoop([this]() { FlushPendingRequests(); });
+}
+
+void DrogonWebSocket::FlushPendingRequests()
+{
+    std::vector<std::string> subscribe;
+    std::vector<std::string> unsubscribe;
+    {
+        std::lock_guard<std::mutex> lock(channels_mutex);
+        is_flush_scheduled = false;
+        subscribe.swap(pending_subscribe);
+        unsubscribe.swap(pending_unsubscribe);
+    }
+
+    // Unsubscribes go first so that a resubscribe ends up subscribed
+    if (!unsubscribe.empty())
+    {
+        SendChannelRequest(false, unsubscribe);
+    }
+    if (!subscribe.empty())
+    {
+        SendChannelRequest(true, subscribe);
     }
 }
 
-// Function to subscribe to a symbol on the WebSocket server
-void DrogonWebSocket::SubscribeToSymbol(const std::string& symbol)
+void DrogonWebSocket::SendChannelRequest(const bool subscribe, const std::vector<std::string>& channels)
 {
     try
     {
+        const bool is_private = api_credentials != nullptr;
         Json::Value msg;
         msg["jsonrpc"] = "2.0";
-        msg["method"] = "public/subscribe";
+        msg["method"] = is_private ? (subscribe ? "private/subscribe" : "private/unsubscribe")
+                                   : (subscribe ? "public/subscribe" : "public/unsubscribe");
         msg["params"]["channels"] = Json::Value(Json::arrayValue);
-        msg["params"]["channels"].append("ticker." + symbol + ".100ms");
-        msg["id"] = 0;
+        for (const auto& channel : channels)
+        {
+            if (!is_private && IsPrivateChannel(channel))
+            {
+                BinaryLogger::Write(LOG_SKIPPED_PRIVATE, channel);
+                continue;
+            }
+            msg["params"]["channels"].append(channel);
+        }
+        if (msg["params"]["channels"].empty())
+        {
+            return;
+        }
+        msg["id"] = Json::UInt64(next_request_id.fetch_add(1, std::memory_order_relaxed));
 
         const Json::StreamWriterBuilder writer;
         const std::string msg_str = Json::writeString(writer, msg);
-        const drogon::WebSocketConnectionPtr& ws_conn = ws_client->getConnection();
-        ws_conn->send(msg_str);
-        std::cout << GetFormattedTimestamp() << " Subscription request sent for: " << symbol << "\n";
+        const auto client = GetClient();
+        if (client && client->getConnection())
+        {
+            client->getConnection()->send(msg_str);
+        }
     }
     catch (const std::exception& e)
     {
-        std::cerr << GetFormattedTimestamp() << " Exception during subscription: " << e.what() << "\n";
+        BinaryLogger::Write(LOG_SUBSCRIBE_EXCEPTION, e.what());
     }
 }
 
 // Function to handle incoming messages from the WebSocket server
 void DrogonWebSocket::HandleMessage(std::string&& msg, const drogon::WebSocketClientPtr& ws_ptr,
                                     const drogon::WebSocketMessageType& type)
+{
+    // Pongs and heartbeats count too; only this loop writes the counter, so no read-modify-write is needed
+    frames_received.store(frames_received.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (type == drogon::WebSocketMessageType::Text)
+    {
+        ReceiveFrame(msg);
+    }
+}
+
+void DrogonWebSocket::ReceiveFrame(const std::string_view frame)
+{
+    if (recorder)
+    {
+        recorder->Record(frame);
+    }
+    DispatchFrame(frame);
+}
+
+void DrogonWebSocket::HandleReply(const std::string_view frame)
+{
+    uint64_t id = 0;
+    bool is_error = false;
+    if (!MarketDataDecoder::DecodeReply(frame, id, is_error))
+    {
+        bool is_test_request = false;
+        if (MarketDataDecoder::DecodeHeartbeat(frame, is_test_request) && is_test_request)
+        {
+            SendRpc("public/test", "{}");
+        }
+        return;
+    }
+
+    if (id == auth_request_id.load())
+    {
+        if (is_error)
+        {
+            BinaryLogger::Write(LOG_AUTH_FAILED, frame);
+            return;
+        }
+        is_authenticated = true;
+        BinaryLogger::Write(LOG_AUTHENTICATED);
+        OnReady();
+    }
+    else if (is_error)
+    {
+        BinaryLogger::Write(LOG_REQUEST_FAILED, id, frame);
+    }
+}
+
+void DrogonWebSocket::DispatchFrame(const std::string_view frame)
 {
     try
     {
-        if (type == drogon::WebSocketMessageType::Text)
+        // Only the channel and the bounds of its data are located here; decoding is left to the handler
+        std::string_view channel;
+        std::string_view data;
+        if (!MarketDataDecoder::DecodeNotification(frame, channel, data))
         {
-            Json::Value json_data;
-            const Json::CharReaderBuilder reader_builder;
-            std::string errs;
-            std::istringstream s(msg);
+            HandleReply(frame);
+            return;
+        }
 
-            if (Json::parseFromStream(reader_builder, s, &json_data, &errs))
-            {
-                if (json_data.isMember("params"))
-                {
-                    const auto& params = json_data["params"];
-                    if (params.isMember("channel") && params.isMember("data"))
-                    {
-                        std::cout << GetFormattedTimestamp() << " " << params["channel"].asString() << "\n";
-                    }
-                }
-            }
-            else
+        std::shared_ptr<ChannelEntry> entry;
+        {
+            std::lock_guard<std::mutex> lock(channels_mutex);
+            const auto it = ws_channels.find(channel);
+            if (it != ws_channels.end())
             {
-                std::cerr << GetFormattedTimestamp() << " Failed to parse message: " << errs << "\n";
+                entry = it->second;
             }
         }
+
+        // The handler runs unlocked so it may change subscriptions itself
+        if (entry && entry->handler)
+        {
+            entry->handler(channel, data);
+        }
     }
     catch (const std::exception& e)
     {
-        std::cerr << GetFormattedTimestamp() << " Exception processing message: " << e.what() << "\n";
+        BinaryLogger::Write(LOG_MESSAGE_EXCEPTION, e.what());
     }
 }
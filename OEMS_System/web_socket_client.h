@@ -1,24 +1,164 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 #include <drogon/WebSocketClient.h>
 #include <json/json.h>
 
+#include "api_credentials.h"
+#include "latency_recorder.h"
+#include "market_data_recorder.h"
+#include "reconnect_backoff.h"
+
+enum class ConnectionEvent
+{
+    DISCONNECTED,    // The session closed, failed or went silent; nothing arrives until RECONNECTED
+    RECONNECTED      // A new session is up and every channel has been subscribed again
+};
+
+struct ConnectionStats
+{
+    uint64_t disconnects;
+    uint64_t heartbeat_timeouts;     // Sessions given up on because nothing arrived, not even a probe reply
+    uint64_t connect_attempts;
+    LatencySummary recovery;         // Loss detected until the channels were subscribed again
+};
+
+// One market-data connection carrying any number of channels, each routed to its own handler.
+//
+// Liveness comes from the exchange's heartbeat: any frame proves the session is alive, a quiet one is
+// probed with public/test, and one that stays silent is dropped. A lost session is replaced straight away,
+// then with jittered exponential backoff while attempts keep failing. Checks and reconnects run on the Drogon
+// app loop, so a dead or reconnecting session never stalls the connection's own loop.
 class DrogonWebSocket
 {
+  public:
+    // data is the raw "params.data" member of the frame and is only valid for the duration of the call
+    using ChannelHandler = std::function<void(std::string_view channel, std::string_view data)>;
+    // DISCONNECTED is called on the app loop, RECONNECTED on the connection's loop after the resubscribe
+    using ConnectionListener = std::function<void(ConnectionEvent event)>;
+
+    static constexpr int HEARTBEAT_INTERVAL_S = 10;    // The shortest public/set_heartbeat accepts
+    static constexpr double LIVENESS_CHECK_S = 1.0;
+    static constexpr int PROBE_AFTER_CHECKS = 2;       // Silent checks before public/test is sent
+    static constexpr int DEAD_AFTER_CHECKS = 4;        // Silent checks before the session is dropped
+    static constexpr std::chrono::milliseconds RECONNECT_BACKOFF_MIN{100};
+    static constexpr std::chrono::milliseconds RECONNECT_BACKOFF_MAX{5000};
+
   private:
+    struct ChannelEntry
+    {
+        std::string name;
+        ChannelHandler handler;
+    };
+
+    // Replaced on every reconnect, so it is read and swapped under client_mutex
+    std::mutex client_mutex;
     std::shared_ptr<drogon::WebSocketClient> ws_client;
-    std::string ws_symbol;
-    bool is_connected{false};
+    const ApiCredentials* api_credentials;
+    trantor::EventLoop* event_loop;
+    MarketDataRecorder* recorder{nullptr};
+    std::atomic<bool> is_connected{false};
+    std::atomic<bool> is_authenticated{false};
+    std::atomic<bool> is_stopping{false};
+    std::atomic<uint64_t> next_request_id{1};
+    std::atomic<uint64_t> auth_request_id{0};
+    // Callbacks from a client that has since been replaced carry an older session and are ignored
+    std::atomic<uint64_t> session{0};
+    // Written only by the connection's loop; the liveness check just compares it with its last reading
+    std::atomic<uint64_t> frames_received{0};
+    std::vector<ConnectionListener> connection_listeners;
+
+    // Reconnect state, only touched on the app loop
+    // Reset on the app loop when the connection is torn down; work queued there holds it weakly and does
+    // nothing once it has expired
+    std::shared_ptr<const bool> alive_token{std::make_shared<const bool>(true)};
+    trantor::TimerId liveness_timer{0};
+    trantor::TimerId reconnect_timer{0};
+    uint64_t checked_session{0};
+    uint64_t checked_frames{0};
+    int silent_checks{0};
+    ReconnectBackoff reconnect_backoff{RECONNECT_BACKOFF_MIN, RECONNECT_BACKOFF_MAX};
+
+    // Start of the current outage, 0 while the session is up
+    std::atomic<int64_t> disconnected_at_ns{0};
+    std::atomic<uint64_t> disconnects{0};
+    std::atomic<uint64_t> heartbeat_timeouts{0};
+    std::atomic<uint64_t> connect_attempts{0};
+    LatencyHistogram recovery_histogram;
 
-    static std::string GetFormattedTimestamp();
-    void SubscribeToSymbol(const std::string& symbol);
+    std::mutex channels_mutex;
+    // Keys view the name owned by their entry, so lookups straight from the frame need no copy
+    std::unordered_map<std::string_view, std::shared_ptr<ChannelEntry>> ws_channels;
+    std::vector<std::string> pending_subscribe;
+    std::vector<std::string> pending_unsubscribe;
+    bool is_flush_scheduled{false};
+
+    static bool IsPrivateChannel(std::string_view channel) noexcept;
+
+    bool IsReady() const noexcept;
+    std::shared_ptr<drogon::WebSocketClient> GetClient();
+    static trantor::EventLoop* GetSupervisorLoop();
+    // Stops the reconnect machinery; runs on the app loop
+    void Shutdown();
+    void OpenSession();
+    void OnSessionLost(uint64_t lost_session);
+    void CheckLiveness();
+    void SendRpc(std::string_view method, std::string_view params);
+    void Authenticate();
+    void OnReady();
+    void ScheduleFlush();
+    void FlushPendingRequests();
+    void SendChannelRequest(bool subscribe, const std::vector<std::string>& channels);
+    void HandleReply(std::string_view frame);
     void HandleMessage(std::string&& msg, const drogon::WebSocketClientPtr& ws_ptr,
                        const drogon::WebSocketMessageType& type);
 
   public:
-    DrogonWebSocket();
+    // With credentials the connection authenticates first, which private channels (user.*) require. Frames
+    // are handled on loop, or on the Drogon app loop if none is given.
+    explicit DrogonWebSocket(const ApiCredentials* credentials = nullptr, trantor::EventLoop* loop = nullptr);
     ~DrogonWebSocket();
-    void ConnectToServer(const std::string& symbol);
+
+    DrogonWebSocket(const DrogonWebSocket&) = delete;
+    DrogonWebSocket& operator=(const DrogonWebSocket&) = delete;
+
+    // Every text frame is handed to the recorder before it is dispatched; must be set before connecting
+    void SetRecorder(MarketDataRecorder* frame_recorder);
+
+    // Listeners must be added before ConnectToServer
+    void AddConnectionListener(ConnectionListener listener);
+
+    // Opens the connection and keeps it open, reconnecting whenever the session is lost
+    void ConnectToServer();
+
+    ConnectionStats GetConnectionStats() const noexcept;
+
+    // Calls made in quick succession are coalesced into a single subscribe request on the event loop.
+    // Subscribing to a channel that is already tracked only replaces its handler.
+    void Subscribe(const std::vector<std::string>& channels, const ChannelHandler& handler);
+    void Unsubscribe(const std::vector<std::string>& channels);
+
+    // Unsubscribes and subscribes again, keeping the handlers, so the exchange resends a snapshot
+    void Resubscribe(const std::vector<std::string>& channels);
+
+    size_t GetChannelCount();
+
+    // The loop frames are handled on, for timers that must not run alongside the channel handlers
+    trantor::EventLoop* GetLoop() const;
+
+    // Everything the connection does with a text frame it receives: record it, then dispatch it. Replay feeds
+    // captured frames in here so they take the same path as live ones.
+    void ReceiveFrame(std::string_view frame);
+
+    // Routes one text frame exactly as if it had arrived on the socket
+    void DispatchFrame(std::string_view frame);
 };